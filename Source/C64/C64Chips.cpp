@@ -68,6 +68,7 @@
 #include "C64Display.h"
 #include "C64GamesList.h"
 #include <Util/Misc.h>
+#include <Util/EmuScheduler.h>
 #include <algorithm>
 
 class FC64Emulator : public ICPUInterface
@@ -137,6 +138,7 @@ private:
     c64_t       C64Emu;
     ui_c64_t    C64UI;
     double      ExecTime;
+    FEmuScheduler   EmuScheduler;   // runs whole frames at a fixed rate independent of the UI
 
     FC64GamesList       GamesList;
     const FGameInfo*    CurrentGame = nullptr;
@@ -444,10 +446,10 @@ bool FC64Emulator::Init()
 void FC64Emulator::SetupCodeAnalysisLabels()
 {
     // Add IO Labels to code analysis
-    AddVICRegisterLabels(IOSystem[0]);  // Page $D000-$D3ff
-    AddSIDRegisterLabels(IOSystem[1]);  // Page $D400-$D7ff
-    IOSystem[2].SetLabelAtAddress("ColourRAM", ELabelType::Data, 0x0000);    // Colour RAM $D800
-    AddCIARegisterLabels(IOSystem[3]);  // Page $DC00-$Dfff
+    AddVICRegisterLabels(CodeAnalysis, IOSystem[0]);  // Page $D000-$D3ff
+    AddSIDRegisterLabels(CodeAnalysis, IOSystem[1]);  // Page $D400-$D7ff
+    IOSystem[2].SetLabelAtAddress(CodeAnalysis, "ColourRAM", ELabelType::Data, 0x0000);    // Colour RAM $D800
+    AddCIARegisterLabels(CodeAnalysis, IOSystem[3]);  // Page $DC00-$Dfff
 }
 
 void FC64Emulator::UpdateCodeAnalysisPages(uint8_t cpuPort)
@@ -666,16 +668,27 @@ void FC64Emulator::Shutdown()
     c64_discard(&C64Emu);
 }
 
+// PAL frame - 312 lines of 63 cycles
+static const uint32_t kC64FrameMicroSeconds = (uint32_t)((312ull * 63 * 1000000) / C64_FREQUENCY);
+
 void FC64Emulator::Tick()
 {
-    const float frameTime = (float)std::min(1000000.0f / ImGui::GetIO().Framerate, 32000.0f) * 1.0f;// speccyInstance.ExecSpeedScale;
     FCodeAnalysisViewState& viewState =  CodeAnalysis.GetFocussedViewState();
 
-    c64_exec(&C64Emu, (uint32_t)std::max(static_cast<uint32_t>(frameTime), uint32_t(1)));
+    EmuScheduler.SetFrameTime(kC64FrameMicroSeconds);
+    EmuScheduler.BeginUpdate();
+    while (EmuScheduler.ShouldRunFrame())
+        c64_exec(&C64Emu, EmuScheduler.GetFrameTime());
+
+    // carry on with any long analysis passes between frames
+    CodeAnalysis.AnalysisJobs.Update(CodeAnalysis);
 
     ui_c64_draw(&C64UI);
     if (ImGui::Begin("C64 Screen"))
     {
+        ImGui::Checkbox("Turbo", EmuScheduler.GetTurboPtr());
+        ImGui::SameLine();
+        ImGui::Text("Emulation speed x%.1f", EmuScheduler.GetEmulationSpeed());
         ImGui::Text("Mapped: ");
         if (bBasicROMMapped)
         {
@@ -87,11 +87,11 @@ void	FSIDAnalysis::DrawUI(void)
 	ImGui::EndChild();
 }
 
-void AddSIDRegisterLabels(FCodeAnalysisPage& IOPage)
+void AddSIDRegisterLabels(FCodeAnalysisState& state, FCodeAnalysisPage& IOPage)
 {
 	std::vector<FRegDisplayConfig>& regList = g_SIDRegDrawInfo;
 
 	for (int reg = 0; reg < (int)regList.size(); reg++)
-		IOPage.SetLabelAtAddress(regList[reg].Name, ELabelType::Data, reg);
+		IOPage.SetLabelAtAddress(state, regList[reg].Name, ELabelType::Data, reg);
 
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "AnalysisJobs.h"
+#include "CodeAnalyser.h"
+#include "AnalysisPageDatabase.h"
+
+#include <algorithm>
+#include <chrono>
+
+bool FAddressRangeJob::Step(FCodeAnalysisState& state)
+{
+	const int endAddr = std::min(NextAddress + kAddressesPerStep, 1 << 16);
+	NextAddress = ProcessRange(state, NextAddress, endAddr);
+	return NextAddress >= (1 << 16);
+}
+
+int FReAnalyseCodeJob::ProcessRange(FCodeAnalysisState& state, int startAddr, int endAddr)
+{
+	FAnalysisPageDatabase* pDatabase = bFixUpsAreSaved ? state.pAnalysisDatabase : nullptr;
+	if (pDatabase == nullptr)
+		return ReAnalyseCodeRange(state, startAddr, endAddr);
+
+	// an instruction at the end of the range can run on into the next page
+	const int kMaxInstructionSize = 4;
+	const int firstPage = startAddr >> FCodeAnalysisPage::kPageShift;
+	const int lastPage = (std::min(endAddr + kMaxInstructionSize, 1 << 16) - 1) >> FCodeAnalysisPage::kPageShift;
+	const FCodeAnalysisPage* pSavedPages[FCodeAnalysisState::kNoPagesInAddressSpace] = { nullptr };
+	for (int pageNo = firstPage; pageNo <= lastPage; pageNo++)
+	{
+		const FCodeAnalysisPage* pPage = state.GetReadPage(pageNo << FCodeAnalysisPage::kPageShift);
+		if (pPage != nullptr && pDatabase->IsPageSaved(*pPage))
+			pSavedPages[pageNo] = pPage;
+	}
+
+	const int nextAddr = ReAnalyseCodeRange(state, startAddr, endAddr);
+
+	for (int pageNo = firstPage; pageNo <= lastPage; pageNo++)
+	{
+		if (pSavedPages[pageNo] != nullptr)
+			pDatabase->ClearChangedPage(*pSavedPages[pageNo]);
+	}
+	return nextAddr;
+}
+
+int FResetReferenceInfoJob::ProcessRange(FCodeAnalysisState& state, int startAddr, int endAddr)
+{
+	ResetReferenceInfoRange(state, startAddr, endAddr);
+	return endAddr;
+}
+
+void FAnalysisJobQueue::AddJob(std::unique_ptr<FAnalysisJob> pJob)
+{
+	Jobs.push_back(std::move(pJob));
+}
+
+bool FAnalysisJobQueue::StepCurrentJob(FCodeAnalysisState& state)
+{
+	FAnalysisJob* pJob = Jobs.front().get();
+	if (pJob->Step(state) == false)
+		return false;
+
+	// keep the job alive for the callback
+	std::unique_ptr<FAnalysisJob> pFinishedJob = std::move(Jobs.front());
+	Jobs.pop_front();
+	if (pFinishedJob->OnFinished)
+		pFinishedJob->OnFinished(state);
+	return true;
+}
+
+void FAnalysisJobQueue::Update(FCodeAnalysisState& state, double timeBudgetMS)
+{
+	typedef std::chrono::steady_clock FClock;
+	const FClock::time_point startTime = FClock::now();
+
+	while (Jobs.empty() == false)
+	{
+		StepCurrentJob(state);
+
+		const double elapsedMS = std::chrono::duration<double, std::milli>(FClock::now() - startTime).count();
+		if (elapsedMS >= timeBudgetMS)
+			break;
+	}
+}
+
+void FAnalysisJobQueue::RunAll(FCodeAnalysisState& state)
+{
+	while (Jobs.empty() == false)
+		StepCurrentJob(state);
+}
+
+void FAnalysisJobQueue::Clear()
+{
+	Jobs.clear();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+class FCodeAnalysisState;
+
+// Long running analysis pass that's done a slice at a time so it doesn't hold up the UI
+class FAnalysisJob
+{
+public:
+	virtual ~FAnalysisJob() = default;
+
+	virtual const char*	GetName() const = 0;
+	virtual bool		Step(FCodeAnalysisState& state) = 0;	// do a slice of the work, returns true when the job has finished
+	virtual float		GetProgress() const = 0;	// 0-1
+
+	std::function<void(FCodeAnalysisState&)>	OnFinished;	// optional
+};
+
+// Job that goes through the whole address space in blocks
+class FAddressRangeJob : public FAnalysisJob
+{
+public:
+	static const int kAddressesPerStep = 1024;
+
+	bool	Step(FCodeAnalysisState& state) override;
+	float	GetProgress() const override { return (float)NextAddress / (float)(1 << 16); }
+
+protected:
+	// returns the address to carry on from, which can be past the end of the range
+	virtual int	ProcessRange(FCodeAnalysisState& state, int startAddr, int endAddr) = 0;
+
+	int		NextAddress = 0;
+};
+
+class FReAnalyseCodeJob : public FAddressRangeJob
+{
+public:
+	FReAnalyseCodeJob(bool bFixUpsAreSaved = false) : bFixUpsAreSaved(bFixUpsAreSaved) {}
+
+	const char*	GetName() const override { return "Re-analysing code"; }
+protected:
+	int	ProcessRange(FCodeAnalysisState& state, int startAddr, int endAddr) override;
+
+	// for the pass done on load - fix ups to pages that haven't been edited since don't need saving
+	bool	bFixUpsAreSaved = false;
+};
+
+class FResetReferenceInfoJob : public FAddressRangeJob
+{
+public:
+	const char*	GetName() const override { return "Resetting reference info"; }
+protected:
+	int	ProcessRange(FCodeAnalysisState& state, int startAddr, int endAddr) override;
+};
+
+// Jobs are run in the order they were added, from the main thread between emulated frames.
+// Each update works through as many steps as fit in the time budget.
+class FAnalysisJobQueue
+{
+public:
+	static constexpr double kDefaultTimeBudgetMS = 4.0;
+
+	void	AddJob(std::unique_ptr<FAnalysisJob> pJob);
+	void	Update(FCodeAnalysisState& state, double timeBudgetMS = kDefaultTimeBudgetMS);
+	void	RunAll(FCodeAnalysisState& state);	// finish everything now, for batch tools & tests
+	void	Clear();
+
+	bool	IsBusy() const { return Jobs.empty() == false; }
+	int		GetNoJobs() const { return (int)Jobs.size(); }
+	const FAnalysisJob*	GetCurrentJob() const { return Jobs.empty() ? nullptr : Jobs.front().get(); }
+
+private:
+	bool	StepCurrentJob(FCodeAnalysisState& state);
+
+	std::deque<std::unique_ptr<FAnalysisJob>>	Jobs;
+};
@@ -0,0 +1,505 @@
+#include "AnalysisPageDatabase.h"
+#include "CodeAnalyser.h"
+#include "CodeAnalysisPage.h"
+#include "CodeAnalysisState.h"
+#include "Debug/DebugLog.h"
+
+#include <json.hpp>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using json = nlohmann::json;
+
+// from CodeAnalysisJson.cpp
+void WritePageToJson(const FCodeAnalysisPage& page, json& jsonDoc);
+void ReadPageFromJson(FCodeAnalysisState& state, FCodeAnalysisPage& page, const json& jsonDoc);
+void WriteAnalysisGlobalsToJson(FCodeAnalysisState& state, json& jsonDoc, bool bROMS);
+bool ImportAnalysisJsonDoc(FCodeAnalysisState& state, const json& jsonGameData);
+
+static const uint32_t kPageDatabaseMagic = 0x42445041;	// 'APDB'
+static const uint32_t kPageDatabaseVersion = 1;
+static const int16_t kGlobalsRecordId = -1;			// bank descriptions, character sets & maps
+static const uint32_t kMinStaleBytesToCompact = 64 * 1024;
+
+struct FPageDatabaseHeader
+{
+	uint32_t	Magic = kPageDatabaseMagic;
+	uint32_t	Version = kPageDatabaseVersion;
+	uint32_t	DirectoryOffset = 0;
+	uint32_t	NoDirectoryEntries = 0;
+};
+
+struct FPageDirectoryEntry
+{
+	int16_t		PageId = 0;
+	uint16_t	Pad = 0;
+	uint32_t	Offset = 0;
+	uint32_t	Size = 0;
+};
+
+static uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+{
+	const uint8_t* pBytes = (const uint8_t*)pData;
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ pBytes[i]) * 0x100000001b3ull;
+	return hash;
+}
+
+template <typename T>
+static uint64_t HashValue(uint64_t hash, const T& value)
+{
+	return HashBytes(hash, &value, sizeof(T));
+}
+
+static uint64_t HashString(uint64_t hash, const std::string& str)
+{
+	hash = HashBytes(hash, str.data(), str.size());
+	return HashValue(hash, (uint8_t)0);	// so neighbouring strings don't run together
+}
+
+// Covers everything WritePageToJson saves, so a page that hashes the same as when it was last saved doesn't need writing.
+// Hashing the page is much cheaper than serialising it.
+static uint64_t HashPageAnnotations(const FCodeAnalysisPage& page)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (int pageAddr = 0; pageAddr < FCodeAnalysisPage::kPageSize; pageAddr++)
+	{
+		const FLabelInfo* pLabelInfo = page.Labels[pageAddr];
+		const FCodeInfo* pCodeInfo = page.CodeInfo[pageAddr];
+		const FCommentBlock* pCommentBlock = page.CommentBlocks[pageAddr];
+		const uint8_t itemMask = (pLabelInfo != nullptr ? 1 : 0) | (pCodeInfo != nullptr ? 2 : 0) | (pCommentBlock != nullptr ? 4 : 0);
+		hash = HashValue(hash, itemMask);
+
+		if (pLabelInfo != nullptr)
+		{
+			hash = HashString(hash, pLabelInfo->Name);
+			hash = HashValue(hash, pLabelInfo->Global);
+			hash = HashValue(hash, pLabelInfo->LabelType);
+			hash = HashString(hash, pLabelInfo->Comment);
+		}
+
+		if (pCodeInfo != nullptr)
+		{
+			hash = HashValue(hash, pCodeInfo->ByteSize);
+			hash = HashValue(hash, pCodeInfo->OperandType);
+			hash = HashValue(hash, pCodeInfo->Flags);
+			hash = HashString(hash, pCodeInfo->Comment);
+		}
+
+		if (pCommentBlock != nullptr)
+			hash = HashString(hash, pCommentBlock->Comment);
+
+		const FDataInfo& dataInfo = page.DataInfo[pageAddr];
+		hash = HashValue(hash, dataInfo.DataType);
+		hash = HashValue(hash, dataInfo.OperandType);
+		hash = HashValue(hash, dataInfo.ByteSize);
+		hash = HashValue(hash, dataInfo.Flags);
+		hash = HashValue(hash, dataInfo.CharSetAddress.Val);	// shares storage with InstructionAddress
+		hash = HashValue(hash, dataInfo.EmptyCharNo);
+		hash = HashString(hash, dataInfo.Comment);
+	}
+	return hash;
+}
+
+static void WritePageRecord(const FCodeAnalysisPage& page, std::vector<uint8_t>& outRecord)
+{
+	json pageJson;
+	WritePageToJson(page, pageJson);
+	outRecord = json::to_cbor(pageJson);
+}
+
+static void WriteGlobalsRecord(FCodeAnalysisState& state, std::vector<uint8_t>& outRecord)
+{
+	json globalsJson = json::object();
+	WriteAnalysisGlobalsToJson(state, globalsJson, false);
+
+	// label names in every bank so new labels can be made unique without reading in all the pages
+	json& labelNamesJson = globalsJson["LabelNames"];
+	labelNamesJson = json::object();
+	for (const auto& labelUsage : state.GetLabelUsage())
+		labelNamesJson[labelUsage.first] = labelUsage.second;
+	outRecord = json::to_cbor(globalsJson);
+}
+
+// returns false if the record is corrupt
+static bool DecodeRecord(const FMappedFile& file, uint32_t offset, uint32_t size, int16_t recordId, json& outJson)
+{
+	const uint8_t* pRecord = file.pData + offset;
+	try
+	{
+		outJson = json::from_cbor(pRecord, pRecord + size);
+	}
+	catch (const json::exception& e)
+	{
+		LOGERROR("Analysis database record %d is corrupt: %s", recordId, e.what());
+		return false;
+	}
+	return true;
+}
+
+bool FAnalysisPageDatabase::Open(FCodeAnalysisState& state, const char* pFileName)
+{
+	Close();
+
+	if (MapFile(pFileName, MappedFile) == false)
+		return false;
+
+	FPageDatabaseHeader header;
+	if (MappedFile.Size >= sizeof(header))
+		memcpy(&header, MappedFile.pData, sizeof(header));
+	const uint64_t directoryEnd = (uint64_t)header.DirectoryOffset + (uint64_t)header.NoDirectoryEntries * sizeof(FPageDirectoryEntry);
+	if (MappedFile.Size < sizeof(header) || header.Magic != kPageDatabaseMagic || header.Version != kPageDatabaseVersion || directoryEnd > MappedFile.Size)
+	{
+		LOGERROR("'%s' is not a valid analysis database", pFileName);
+		Close();
+		return false;
+	}
+
+	for (uint32_t entryNo = 0; entryNo < header.NoDirectoryEntries; entryNo++)
+	{
+		FPageDirectoryEntry entry;
+		memcpy(&entry, MappedFile.pData + header.DirectoryOffset + (entryNo * sizeof(FPageDirectoryEntry)), sizeof(entry));
+		if ((uint64_t)entry.Offset + entry.Size > MappedFile.Size)
+		{
+			LOGERROR("'%s' page %d record is out of range", pFileName, entry.PageId);
+			Close();
+			return false;
+		}
+
+		FPageRecord& record = Records[entry.PageId];
+		record.Offset = entry.Offset;
+		record.Size = entry.Size;
+	}
+	FileName = pFileName;
+
+	// check the records that are read in now before touching the analysis state
+	// so a corrupt file can be rejected and the caller can fall back to the json
+	json recordJson;
+	for (const auto& bank : state.GetBanks())
+	{
+		if (bank.bReadOnly || bank.IsMapped() == false)
+			continue;
+
+		for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
+		{
+			auto recordIt = Records.find(bank.Pages[pageNo].PageId);
+			if (recordIt != Records.end() && DecodeRecord(MappedFile, recordIt->second.Offset, recordIt->second.Size, recordIt->first, recordJson) == false)
+			{
+				Close();
+				return false;
+			}
+		}
+	}
+
+	json globalsJson;
+	auto globalsIt = Records.find(kGlobalsRecordId);
+	if (globalsIt != Records.end() && DecodeRecord(MappedFile, globalsIt->second.Offset, globalsIt->second.Size, kGlobalsRecordId, globalsJson) == false)
+	{
+		Close();
+		return false;
+	}
+
+	bool bLoadAllBanks = true;	// older databases don't have the label names so all the pages are needed for them
+	if (globalsIt != Records.end())
+	{
+		ImportAnalysisJsonDoc(state, globalsJson);
+		globalsIt->second.bLoaded = true;
+
+		if (globalsJson.contains("LabelNames"))
+		{
+			for (const auto& labelName : globalsJson["LabelNames"].items())
+				state.RegisterLabelName(labelName.key(), labelName.value());
+			bLoadAllBanks = false;
+		}
+	}
+
+	for (auto& bank : state.GetBanks())
+	{
+		for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
+		{
+			if (bank.bReadOnly == false && Records.find(bank.Pages[pageNo].PageId) != Records.end())
+				bank.bHasStoredPages = true;
+		}
+
+		if (bank.IsMapped() || bLoadAllBanks)
+			LoadBank(state, bank);
+	}
+
+	LOGINFO("Opened analysis database '%s', %d records", pFileName, (int)Records.size());
+	return true;
+}
+
+void FAnalysisPageDatabase::Close()
+{
+	UnmapFile(MappedFile);
+	Records.clear();
+	FileName.clear();
+}
+
+void FAnalysisPageDatabase::LoadBank(FCodeAnalysisState& state, FCodeAnalysisBank& bank)
+{
+	if (IsOpen() == false || bank.bReadOnly)
+		return;
+
+	bank.bHasStoredPages = false;
+	bool bLoadedPages = false;
+	for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
+	{
+		FCodeAnalysisPage& page = bank.Pages[pageNo];
+		auto recordIt = Records.find(page.PageId);
+		if (recordIt == Records.end() || recordIt->second.bLoaded)
+			continue;
+
+		// a page that can't be read is left as it is on disk rather than being saved over
+		FPageRecord& record = recordIt->second;
+		json pageJson;
+		if (DecodeRecord(MappedFile, record.Offset, record.Size, page.PageId, pageJson) == false)
+			continue;
+
+		ReadPageFromJson(state, page, pageJson);
+		page.bUsed = true;
+		for (int pageAddr = 0; pageAddr < FCodeAnalysisPage::kPageSize; pageAddr++)
+		{
+			if (page.Labels[pageAddr] != nullptr)
+				state.RegisterLabelName(page.Labels[pageAddr]->Name);
+		}
+		record.Hash = HashPageAnnotations(page);
+		record.bLoaded = true;
+		bLoadedPages = true;
+		ApplyPendingPageState(state, page);
+	}
+
+	if (bLoadedPages)
+	{
+		bank.bIsDirty = true;
+		state.SetCodeAnalysisDirty(FAddressRef(bank.Id, bank.GetMappedAddress()));
+	}
+}
+
+void FAnalysisPageDatabase::LoadAllBanks(FCodeAnalysisState& state)
+{
+	for (auto& bank : state.GetBanks())
+		LoadBank(state, bank);
+}
+
+bool FAnalysisPageDatabase::IsPageWaitingToLoad(int16_t pageId) const
+{
+	auto recordIt = Records.find(pageId);
+	return recordIt != Records.end() && recordIt->second.bLoaded == false;
+}
+
+void FAnalysisPageDatabase::ClearChangedPages(const FCodeAnalysisState& state)
+{
+	for (const auto& bank : state.GetBanks())
+	{
+		for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
+			ClearChangedPage(bank.Pages[pageNo]);
+	}
+}
+
+bool FAnalysisPageDatabase::IsPageSaved(const FCodeAnalysisPage& page) const
+{
+	auto recordIt = Records.find(page.PageId);
+	return recordIt != Records.end() && recordIt->second.bLoaded && recordIt->second.Hash == HashPageAnnotations(page);
+}
+
+void FAnalysisPageDatabase::ClearChangedPage(const FCodeAnalysisPage& page)
+{
+	auto recordIt = Records.find(page.PageId);
+	if (recordIt != Records.end() && recordIt->second.bLoaded)
+		recordIt->second.Hash = HashPageAnnotations(page);
+}
+
+bool FAnalysisPageDatabase::Save(FCodeAnalysisState& state, const char* pFileName)
+{
+	if (IsOpen() == false || FileName != pFileName)
+		return WriteAll(state, pFileName);
+
+	// find the pages that have changed since they were loaded or saved
+	struct FChangedPage
+	{
+		const FCodeAnalysisPage*	pPage = nullptr;
+		uint64_t					Hash = 0;
+	};
+	std::vector<FChangedPage> changedPages;
+	uint64_t liveBytes = sizeof(FPageDatabaseHeader);
+	for (const auto& bank : state.GetBanks())
+	{
+		if (bank.bReadOnly)
+			continue;
+
+		for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
+		{
+			const FCodeAnalysisPage& page = bank.Pages[pageNo];
+			auto recordIt = Records.find(page.PageId);
+			if (recordIt != Records.end() && recordIt->second.bLoaded == false)	// never loaded so can't have changed
+			{
+				liveBytes += recordIt->second.Size;
+				continue;
+			}
+
+			const uint64_t hash = HashPageAnnotations(page);
+			if (recordIt != Records.end() && recordIt->second.Hash == hash)
+			{
+				liveBytes += recordIt->second.Size;
+				continue;
+			}
+
+			changedPages.push_back({ &page, hash });
+		}
+	}
+
+	// rewrite the whole thing if most of the file is superseded records
+	if (MappedFile.Size > kMinStaleBytesToCompact && MappedFile.Size > liveBytes * 2)
+		return WriteAll(state, pFileName);
+
+	std::vector<uint8_t> globalsRecord;
+	WriteGlobalsRecord(state, globalsRecord);
+
+	auto globalsIt = Records.find(kGlobalsRecordId);
+	if (changedPages.empty() && globalsIt != Records.end() && globalsIt->second.Size == globalsRecord.size() &&
+		memcmp(MappedFile.pData + globalsIt->second.Offset, globalsRecord.data(), globalsRecord.size()) == 0)
+	{
+		NoPagesWritten = 0;	// nothing to do
+		return true;
+	}
+
+	std::vector<uint8_t> appendData;
+	std::unordered_map<int16_t, FPageRecord> newRecords = Records;
+	uint32_t writeOffset = (uint32_t)MappedFile.Size;
+	std::vector<uint8_t> pageRecord;
+	for (const FChangedPage& changedPage : changedPages)
+	{
+		WritePageRecord(*changedPage.pPage, pageRecord);
+		FPageRecord& record = newRecords[changedPage.pPage->PageId];
+		record.Offset = writeOffset + (uint32_t)appendData.size();
+		record.Size = (uint32_t)pageRecord.size();
+		record.Hash = changedPage.Hash;
+		record.bLoaded = true;
+		appendData.insert(appendData.end(), pageRecord.begin(), pageRecord.end());
+	}
+
+	FPageRecord& globals = newRecords[kGlobalsRecordId];
+	globals.Offset = writeOffset + (uint32_t)appendData.size();
+	globals.Size = (uint32_t)globalsRecord.size();
+	globals.bLoaded = true;
+	appendData.insert(appendData.end(), globalsRecord.begin(), globalsRecord.end());
+
+	FPageDatabaseHeader header;
+	header.DirectoryOffset = writeOffset + (uint32_t)appendData.size();
+	header.NoDirectoryEntries = (uint32_t)newRecords.size();
+	for (const auto& recordIt : newRecords)
+	{
+		FPageDirectoryEntry entry;
+		entry.PageId = recordIt.first;
+		entry.Offset = recordIt.second.Offset;
+		entry.Size = recordIt.second.Size;
+		const uint8_t* pEntry = (const uint8_t*)&entry;
+		appendData.insert(appendData.end(), pEntry, pEntry + sizeof(entry));
+	}
+
+	// the file can't be written while it's mapped
+	// unloaded pages are still read from it later so it's remapped afterwards
+	UnmapFile(MappedFile);
+	bool bWritten = false;
+	FILE* fp = fopen(pFileName, "r+b");
+	if (fp != nullptr)
+	{
+		// new records & directory go on the end, the header is updated last so the old directory stays valid until then
+		bWritten = fseek(fp, writeOffset, SEEK_SET) == 0 && fwrite(appendData.data(), 1, appendData.size(), fp) == appendData.size();
+		bWritten = bWritten && fflush(fp) == 0;
+		bWritten = bWritten && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fp) == 1;
+		fclose(fp);
+	}
+
+	if (MapFile(pFileName, MappedFile) == false)
+	{
+		LOGERROR("Could not remap analysis database '%s'", pFileName);
+		Records.clear();
+		FileName.clear();
+		return false;
+	}
+
+	if (bWritten == false)
+	{
+		LOGERROR("Failed to write analysis database '%s'", pFileName);
+		return false;
+	}
+
+	Records = std::move(newRecords);
+	NoPagesWritten = (int)changedPages.size();
+	LOGINFO("Analysis database '%s' saved, %d pages written", pFileName, NoPagesWritten);
+	return true;
+}
+
+bool FAnalysisPageDatabase::WriteAll(FCodeAnalysisState& state, const char* pFileName)
+{
+	// everything needs to be in memory before the old file goes
+	LoadAllBanks(state);
+
+	std::vector<uint8_t> fileData(sizeof(FPageDatabaseHeader));
+	std::unordered_map<int16_t, FPageRecord> newRecords;
+	std::vector<uint8_t> record;
+
+	NoPagesWritten = 0;
+	for (const auto& bank : state.GetBanks())
+	{
+		if (bank.bReadOnly)
+			continue;
+
+		for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
+		{
+			const FCodeAnalysisPage& page = bank.Pages[pageNo];
+			WritePageRecord(page, record);
+			FPageRecord& pageRecord = newRecords[page.PageId];
+			pageRecord.Offset = (uint32_t)fileData.size();
+			pageRecord.Size = (uint32_t)record.size();
+			pageRecord.Hash = HashPageAnnotations(page);
+			pageRecord.bLoaded = true;
+			fileData.insert(fileData.end(), record.begin(), record.end());
+			NoPagesWritten++;
+		}
+	}
+
+	WriteGlobalsRecord(state, record);
+	FPageRecord& globals = newRecords[kGlobalsRecordId];
+	globals.Offset = (uint32_t)fileData.size();
+	globals.Size = (uint32_t)record.size();
+	globals.bLoaded = true;
+	fileData.insert(fileData.end(), record.begin(), record.end());
+
+	FPageDatabaseHeader header;
+	header.DirectoryOffset = (uint32_t)fileData.size();
+	header.NoDirectoryEntries = (uint32_t)newRecords.size();
+	for (const auto& recordIt : newRecords)
+	{
+		FPageDirectoryEntry entry;
+		entry.PageId = recordIt.first;
+		entry.Offset = recordIt.second.Offset;
+		entry.Size = recordIt.second.Size;
+		const uint8_t* pEntry = (const uint8_t*)&entry;
+		fileData.insert(fileData.end(), pEntry, pEntry + sizeof(entry));
+	}
+	memcpy(fileData.data(), &header, sizeof(header));
+
+	// write to a temporary file and swap it in so a failed save doesn't lose the old one
+	Close();
+	const std::string tempFileName = std::string(pFileName) + ".tmp";
+	if (SaveBinaryFile(tempFileName.c_str(), fileData.data(), fileData.size()) == false)
+	{
+		LOGERROR("Failed to write analysis database '%s'", tempFileName.c_str());
+		return false;
+	}
+	remove(pFileName);
+	if (rename(tempFileName.c_str(), pFileName) != 0 || MapFile(pFileName, MappedFile) == false)
+	{
+		LOGERROR("Failed to replace analysis database '%s'", pFileName);
+		return false;
+	}
+
+	Records = std::move(newRecords);
+	FileName = pFileName;
+	LOGINFO("Analysis database '%s' written, %d pages", pFileName, NoPagesWritten);
+	return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Util/FileUtil.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+class FCodeAnalysisState;
+struct FCodeAnalysisBank;
+struct FCodeAnalysisPage;
+
+// On disk analysis with one record per page, for the banks that aren't read only.
+// Opening the file maps it and reads the page directory, a bank's pages are only read into the analysis state when it's first needed.
+// Saving appends records for the pages that have changed followed by a new directory - the file is rewritten when too much of it is stale.
+class FAnalysisPageDatabase
+{
+public:
+	~FAnalysisPageDatabase() { Close(); }
+
+	bool	Open(FCodeAnalysisState& state, const char* pFileName);	// also loads the banks that are currently mapped
+	void	Close();
+	bool	IsOpen() const { return MappedFile.pData != nullptr; }
+
+	void	LoadBank(FCodeAnalysisState& state, FCodeAnalysisBank& bank);
+	void	LoadAllBanks(FCodeAnalysisState& state);
+	void	ClearChangedPages(const FCodeAnalysisState& state);	// state as it is now counts as saved
+	bool	IsPageSaved(const FCodeAnalysisPage& page) const;	// read in and hasn't changed since
+	void	ClearChangedPage(const FCodeAnalysisPage& page);
+	bool	IsPageWaitingToLoad(int16_t pageId) const;	// has a record that hasn't been read in
+
+	bool	Save(FCodeAnalysisState& state, const char* pFileName);
+
+	int		GetNoPagesWrittenLastSave() const { return NoPagesWritten; }
+
+private:
+	struct FPageRecord
+	{
+		uint32_t	Offset = 0;
+		uint32_t	Size = 0;
+		uint64_t	Hash = 0;	// hash of the page annotations when last loaded or saved
+		bool		bLoaded = false;
+	};
+
+	bool	WriteAll(FCodeAnalysisState& state, const char* pFileName);
+
+	std::string		FileName;
+	FMappedFile		MappedFile;
+	std::unordered_map<int16_t, FPageRecord>	Records;	// keyed by page id
+	int				NoPagesWritten = 0;
+};
@@ -0,0 +1,101 @@
+#include "AnalysisSnapshot.h"
+#include "CodeAnalyser.h"
+
+#include <string.h>
+
+void FAnalysisSnapshots::Reset()
+{
+	// nothing can be held while resetting
+	for (FAnalysisFrameSnapshot& snapshot : Snapshots)
+	{
+		snapshot.FrameNo = -1;
+		snapshot.Banks.clear();
+		snapshot.FrameBuffer.clear();
+	}
+	LatestIndex = -1;
+	HeldIndex = -1;
+	NoPagesCopied = 0;
+}
+
+static std::shared_ptr<const FPageSnapshot> CopyPage(const FCodeAnalysisPage& page, const uint8_t* pMemory)
+{
+	std::shared_ptr<FPageSnapshot> pSnapshot = std::make_shared<FPageSnapshot>();
+	pSnapshot->ChangeCount = page.SnapshotChangeCount;
+	if (pMemory != nullptr)
+		memcpy(pSnapshot->Memory, pMemory, FCodeAnalysisPage::kPageSize);
+	else
+		memset(pSnapshot->Memory, 0, FCodeAnalysisPage::kPageSize);
+	memcpy(pSnapshot->LastFrameRead, page.LastFrameRead, sizeof(page.LastFrameRead));
+	memcpy(pSnapshot->LastFrameWritten, page.LastFrameWritten, sizeof(page.LastFrameWritten));
+	for (int addr = 0; addr < FCodeAnalysisPage::kPageSize; addr++)
+	{
+		const FCodeInfo* pCodeInfo = page.CodeInfo[addr];
+		pSnapshot->LastFrameExecuted[addr] = pCodeInfo != nullptr ? pCodeInfo->FrameLastExecuted : -1;
+	}
+	return pSnapshot;
+}
+
+bool FAnalysisSnapshots::Publish(const FCodeAnalysisState& state, const uint8_t* pFrameBuffer, size_t frameBufferSize)
+{
+	const int latestIndex = LatestIndex;
+	const int writeIndex = latestIndex == 0 ? 1 : 0;
+	if (HeldIndex == writeIndex)
+		return false;	// UI is still drawing from it, try again next frame
+
+	FAnalysisFrameSnapshot& snapshot = Snapshots[writeIndex];
+	const FAnalysisFrameSnapshot* pPrevSnapshot = latestIndex != -1 ? &Snapshots[latestIndex] : nullptr;
+	const std::vector<FCodeAnalysisBank>& banks = state.GetBanks();
+
+	NoPagesCopied = 0;
+	snapshot.FrameNo = state.CurrentFrameNo;
+	snapshot.Banks.resize(banks.size());
+	for (const FCodeAnalysisBank& bank : banks)
+	{
+		auto& bankPages = snapshot.Banks[bank.Id];
+		bankPages.resize(bank.NoPages);
+
+		for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
+		{
+			const FCodeAnalysisPage& page = bank.Pages[pageNo];
+			const uint8_t* pMemory = bank.Memory != nullptr ? bank.Memory + (pageNo * FCodeAnalysisPage::kPageSize) : nullptr;
+			const FPageSnapshot* pPrevPage = pPrevSnapshot != nullptr ? pPrevSnapshot->GetPage(bank.Id, pageNo) : nullptr;
+
+			// share the previous copy if nothing has changed
+			if (pPrevPage != nullptr && pPrevPage->ChangeCount == page.SnapshotChangeCount &&
+				(pMemory == nullptr || memcmp(pPrevPage->Memory, pMemory, FCodeAnalysisPage::kPageSize) == 0))
+			{
+				bankPages[pageNo] = pPrevSnapshot->Banks[bank.Id][pageNo];
+			}
+			else
+			{
+				bankPages[pageNo] = CopyPage(page, pMemory);
+				NoPagesCopied++;
+			}
+		}
+	}
+
+	if (pFrameBuffer != nullptr)
+		snapshot.FrameBuffer.assign(pFrameBuffer, pFrameBuffer + frameBufferSize);
+	else
+		snapshot.FrameBuffer.clear();
+
+	LatestIndex = writeIndex;
+	return true;
+}
+
+const FAnalysisFrameSnapshot* FAnalysisSnapshots::Acquire()
+{
+	int index;
+	do
+	{
+		index = LatestIndex;
+		HeldIndex = index;
+	} while (LatestIndex != index);	// publish finished while we were acquiring
+
+	return index != -1 ? &Snapshots[index] : nullptr;
+}
+
+void FAnalysisSnapshots::Release()
+{
+	HeldIndex = -1;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CodeAnalysisPage.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class FCodeAnalysisState;
+
+// Read only copy of a page's memory and access info for the UI
+struct FPageSnapshot
+{
+	uint32_t	ChangeCount = 0;	// page SnapshotChangeCount when this was taken
+	uint8_t		Memory[FCodeAnalysisPage::kPageSize];
+	int			LastFrameRead[FCodeAnalysisPage::kPageSize];
+	int			LastFrameWritten[FCodeAnalysisPage::kPageSize];
+	int			LastFrameExecuted[FCodeAnalysisPage::kPageSize];	// -1 if not code or not executed
+};
+
+// Everything the UI draws from for one frame.
+// Pages that haven't changed are shared with the previous snapshot rather than copied.
+struct FAnalysisFrameSnapshot
+{
+	const FPageSnapshot*	GetPage(int16_t bankId, int bankPageNo) const
+	{
+		if (bankId < 0 || bankId >= (int)Banks.size() || bankPageNo < 0 || bankPageNo >= (int)Banks[bankId].size())
+			return nullptr;
+		return Banks[bankId][bankPageNo].get();
+	}
+
+	int		FrameNo = -1;
+	std::vector<std::vector<std::shared_ptr<const FPageSnapshot>>>	Banks;	// indexed by bank id then page
+	std::vector<uint8_t>	FrameBuffer;	// emulator output, palette indices
+};
+
+// Double buffered snapshots of the analysis state.
+// The emulation side publishes at the end of a frame, the UI draws from the latest published snapshot.
+// A snapshot the UI is holding is never written to - publishing is skipped until it's released.
+class FAnalysisSnapshots
+{
+public:
+	void	Reset();
+
+	// emulation side
+	bool	Publish(const FCodeAnalysisState& state, const uint8_t* pFrameBuffer, size_t frameBufferSize);
+
+	// UI side
+	const FAnalysisFrameSnapshot*	Acquire();
+	void	Release();
+
+	int		GetNoPagesCopiedLastPublish() const { return NoPagesCopied; }
+
+private:
+	FAnalysisFrameSnapshot	Snapshots[2];
+	std::atomic<int>		LatestIndex = -1;	// last published snapshot, -1 if none
+	std::atomic<int>		HeldIndex = -1;		// snapshot the UI is drawing from
+	int						NoPagesCopied = 0;
+};
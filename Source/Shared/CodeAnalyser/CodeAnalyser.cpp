@@ -16,6 +16,7 @@
 #include "6502/CodeAnalyser6502.h"
 #include <Debug/DebugLog.h>
 #include "Commands/CommandProcessor.h"
+#include "AnalysisPageDatabase.h"
 #include "Commands/SetItemDataCommand.h"
 #include "Z80/Z80Disassembler.h"
 #include "6502/M6502Disassembler.h"
@@ -37,6 +38,7 @@ int16_t	FCodeAnalysisState::CreateBank(const char* bankName, int noKb,uint8_t* p
 	newBank.Pages = new FCodeAnalysisPage[noPages];
 	newBank.Name = bankName;
 	newBank.bReadOnly = bReadOnly;
+	newBank.DirtyPages.resize(noPages, 0);
 	for (int pageNo = 0; pageNo < noPages; pageNo++)
 	{
 		char pageName[32];
@@ -46,6 +48,16 @@ int16_t	FCodeAnalysisState::CreateBank(const char* bankName, int noKb,uint8_t* p
 	return bankId;
 }
 
+bool FCodeAnalysisBank::HasDirtyPages() const
+{
+	for (uint8_t bDirty : DirtyPages)
+	{
+		if (bDirty)
+			return true;
+	}
+	return false;
+}
+
 // Set bank to memory pages starting at pageNo
 bool FCodeAnalysisState::MapBank(int16_t bankId, int startPageNo)
 {
@@ -184,6 +196,20 @@ bool FCodeAnalysisState::ToggleDataBreakpointAtAddress(FAddressRef addr, uint16_
 		return Debugger.AddDataBreakpoint(addr, dataSize);
 }
 
+bool FCodeAnalysisState::ToggleDataReadBreakpointAtAddress(FAddressRef addr, uint16_t dataSize)
+{
+	if (Debugger.IsAddressBreakpointed(addr))
+		return Debugger.RemoveBreakpoint(addr);
+	else
+		return Debugger.AddDataReadBreakpoint(addr, dataSize);
+}
+
+
+void FCodeAnalysisState::LoadBankAnalysis(FCodeAnalysisBank& bank)
+{
+	if (pAnalysisDatabase != nullptr && bank.bHasStoredPages)
+		pAnalysisDatabase->LoadBank(*this, bank);
+}
 
 bool FCodeAnalysisState::EnsureUniqueLabelName(std::string& labelName)
 {
@@ -391,7 +417,7 @@ FLabelInfo* GenerateLabelForAddress(FCodeAnalysisState &state, FAddressRef addre
 	if (pLabel != nullptr)
 		return nullptr;
 		
-	pLabel = FLabelInfo::Allocate();
+	pLabel = FLabelInfo::Allocate(state);
 	pLabel->LabelType = labelType;
 	//pLabel->Address = address;
 	pLabel->ByteSize = 0;
@@ -456,7 +482,7 @@ uint16_t WriteCodeInfoForAddress(FCodeAnalysisState &state, uint16_t pc)
 	FCodeInfo* pCodeInfo = state.GetCodeInfoForAddress(pc);
 	if (pCodeInfo == nullptr)
 	{
-		pCodeInfo = FCodeInfo::Allocate();
+		pCodeInfo = FCodeInfo::Allocate(state);
 		state.SetCodeInfoForAddress(pc, pCodeInfo);
 	}	
 
@@ -561,8 +587,7 @@ bool AnalyseAtPC(FCodeAnalysisState &state, uint16_t& pc)
 			pCodeInfo->bSelfModifyingCode = false;
 			for(uint16_t operandAddr = 0;operandAddr<pCodeInfo->ByteSize;operandAddr++)
 			{
-				FDataInfo* pOpDataInfo = state.GetReadDataInfoForAddress(pc + operandAddr);
-				if(pOpDataInfo->Writes.IsEmpty() == false)
+				if(state.GetWritesForAddress(pc + operandAddr).IsEmpty() == false)
 				{
 					pCodeInfo->bSelfModifyingCode = true;
 				}					
@@ -599,9 +624,13 @@ bool RegisterCodeExecuted(FCodeAnalysisState &state, uint16_t pc, uint16_t oldpc
 {
 	AnalyseAtPC(state, pc);
 
-	FCodeInfo* pCodeInfo = state.GetCodeInfoForAddress(pc);
-	if (pCodeInfo != nullptr)
+	FCodeAnalysisPage* pPage = state.GetReadPage(pc);
+	FCodeInfo* pCodeInfo = pPage->CodeInfo[pc & FCodeAnalysisPage::kPageMask];
+	if (pCodeInfo != nullptr && pCodeInfo->FrameLastExecuted != state.CurrentFrameNo)
+	{
+		pPage->RegisterAccessChange(state.CurrentFrameNo, pCodeInfo->FrameLastExecuted == -1);
 		pCodeInfo->FrameLastExecuted = state.CurrentFrameNo;
+	}
 
 	if (state.CPUInterface->CPUType == ECPUType::Z80)
 		return RegisterCodeExecutedZ80(state, pc, oldpc);
@@ -625,21 +654,20 @@ void RegisterDataRead(FCodeAnalysisState& state, uint16_t pc, uint16_t dataAddr)
 		LOGINFO("Access 0x%04X at PC:", g_DbgReadAddress, pc);
 	}
 
-	if (state.GetCodeInfoForAddress(dataAddr) == nullptr)	// don't register instruction data reads
-	{
-		FDataInfo* pDataInfo = state.GetReadDataInfoForAddress(dataAddr);
-		pDataInfo->LastFrameRead = state.CurrentFrameNo;
-		pDataInfo->Reads.RegisterAccess(state.AddressRefFromPhysicalAddress(pc));
-	}
+	FCodeAnalysisPage* pPage = state.GetReadPage(dataAddr);
+	const uint16_t pageAddr = dataAddr & FCodeAnalysisPage::kPageMask;
+	if (pPage->CodeInfo[pageAddr] == nullptr)	// don't register instruction data reads
+		pPage->RegisterRead(pageAddr, state.AddressRefFromPhysicalAddress(pc), state.CurrentFrameNo);
 }
 
 void RegisterDataWrite(FCodeAnalysisState &state, uint16_t pc,uint16_t dataAddr,uint8_t value)
 {
-	FDataInfo* pDataInfo = state.GetWriteDataInfoForAddress(dataAddr);
-	pDataInfo->LastFrameWritten = state.CurrentFrameNo;
-	pDataInfo->Writes.RegisterAccess(state.AddressRefFromPhysicalAddress(pc));
+	FCodeAnalysisPage* pPage = state.GetWritePage(dataAddr);
+	const uint16_t pageAddr = dataAddr & FCodeAnalysisPage::kPageMask;
+	pPage->RegisterWrite(pageAddr, state.AddressRefFromPhysicalAddress(pc), state.CurrentFrameNo);
 
 	// check for SMC
+	const FDataInfo* pDataInfo = &pPage->DataInfo[pageAddr];
 	if (pDataInfo->DataType == EDataType::InstructionOperand)
 	{
 		// TODO: record some info such as what byte was written
@@ -651,8 +679,14 @@ void RegisterDataWrite(FCodeAnalysisState &state, uint16_t pc,uint16_t dataAddr,
 
 void ReAnalyseCode(FCodeAnalysisState &state)
 {
-	int addr = 0;
-	while ( addr < (1 << 16))
+	ReAnalyseCodeRange(state, 0, 1 << 16);
+}
+
+// an instruction starting in the range can take it past the end
+int ReAnalyseCodeRange(FCodeAnalysisState& state, int startAddr, int endAddr)
+{
+	int addr = startAddr;
+	while (addr < endAddr)
 	{
 		FCodeInfo* pCodeInfo = state.GetCodeInfoForAddress(addr);
 		if (pCodeInfo != nullptr)
@@ -665,7 +699,7 @@ void ReAnalyseCode(FCodeAnalysisState &state)
 				pOperandData->ByteSize = 1;
 				pOperandData->DataType = EDataType::InstructionOperand;
 				pOperandData->InstructionAddress = state.AddressRefFromPhysicalAddress(addr);
-				if (pOperandData->Writes.IsEmpty() == false)
+				if (state.GetWritesForAddress(addr + i).IsEmpty() == false)
 					pCodeInfo->bSelfModifyingCode = true;
 				if (i > 0)	// make sure other entries after are null
 					state.SetCodeInfoForAddress(addr + i, nullptr);
@@ -685,20 +719,23 @@ void ReAnalyseCode(FCodeAnalysisState &state)
 			addr++;
 		}
 	}
+	return addr;
 }
 
 // Do we want to do this with every page?
 void ResetReferenceInfo(FCodeAnalysisState &state)
 {
-	for (int i = 0; i < (1 << 16); i++)
+	ResetReferenceInfoRange(state, 0, 1 << 16);
+}
+
+void ResetReferenceInfoRange(FCodeAnalysisState& state, int startAddr, int endAddr)
+{
+	for (int i = startAddr; i < endAddr; i++)
 	{
-		FDataInfo* pDataInfo = state.GetReadDataInfoForAddress(i);
-		if (pDataInfo != nullptr)
+		if ((i & FCodeAnalysisPage::kPageMask) == 0)
 		{
-			pDataInfo->LastFrameRead = -1;
-			pDataInfo->Reads.Reset();
-			pDataInfo->LastFrameWritten = -1;
-			pDataInfo->Writes.Reset();
+			state.GetReadPage(i)->ResetAccessInfo();
+			state.GetWritePage(i)->ResetAccessInfo();
 		}
 
 		FLabelInfo* pLabelInfo = state.GetLabelForAddress(i);
@@ -706,16 +743,78 @@ void ResetReferenceInfo(FCodeAnalysisState &state)
 		{
 			pLabelInfo->References.Reset();
 		}
+	}
+}
+
+
 
-		state.SetLastWriterForAddress(i,  FAddressRef());
+// searches back into whatever is mapped below the bank if the bank has nothing before the address
+bool FindLabelBeforeAddress(FCodeAnalysisState& state, FAddressRef address, ELabelRangeType type, FLabelSearchResult& result)
+{
+	FCodeAnalysisBank* pBank = state.GetBank(address.BankId);
+	uint16_t searchAddr = address.Address;
+
+	while (pBank != nullptr && pBank->PrimaryMappedPage != -1 && pBank->AddressValid(searchAddr))
+	{
+		const uint16_t bankBaseAddr = pBank->GetMappedAddress();
+		pBank->LabelIndex.Update(pBank->Pages, pBank->NoPages);
+
+		const FLabelRangeIndex::FEntry* pEntry = pBank->LabelIndex.FindLabel(type, searchAddr - bankBaseAddr);
+		if (pEntry != nullptr)
+		{
+			result.pLabel = pEntry->pLabel;
+			result.LabelAddress = FAddressRef(pBank->Id, bankBaseAddr + pEntry->BankAddr);
+			result.Offset = address.Address - result.LabelAddress.Address;
+			return true;
+		}
+
+		if (bankBaseAddr == 0)
+			break;
+		searchAddr = bankBaseAddr - 1;
+		pBank = state.GetBank(state.GetBankFromAddress(searchAddr));
 	}
+
+	return false;
 }
 
+static void AddPageCoverageStats(FCodeAnalysisPage& page, bool bReadOnly, FCoverageStats& stats)
+{
+	page.UpdateCoverage();
+	if (bReadOnly)
+	{
+		stats.CommentedCode += page.Coverage.CommentedCode;
+		stats.UncommentedCode += page.Coverage.UncommentedCode;
+		stats.ReadOnlyData += FCodeAnalysisPage::kPageSize - (page.Coverage.CommentedCode + page.Coverage.UncommentedCode);
+	}
+	else
+	{
+		stats += page.Coverage;
+	}
+}
+
+void GetBankCoverageStats(FCodeAnalysisBank& bank, FCoverageStats& stats)
+{
+	stats = FCoverageStats();
+	for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
+		AddPageCoverageStats(bank.Pages[pageNo], bank.bReadOnly, stats);
+}
 
+void GetMappedCoverageStats(FCodeAnalysisState& state, FCoverageStats& stats)
+{
+	stats = FCoverageStats();
+	for (int pageNo = 0; pageNo < FCodeAnalysisState::kNoPagesInAddressSpace; pageNo++)
+	{
+		const uint16_t pageAddr = pageNo * FCodeAnalysisPage::kPageSize;
+		FCodeAnalysisPage* pPage = state.GetReadPage(pageAddr);
+		const FCodeAnalysisBank* pBank = state.GetBank(state.GetBankFromAddress(pageAddr));
+		if (pPage != nullptr)
+			AddPageCoverageStats(*pPage, pBank != nullptr && pBank->bReadOnly, stats);
+	}
+}
 
 FLabelInfo* AddLabel(FCodeAnalysisState &state, uint16_t address,const char *name,ELabelType type)
 {
-	FLabelInfo *pLabel = FLabelInfo::Allocate();
+	FLabelInfo *pLabel = FLabelInfo::Allocate(state);
 	pLabel->Name = name;
 	pLabel->LabelType = type;
 	//pLabel->Address = address;
@@ -734,7 +833,7 @@ FCommentBlock* AddCommentBlock(FCodeAnalysisState& state, FAddressRef addressRef
 	FCommentBlock* pExistingBlock = state.GetCommentBlockForAddress(addressRef);
 	if(pExistingBlock == nullptr)
 	{
-		FCommentBlock* pCommentBlock = FCommentBlock::Allocate();
+		FCommentBlock* pCommentBlock = FCommentBlock::Allocate(state);
 		pCommentBlock->Comment = "";
 		pCommentBlock->ByteSize = 1;
 		state.SetCommentBlockForAddress(addressRef, pCommentBlock);
@@ -757,6 +856,10 @@ void GenerateGlobalInfo(FCodeAnalysisState &state)
 		if (bank.PrimaryMappedPage == -1)
 			continue;
 
+		// banks still in the analysis database get added when they're mapped in and read
+		if (bank.bHasStoredPages)
+			continue;
+
 		for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
 		{
 			const FCodeAnalysisPage& page = bank.Pages[pageNo];
@@ -810,14 +913,25 @@ FCodeAnalysisState::FCodeAnalysisState()
 
 }
 
+FCodeAnalysisState::~FCodeAnalysisState()
+{
+	InitCharacterSets(*this);	// frees the character sets & maps
+
+	for (FCodeAnalysisBank& bank : Banks)
+		delete[] bank.Pages;
+}
+
 // Called each time a new game is loaded up
 void FCodeAnalysisState::Init(ICPUInterface* pCPUInterface)
 {
 	InitImageViewers();
-	InitCharacterSets();
+	InitCharacterSets(*this);
 	
 	ResetLabelNames();
+	PendingPageStates.clear();
+	AnalysisJobs.Clear();
 	ItemList.clear();
+	ItemListSegments.clear();
 
 	// reset registered pages
 	for (FCodeAnalysisPage* pPage : GetRegisteredPages())
@@ -842,9 +956,10 @@ void FCodeAnalysisState::Init(ICPUInterface* pCPUInterface)
 	}
 	
 	FreeMachineStates(*this);
-	FLabelInfo::FreeAll();
-	FCodeInfo::FreeAll();
-	FCommentBlock::FreeAll();
+	FLabelInfo::FreeAll(*this);
+	FCodeInfo::FreeAll(*this);
+	FCommentBlock::FreeAll(*this);
+	FCommentLine::FreeAll(*this);
 
 	for (int i = 0; i < FCodeAnalysisState::kNoViewStates; i++)
 	{
@@ -857,6 +972,9 @@ void FCodeAnalysisState::Init(ICPUInterface* pCPUInterface)
 	{
 		bank.Description.clear();
 		bank.ItemList.clear();
+		bank.PageItemStart.clear();
+		bank.bHasStoredPages = false;
+		std::fill(bank.DirtyPages.begin(), bank.DirtyPages.end(), 0);
 	}
 
 	CPUInterface = pCPUInterface;
@@ -1001,6 +1119,7 @@ void RemoveLabelAtAddress(FCodeAnalysisState &state, FAddressRef address)
 		if (pLabelInfo->Global || pLabelInfo->LabelType == ELabelType::Function)
 			GenerateGlobalInfo(state);
 
+		FLabelInfo::Free(state, pLabelInfo);
 		state.SetCodeAnalysisDirty(address);
 	}
 }
@@ -1018,6 +1137,7 @@ void SetLabelName(FCodeAnalysisState &state, FLabelInfo *pLabel, const char *pTe
 void SetItemCommentText(FCodeAnalysisState &state, const FCodeAnalysisItem& item, const char *pText)
 {
 	item.Item->Comment = pText;
+	state.SetCodeAnalysisDirty(item.AddressRef);
 }
 
 void FormatData(FCodeAnalysisState& state, const FDataFormattingOptions& options)
@@ -9,10 +9,15 @@
 
 #include "CodeAnalyserTypes.h"
 #include "CodeAnalysisPage.h"
+#include "AnalysisJobs.h"
 #include "Debugger.h"
+#include "LabelRangeIndex.h"
 
 class FGraphicsView;
 class FCodeAnalysisState;
+class FAnalysisPageDatabase;
+struct FCharacterSet;
+struct FCharacterMap;
 
 enum class ELabelType;
 
@@ -147,19 +152,7 @@ struct FCodeAnalysisViewState
 	void GoToAddress(FAddressRef address, bool bLabel = false);
 	bool GoToPreviousAddress();
 
-	bool GetYPosForAddress(FAddressRef addr, float& ypos)
-	{
-		for (const auto& item : AddressCoords)
-		{
-			if (item.Address == addr)
-			{
-				ypos = item.YPos;
-				return true;
-			}
-		}
-
-		return false;
-	}
+	bool GetYPosForAddress(FAddressRef addr, float& ypos) const;
 
 	bool			Enabled = false;
 	bool			TrackPCFrame = false;
@@ -173,7 +166,7 @@ struct FCodeAnalysisViewState
 	std::vector<FCodeAnalysisItem>	FilteredGlobalDataItems;
 	FLabelListFilter				GlobalFunctionsFilter;
 	std::vector<FCodeAnalysisItem>	FilteredGlobalFunctions;
-	std::vector< FAddressCoord>		AddressCoords;
+	std::vector< FAddressCoord>		AddressCoords;	// sorted by address
 	int								JumpLineIndent;
 
 	bool					DataFormattingTabOpen = false;
@@ -215,16 +208,31 @@ struct FCodeAnalysisBank
 	std::string			Name;
 	std::string			Description;	// where we can describe what the bank is used for
 	bool				bReadOnly = false;
-	bool				bIsDirty = false;
+	bool				bIsDirty = false;	// whole item list needs rebuilding
+	bool				bHasStoredPages = false;	// has pages in the analysis database that haven't been read in yet
+	std::vector<uint8_t>	DirtyPages;		// pages whose items need rebuilding
 	std::vector<FCodeAnalysisItem>		ItemList;
+	std::vector<int>	PageItemStart;	// index of first item for each page, NoPages + 1 entries
+	FLabelRangeIndex	LabelIndex;
+
+	void		SetPageDirty(int bankPageNo) { DirtyPages[bankPageNo] = 1; }
+	bool		HasDirtyPages() const;
 
 	bool		AddressValid(uint16_t addr) const { return addr >= GetMappedAddress() && addr < GetMappedAddress() + (NoPages * FCodeAnalysisPage::kPageSize);	}
-	bool		IsUsed() const { return Pages[0].bUsed; }
+	bool		IsUsed() const { return Pages[0].bUsed || bHasStoredPages; }
 	bool		IsMapped() const { return MappedPages.empty() == false; }
 	uint16_t	GetMappedAddress() const { return PrimaryMappedPage * FCodeAnalysisPage::kPageSize; }
 	uint16_t	GetSizeBytes() const { return NoPages * FCodeAnalysisPage::kPageSize; }
 };
 
+// run of a bank's items in the global item list
+struct FItemListSegment
+{
+	int16_t		BankId = -1;
+	int			Start = 0;
+	int			Count = 0;
+};
+
 // code analysis information
 class FCodeAnalysisState
 {
@@ -236,6 +244,8 @@ public:
 	static const int kNoPagesInAddressSpace = kAddressSize / FCodeAnalysisPage::kPageSize;
 
 	FCodeAnalysisState();
+	~FCodeAnalysisState();
+	FCodeAnalysisState(const FCodeAnalysisState&) = delete;	// owns the bank pages
 	void	Init(ICPUInterface* pCPUInterface);
 	void	OnFrameStart();
 	void	OnFrameEnd();
@@ -258,6 +268,7 @@ public:
 	bool		IsAddressBreakpointed(FAddressRef addr) const;
 	bool		ToggleExecBreakpointAtAddress(FAddressRef addr);
 	bool		ToggleDataBreakpointAtAddress(FAddressRef addr, uint16_t dataSize);
+	bool		ToggleDataReadBreakpointAtAddress(FAddressRef addr, uint16_t dataSize);
 
 	
 	FCodeAnalysisBank* GetBank(int16_t bankId) { return (bankId >= 0 && bankId < Banks.size()) ? &Banks[bankId] : nullptr; }
@@ -312,7 +323,21 @@ public:
 	{
 		FCodeAnalysisBank* pBank = GetBank(addrRef.BankId);
 		if (pBank != nullptr)
-			pBank->bIsDirty = true;
+		{
+			// only the page the address is in needs rebuilding if we know where the bank is
+			const int bankPageNo = (addrRef.Address - pBank->GetMappedAddress()) >> kPageShift;
+			if (pBank->PrimaryMappedPage != -1 && pBank->AddressValid(addrRef.Address) && bankPageNo < (int)pBank->DirtyPages.size())
+			{
+				pBank->SetPageDirty(bankPageNo);
+				pBank->Pages[bankPageNo].AnnotationChangeCount++;
+			}
+			else
+			{
+				pBank->bIsDirty = true;
+				for (int pageNo = 0; pageNo < pBank->NoPages; pageNo++)
+					pBank->Pages[pageNo].AnnotationChangeCount++;
+			}
+		}
 		bCodeAnalysisDataDirty = true;
 	}
 
@@ -328,6 +353,8 @@ public:
 			FCodeAnalysisBank* pBank = GetBank(MappedBanks[i]);
 			if (pBank != nullptr)
 				pBank->bIsDirty = true;
+			if (ReadPageTable[i] != nullptr)
+				ReadPageTable[i]->AnnotationChangeCount++;
 			bCodeAnalysisDataDirty = true;
 		}
 	}
@@ -352,12 +379,22 @@ public:
 	void	ResetLabelNames() { LabelUsage.clear(); }
 	bool	EnsureUniqueLabelName(std::string& lableName);
 	bool	RemoveLabelName(const std::string& labelName);	// for changing label names
+	void	RegisterLabelName(const std::string& labelName, int usage = 0) { LabelUsage.try_emplace(labelName, usage); }	// for labels that are loaded
+	const std::map<std::string, int>& GetLabelUsage() const { return LabelUsage; }
+
+	// read in a bank from the analysis database if it hasn't been yet
+	void	LoadBankAnalysis(FCodeAnalysisBank& bank);
 
 public:
 
 	bool					bRegisterDataAccesses = true;
 
 	std::vector<FCodeAnalysisItem>	ItemList;
+	std::vector<FItemListSegment>	ItemListSegments;	// where each bank's items are in ItemList
+	FItemPools						ItemPools;
+
+	std::vector<FCharacterSet*>		CharacterSets;
+	std::vector<FCharacterMap*>		CharacterMaps;
 
 	std::vector<FCodeAnalysisItem>	GlobalDataItems;
 	bool						bRebuildFilteredGlobalDataItems = true;
@@ -372,6 +409,9 @@ public:
 	FCodeAnalysisViewState& GetAltViewState() { return ViewState[FocussedWindowId ^ 1]; }
 	
 	FDebugger				Debugger;
+	FAnalysisJobQueue		AnalysisJobs;	// updated by the machine between frames
+	FAnalysisPageDatabase*	pAnalysisDatabase = nullptr;	// optional, set by machines that load banks when they're first needed
+	std::map<int16_t, std::vector<uint8_t>>	PendingPageStates;	// analysis state file sections for pages the database hasn't read in yet
 
 	FAddressRef				CopiedAddress;
 
@@ -430,7 +470,9 @@ public:
 	{
 		if(pLabel != nullptr)	// ensure no name clashes
 			EnsureUniqueLabelName(pLabel->Name);
-		GetReadPage(addr)->Labels[addr & kPageMask] = pLabel; 
+		FCodeAnalysisPage* pPage = GetReadPage(addr);
+		pPage->Labels[addr & kPageMask] = pLabel;
+		pPage->LabelChangeCount++;
 	}
 	void SetLabelForAddress(FAddressRef addrRef, FLabelInfo* pLabel)
 	{
@@ -441,7 +483,20 @@ public:
 		if (pBank != nullptr)
 		{
 			const uint16_t bankAddr = addrRef.Address - (pBank->PrimaryMappedPage * FCodeAnalysisPage::kPageSize);
-			pBank->Pages[bankAddr >> FCodeAnalysisPage::kPageShift].Labels[bankAddr & FCodeAnalysisPage::kPageMask] = pLabel;
+			FCodeAnalysisPage& page = pBank->Pages[bankAddr >> FCodeAnalysisPage::kPageShift];
+			page.Labels[bankAddr & FCodeAnalysisPage::kPageMask] = pLabel;
+			page.LabelChangeCount++;
+		}
+	}
+
+	// for when a label's type is changed in place
+	void SetLabelChanged(FAddressRef addrRef)
+	{
+		FCodeAnalysisBank* pBank = GetBank(addrRef.BankId);
+		if (pBank != nullptr)
+		{
+			const uint16_t bankAddr = addrRef.Address - (pBank->PrimaryMappedPage * FCodeAnalysisPage::kPageSize);
+			pBank->Pages[bankAddr >> FCodeAnalysisPage::kPageShift].LabelChangeCount++;
 		}
 	}
 
@@ -486,7 +541,13 @@ public:
 		}
 	}
 
-	void SetCodeInfoForAddress(uint16_t addr, FCodeInfo* pCodeInfo) { GetReadPage(addr)->CodeInfo[addr & kPageMask] = pCodeInfo; }
+	void SetCodeInfoForAddress(uint16_t addr, FCodeInfo* pCodeInfo) 
+	{ 
+		FCodeAnalysisPage* pPage = GetReadPage(addr);
+		pPage->CodeInfo[addr & kPageMask] = pCodeInfo; 
+		pPage->SnapshotChangeCount++;	// execution info comes from the code info
+		pPage->AnnotationChangeCount++;
+	}
 
 	const FDataInfo* GetReadDataInfoForAddress(uint16_t addr) const { return &GetReadPage(addr)->DataInfo[addr & kPageMask]; }
 	FDataInfo* GetReadDataInfoForAddress(uint16_t addr) { return &GetReadPage(addr)->DataInfo[addr & kPageMask]; }
@@ -518,8 +579,53 @@ public:
 			return nullptr;
 		}
 	}
-	FAddressRef GetLastWriterForAddress(uint16_t addr) const { return GetWritePage(addr)->DataInfo[addr & kPageMask].LastWriter; }
-	void SetLastWriterForAddress(uint16_t addr, FAddressRef lastWriter) { GetWritePage(addr)->DataInfo[addr & kPageMask].LastWriter = lastWriter; }
+	FAddressRef GetLastWriterForAddress(uint16_t addr) const { return GetWritePage(addr)->LastWriter[addr & kPageMask]; }
+	void SetLastWriterForAddress(uint16_t addr, FAddressRef lastWriter) { GetWritePage(addr)->LastWriter[addr & kPageMask] = lastWriter; }
+
+	// data access tracking - reads are tracked in the read page and writes in the write page
+	int GetLastFrameReadForAddress(uint16_t addr) const { return GetReadPage(addr)->LastFrameRead[addr & kPageMask]; }
+	int GetLastFrameWrittenForAddress(uint16_t addr) const { return GetWritePage(addr)->LastFrameWritten[addr & kPageMask]; }
+	const FItemReferenceTracker& GetReadsForAddress(uint16_t addr) const { return GetReadPage(addr)->GetReads(addr & kPageMask); }
+	const FItemReferenceTracker& GetWritesForAddress(uint16_t addr) const { return GetWritePage(addr)->GetWrites(addr & kPageMask); }
+
+	const FCodeAnalysisPage* GetPageForAddress(FAddressRef addrRef) const
+	{
+		const FCodeAnalysisBank* pBank = GetBank(addrRef.BankId);
+		if (pBank != nullptr)
+		{
+			const uint16_t bankAddr = addrRef.Address - pBank->GetMappedAddress();
+			return &pBank->Pages[bankAddr >> FCodeAnalysisPage::kPageShift];
+		}
+		else
+		{
+			return nullptr;
+		}
+	}
+	int GetLastFrameReadForAddress(FAddressRef addrRef) const
+	{
+		const FCodeAnalysisPage* pPage = GetPageForAddress(addrRef);
+		return pPage != nullptr ? pPage->LastFrameRead[addrRef.Address & kPageMask] : -1;
+	}
+	int GetLastFrameWrittenForAddress(FAddressRef addrRef) const
+	{
+		const FCodeAnalysisPage* pPage = GetPageForAddress(addrRef);
+		return pPage != nullptr ? pPage->LastFrameWritten[addrRef.Address & kPageMask] : -1;
+	}
+	FAddressRef GetLastWriterForAddress(FAddressRef addrRef) const
+	{
+		const FCodeAnalysisPage* pPage = GetPageForAddress(addrRef);
+		return pPage != nullptr ? pPage->LastWriter[addrRef.Address & kPageMask] : FAddressRef();
+	}
+	const FItemReferenceTracker& GetReadsForAddress(FAddressRef addrRef) const
+	{
+		const FCodeAnalysisPage* pPage = GetPageForAddress(addrRef);
+		return pPage != nullptr ? pPage->GetReads(addrRef.Address & kPageMask) : FCodeAnalysisPage::kNoReferences;
+	}
+	const FItemReferenceTracker& GetWritesForAddress(FAddressRef addrRef) const
+	{
+		const FCodeAnalysisPage* pPage = GetPageForAddress(addrRef);
+		return pPage != nullptr ? pPage->GetWrites(addrRef.Address & kPageMask) : FCodeAnalysisPage::kNoReferences;
+	}
 
 	FMachineState* GetMachineState(uint16_t addr) { return GetReadPage(addr)->MachineState[addr & kPageMask];}
 	void SetMachineStateForAddress(uint16_t addr, FMachineState* pMachineState) { GetReadPage(addr)->MachineState[addr & kPageMask] = pMachineState; }
@@ -580,15 +686,30 @@ FLabelInfo* GenerateLabelForAddress(FCodeAnalysisState &state, FAddressRef addrR
 void RunStaticCodeAnalysis(FCodeAnalysisState &state, uint16_t pc);
 bool RegisterCodeExecuted(FCodeAnalysisState &state, uint16_t pc, uint16_t oldpc);
 void ReAnalyseCode(FCodeAnalysisState &state);
+int ReAnalyseCodeRange(FCodeAnalysisState& state, int startAddr, int endAddr);	// returns the address to carry on from
 uint16_t WriteCodeInfoForAddress(FCodeAnalysisState& state, uint16_t pc);
 void GenerateGlobalInfo(FCodeAnalysisState &state);
 void RegisterDataRead(FCodeAnalysisState& state, uint16_t pc, uint16_t dataAddr);
 void RegisterDataWrite(FCodeAnalysisState &state, uint16_t pc, uint16_t dataAddr, uint8_t value);
 void UpdateCodeInfoForAddress(FCodeAnalysisState &state, uint16_t pc);
 void ResetReferenceInfo(FCodeAnalysisState &state);
+void ResetReferenceInfoRange(FCodeAnalysisState& state, int startAddr, int endAddr);
 
 std::string GetItemText(FCodeAnalysisState& state, FAddressRef address);
 
+// nearest label of a type at or before an address, from the bank label indices
+struct FLabelSearchResult
+{
+	const FLabelInfo*	pLabel = nullptr;
+	FAddressRef			LabelAddress;
+	int					Offset = 0;	// bytes from the label to the address searched from
+};
+bool FindLabelBeforeAddress(FCodeAnalysisState& state, FAddressRef address, ELabelRangeType type, FLabelSearchResult& result);
+
+// coverage from the page counts - anything in a read only bank that isn't code counts as read only data
+void GetBankCoverageStats(FCodeAnalysisBank& bank, FCoverageStats& stats);
+void GetMappedCoverageStats(FCodeAnalysisState& state, FCoverageStats& stats);	// what's mapped into the address space
+
 // Commands
 void Undo(FCodeAnalysisState &state);
 
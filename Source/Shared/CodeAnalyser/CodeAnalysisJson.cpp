@@ -7,25 +7,30 @@
 #include <fstream>
 #include <sstream>
 #include <json.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "Util/GraphicsView.h"
 #include "Debug/DebugLog.h"
 using json = nlohmann::json;
 
 void WritePageToJson(const FCodeAnalysisPage& page, json& jsonDoc);
 void ReadPageFromJson(FCodeAnalysisState& state, FCodeAnalysisPage& page, const json& jsonDoc);
-FCommentBlock* CreateCommentBlockFromJson(const json& commentBlockJson);
-FCodeInfo* CreateCodeInfoFromJson(const json& codeInfoJson);
-FLabelInfo* CreateLabelInfoFromJson(const json& labelInfoJson);
+FCommentBlock* CreateCommentBlockFromJson(FCodeAnalysisState& state, const json& commentBlockJson);
+FCodeInfo* CreateCodeInfoFromJson(FCodeAnalysisState& state, const json& codeInfoJson);
+FLabelInfo* CreateLabelInfoFromJson(FCodeAnalysisState& state, const json& labelInfoJson);
 void LoadDataInfoFromJson(FCodeAnalysisState& state, FDataInfo* pDataInfo, const json& dataInfoJson);
+bool ImportAnalysisJsonDoc(FCodeAnalysisState& state, const json& jsonGameData);
 
-bool ExportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName, bool bROMS)
-{
-	json jsonGameData;
+// cache of shared json documents, keyed by file name
+static std::mutex g_SharedJsonLock;
+static std::map<std::string, std::shared_ptr<const json>>	g_SharedJsonDocs;
 
-	int pagesWritten = 0;
+// bank descriptions, character sets & maps - everything that isn't stored in a page
+void WriteAnalysisGlobalsToJson(FCodeAnalysisState& state, json& jsonDoc, bool bROMS)
+{
 	const auto& banks = state.GetBanks();
-
-	// iterate through all registered banks
 	for (int bankNo = 0; bankNo < banks.size(); bankNo++)
 	{
 		const FCodeAnalysisBank& bank = banks[bankNo];
@@ -37,27 +42,13 @@ bool ExportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName, bo
 		bankJson["Description"] = bank.Description;
 
 		//bankJson["PrimaryMappedPage"] = bank.PrimaryMappedPage;
-		jsonGameData["Banks"].push_back(bankJson);
-
-		for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
-		{
-			const FCodeAnalysisPage& page = bank.Pages[pageNo];
-			//if (page.bUsed)
-			{
-				json pageData;
-
-				WritePageToJson(page, pageData);
-				jsonGameData["Pages"].push_back(pageData);
-				pagesWritten++;
-			}
-		}
+		jsonDoc["Banks"].push_back(bankJson);
 	}
-	LOGINFO("%d pages written", pagesWritten);
 
 	// Write character sets
-	for (int i = 0; i < GetNoCharacterSets(); i++)
+	for (int i = 0; i < GetNoCharacterSets(state); i++)
 	{
-		const FCharacterSet* pCharSet = GetCharacterSetFromIndex(i);
+		const FCharacterSet* pCharSet = GetCharacterSetFromIndex(state, i);
 		json jsonCharacterSet;
 
 		jsonCharacterSet["AddressRef"] = pCharSet->Params.Address.Val;
@@ -66,13 +57,13 @@ bool ExportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName, bo
 		jsonCharacterSet["ColourInfo"] = pCharSet->Params.ColourInfo;
 		jsonCharacterSet["Dynamic"] = pCharSet->Params.bDynamic;
 
-		jsonGameData["CharacterSets"].push_back(jsonCharacterSet);
+		jsonDoc["CharacterSets"].push_back(jsonCharacterSet);
 	}
 
 	// Write character maps
-	for (int i = 0; i < GetNoCharacterMaps(); i++)
+	for (int i = 0; i < GetNoCharacterMaps(state); i++)
 	{
-		const FCharacterMap* pCharMap = GetCharacterMapFromIndex(i);
+		const FCharacterMap* pCharMap = GetCharacterMapFromIndex(state, i);
 		json jsonCharacterMap;
 
 		jsonCharacterMap["AddressRef"] = pCharMap->Params.Address.Val;
@@ -81,31 +72,317 @@ bool ExportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName, bo
 		jsonCharacterMap["CharacterSetRef"] = pCharMap->Params.CharacterSet.Val;
 		jsonCharacterMap["IgnoreCharacter"] = pCharMap->Params.IgnoreCharacter;
 
-		jsonGameData["CharacterMaps"].push_back(jsonCharacterMap);
+		jsonDoc["CharacterMaps"].push_back(jsonCharacterMap);
+	}
+}
+
+// Writes a document a piece at a time so the whole thing never has to be built in memory.
+// Keys must be written in sorted order so the pretty output matches dumping the whole document with setw(4).
+class FJsonStreamWriter
+{
+public:
+	FJsonStreamWriter(std::ostream& stream, bool bCompact)
+		: Stream(stream)
+		, Serializer(nlohmann::detail::output_adapter<char>(stream), ' ')
+		, bCompact(bCompact)
+	{
+	}
+
+	void WriteKey(const std::string& key, const json& value)
+	{
+		EndArray();
+		BeginKey(key);
+		Serializer.dump(value, !bCompact, false, kIndent, kIndent);
+	}
+
+	// array is started by the first element so empty arrays aren't written, like a document that never had anything pushed to it
+	void WriteArrayElement(const std::string& key, const json& value)
+	{
+		if (ArrayKey != key)
+		{
+			EndArray();
+			BeginKey(key);
+			Stream << '[';
+			ArrayKey = key;
+		}
+		else
+		{
+			Stream << ',';
+		}
+
+		if (bCompact == false)
+			Stream << '\n' << std::string(kIndent * 2, ' ');
+		Serializer.dump(value, !bCompact, false, kIndent, kIndent * 2);
+	}
+
+	void End()
+	{
+		EndArray();
+		if (NoKeys == 0)
+			Stream << "null";
+		else
+			Stream << (bCompact ? "}" : "\n}");
+	}
+
+private:
+	void BeginKey(const std::string& key)
+	{
+		Stream << (NoKeys++ == 0 ? "{" : ",");
+		if (bCompact == false)
+			Stream << '\n' << std::string(kIndent, ' ');
+		Serializer.dump(json(key), false, false, 0);
+		Stream << (bCompact ? ":" : ": ");
 	}
 
-	// Write file out
+	void EndArray()
+	{
+		if (ArrayKey.empty())
+			return;
+		if (bCompact == false)
+			Stream << '\n' << std::string(kIndent, ' ');
+		Stream << ']';
+		ArrayKey.clear();
+	}
+
+	static const int kIndent = 4;
+
+	std::ostream&	Stream;
+	nlohmann::detail::serializer<json>	Serializer;
+	bool			bCompact = false;
+	int				NoKeys = 0;
+	std::string		ArrayKey;
+};
+
+bool ExportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName, bool bROMS, bool bCompact)
+{
 	std::ofstream outFileStream(pJsonFileName);
-	if (outFileStream.is_open())
+	if (outFileStream.is_open() == false)
+		return false;
+
 	{
-		outFileStream << std::setw(4) << jsonGameData << std::endl;
-		return true;
+		// file is changing so make sure it gets reloaded next time it's shared
+		std::lock_guard<std::mutex> lock(g_SharedJsonLock);
+		g_SharedJsonDocs.erase(pJsonFileName);
 	}
 
-	return false;
+	FJsonStreamWriter writer(outFileStream, bCompact);
+
+	// globals are small so they are built as a document, their keys all sort before "Pages"
+	json jsonGlobals;
+	WriteAnalysisGlobalsToJson(state, jsonGlobals, bROMS);
+	for (auto it = jsonGlobals.begin(); it != jsonGlobals.end(); ++it)
+		writer.WriteKey(it.key(), it.value());
+
+	// pages are written one at a time
+	int pagesWritten = 0;
+	const auto& banks = state.GetBanks();
+	for (int bankNo = 0; bankNo < banks.size(); bankNo++)
+	{
+		const FCodeAnalysisBank& bank = banks[bankNo];
+		if (bank.bReadOnly != bROMS)	// skip read only banks - ROM
+			continue;
+
+		for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
+		{
+			json pageData;
+			WritePageToJson(bank.Pages[pageNo], pageData);
+			writer.WriteArrayElement("Pages", pageData);
+			pagesWritten++;
+		}
+	}
+	writer.End();
+	outFileStream << std::endl;
+	LOGINFO("%d pages written", pagesWritten);
+
+	return outFileStream.good();
 }
 
+// SAX handler that applies each page as soon as it has been read.
+// Everything outside of "Pages" is small so it's collected into a document and imported the usual way.
+class FAnalysisJsonSaxReader
+{
+public:
+	using number_integer_t = json::number_integer_t;
+	using number_unsigned_t = json::number_unsigned_t;
+	using number_float_t = json::number_float_t;
+	using string_t = json::string_t;
+
+	FAnalysisJsonSaxReader(FCodeAnalysisState& state) : State(state) {}
+
+	const json&	GetGlobals() const { return Globals; }
+	int			GetNoPagesRead() const { return NoPagesRead; }
+
+	bool null() { AddValue(nullptr); return true; }
+	bool boolean(bool val) { AddValue(val); return true; }
+	bool number_integer(number_integer_t val) { AddValue(val); return true; }
+	bool number_unsigned(number_unsigned_t val) { AddValue(val); return true; }
+	bool number_float(number_float_t val, const string_t&) { AddValue(val); return true; }
+	bool string(string_t& val) { AddValue(std::move(val)); return true; }
+
+	bool key(string_t& val)
+	{
+		Key = std::move(val);
+		return true;
+	}
+
+	bool start_object(std::size_t)
+	{
+		if (Depth == 0)	// the document itself
+		{
+			Depth++;
+			return true;
+		}
+
+		if (bInPages && Depth + 1 == kPageDepth)
+		{
+			CurrentPage = json::object();
+			Stack.push_back(&CurrentPage);
+		}
+		else
+		{
+			Stack.push_back(AddValue(json::object()));
+		}
+		Depth++;
+		return true;
+	}
+
+	bool end_object()
+	{
+		if (Depth == 1)
+		{
+			Depth--;
+			return true;
+		}
+
+		if (bInPages && Depth == kPageDepth)
+			ApplyPage();
+		Stack.pop_back();
+		Depth--;
+		return true;
+	}
+
+	bool start_array(std::size_t)
+	{
+		if (Depth == 1 && Key == "Pages")
+			bInPages = true;
+		else
+			Stack.push_back(AddValue(json::array()));
+		Depth++;
+		return true;
+	}
+
+	bool end_array()
+	{
+		if (bInPages && Depth == 2)
+			bInPages = false;
+		else
+			Stack.pop_back();
+		Depth--;
+		return true;
+	}
+
+	bool parse_error(std::size_t position, const std::string& lastToken, const nlohmann::detail::exception& ex)
+	{
+		LOGERROR("Json parse error at %d '%s': %s", (int)position, lastToken.c_str(), ex.what());
+		return false;
+	}
+
+private:
+	json* AddValue(json&& value)
+	{
+		json* pTarget = &Discard;	// anything that isn't part of the document we use
+		if (Stack.empty() == false)
+		{
+			json& parent = *Stack.back();
+			if (parent.is_array())
+			{
+				parent.push_back(std::move(value));
+				return &parent.back();
+			}
+			pTarget = &parent[Key];
+		}
+		else if (Depth == 1)
+		{
+			pTarget = &Globals[Key];
+		}
+
+		*pTarget = std::move(value);
+		return pTarget;
+	}
+
+	void ApplyPage()
+	{
+		if (CurrentPage.contains("PageId") == false)
+			return;
+
+		const int pageId = CurrentPage["PageId"];
+		FCodeAnalysisPage* pPage = State.GetPage(pageId);
+		if (pPage != nullptr)
+		{
+			ReadPageFromJson(State, *pPage, CurrentPage);
+			pPage->bUsed = true;
+			NoPagesRead++;
+		}
+	}
+
+	static const int kPageDepth = 3;	// document -> Pages array -> page
+
+	FCodeAnalysisState&	State;
+	json				Globals;
+	json				CurrentPage;
+	json				Discard;
+	std::vector<json*>	Stack;
+	std::string			Key;
+	int					Depth = 0;
+	bool				bInPages = false;
+	int					NoPagesRead = 0;
+};
+
 bool ImportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName)
 {
 	std::ifstream inFileStream(pJsonFileName);
 	if (inFileStream.is_open() == false)
 		return false;
 
-	json jsonGameData;
+	FAnalysisJsonSaxReader reader(state);
+	if (json::sax_parse(inFileStream, &reader) == false)
+	{
+		LOGERROR("Failed to import analysis from %s", pJsonFileName);
+		return false;
+	}
+
+	return ImportAnalysisJsonDoc(state, reader.GetGlobals());
+}
+
+bool ImportSharedAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName)
+{
+	std::shared_ptr<const json> pJsonDoc;
+	{
+		std::lock_guard<std::mutex> lock(g_SharedJsonLock);
+		auto docIt = g_SharedJsonDocs.find(pJsonFileName);
+		if (docIt != g_SharedJsonDocs.end())
+		{
+			pJsonDoc = docIt->second;
+		}
+		else
+		{
+			std::ifstream inFileStream(pJsonFileName);
+			if (inFileStream.is_open() == false)
+				return false;
+
+			std::shared_ptr<json> pNewDoc = std::make_shared<json>();
+			inFileStream >> *pNewDoc;
+			pJsonDoc = pNewDoc;
+			g_SharedJsonDocs[pJsonFileName] = pJsonDoc;
+		}
+	}
 
-	inFileStream >> jsonGameData;
-	inFileStream.close();
+	// document is read only from here so no lock needed
+	return ImportAnalysisJsonDoc(state, *pJsonDoc);
+}
 
+bool ImportAnalysisJsonDoc(FCodeAnalysisState& state, const json& jsonGameData)
+{
 	if (jsonGameData.contains("Banks"))
 	{
 		for (const auto& bankJson : jsonGameData["Banks"])
@@ -153,7 +430,7 @@ bool ImportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName)
 		for (const auto& commentBlockJson : jsonGameData["CommentBlocks"])
 		{
 			const uint16_t addr = commentBlockJson["Address"];
-			FCommentBlock* pCommentBlock = CreateCommentBlockFromJson(commentBlockJson);
+			FCommentBlock* pCommentBlock = CreateCommentBlockFromJson(state, commentBlockJson);
 			state.SetCommentBlockForAddress(state.AddressRefFromPhysicalAddress(addr), pCommentBlock);
 		}
 	}
@@ -163,7 +440,7 @@ bool ImportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName)
 		for (const auto codeInfoJson : jsonGameData["CodeInfo"])
 		{
 			const uint16_t addr = codeInfoJson["Address"];
-			FCodeInfo* pCodeInfo = CreateCodeInfoFromJson(codeInfoJson);
+			FCodeInfo* pCodeInfo = CreateCodeInfoFromJson(state, codeInfoJson);
 			state.SetCodeInfoForAddress(addr, pCodeInfo);
 
 			// set operand data items
@@ -182,7 +459,7 @@ bool ImportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName)
 		for (const auto labelInfoJson : jsonGameData["LabelInfo"])
 		{
 			const uint16_t addr = labelInfoJson["Address"];
-			FLabelInfo* pLabelInfo = CreateLabelInfoFromJson(labelInfoJson);
+			FLabelInfo* pLabelInfo = CreateLabelInfoFromJson(state, labelInfoJson);
 			state.SetLabelForAddress(addr, pLabelInfo);
 		}
 	}
@@ -392,17 +669,17 @@ void WriteAddressRangeToJson(FCodeAnalysisState& state, int startAddress, int en
 }
 #endif
 
-FCommentBlock* CreateCommentBlockFromJson(const json& commentBlockJson)
+FCommentBlock* CreateCommentBlockFromJson(FCodeAnalysisState& state, const json& commentBlockJson)
 {
-	FCommentBlock* pCommentBlock = FCommentBlock::Allocate();
+	FCommentBlock* pCommentBlock = FCommentBlock::Allocate(state);
 	//pCommentBlock->Address = commentBlockJson["Address"];
 	pCommentBlock->Comment = commentBlockJson["Comment"];
 	return pCommentBlock;
 }
 
-FCodeInfo* CreateCodeInfoFromJson(const json& codeInfoJson)
+FCodeInfo* CreateCodeInfoFromJson(FCodeAnalysisState& state, const json& codeInfoJson)
 {
-	FCodeInfo* pCodeInfo = FCodeInfo::Allocate();
+	FCodeInfo* pCodeInfo = FCodeInfo::Allocate(state);
 	pCodeInfo->ByteSize = codeInfoJson["ByteSize"];
 
 	if (codeInfoJson.contains("SMC"))
@@ -420,9 +697,9 @@ FCodeInfo* CreateCodeInfoFromJson(const json& codeInfoJson)
 	return pCodeInfo;
 }
 
-FLabelInfo* CreateLabelInfoFromJson(const json& labelInfoJson)
+FLabelInfo* CreateLabelInfoFromJson(FCodeAnalysisState& state, const json& labelInfoJson)
 {
-	FLabelInfo* pLabelInfo = FLabelInfo::Allocate();
+	FLabelInfo* pLabelInfo = FLabelInfo::Allocate(state);
 
 	pLabelInfo->Name = labelInfoJson["Name"];
 	if (labelInfoJson.contains("Global"))
@@ -541,37 +818,39 @@ void ReadPageFromJson(FCodeAnalysisState &state, FCodeAnalysisPage& page, const
 {
 	if (jsonDoc.contains("CommentBlocks"))
 	{
-		for (const auto commentBlockJson : jsonDoc["CommentBlocks"])
+		for (const auto& commentBlockJson : jsonDoc["CommentBlocks"])
 		{
 			const uint16_t pageAddr = commentBlockJson["Address"];
-			FCommentBlock* pCommentBlock = CreateCommentBlockFromJson(commentBlockJson);
+			FCommentBlock* pCommentBlock = CreateCommentBlockFromJson(state, commentBlockJson);
 			page.CommentBlocks[pageAddr] = pCommentBlock;
 		}
 	}
 
 	if (jsonDoc.contains("LabelInfo"))
 	{
-		for (const auto labelInfoJson : jsonDoc["LabelInfo"])
+		for (const auto& labelInfoJson : jsonDoc["LabelInfo"])
 		{
 			const uint16_t pageAddr = labelInfoJson["Address"];
-			FLabelInfo* pLabelInfo = CreateLabelInfoFromJson(labelInfoJson);
+			FLabelInfo* pLabelInfo = CreateLabelInfoFromJson(state, labelInfoJson);
 			page.Labels[pageAddr] = pLabelInfo;
+			page.LabelChangeCount++;
 		}
 	}
 
 	if (jsonDoc.contains("CodeInfo"))
 	{
-		for (const auto codeInfoJson : jsonDoc["CodeInfo"])
+		for (const auto& codeInfoJson : jsonDoc["CodeInfo"])
 		{
 			const uint16_t pageAddr = codeInfoJson["Address"];
-			FCodeInfo* pCodeInfo = CreateCodeInfoFromJson(codeInfoJson);
+			FCodeInfo* pCodeInfo = CreateCodeInfoFromJson(state, codeInfoJson);
 			page.CodeInfo[pageAddr] = pCodeInfo;
+			page.AnnotationChangeCount++;
 		}
 	}
 
 	if (jsonDoc.contains("DataInfo"))
 	{
-		for (const auto dataInfoJson : jsonDoc["DataInfo"])
+		for (const auto& dataInfoJson : jsonDoc["DataInfo"])
 		{
 			const uint16_t pageAddr = dataInfoJson["Address"];
 			FDataInfo* pDataInfo = &page.DataInfo[pageAddr];
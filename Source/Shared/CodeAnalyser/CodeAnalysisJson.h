@@ -2,5 +2,12 @@
 
 class FCodeAnalysisState;
 
-bool ExportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName, bool bROMS = false);
+// Pages are streamed to and from the file one at a time.
+// Compact output has no indentation or line breaks, both forms load the same way.
+bool ExportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName, bool bROMS = false, bool bCompact = false);
 bool ImportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName);
+
+// For read only analysis that's the same for every game (e.g. ROMs)
+// The json is parsed once per process and shared by all analysis states that import it.
+// Each state still builds its own ROM pages from it - items come from the state's own pools so the built pages can't be shared.
+bool ImportSharedAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName);
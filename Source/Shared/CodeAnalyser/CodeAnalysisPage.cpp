@@ -3,95 +3,248 @@
 
 #include "Util/MemoryBuffer.h"
 #include "Util/GraphicsView.h"
+#include <algorithm>
 #include <cassert>
 #include <string.h>
 
 //#include "json.hpp"
-std::vector<FCodeInfo*>		FCodeInfo::AllocatedList;
-std::vector<FLabelInfo*>	FLabelInfo::AllocatedList;
-std::vector<FCommentBlock*>	FCommentBlock::AllocatedList;
-
-std::vector<FCommentLine*>	FCommentLine::AllocatedList;
-std::vector<FCommentLine*>	FCommentLine::FreeList;
 
 FImageData::~FImageData() 
 { 
 	delete GraphicsView; 
 }
 
-FCodeInfo* FCodeInfo::Allocate()
+FItemReferenceTracker& FItemReferenceTracker::operator=(const FItemReferenceTracker& other)
 {
-	FCodeInfo* pCodeInfo = new FCodeInfo;
-	AllocatedList.push_back(pCodeInfo);
-	return pCodeInfo;
+	if (this == &other)
+		return *this;
+
+	for (int i = 0; i < kNoInlineRefs; i++)
+	{
+		InlineRefs[i] = other.InlineRefs[i];
+		InlineCounts[i] = other.InlineCounts[i];
+	}
+	NoInlineRefs = other.NoInlineRefs;
+
+	delete pOverflow;
+	pOverflow = other.pOverflow != nullptr ? new FOverflow(*other.pOverflow) : nullptr;
+	return *this;
 }
 
-void FCodeInfo::FreeAll()
+FItemReferenceTracker& FItemReferenceTracker::operator=(FItemReferenceTracker&& other) noexcept
 {
-	for (auto it : AllocatedList)
-		delete it;
+	if (this == &other)
+		return *this;
 
-	AllocatedList.clear();
+	for (int i = 0; i < kNoInlineRefs; i++)
+	{
+		InlineRefs[i] = other.InlineRefs[i];
+		InlineCounts[i] = other.InlineCounts[i];
+	}
+	NoInlineRefs = other.NoInlineRefs;
+
+	delete pOverflow;
+	pOverflow = other.pOverflow;
+	other.pOverflow = nullptr;
+	other.NoInlineRefs = 0;
+	return *this;
+}
+
+void FItemReferenceTracker::Reset()
+{
+	NoInlineRefs = 0;
+	delete pOverflow;
+	pOverflow = nullptr;
 }
 
-FLabelInfo* FLabelInfo::Allocate()
+static inline uint32_t HashAddressRef(const FAddressRef& addrRef)
 {
-	FLabelInfo* pLabelInfo = new FLabelInfo;
-	AllocatedList.push_back(pLabelInfo);
-	return pLabelInfo;
+	return addrRef.Val * 2654435761u;	// Knuth multiplicative hash
 }
 
-void FLabelInfo::FreeAll()
+void FItemReferenceTracker::RegisterAccessOverflow(const FAddressRef& addrRef)
 {
-	for (auto it : AllocatedList)
-		delete it;
+	if (pOverflow == nullptr)
+	{
+		// spill inline refs to the heap
+		pOverflow = new FOverflow;
+		pOverflow->Refs.assign(InlineRefs, InlineRefs + NoInlineRefs);
+		pOverflow->Counts.assign(InlineCounts, InlineCounts + NoInlineRefs);
+		NoInlineRefs = 0;
+	}
+
+	const int refIndex = FindOverflowRef(addrRef);
+	if (refIndex != -1)
+	{
+		pOverflow->Counts[refIndex]++;
+		return;
+	}
+
+	pOverflow->Refs.push_back(addrRef);
+	pOverflow->Counts.push_back(1);
 
-	AllocatedList.clear();
+	const int noRefs = (int)pOverflow->Refs.size();
+	if (noRefs > kMaxLinearSearchRefs)
+	{
+		// keep the table at most half full
+		if (noRefs * 2 > (int)pOverflow->HashTable.size())
+			RebuildHashTable();
+		else
+			InsertIntoHashTable(noRefs - 1);
+	}
 }
 
-FCommentBlock* FCommentBlock::Allocate()
+int FItemReferenceTracker::FindOverflowRef(const FAddressRef& addrRef) const
 {
-	FCommentBlock* pCommentBlock = new FCommentBlock;
-	AllocatedList.push_back(pCommentBlock);
-	return pCommentBlock;
+	const std::vector<FAddressRef>& refs = pOverflow->Refs;
+
+	if (pOverflow->HashTable.empty())
+	{
+		for (int i = 0; i < (int)refs.size(); i++)
+		{
+			if (refs[i] == addrRef)
+				return i;
+		}
+		return -1;
+	}
+
+	const uint32_t mask = (uint32_t)pOverflow->HashTable.size() - 1;
+	uint32_t slot = HashAddressRef(addrRef) & mask;
+	while (pOverflow->HashTable[slot] != -1)
+	{
+		const int refIndex = pOverflow->HashTable[slot];
+		if (refs[refIndex] == addrRef)
+			return refIndex;
+		slot = (slot + 1) & mask;
+	}
+	return -1;
 }
 
-void FCommentBlock::FreeAll()
+void FItemReferenceTracker::InsertIntoHashTable(int refIndex)
 {
-	for (auto it : AllocatedList)
-		delete it;
+	const uint32_t mask = (uint32_t)pOverflow->HashTable.size() - 1;
+	uint32_t slot = HashAddressRef(pOverflow->Refs[refIndex]) & mask;
+	while (pOverflow->HashTable[slot] != -1)
+		slot = (slot + 1) & mask;
+	pOverflow->HashTable[slot] = refIndex;
+}
 
-	AllocatedList.clear();
+void FItemReferenceTracker::RebuildHashTable()
+{
+	size_t tableSize = 64;
+	while (tableSize < pOverflow->Refs.size() * 2)
+		tableSize *= 2;
+
+	pOverflow->HashTable.assign(tableSize, -1);
+	for (int i = 0; i < (int)pOverflow->Refs.size(); i++)
+		InsertIntoHashTable(i);
 }
 
-FCommentLine* FCommentLine::Allocate()
+FCodeInfo* FCodeInfo::Allocate(FCodeAnalysisState& state)
 {
-	if (FreeList.size() == 0)
-		FreeList.push_back(new FCommentLine);
-	
-	FCommentLine* pLine = FreeList.back();
-	AllocatedList.push_back(pLine);
-	FreeList.pop_back();
+	return state.ItemPools.CodeInfo.Allocate();
+}
+
+void FCodeInfo::FreeAll(FCodeAnalysisState& state)
+{
+	state.ItemPools.CodeInfo.Reset();
+}
+
+FLabelInfo* FLabelInfo::Allocate(FCodeAnalysisState& state)
+{
+	return state.ItemPools.Labels.Allocate();
+}
+
+void FLabelInfo::Free(FCodeAnalysisState& state, FLabelInfo* pLabel)
+{
+	state.ItemPools.PendingLabelFrees.push_back(pLabel);
+}
+
+void FLabelInfo::FreeAll(FCodeAnalysisState& state)
+{
+	state.ItemPools.PendingLabelFrees.clear();
+	state.ItemPools.Labels.Reset();
+}
+
+FCommentBlock* FCommentBlock::Allocate(FCodeAnalysisState& state)
+{
+	return state.ItemPools.CommentBlocks.Allocate();
+}
+
+void FCommentBlock::Free(FCodeAnalysisState& state, FCommentBlock* pCommentBlock)
+{
+	state.ItemPools.PendingCommentBlockFrees.push_back(pCommentBlock);
+}
+
+void FCommentBlock::FreeAll(FCodeAnalysisState& state)
+{
+	state.ItemPools.PendingCommentBlockFrees.clear();
+	state.ItemPools.CommentBlocks.Reset();
+}
+
+FCommentLine* FCommentLine::Allocate(FCodeAnalysisState& state)
+{
+	return state.ItemPools.CommentLines.Allocate();
+}
 
-	return pLine;
+void FCommentLine::Free(FCodeAnalysisState& state, FCommentLine* pLine)
+{
+	state.ItemPools.CommentLines.Free(pLine);
 }
 
-void FCommentLine::FreeAll()
+void FCommentLine::FreeAll(FCodeAnalysisState& state)
 {
-	for (auto it : AllocatedList)
-		FreeList.push_back(it);
+	state.ItemPools.CommentLines.Reset();
+}
 
-	AllocatedList.clear();
+template <class T>
+static bool IsPendingFree(const std::vector<T*>& pendingFrees, const FItem* pItem)
+{
+	return std::find(pendingFrees.begin(), pendingFrees.end(), pItem) != pendingFrees.end();
 }
 
+void ReleasePendingItemFrees(FCodeAnalysisState& state)
+{
+	FItemPools& pools = state.ItemPools;
+	if (pools.PendingLabelFrees.empty() && pools.PendingCommentBlockFrees.empty())
+		return;
+
+	// cursors aren't in the lists
+	for (int i = 0; i < FCodeAnalysisState::kNoViewStates; i++)
+	{
+		FCodeAnalysisViewState& viewState = state.ViewState[i];
+		const FItem* pCursorItem = viewState.GetCursorItem().Item;
+		if (IsPendingFree(pools.PendingLabelFrees, pCursorItem) || IsPendingFree(pools.PendingCommentBlockFrees, pCursorItem))
+			viewState.SetCursorItem(FCodeAnalysisItem());
+	}
+
+	if (pools.PendingLabelFrees.empty() == false)
+	{
+		state.bRebuildFilteredGlobalDataItems = true;
+		state.bRebuildFilteredGlobalFunctions = true;
+	}
+
+	for (FLabelInfo* pLabel : pools.PendingLabelFrees)
+		pools.Labels.Free(pLabel);
+	for (FCommentBlock* pCommentBlock : pools.PendingCommentBlockFrees)
+		pools.CommentBlocks.Free(pCommentBlock);
+	pools.PendingLabelFrees.clear();
+	pools.PendingCommentBlockFrees.clear();
+}
+
+
+const FItemReferenceTracker FCodeAnalysisPage::kNoReferences;
 
 void FCodeAnalysisPage::Initialise()
 {
 	bUsed = false;
 	
 	memset(Labels, 0, sizeof(Labels));
+	LabelChangeCount++;
 	memset(CodeInfo, 0, sizeof(CodeInfo));
+	AnnotationChangeCount++;
 	memset(CommentBlocks, 0, sizeof(CommentBlocks));
+	ResetAccessInfo();
 
 	for (int addr = 0; addr < FCodeAnalysisPage::kPageSize; addr++)
 	{
@@ -103,6 +256,58 @@ void FCodeAnalysisPage::Initialise()
 }
 
 
+void FCodeAnalysisPage::ResetAccessInfo()
+{
+	SnapshotChangeCount++;
+	for (int addr = 0; addr < FCodeAnalysisPage::kPageSize; addr++)
+	{
+		LastFrameRead[addr] = -1;
+		LastFrameWritten[addr] = -1;
+		LastWriter[addr] = FAddressRef();
+	}
+	memset(ReadRefsIndex, 0, sizeof(ReadRefsIndex));
+	memset(WriteRefsIndex, 0, sizeof(WriteRefsIndex));
+	ReferenceSets.clear();
+
+	// nothing has been accessed now
+	Coverage.Unknown += Coverage.ReadOnlyData + Coverage.WriteOnlyData + Coverage.ReadWriteData;
+	Coverage.ReadOnlyData = 0;
+	Coverage.WriteOnlyData = 0;
+	Coverage.ReadWriteData = 0;
+}
+
+void FCodeAnalysisPage::UpdateCoverage()
+{
+	if (CoverageAnnotationChangeCount == AnnotationChangeCount)
+		return;
+
+	Coverage = FCoverageStats();
+	for (int addr = 0; addr < FCodeAnalysisPage::kPageSize; addr++)
+	{
+		const FCodeInfo* pCodeInfo = CodeInfo[addr];
+		if (pCodeInfo != nullptr)
+		{
+			if (pCodeInfo->Comment.empty())
+				Coverage.UncommentedCode++;
+			else
+				Coverage.CommentedCode++;
+			continue;
+		}
+
+		const bool bRead = LastFrameRead[addr] != -1;
+		const bool bWritten = LastFrameWritten[addr] != -1;
+		if (bRead && bWritten)
+			Coverage.ReadWriteData++;
+		else if (bRead)
+			Coverage.ReadOnlyData++;
+		else if (bWritten)
+			Coverage.WriteOnlyData++;
+		else
+			Coverage.Unknown++;
+	}
+	CoverageAnnotationChangeCount = AnnotationChangeCount;
+}
+
 void FCodeAnalysisPage::Reset(void)
 {
 	for (int addr = 0; addr < FCodeAnalysisPage::kPageSize; addr++)
@@ -114,7 +319,7 @@ void FCodeAnalysisPage::Reset(void)
 		MachineState[addr] = nullptr;
 	}
 
-	Initialise();
+	Initialise();	// bumps SnapshotChangeCount
 }
 
 static const uint32_t kMagic = 0xc0de;
@@ -293,17 +498,18 @@ bool FCodeAnalysisPage::ReadFromBuffer(FMemoryBuffer& buffer)
 }
 #endif
 
-void FCodeAnalysisPage::SetLabelAtAddress(const char* pLabelName, ELabelType type, uint16_t addr)
+void FCodeAnalysisPage::SetLabelAtAddress(FCodeAnalysisState& state, const char* pLabelName, ELabelType type, uint16_t addr)
 {
 	FLabelInfo* pLabel = Labels[addr];
 	if (pLabel == nullptr)
 	{
-		pLabel = FLabelInfo::Allocate();
+		pLabel = FLabelInfo::Allocate(state);
 		Labels[addr] = pLabel;
 	}
 
 	pLabel->Name = pLabelName;
 	pLabel->LabelType = type;
+	LabelChangeCount++;
 }
 
 
@@ -1,15 +1,18 @@
 #pragma once
 #include <stdio.h>
 #include <cstdint>
+#include <deque>
 #include <string>
 //#include <map>
 #include <vector>
 
 #include <Util/Misc.h>
+#include <Util/ItemPool.h>
 
 #include "CodeAnalyserTypes.h"
 
 class FMemoryBuffer;
+class FCodeAnalysisState;
 
 // don't change order or you'll mess up the load/save
 enum class ELabelType
@@ -65,33 +68,96 @@ struct FItem
 	//int16_t		InstructionPageId = 0;
 };*/
 
+// read only view of the references in a tracker
+struct FReferenceList
+{
+	const FAddressRef*	pRefs = nullptr;
+	int					Count = 0;
+
+	const FAddressRef*	begin() const { return pRefs; }
+	const FAddressRef*	end() const { return pRefs + Count; }
+	size_t				size() const { return Count; }
+	bool				empty() const { return Count == 0; }
+	const FAddressRef&	operator[](int index) const { return pRefs[index]; }
+};
+
+// Set of addresses that reference an item, with a hit count for each reference
+// The first few references are stored inline, bigger sets spill to the heap and get a hash index
 class FItemReferenceTracker
 {
 public:
-	void Reset() { References.clear(); }
-	
+	FItemReferenceTracker() = default;
+	FItemReferenceTracker(const FItemReferenceTracker& other) { *this = other; }
+	FItemReferenceTracker(FItemReferenceTracker&& other) noexcept { *this = std::move(other); }
+	~FItemReferenceTracker() { delete pOverflow; }
+
+	FItemReferenceTracker& operator=(const FItemReferenceTracker& other);
+	FItemReferenceTracker& operator=(FItemReferenceTracker&& other) noexcept;
+
+	void	Reset();
+
 	void	RegisterAccess(const FAddressRef& addrRef)
 	{
-		const auto size = References.size();
-		for (int i = 0; i < size; i++)
+		if (pOverflow == nullptr)
 		{
-			if (References[i] == addrRef)
+			for (int i = 0; i < NoInlineRefs; i++)
+			{
+				if (InlineRefs[i] == addrRef)
+				{
+					InlineCounts[i]++;
+					return;
+				}
+			}
+
+			if (NoInlineRefs < kNoInlineRefs)
+			{
+				InlineRefs[NoInlineRefs] = addrRef;
+				InlineCounts[NoInlineRefs++] = 1;
 				return;
+			}
 		}
 
-		References.emplace_back(addrRef);
+		RegisterAccessOverflow(addrRef);
 	}
 
-	bool IsEmpty() const { return References.empty(); }
-	const std::vector<FAddressRef>& GetReferences() const { return References; }
+	bool		IsEmpty() const { return GetNoReferences() == 0; }
+	int			GetNoReferences() const { return pOverflow != nullptr ? (int)pOverflow->Refs.size() : NoInlineRefs; }
+	FReferenceList	GetReferences() const 
+	{ 
+		if (pOverflow != nullptr)
+			return { pOverflow->Refs.data(), (int)pOverflow->Refs.size() };
+		return { InlineRefs, NoInlineRefs };
+	}
+	// hit count for reference at index in GetReferences()
+	uint32_t	GetCount(int index) const { return pOverflow != nullptr ? pOverflow->Counts[index] : InlineCounts[index]; }
+
 private:
-	std::vector<FAddressRef>	References;
+	static const int kNoInlineRefs = 4;
+	static const int kMaxLinearSearchRefs = 16;	// beyond this a hash index is used
+
+	struct FOverflow
+	{
+		std::vector<FAddressRef>	Refs;
+		std::vector<uint32_t>		Counts;
+		std::vector<int32_t>		HashTable;	// open addressed indices into Refs, -1 = empty
+	};
+
+	void	RegisterAccessOverflow(const FAddressRef& addrRef);
+	int		FindOverflowRef(const FAddressRef& addrRef) const;
+	void	InsertIntoHashTable(int refIndex);
+	void	RebuildHashTable();
+
+	FAddressRef	InlineRefs[kNoInlineRefs];
+	uint32_t	InlineCounts[kNoInlineRefs] = { 0 };
+	int			NoInlineRefs = 0;
+	FOverflow*	pOverflow = nullptr;
 };
 
 struct FLabelInfo : FItem
 {
-	static FLabelInfo* Allocate();
-	static void FreeAll();
+	static FLabelInfo* Allocate(FCodeAnalysisState& state);
+	static void Free(FCodeAnalysisState& state, FLabelInfo* pLabel);
+	static void FreeAll(FCodeAnalysisState& state);
 
 	std::string				Name;
 	bool					Global = false;
@@ -99,16 +165,15 @@ struct FLabelInfo : FItem
 	FItemReferenceTracker	References;
 	//std::map<uint16_t, int>	References;
 private:
+	template <class, int> friend class FItemPool;
 	FLabelInfo() { Type = EItemType::Label; }
 	~FLabelInfo() = default;
-
-	static std::vector<FLabelInfo*>	AllocatedList;
 };
 
 struct FCodeInfo : FItem
 {
-	static FCodeInfo* Allocate();
-	static void FreeAll();
+	static FCodeInfo* Allocate(FCodeAnalysisState& state);
+	static void FreeAll(FCodeAnalysisState& state);
 
 	EOperandType	OperandType = EOperandType::Unknown;
 	std::string		Text;				// Disassembly text
@@ -131,10 +196,9 @@ struct FCodeInfo : FItem
 	bool	bNOPped = false;
 	uint8_t	OpcodeBkp[4] = { 0 };
 private:
+	template <class, int> friend class FItemPool;
 	FCodeInfo() :FItem(){Type = EItemType::Code;	}
 	~FCodeInfo() = default;
-
-	static std::vector<FCodeInfo*>	AllocatedList;
 };
 
 
@@ -186,10 +250,6 @@ struct FDataInfo : FItem
 		DataType = EDataType::Byte;
 		OperandType = EOperandType::Unknown;
 		Comment.clear();
-		LastFrameRead = -1;
-		Reads.Reset();
-		LastFrameWritten = -1;
-		Writes.Reset();
 	}
 
 	EDataType	DataType = EDataType::Byte;
@@ -220,43 +280,92 @@ struct FDataInfo : FItem
 	};
 	uint8_t		EmptyCharNo = 0;
 
-	int						LastFrameRead = -1;
-	FItemReferenceTracker	Reads;	// address and counts of data access instructions
-	int						LastFrameWritten = -1;
-	FItemReferenceTracker	Writes;	// address and counts of data access instructions
-	FAddressRef				LastWriter;
+	// read/write tracking lives in the page's access arrays - see FCodeAnalysisPage
 };
 
 struct FCommentBlock : FItem
 {
-	static FCommentBlock* Allocate();
-	static void FreeAll();
+	static FCommentBlock* Allocate(FCodeAnalysisState& state);
+	static void Free(FCodeAnalysisState& state, FCommentBlock* pCommentBlock);
+	static void FreeAll(FCodeAnalysisState& state);
 
 private:
+	template <class, int> friend class FItemPool;
 	FCommentBlock() : FItem() { Type = EItemType::CommentBlock; }
 	~FCommentBlock() = default;
-	static std::vector<FCommentBlock*>	AllocatedList;
 };
 
 struct FCommentLine : FItem
 {
 
-	static FCommentLine* Allocate();
-	static void FreeAll();
+	static FCommentLine* Allocate(FCodeAnalysisState& state);
+	static void Free(FCodeAnalysisState& state, FCommentLine* pLine);
+	static void FreeAll(FCodeAnalysisState& state);
 private:
+	template <class, int> friend class FItemPool;
 	FCommentLine() : FItem() { Type = EItemType::CommentLine; }
 	~FCommentLine() = default;
+};
 
-	static std::vector<FCommentLine*>	AllocatedList;
-	static std::vector<FCommentLine*>	FreeList;
+// Pools for items allocated by an analysis state - each state owns its own so several can run side by side
+struct FItemPools
+{
+	FItemPool<FCodeInfo>			CodeInfo;
+	FItemPool<FLabelInfo>			Labels;
+	FItemPool<FCommentBlock>		CommentBlocks;
+	FItemPool<FCommentLine, 256>	CommentLines;
+
+	// removed labels & comment blocks can still be in the item lists & view cursors
+	// so they only go back to the pools once the lists have been rebuilt
+	std::vector<FLabelInfo*>		PendingLabelFrees;
+	std::vector<FCommentBlock*>		PendingCommentBlockFrees;
 };
 
+// return removed items to the pools - call after the item lists have been rebuilt
+void ReleasePendingItemFrees(FCodeAnalysisState& state);
+
 // abstract machine state class - device specific
 struct FMachineState
 {
 
 };
 
+// number of bytes classified as each kind of code or data
+struct FCoverageStats
+{
+	int		CommentedCode = 0;
+	int		UncommentedCode = 0;
+	int		ReadOnlyData = 0;
+	int		WriteOnlyData = 0;
+	int		ReadWriteData = 0;
+	int		Unknown = 0;	// data that hasn't been accessed
+
+	int		GetTotal() const { return CommentedCode + UncommentedCode + ReadOnlyData + WriteOnlyData + ReadWriteData + Unknown; }
+
+	// data byte accessed for the first time
+	void	AddFirstRead(bool bWritten)
+	{
+		if (bWritten) { WriteOnlyData--; ReadWriteData++; }
+		else { Unknown--; ReadOnlyData++; }
+	}
+	void	AddFirstWrite(bool bRead)
+	{
+		if (bRead) { ReadOnlyData--; ReadWriteData++; }
+		else { Unknown--; WriteOnlyData++; }
+	}
+
+	FCoverageStats& operator+=(const FCoverageStats& other)
+	{
+		CommentedCode += other.CommentedCode;
+		UncommentedCode += other.UncommentedCode;
+		ReadOnlyData += other.ReadOnlyData;
+		WriteOnlyData += other.WriteOnlyData;
+		ReadWriteData += other.ReadWriteData;
+		Unknown += other.Unknown;
+		return *this;
+	}
+};
+
 struct FCodeAnalysisPage
 {
 	void Initialise();
@@ -264,17 +373,85 @@ struct FCodeAnalysisPage
 	//void WriteToBuffer(FMemoryBuffer& buffer);
 	//bool ReadFromBuffer(FMemoryBuffer& buffer);
 
-	void SetLabelAtAddress(const char* pLabelName, ELabelType type, uint16_t addr);
+	void SetLabelAtAddress(FCodeAnalysisState& state, const char* pLabelName, ELabelType type, uint16_t addr);
 	static const int kPageSize = 1024;	// 1Kb page
 	static const int kPageShift = 10;	// 1Kb page
 	static const int kPageMask = kPageSize - 1;
 
+	// Data access tracking
+	const FItemReferenceTracker& GetReads(uint16_t pageAddr) const { return ReadRefsIndex[pageAddr] != 0 ? ReferenceSets[ReadRefsIndex[pageAddr] - 1] : kNoReferences; }
+	const FItemReferenceTracker& GetWrites(uint16_t pageAddr) const { return WriteRefsIndex[pageAddr] != 0 ? ReferenceSets[WriteRefsIndex[pageAddr] - 1] : kNoReferences; }
+	FItemReferenceTracker& GetOrCreateReads(uint16_t pageAddr) { return GetOrCreateReferenceSet(ReadRefsIndex[pageAddr]); }
+	FItemReferenceTracker& GetOrCreateWrites(uint16_t pageAddr) { return GetOrCreateReferenceSet(WriteRefsIndex[pageAddr]); }
+
+	void RegisterRead(uint16_t pageAddr, FAddressRef pc, int frameNo)
+	{
+		RegisterAccessChange(frameNo, LastFrameRead[pageAddr] == -1);
+		if (LastFrameRead[pageAddr] == -1 && CodeInfo[pageAddr] == nullptr)
+			Coverage.AddFirstRead(LastFrameWritten[pageAddr] != -1);
+		LastFrameRead[pageAddr] = frameNo;
+		GetOrCreateReads(pageAddr).RegisterAccess(pc);
+	}
+
+	void RegisterWrite(uint16_t pageAddr, FAddressRef pc, int frameNo)
+	{
+		RegisterAccessChange(frameNo, LastFrameWritten[pageAddr] == -1);
+		if (LastFrameWritten[pageAddr] == -1 && CodeInfo[pageAddr] == nullptr)
+			Coverage.AddFirstWrite(LastFrameRead[pageAddr] != -1);
+		LastFrameWritten[pageAddr] = frameNo;
+		GetOrCreateWrites(pageAddr).RegisterAccess(pc);
+	}
+
+	// Snapshots copy a page when SnapshotChangeCount moves.
+	// First accesses always count, repeat accesses only once every kAccessChangeFrames so busy pages aren't copied every frame.
+	// The heatmap drawn from snapshots can lag by that many frames.
+	static const int kAccessChangeFrames = 4;
+	void RegisterAccessChange(int frameNo, bool bFirstAccess)
+	{
+		if (bFirstAccess || frameNo - AccessChangeFrameNo >= kAccessChangeFrames)
+		{
+			SnapshotChangeCount++;
+			AccessChangeFrameNo = frameNo;
+		}
+	}
+
+	void ResetAccessInfo();
+	void UpdateCoverage();	// counts the page again if code or comments have changed
+
+	static const FItemReferenceTracker	kNoReferences;
+
 	bool			bUsed = false;	// has this page been used?
 	int16_t			PageId = -1;
 	FLabelInfo*		Labels[kPageSize];
 	FCodeInfo*		CodeInfo[kPageSize];
-	FDataInfo		DataInfo[kPageSize];
+	FDataInfo		DataInfo[kPageSize];	// annotation data, only touched by analysis & UI
 	FCommentBlock*	CommentBlocks[kPageSize];
 
 	FMachineState*	MachineState[kPageSize];
+
+	// Hot access tracking state, updated on every memory access when registering data accesses.
+	// Kept as dense arrays so the emulation loop doesn't pull FDataInfo into the cache.
+	int				LastFrameRead[kPageSize];
+	int				LastFrameWritten[kPageSize];
+	FAddressRef		LastWriter[kPageSize];
+	uint16_t		ReadRefsIndex[kPageSize];	// 1 based index into ReferenceSets, 0 = no references
+	uint16_t		WriteRefsIndex[kPageSize];
+	std::deque<FItemReferenceTracker>	ReferenceSets;	// only allocated for addresses that have been accessed
+	uint32_t		SnapshotChangeCount = 0;	// bumped when access or execution info changes in a way the UI can see, never reset so snapshots can compare it
+	int				AccessChangeFrameNo = -kAccessChangeFrames;	// frame an access last bumped SnapshotChangeCount
+	uint32_t		LabelChangeCount = 0;	// bumped when labels are added, removed or change type
+	uint32_t		AnnotationChangeCount = 0;	// bumped when code info or comments change
+	FCoverageStats	Coverage;	// access counts are kept up to date as data is first read or written
+	uint32_t		CoverageAnnotationChangeCount = ~0u;	// AnnotationChangeCount when Coverage was last counted
+
+private:
+	FItemReferenceTracker& GetOrCreateReferenceSet(uint16_t& refsIndex)
+	{
+		if (refsIndex == 0)
+		{
+			ReferenceSets.emplace_back();
+			refsIndex = (uint16_t)ReferenceSets.size();
+		}
+		return ReferenceSets[refsIndex - 1];
+	}
 };
\ No newline at end of file
@@ -3,6 +3,10 @@
 #include <stdint.h>
 #include "CodeAnalysisPage.h"
 #include "CodeAnalyser.h"
+#include "AnalysisPageDatabase.h"
+
+#include <string.h>
+#include <vector>
 
 const uint32_t kAnalysisStateMagic = 0xBeefCafe;
 const uint32_t kAnalysisStatePageMagic = 0xDeadCafe;
@@ -39,29 +43,32 @@ void WritePageState(const FCodeAnalysisPage& page, FILE* fp)
 		if (pCodeInfoItem == nullptr || pCodeInfoItem->bSelfModifyingCode == true)
 		{
 			const FDataInfo* pDataInfo = &page.DataInfo[pageAddr];
+			const FItemReferenceTracker& reads = page.GetReads(pageAddr);
+			const FItemReferenceTracker& writes = page.GetWrites(pageAddr);
+			const FAddressRef lastWriter = page.LastWriter[pageAddr];
 
 			// check if we need to write
-			if (pDataInfo->Reads.GetReferences().empty() == false ||
-				pDataInfo->Writes.GetReferences().empty() == false ||
-				pDataInfo->LastWriter.IsValid())
+			if (reads.IsEmpty() == false ||
+				writes.IsEmpty() == false ||
+				lastWriter.IsValid())
 			{
 				const uint16_t itemId = pageAddr | kDataId;
 				fwrite(&itemId, sizeof(itemId), 1, fp);
 
 				// Reads
-				tempU16 = (uint16_t)pDataInfo->Reads.GetReferences().size();
+				tempU16 = (uint16_t)reads.GetReferences().size();
 				fwrite(&tempU16, sizeof(tempU16), 1, fp);
-				for (const auto& read : pDataInfo->Reads.GetReferences())
+				for (const auto& read : reads.GetReferences())
 					fwrite(&read.Val, sizeof(read.Val), 1, fp);
 
 				// Writes
-				tempU16 = (uint16_t)pDataInfo->Writes.GetReferences().size();
+				tempU16 = (uint16_t)writes.GetReferences().size();
 				fwrite(&tempU16, sizeof(tempU16), 1, fp);
-				for (const auto& write : pDataInfo->Writes.GetReferences())
+				for (const auto& write : writes.GetReferences())
 					fwrite(&write.Val, sizeof(write.Val), 1, fp);
 
 				// Last Writer
-				fwrite(&pDataInfo->LastWriter.Val, sizeof(pDataInfo->LastWriter), 1, fp);
+				fwrite(&lastWriter.Val, sizeof(lastWriter), 1, fp);
 			}
 
 			pageAddr += pDataInfo->ByteSize;
@@ -76,10 +83,60 @@ void WritePageState(const FCodeAnalysisPage& page, FILE* fp)
 	fwrite(&kTerminatorId, sizeof(kTerminatorId), 1, fp);
 }
 
-void ReadPageState(FCodeAnalysisPage& page, FILE* fp)
+// copies a page's section of the state file, so it can be read in now or kept until the page is loaded
+static void ReadPageStateSection(FILE* fp, std::vector<uint8_t>& outSection)
 {
+	outSection.clear();
+	auto copyBytes = [fp, &outSection](size_t size)
+	{
+		const size_t offset = outSection.size();
+		outSection.resize(offset + size, 0);
+		fread(outSection.data() + offset, size, 1, fp);
+		return outSection.data() + offset;
+	};
+	auto copyRefs = [&copyBytes]()
+	{
+		uint16_t count;
+		memcpy(&count, copyBytes(sizeof(count)), sizeof(count));
+		copyBytes(count * sizeof(FAddressRef::Val));
+	};
+
 	uint16_t itemId;
-	fread(&itemId, sizeof(itemId), 1, fp);
+	memcpy(&itemId, copyBytes(sizeof(itemId)), sizeof(itemId));
+
+	while (itemId != kTerminatorId && feof(fp) == 0)
+	{
+		if (itemId & kLabelId)
+		{
+			copyRefs();
+		}
+		else if (itemId & kDataId)
+		{
+			copyRefs();	// Reads
+			copyRefs();	// Writes
+			copyBytes(sizeof(FAddressRef::Val));	// Last Writer
+		}
+
+		memcpy(&itemId, copyBytes(sizeof(itemId)), sizeof(itemId));
+	}
+
+	if (itemId != kTerminatorId)	// truncated file
+		memcpy(copyBytes(sizeof(kTerminatorId)), &kTerminatorId, sizeof(kTerminatorId));
+}
+
+template <typename T>
+static T ReadStateValue(const uint8_t*& pData)
+{
+	T value;
+	memcpy(&value, pData, sizeof(T));
+	pData += sizeof(T);
+	return value;
+}
+
+void ReadPageState(FCodeAnalysisPage& page, const std::vector<uint8_t>& section)
+{
+	const uint8_t* pData = section.data();
+	uint16_t itemId = ReadStateValue<uint16_t>(pData);
 
 	while (itemId != kTerminatorId)
 	{
@@ -90,52 +147,62 @@ void ReadPageState(FCodeAnalysisPage& page, FILE* fp)
 			FLabelInfo* pLabelInfo = page.Labels[pageAddr];
 			//assert(pLabelInfo != nullptr);
 
-			uint16_t count;
-			fread(&count, sizeof(count), 1, fp);
+			const uint16_t count = ReadStateValue<uint16_t>(pData);
 
 			if (pLabelInfo != nullptr)
 				pLabelInfo->References.Reset();
 			for (int i = 0; i < count; i++)
 			{
 				FAddressRef ref;
-				fread(&ref.Val, sizeof(ref.Val), 1, fp);
+				ref.Val = ReadStateValue<uint32_t>(pData);
 				if (pLabelInfo != nullptr)
 					pLabelInfo->References.RegisterAccess(ref);
 			}
 		}
 		else if (itemId & kDataId)
 		{
-			FDataInfo& dataItem = page.DataInfo[pageAddr];
 			uint16_t count;
 
 			// Reads
-			fread(&count, sizeof(count), 1, fp);
-			dataItem.Reads.Reset();
+			count = ReadStateValue<uint16_t>(pData);
+			FItemReferenceTracker& reads = page.GetOrCreateReads(pageAddr);
+			reads.Reset();
 			for (int i = 0; i < count; i++)
 			{
 				FAddressRef ref;
-				fread(&ref.Val, sizeof(ref.Val), 1, fp);
-				dataItem.Reads.RegisterAccess(ref);
+				ref.Val = ReadStateValue<uint32_t>(pData);
+				reads.RegisterAccess(ref);
 			}
 
 			// Writes
-			fread(&count, sizeof(count), 1, fp);
-			dataItem.Writes.Reset();
+			count = ReadStateValue<uint16_t>(pData);
+			FItemReferenceTracker& writes = page.GetOrCreateWrites(pageAddr);
+			writes.Reset();
 			for (int i = 0; i < count; i++)
 			{
 				FAddressRef ref;
-				fread(&ref.Val, sizeof(ref.Val), 1, fp);
-				dataItem.Writes.RegisterAccess(ref);
+				ref.Val = ReadStateValue<uint32_t>(pData);
+				writes.RegisterAccess(ref);
 			}
 
 			// Last Writer
-			fread(&dataItem.LastWriter.Val, sizeof(dataItem.LastWriter.Val), 1, fp);
+			page.LastWriter[pageAddr].Val = ReadStateValue<uint32_t>(pData);
 		}
 
-		fread(&itemId, sizeof(itemId), 1, fp);
+		itemId = ReadStateValue<uint16_t>(pData);
 	}
 }
 
+void ApplyPendingPageState(FCodeAnalysisState& state, FCodeAnalysisPage& page)
+{
+	auto stateIt = state.PendingPageStates.find(page.PageId);
+	if (stateIt == state.PendingPageStates.end())
+		return;
+
+	ReadPageState(page, stateIt->second);
+	state.PendingPageStates.erase(stateIt);
+}
+
 bool ExportAnalysisState(FCodeAnalysisState& state, const char* pAnalysisBinFile)
 {
 	FILE* fp = fopen(pAnalysisBinFile, "wb");
@@ -158,7 +225,15 @@ bool ExportAnalysisState(FCodeAnalysisState& state, const char* pAnalysisBinFile
 		for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
 		{
 			const FCodeAnalysisPage& page = bank.Pages[pageNo];
-			if (page.bUsed)
+			auto pendingIt = state.PendingPageStates.find(page.PageId);
+			if (pendingIt != state.PendingPageStates.end())	// not read in yet so it hasn't changed
+			{
+				fwrite(&kAnalysisStatePageMagic, sizeof(kAnalysisStatePageMagic), 1, fp);
+				fwrite(&page.PageId, sizeof(page.PageId), 1, fp);
+				fwrite(pendingIt->second.data(), 1, pendingIt->second.size(), fp);
+				pagesWritten++;
+			}
+			else if (page.bUsed)
 			{
 				WritePageState(page, fp);
 				pagesWritten++;
@@ -198,11 +273,18 @@ bool ImportAnalysisState(FCodeAnalysisState& state, const char* pAnalysisBinFile
 	assert(magic == kAnalysisStatePageMagic);
 	fread(&pageId, sizeof(pageId), 1, fp);
 
+	std::vector<uint8_t> section;
 	while (pageId != kTerminatorId)
 	{
 		FCodeAnalysisPage* pPage = state.GetPage(pageId);
 		assert(pPage != nullptr);
-		ReadPageState(*pPage, fp);
+		ReadPageStateSection(fp, section);
+
+		// label references need the labels, so pages still in the database wait until they're read in
+		if (state.pAnalysisDatabase != nullptr && state.pAnalysisDatabase->IsPageWaitingToLoad(pageId))
+			state.PendingPageStates[pageId] = section;
+		else
+			ReadPageState(*pPage, section);
 
 		// get next pageId
 		fread(&magic, sizeof(magic), 1, fp);
@@ -1,6 +1,8 @@
 #pragma once
 
 class FCodeAnalysisState;
+struct FCodeAnalysisPage;
 
 bool ExportAnalysisState(FCodeAnalysisState& state, const char* pAnalysisBinFile);
 bool ImportAnalysisState(FCodeAnalysisState& state, const char* pAnalysisBinFile);
+void ApplyPendingPageState(FCodeAnalysisState& state, FCodeAnalysisPage& page);	// state ImportAnalysisState held back until the page was read in
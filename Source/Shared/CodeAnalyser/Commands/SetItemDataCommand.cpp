@@ -52,7 +52,10 @@ void FSetItemDataCommand::Do(FCodeAnalysisState& state)
 
 			FLabelInfo* pLabelInfo = state.GetLabelForAddress(Item.AddressRef);
 			if (pLabelInfo != nullptr)
+			{
 				pLabelInfo->LabelType = ELabelType::Data;
+				state.SetLabelChanged(Item.AddressRef);
+			}
 		}
 	}
 }
@@ -10,13 +10,8 @@
 #include "6502/M6502Disassembler.h"
 #include <Util/GraphicsView.h>
 
-static const uint32_t	BPMask_Exec			= 0x0001;
-static const uint32_t	BPMask_DataWrite	= 0x0002;
-static const uint32_t	BPMask_DataRead		= 0x0004;
-static const uint32_t	BPMask_IORead		= 0x0008;
-static const uint32_t	BPMask_IOWrite		= 0x0010;
-static const uint32_t	BPMask_IRQ			= 0x0020;
-static const uint32_t	BPMask_NMI			= 0x0040;
+#include <algorithm>
+#include <cstring>
 
 void FDebugger::Init(FCodeAnalysisState* pCA)
 {
@@ -30,57 +25,88 @@ void FDebugger::Init(FCodeAnalysisState* pCA)
 
     Watches.clear();
 	Stacks.clear();
+	EventTrace.Init();
 
 	StackMin = 0xffff;
 	StackMax = 0;
 }
 
-void FDebugger::CPUTick(uint64_t pins)
+FCPUTickInfo FDebugger::DecodeZ80TickPins(uint64_t pins, uint64_t lastPins, bool bOpDone, bool bIff1)
 {
-    const uint64_t risingPins = pins & (pins ^ LastTickPins);
-    int trapId = kTrapId_None;
-
-    uint16_t addr = 0;
-	bool bMemAccess = false;
-	bool bWrite = false;
-	bool bRead = false;
-	bool bNewOp = false;
-	bool bIORead = false;
-	bool bIOWrite = false;
-	bool bIrq = false;
-	bool bNMI = false;
-	uint32_t BPMaskCheck = 0;
+	FCPUTickInfo tick;
+	const uint64_t ctrlPins = pins & Z80_CTRL_PIN_MASK;
+	tick.Pins = pins;
+	tick.RisingPins = pins & (pins ^ lastPins);
+	tick.Address = Z80_GET_ADDR(pins);
+	tick.Data = Z80_GET_DATA(pins);
+
+	// a new access if the control pins or address have changed since the last tick
+	tick.bNewBusCycle = (ctrlPins & (Z80_MREQ | Z80_IORQ)) && ((pins ^ lastPins) & (Z80_CTRL_PIN_MASK | 0xffff));
+	if (tick.bNewBusCycle)
+	{
+		tick.bMemRead = (ctrlPins & (Z80_MREQ | Z80_RD)) == (Z80_MREQ | Z80_RD);
+		tick.bMemWrite = (ctrlPins & (Z80_MREQ | Z80_WR)) == (Z80_MREQ | Z80_WR);
+		tick.bOpcodeFetch = tick.bMemRead && (ctrlPins & Z80_M1);
+		tick.bIORead = ctrlPins == (Z80_IORQ | Z80_RD);
+		tick.bIOWrite = ctrlPins == (Z80_IORQ | Z80_WR);
+	}
+	tick.bNewOp = bOpDone;
+	tick.bIrq = (pins & Z80_INT) && bIff1;
+	tick.bNMI = tick.RisingPins & Z80_NMI;
+	return tick;
+}
 
-    if (CPUType == ECPUType::Z80)
-    {
-        addr = Z80_GET_ADDR(pins);
-
-        bMemAccess = !!((pins & Z80_CTRL_PIN_MASK) & Z80_MREQ);
-		bWrite = (risingPins & Z80_CTRL_PIN_MASK) == (Z80_MREQ | Z80_WR);
-		bRead = (risingPins & Z80_CTRL_PIN_MASK) == (Z80_MREQ | Z80_RD);
-        bNewOp = z80_opdone(pZ80);
-		bIORead = (pins & Z80_CTRL_PIN_MASK) == (Z80_IORQ | Z80_RD);
-		bIOWrite = (pins & Z80_CTRL_PIN_MASK) == (Z80_IORQ | Z80_WR);
-		bIrq = (pins & Z80_INT) && pZ80->iff1;
-		bNMI = risingPins & Z80_NMI;
-    }
-    else if (CPUType == ECPUType::M6502)
-    {
-		addr = M6502_GET_ADDR(pins);
-		// TODO: bMemAccess
-		// TODO: bWrite
-		// TODO: bRead
-		bNewOp =  pins & M6502_SYNC;
-		bIrq = risingPins & M6502_IRQ;
-		bNMI = risingPins & M6502_NMI;
+FCPUTickInfo FDebugger::DecodeTickPins(uint64_t pins) const
+{
+	if (CPUType == ECPUType::Z80)
+		return DecodeZ80TickPins(pins, LastTickPins, z80_opdone(pZ80), pZ80->iff1);
+
+	FCPUTickInfo tick;
+	tick.Pins = pins;
+	tick.RisingPins = pins & (pins ^ LastTickPins);
+
+	if (CPUType == ECPUType::M6502)
+	{
+		tick.Address = M6502_GET_ADDR(pins);
+		tick.Data = M6502_GET_DATA(pins);
+		// TODO: bMemRead
+		// TODO: bMemWrite
+		tick.bNewOp = pins & M6502_SYNC;
+		tick.bIrq = tick.RisingPins & M6502_IRQ;
+		tick.bNMI = tick.RisingPins & M6502_NMI;
 	}
 
-	// setup breakpoint mask to check
-	BPMaskCheck |= bWrite ? BPMask_DataWrite : 0;
+	return tick;
+}
 
-    const FAddressRef addrRef = pCodeAnalysis->AddressRefFromPhysicalAddress(addr);
+void FDebugger::CPUTick(const FCPUTickInfo& tick)
+{
+	const uint64_t pins = tick.Pins;
+	const uint16_t addr = tick.Address;
+	const bool bWrite = tick.bMemWrite;
+	const bool bRead = tick.bMemRead && tick.bOpcodeFetch == false;
+	const bool bIORead = tick.bIORead;
+	const bool bIOWrite = tick.bIOWrite;
+	const bool bIrq = tick.bIrq;
+	const bool bNMI = tick.bNMI;
+	int trapId = kTrapId_None;
+	uint32_t BPMaskCheck = 0;
 
-    if (bNewOp)
+	// setup breakpoint mask to check - addresses & ports without breakpoints have no flags set
+	if (bWrite)
+		BPMaskCheck |= AddressBreakpointFlags[addr] & BPMask_DataWrite;
+	if (bRead)
+		BPMaskCheck |= AddressBreakpointFlags[addr] & BPMask_DataRead;
+	if (bIORead)
+		BPMaskCheck |= PortBreakpointFlags[addr] & BPMask_IORead;
+	if (bIOWrite)
+		BPMaskCheck |= PortBreakpointFlags[addr] & BPMask_IOWrite;
+	if (bIrq && bLastTickIrq == false)	// the interrupt line is held for several ticks, only the start counts
+		BPMaskCheck |= BreakpointMask & BPMask_IRQ;
+	if (bNMI)
+		BPMaskCheck |= BreakpointMask & BPMask_NMI;
+
+    if (tick.bNewOp)
     {
         PC = pCodeAnalysis->AddressRefFromPhysicalAddress(pins & 0xffff);
 		trapId = OnInstructionExecuted(pins);
@@ -125,60 +151,12 @@ void FDebugger::CPUTick(uint64_t pins)
 		break;
     }
 
-    // iterate through data breakpoints
-	// this can slow down if there are a lot of BPs
-	// Do a mask check
-	if (BPMaskCheck & BreakpointMask)
+	// only look through the breakpoints if one could have triggered
+	if (BPMaskCheck != 0)
 	{
-		for (int i = 0; i < Breakpoints.size(); i++)
-		{
-			const FBreakpoint& bp = Breakpoints[i];
-
-			if (bp.bEnabled)
-			{
-				switch (bp.Type)
-				{
-				case EBreakpointType::Data:
-					if (bWrite &&
-						addrRef.BankId == bp.Address.BankId &&
-						addrRef.Address >= bp.Address.Address &&
-						addrRef.Address < bp.Address.Address + bp.Size)
-					{
-						trapId = kTrapId_BpBase + i;
-					}
-					break;
-
-				case EBreakpointType::Irq:
-					if (bIrq)
-						trapId = kTrapId_BpBase + i;
-					break;
-
-				case EBreakpointType::NMI:
-					if (bNMI)
-						trapId = kTrapId_BpBase + i;
-					break;
-
-					// In/Out - only for Z80
-				case EBreakpointType::In:
-					if (bIORead)
-					{
-						const uint16_t mask = bp.Val;
-						if ((Z80_GET_ADDR(pins) & mask) == (bp.Address.Address & mask))
-							trapId = kTrapId_BpBase + i;
-					}
-					break;
-
-				case EBreakpointType::Out:
-					if (bIOWrite)
-					{
-						const uint16_t mask = bp.Val;
-						if ((Z80_GET_ADDR(pins) & mask) == (bp.Address.Address & mask))
-							trapId = kTrapId_BpBase + i;
-					}
-					break;
-				}
-			}
-		}
+		const int bpTrapId = FindTriggeredBreakpoint(BPMaskCheck, addr, pins);
+		if (bpTrapId != kTrapId_None)
+			trapId = bpTrapId;
 	}
 
     if (trapId != kTrapId_None)
@@ -187,6 +165,7 @@ void FDebugger::CPUTick(uint64_t pins)
     }
 
     LastTickPins = pins;
+	bLastTickIrq = bIrq;
 }
 
 int FDebugger::OnInstructionExecuted(uint64_t pins)
@@ -208,25 +187,9 @@ int FDebugger::OnInstructionExecuted(uint64_t pins)
 
 		}
 	}
-	else if(BreakpointMask & BPMask_Exec)
+	else if (AddressBreakpointFlags[PC.Address] & BPMask_Exec)
 	{
-		for (int i = 0; i < Breakpoints.size(); i++)
-		{
-			const FBreakpoint& bp = Breakpoints[i];
-
-			if (bp.bEnabled)
-			{
-				switch (bp.Type)
-				{
-				case EBreakpointType::Exec:
-					if (PC == bp.Address)
-					{
-						trapId = kTrapId_BpBase + i;
-					}
-					break;
-				}
-			}
-		}
+		trapId = FindTriggeredBreakpoint(BPMask_Exec, PC.Address, pins);
 	}
 
 	// Handle IRQ
@@ -242,7 +205,7 @@ int FDebugger::OnInstructionExecuted(uint64_t pins)
 		//return UI_DBG_BP_BASE_TRAPID + 255;	//hack
 	}
 
-	FrameTrace.push_back(PC);
+	FrameTrace.Add(PC);
 
 	// update stack size
 	const uint16_t sp = pZ80->sp;	// this won't get the proper stack pos (see comment above function)
@@ -256,41 +219,134 @@ int FDebugger::OnInstructionExecuted(uint64_t pins)
 
 void FDebugger::StartFrame() 
 { 
+	EventTrace.StartFrame();
 	if (bClearEventsEveryFrame)
 		ClearEvents();
-	FrameTrace.clear();
+	FrameTrace.Clear();
+}
+
+// find which breakpoint caused the flags to be set
+int FDebugger::FindTriggeredBreakpoint(uint32_t bpMask, uint16_t addr, uint64_t pins)
+{
+	const FAddressRef addrRef = pCodeAnalysis->AddressRefFromPhysicalAddress(addr);
+	const uint8_t value = CPUType == ECPUType::Z80 ? Z80_GET_DATA(pins) : M6502_GET_DATA(pins);
+	int trapId = kTrapId_None;
+
+	for (int i = 0; i < Breakpoints.size(); i++)
+	{
+		FBreakpoint& bp = Breakpoints[i];
+
+		if (bp.bEnabled == false)
+			continue;
+
+		bool bHit = false;
+		switch (bp.Type)
+		{
+		case EBreakpointType::Exec:
+			bHit = (bpMask & BPMask_Exec) && addrRef == bp.Address;
+			break;
+
+		case EBreakpointType::Data:
+		case EBreakpointType::DataRead:
+			bHit = (bpMask & (bp.Type == EBreakpointType::Data ? BPMask_DataWrite : BPMask_DataRead)) &&
+				addrRef.BankId == bp.Address.BankId &&
+				addrRef.Address >= bp.Address.Address &&
+				addrRef.Address < bp.Address.Address + bp.Size &&
+				(bp.MatchValue == -1 || bp.MatchValue == value);
+			break;
+
+		case EBreakpointType::Irq:
+			bHit = (bpMask & BPMask_IRQ) != 0;
+			break;
+
+		case EBreakpointType::NMI:
+			bHit = (bpMask & BPMask_NMI) != 0;
+			break;
+
+			// In/Out - only for Z80
+		case EBreakpointType::In:
+			if (bpMask & BPMask_IORead)
+			{
+				const uint16_t mask = bp.Val;
+				bHit = (Z80_GET_ADDR(pins) & mask) == (bp.Address.Address & mask);
+			}
+			break;
+
+		case EBreakpointType::Out:
+			if (bpMask & BPMask_IOWrite)
+			{
+				const uint16_t mask = bp.Val;
+				bHit = (Z80_GET_ADDR(pins) & mask) == (bp.Address.Address & mask);
+			}
+			break;
+		}
 
-	// Setup breakpoint mask 
+		// hit count condition - carry on after a break so every breakpoint that was hit gets counted
+		if (bHit)
+		{
+			bp.NoHits++;
+			if (bp.NoHits >= bp.HitCountTarget)
+			{
+				bp.NoHits = 0;
+				if (trapId == kTrapId_None)
+					trapId = kTrapId_BpBase + i;
+			}
+		}
+	}
+
+	return trapId;
+}
+
+// Rebuild the address & port lookup tables so CPUTick can check for breakpoints with a single load
+void FDebugger::BreakpointsChanged()
+{
 	BreakpointMask = 0;
+	memset(AddressBreakpointFlags, 0, sizeof(AddressBreakpointFlags));
+	memset(PortBreakpointFlags, 0, sizeof(PortBreakpointFlags));
 
 	for (int i = 0; i < Breakpoints.size(); i++)
 	{
 		const FBreakpoint& bp = Breakpoints[i];
 
-		if (bp.bEnabled)
+		if (bp.bEnabled == false)
+			continue;
+
+		switch (bp.Type)
+		{
+		case EBreakpointType::Exec:
+			BreakpointMask |= BPMask_Exec;
+			AddressBreakpointFlags[bp.Address.Address] |= BPMask_Exec;
+			break;
+		case EBreakpointType::Data:
+			BreakpointMask |= BPMask_DataWrite;
+			for (int addrOffset = 0; addrOffset < bp.Size; addrOffset++)
+				AddressBreakpointFlags[(uint16_t)(bp.Address.Address + addrOffset)] |= BPMask_DataWrite;
+			break;
+		case EBreakpointType::DataRead:
+			BreakpointMask |= BPMask_DataRead;
+			for (int addrOffset = 0; addrOffset < bp.Size; addrOffset++)
+				AddressBreakpointFlags[(uint16_t)(bp.Address.Address + addrOffset)] |= BPMask_DataRead;
+			break;
+		case EBreakpointType::In:
+		case EBreakpointType::Out:
 		{
-			switch (bp.Type)
+			const uint32_t portMask = bp.Type == EBreakpointType::In ? BPMask_IORead : BPMask_IOWrite;
+			const uint16_t mask = bp.Val;
+			BreakpointMask |= portMask;
+			for (int port = 0; port < 0x10000; port++)
 			{
-			case EBreakpointType::Exec:
-				BreakpointMask |= BPMask_Exec;
-				break;
-			case EBreakpointType::Data:
-				BreakpointMask |= BPMask_DataWrite;
-				break;
-			case EBreakpointType::In:
-				BreakpointMask |= BPMask_IORead;
-				break;
-			case EBreakpointType::Out:
-				BreakpointMask |= BPMask_IORead;
-				break;
-			case EBreakpointType::Irq:
-				BreakpointMask |= BPMask_IRQ;
-				break;
-			case EBreakpointType::NMI:
-				BreakpointMask |= BPMask_NMI;
-				break;
+				if ((port & mask) == (bp.Address.Address & mask))
+					PortBreakpointFlags[port] |= portMask;
 			}
 		}
+			break;
+		case EBreakpointType::Irq:
+			BreakpointMask |= BPMask_IRQ;
+			break;
+		case EBreakpointType::NMI:
+			BreakpointMask |= BPMask_NMI;
+			break;
+		}
 	}
 }
 
@@ -306,7 +362,7 @@ bool FDebugger::FrameTick(void)
 	return bDebuggerStopped;
 }
 
-static const uint32_t kVersionNo = 2;
+static const uint32_t kVersionNo = 3;
 
 // Load state - breakpoints, watches etc.
 void	FDebugger::LoadFromFile(FILE* fp)
@@ -336,17 +392,24 @@ void	FDebugger::LoadFromFile(FILE* fp)
 		fread(&bp.Type, sizeof(bp.Type), 1, fp);	// Type
 		fread(&bp.Size, sizeof(bp.Size), 1, fp);	// Size
 		fread(&bp.Val, sizeof(bp.Val), 1, fp);		// Val
+		if (versionNo > 2)
+		{
+			fread(&bp.MatchValue, sizeof(bp.MatchValue), 1, fp);		// MatchValue
+			fread(&bp.HitCountTarget, sizeof(bp.HitCountTarget), 1, fp);	// HitCountTarget
+		}
 	}
+	BreakpointsChanged();
 
 	// frame trace
 	if (versionNo > 1)
 	{
-		FrameTrace.clear();
+		FrameTrace.Clear();
 		fread(&num, sizeof(uint32_t), 1, fp);
 		for (int i = 0; i < (int)num; i++)
 		{
-			FAddressRef& address = FrameTrace.emplace_back();
+			FAddressRef address;
 			fread(&address.Val, sizeof(uint32_t), 1, fp);	// address
+			FrameTrace.Add(address);
 		}
 	}
 }
@@ -377,14 +440,18 @@ void	FDebugger::SaveToFile(FILE* fp)
 		fwrite(&bp.Type, sizeof(bp.Type), 1, fp);	// Type
 		fwrite(&bp.Size, sizeof(bp.Size), 1, fp);	// Size
 		fwrite(&bp.Val, sizeof(bp.Val), 1, fp);		// Val
+		fwrite(&bp.MatchValue, sizeof(bp.MatchValue), 1, fp);		// MatchValue
+		fwrite(&bp.HitCountTarget, sizeof(bp.HitCountTarget), 1, fp);	// HitCountTarget
 	}
 
 	// frame trace
-	num = (uint32_t)FrameTrace.size();
+	std::vector<FAddressRef> frameTrace;
+	FrameTrace.GetEntries(0, FrameTrace.GetNoEntries(), frameTrace);
+	num = (uint32_t)frameTrace.size();
 	fwrite(&num, sizeof(uint32_t), 1, fp);
 	for (int i = 0; i < (int)num; i++)
 	{
-		fwrite(&FrameTrace[i].Val,sizeof(uint32_t), 1, fp);	// address
+		fwrite(&frameTrace[i].Val,sizeof(uint32_t), 1, fp);	// address
 	}
 }
 
@@ -495,6 +562,7 @@ bool FDebugger::AddExecBreakpoint(FAddressRef addr)
 		return false;
 
 	Breakpoints.emplace_back(addr, EBreakpointType::Exec);
+	BreakpointsChanged();
 	return true;
 }
 
@@ -504,6 +572,17 @@ bool FDebugger::AddDataBreakpoint(FAddressRef addr, uint16_t size)
 		return false;
 
 	Breakpoints.emplace_back(addr, EBreakpointType::Data,size);
+	BreakpointsChanged();
+	return true;
+}
+
+bool FDebugger::AddDataReadBreakpoint(FAddressRef addr, uint16_t size)
+{
+	if (IsAddressBreakpointed(addr))
+		return false;
+
+	Breakpoints.emplace_back(addr, EBreakpointType::DataRead, size);
+	BreakpointsChanged();
 	return true;
 }
 
@@ -515,6 +594,7 @@ bool FDebugger::RemoveBreakpoint(FAddressRef addr)
 		{
 			Breakpoints[i] = Breakpoints.back();
 			Breakpoints.pop_back();
+			BreakpointsChanged();
 			return true;
 		}
 	}
@@ -619,65 +699,49 @@ void FDebugger::ResetScanlineEvents(void)
 	memset(ScanlineEvents, 0, sizeof(ScanlineEvents));
 }
 
-static const size_t kEventNameLength = 32;
-struct FEventTypeInfo
+void FDebugger::RegisterEventType(uint8_t type, const char* pName, uint32_t col, ShowEventInfoCB pShowAddress, ShowEventInfoCB pShowValue, bool bEnabled)
 {
-	char		EventName[kEventNameLength];
-	uint32_t	EventColour;
-
-	ShowEventInfoCB	ShowAddressCB = nullptr;
-	ShowEventInfoCB	ShowValueCB = nullptr;
-	
-	bool bEnabled = true;
-};
-
-FEventTypeInfo g_EventTypeInfo[256];
-
-void FDebugger::RegisterEventType(uint8_t type, const char* pName, uint32_t col, ShowEventInfoCB pShowAddress, ShowEventInfoCB pShowValue)
-{
-	FEventTypeInfo& typeInfo = g_EventTypeInfo[type];
+	FEventTypeInfo& typeInfo = EventTypeInfo[type];
 	assert(strlen(pName) < kEventNameLength);
 	strncpy(typeInfo.EventName, pName, kEventNameLength);
 	typeInfo.EventColour = col;
 	typeInfo.ShowAddressCB = pShowAddress;
 	typeInfo.ShowValueCB = pShowValue;
+	SetEventTypeEnabled(type, bEnabled);
 }
 
-void FDebugger::RegisterEvent(uint8_t type, FAddressRef pc, uint16_t address, uint8_t value, uint16_t scanlinePos)
+void FDebugger::SetEventTypeEnabled(uint8_t type, bool bEnabled)
 {
-	if (!g_EventTypeInfo[type].bEnabled)
-		return;
-
-	ScanlineEvents[scanlinePos] = type;
-	EventTrace.emplace_back(type, pc, address, value, scanlinePos);
+	EventTypeInfo[type].bEnabled = bEnabled;
+	EventTypeEnabled[type] = bEnabled ? 1 : 0;
 }
 
 uint32_t FDebugger::GetEventColour(uint8_t type)
 {
-	return g_EventTypeInfo[type].EventColour;
+	return EventTypeInfo[type].EventColour;
 }
 
 const char* FDebugger::GetEventName(uint8_t type)
 {
-	return g_EventTypeInfo[type].EventName;
+	return EventTypeInfo[type].EventName;
 }
 
 void FDebugger::ClearEvents()
 {
-	EventTrace.clear();
+	EventTrace.Clear();
 }
 
 bool	FDebugger::TraceForward(FCodeAnalysisViewState& viewState)
 {
 	const FCodeAnalysisItem& cursorItem = viewState.GetCursorItem();
 
-	if (FrameTraceItemIndex == -1 || FrameTrace[FrameTraceItemIndex] != cursorItem.AddressRef)
+	if (FrameTraceItemIndex == -1 || FrameTraceItemIndex >= FrameTrace.GetNoEntries() || FrameTrace.GetEntry(FrameTraceItemIndex) != cursorItem.AddressRef)
 		FrameTraceItemIndex = GetFrameTraceItemIndex(cursorItem.AddressRef);
 
-	if (FrameTraceItemIndex >= 0 && FrameTraceItemIndex < FrameTrace.size() - 1)
+	if (FrameTraceItemIndex >= 0 && FrameTraceItemIndex < FrameTrace.GetNoEntries() - 1)
 	{
 		FrameTraceItemIndex++;
-		viewState.GoToAddress(FrameTrace[FrameTraceItemIndex]);
+		viewState.GoToAddress(FrameTrace.GetEntry(FrameTraceItemIndex));
 	}
 	return FrameTraceItemIndex != -1;
 }
@@ -686,13 +750,13 @@ bool	FDebugger::TraceBack(FCodeAnalysisViewState& viewState)
 {
 	const FCodeAnalysisItem& cursorItem = viewState.GetCursorItem();
 
-	if (FrameTraceItemIndex == -1 || FrameTrace[FrameTraceItemIndex] != cursorItem.AddressRef)
+	if (FrameTraceItemIndex == -1 || FrameTraceItemIndex >= FrameTrace.GetNoEntries() || FrameTrace.GetEntry(FrameTraceItemIndex) != cursorItem.AddressRef)
 		FrameTraceItemIndex = GetFrameTraceItemIndex(cursorItem.AddressRef);
 
 	if (FrameTraceItemIndex > 0)
 	{
 		FrameTraceItemIndex--;
-		viewState.GoToAddress(FrameTrace[FrameTraceItemIndex]);
+		viewState.GoToAddress(FrameTrace.GetEntry(FrameTraceItemIndex));
 	}
 
 	return FrameTraceItemIndex != -1;
@@ -703,9 +767,11 @@ bool	FDebugger::TraceBack(FCodeAnalysisViewState& viewState)
 
 int FDebugger::GetFrameTraceItemIndex(FAddressRef address)
 {
-	for (int i = 0; i < FrameTrace.size(); i++)
+	std::vector<FAddressRef> frameTrace;
+	FrameTrace.GetEntries(0, FrameTrace.GetNoEntries(), frameTrace);
+	for (int i = 0; i < frameTrace.size(); i++)
 	{
-		if (FrameTrace[i] == address)
+		if (frameTrace[i] == address)
 			return i;
 	}
 
@@ -717,7 +783,8 @@ void FDebugger::DrawTrace(void)
 	FCodeAnalysisState& state = *pCodeAnalysis;
 	FCodeAnalysisViewState& viewState = state.GetFocussedViewState();
 	const float line_height = ImGui::GetTextLineHeight();
-	ImGuiListClipper clipper((int)FrameTrace.size(), line_height);
+	const int noTraceEntries = FrameTrace.GetNoEntries();
+	ImGuiListClipper clipper(noTraceEntries, line_height);
 
 	if (ImGui::Button("Trace Back"))
 	{
@@ -733,9 +800,14 @@ void FDebugger::DrawTrace(void)
 	{
 		while (clipper.Step())
 		{
+			// newest first, only the visible lines are decoded
+			const int traceStart = noTraceEntries - clipper.DisplayEnd;
+			TraceLines.clear();
+			FrameTrace.GetEntries(traceStart, clipper.DisplayEnd - clipper.DisplayStart, TraceLines);
+
 			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
 			{
-				const FAddressRef codeAddress = FrameTrace[FrameTrace.size() - i - 1];
+				const FAddressRef codeAddress = TraceLines[noTraceEntries - i - 1 - traceStart];
 				FCodeInfo* pCodeInfo = state.GetCodeInfoForAddress(codeAddress);
 				DrawCodeAddress(state, viewState, codeAddress, false);	// draw current PC
 				//DrawCodeInfo(state, viewState, FCodeAnalysisItem(pCodeInfo, codeAddress));
@@ -745,6 +817,20 @@ void FDebugger::DrawTrace(void)
 	ImGui::EndChild();
 }
 
+// name of the function containing the address, with an offset if it's not the start
+static void DrawCallStackFunctionName(FCodeAnalysisState& state, FAddressRef functionAddr)
+{
+	FLabelSearchResult function;
+	if (FindLabelBeforeAddress(state, functionAddr, ELabelRangeType::Function, function) == false)
+		return;
+
+	if (function.Offset == 0)
+		ImGui::Text("%s :", function.pLabel->Name.c_str());
+	else
+		ImGui::Text("%s + %d :", function.pLabel->Name.c_str(), function.Offset);
+	ImGui::SameLine();
+}
+
 void FDebugger::DrawCallStack(void)
 {
 	FCodeAnalysisState& state = *pCodeAnalysis;
@@ -752,27 +838,13 @@ void FDebugger::DrawCallStack(void)
 
 	// Draw current function & PC position
 	if (CallStack.empty() == false)
-	{
-		const FLabelInfo* pLabel = state.GetLabelForAddress(CallStack.back().FunctionAddr);
-		if (pLabel != nullptr)
-		{
-			ImGui::Text("%s :", pLabel->Name.c_str());
-			ImGui::SameLine();
-		}
-	}
+		DrawCallStackFunctionName(state, CallStack.back().FunctionAddr);
 	DrawCodeAddress(state, viewState, state.CPUInterface->GetPC(), false);	// draw current PC
 
 	for (int i = (int)CallStack.size() - 1; i >= 0; i--)
 	{
 		if (i > 0)
-		{
-			const FLabelInfo* pLabel = state.GetLabelForAddress(CallStack[i - 1].FunctionAddr);
-			if (pLabel != nullptr)
-			{
-				ImGui::Text("%s :", pLabel->Name.c_str());
-				ImGui::SameLine();
-			}
-		}
+			DrawCallStackFunctionName(state, CallStack[i - 1].FunctionAddr);
 		DrawCodeAddress(state, viewState, CallStack[i].CallAddr, false);
 	}
 }
@@ -909,6 +981,11 @@ void FDebugger::DrawWatches(void)
 				FDataInfo* pInfo = state.GetWriteDataInfoForAddress(SelectedWatch);
 				state.ToggleDataBreakpointAtAddress(SelectedWatch, pInfo->ByteSize);
 			}
+			if (ImGui::Selectable("Toggle Read Breakpoint"))
+			{
+				FDataInfo* pInfo = state.GetReadDataInfoForAddress(SelectedWatch);
+				state.ToggleDataReadBreakpointAtAddress(SelectedWatch, pInfo->ByteSize);
+			}
 
 			ImGui::EndPopup();
 		}
@@ -932,6 +1009,8 @@ const char* GetBreakpointTypeText(EBreakpointType type)
 		return "Exec";
 	case EBreakpointType::Data:
 		return "Data";
+	case EBreakpointType::DataRead:
+		return "Read";
 	}
 
 	return "Unknown";
@@ -943,12 +1022,15 @@ void FDebugger::DrawBreakpoints(void)
 	FCodeAnalysisViewState& viewState = state.GetFocussedViewState();
 
 	static ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
-	if (ImGui::BeginTable("Breakpoints", 4, flags))
+	if (ImGui::BeginTable("Breakpoints", 7, flags))
 	{
 		ImGui::TableSetupColumn("Enabled", ImGuiTableColumnFlags_WidthFixed, 60);
 		ImGui::TableSetupColumn("Address", ImGuiTableColumnFlags_WidthStretch);
 		ImGui::TableSetupColumn("Type", ImGuiTableColumnFlags_WidthFixed,50);
 		ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed,40);
+		ImGui::TableSetupColumn("Value", ImGuiTableColumnFlags_WidthFixed, 60);
+		ImGui::TableSetupColumn("Break On Hit", ImGuiTableColumnFlags_WidthFixed, 80);
+		ImGui::TableSetupColumn("Hits", ImGuiTableColumnFlags_WidthFixed, 50);
 		ImGui::TableHeadersRow();
 
 		for (auto& bp : Breakpoints)
@@ -956,7 +1038,8 @@ void FDebugger::DrawBreakpoints(void)
 			ImGui::PushID(bp.Address.Val);
 			ImGui::TableNextRow();
 			ImGui::TableSetColumnIndex(0);
-			ImGui::Checkbox("##Enabled", &bp.bEnabled);
+			if (ImGui::Checkbox("##Enabled", &bp.bEnabled))
+				BreakpointsChanged();
 			ImGui::TableSetColumnIndex(1);
 			ImGui::Text("%s:", NumStr(bp.Address.Address));
 			DrawAddressLabel(state, viewState, bp.Address);
@@ -964,6 +1047,25 @@ void FDebugger::DrawBreakpoints(void)
 			ImGui::Text("%s", GetBreakpointTypeText(bp.Type));
 			ImGui::TableSetColumnIndex(3);
 			ImGui::Text("%d", bp.Size);
+
+			// conditions
+			ImGui::TableSetColumnIndex(4);
+			if (bp.Type == EBreakpointType::Data || bp.Type == EBreakpointType::DataRead)
+			{
+				ImGui::SetNextItemWidth(-1);
+				if (ImGui::InputInt("##Value", &bp.MatchValue, 0))	// -1 for any value
+					bp.MatchValue = std::clamp(bp.MatchValue, -1, 255);
+			}
+			ImGui::TableSetColumnIndex(5);
+			int hitCountTarget = (int)bp.HitCountTarget;
+			ImGui::SetNextItemWidth(-1);
+			if (ImGui::InputInt("##HitCount", &hitCountTarget, 0))
+			{
+				bp.HitCountTarget = (uint32_t)std::max(hitCountTarget, 0);
+				bp.NoHits = 0;
+			}
+			ImGui::TableSetColumnIndex(6);
+			ImGui::Text("%u", bp.NoHits);
 			ImGui::PopID();
 		}
 		ImGui::EndTable();
@@ -1033,27 +1135,34 @@ void FDebugger::DrawEvents(void)
 		ClearEvents();
 	}
 	ImGui::Checkbox("Clear Every Frame", &bClearEventsEveryFrame);
+	if (EventTrace.GetNoDroppedThisFrame() > 0)
+	{
+		ImGui::SameLine();
+		ImGui::Text("%d events dropped this frame", EventTrace.GetNoDroppedThisFrame());
+	}
 
 	FCodeAnalysisState& state = *pCodeAnalysis;
 	FCodeAnalysisViewState& viewState = state.GetFocussedViewState();
 	const float lineHeight = ImGui::GetTextLineHeight();
-	ImGuiListClipper clipper((int)EventTrace.size(), lineHeight);
+	const FEventRange eventRange = EventTrace.GetAvailableRange();
+	ImGuiListClipper clipper((int)eventRange.GetCount(), lineHeight);
 	const float rectSize = lineHeight;
 	ImDrawList* dl = ImGui::GetWindowDrawList();
 	
 	if (ImGui::CollapsingHeader("Event Types"))
 	{
 		int e = 1;	// skip event type None
-		while (g_EventTypeInfo[e].EventName[0])
+		while (EventTypeInfo[e].EventName[0])
 		{
 			ImVec2 pos = ImGui::GetCursorScreenPos();
 			const ImVec2 rectMin(pos.x, pos.y + 3);
 			const ImVec2 rectMax(pos.x + rectSize, pos.y + rectSize + 3);
-			dl->AddRectFilled(rectMin, rectMax, g_EventTypeInfo[e].EventColour);
+			dl->AddRectFilled(rectMin, rectMax, EventTypeInfo[e].EventColour);
 
 			ImGui::Text("  "); 
 			ImGui::SameLine();
-			ImGui::Checkbox(g_EventTypeInfo[e].EventName, &g_EventTypeInfo[e].bEnabled);
+			if (ImGui::Checkbox(EventTypeInfo[e].EventName, &EventTypeInfo[e].bEnabled))
+				SetEventTypeEnabled(e, EventTypeInfo[e].bEnabled);
 			e++;
 		}
 	}
@@ -1073,8 +1182,8 @@ void FDebugger::DrawEvents(void)
 			{
 				for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
 				{
-					const FEvent& event = EventTrace[i];
-					const FEventTypeInfo& typeInfo = g_EventTypeInfo[event.Type];
+					const FEvent& event = EventTrace.GetEvent(eventRange.Start + i);
+					const FEventTypeInfo& typeInfo = EventTypeInfo[event.Type];
 					ImGui::PushID(i);
 					ImGui::TableNextRow();
 
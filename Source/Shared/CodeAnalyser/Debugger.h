@@ -1,6 +1,8 @@
 #pragma once
 
 #include <CodeAnalyser/CodeAnalyserTypes.h>
+#include <CodeAnalyser/EventTrace.h>
+#include <CodeAnalyser/InstructionTrace.h>
 
 #include <chips/z80.h>
 #include <chips/m6502.h>
@@ -39,13 +41,23 @@ enum class EBreakpointType
 	Irq,
 	NMI,
 	In,
-	Out
+	Out,
+	DataRead,
 };
 
 static const int kTrapId_None = 0;
 static const int kTrapId_Step = 128;
 static const int kTrapId_BpBase = kTrapId_Step + 1;
 
+// flags in the breakpoint lookup tables
+static const uint32_t	BPMask_Exec			= 0x0001;
+static const uint32_t	BPMask_DataWrite	= 0x0002;
+static const uint32_t	BPMask_DataRead		= 0x0004;
+static const uint32_t	BPMask_IORead		= 0x0008;
+static const uint32_t	BPMask_IOWrite		= 0x0010;
+static const uint32_t	BPMask_IRQ			= 0x0020;
+static const uint32_t	BPMask_NMI			= 0x0040;
+
 struct FBreakpoint
 {
 	FBreakpoint() {}
@@ -57,6 +69,29 @@ struct FBreakpoint
 	EBreakpointType	Type = EBreakpointType::None;
 	bool			bEnabled = true;
 	uint16_t		Size = 1;
+
+	// conditions
+	int				MatchValue = -1;	// data breakpoints only break when this value is read/written, -1 for any value
+	uint32_t		HitCountTarget = 0;	// break every time it's hit this many times, 0 to break on every hit
+	uint32_t		NoHits = 0;			// hits where the value matched since the last break
+};
+
+// CPU pins for a tick, decoded once so the machine's tick handler and the debugger can share them
+struct FCPUTickInfo
+{
+	uint64_t	Pins = 0;
+	uint64_t	RisingPins = 0;
+	uint16_t	Address = 0;
+	uint8_t		Data = 0;
+	bool		bNewBusCycle = false;	// first tick of a memory or IO access - the pins can be held for several ticks
+	bool		bMemRead = false;		// includes opcode fetches
+	bool		bMemWrite = false;
+	bool		bOpcodeFetch = false;
+	bool		bIORead = false;
+	bool		bIOWrite = false;
+	bool		bNewOp = false;
+	bool		bIrq = false;
+	bool		bNMI = false;
 };
 
 struct FWatch : public FAddressRef
@@ -85,26 +120,29 @@ struct FStackInfo
 };
 
 
-struct FEvent
+typedef void (*ShowEventInfoCB)(FCodeAnalysisState& state, const FEvent& event);
+
+static const size_t kEventNameLength = 32;
+struct FEventTypeInfo
 {
-	FEvent(uint8_t type, FAddressRef pc, uint16_t address, uint8_t value, uint16_t scanlinePos)
-		: Type(type), PC(pc), Address(address), Value(value), ScanlinePos(scanlinePos) {}
+	char		EventName[kEventNameLength] = { 0 };
+	uint32_t	EventColour = 0;
 
-	uint8_t			Type;
-	uint16_t		Address;
-	uint8_t			Value;
-	uint16_t		ScanlinePos;
-	FAddressRef		PC;
+	ShowEventInfoCB	ShowAddressCB = nullptr;
+	ShowEventInfoCB	ShowValueCB = nullptr;
+	
+	bool bEnabled = true;
 };
 
-typedef void (*ShowEventInfoCB)(FCodeAnalysisState& state, const FEvent& event);
-
-
 class FDebugger
 {
 public:
 	void	Init(FCodeAnalysisState* pCodeAnalysis);
-	void	CPUTick(uint64_t pins);
+	FCPUTickInfo	DecodeTickPins(uint64_t pins) const;
+	static FCPUTickInfo	DecodeZ80TickPins(uint64_t pins, uint64_t lastPins, bool bOpDone, bool bIff1);	// for ticks recorded earlier
+	void	CPUTick(uint64_t pins) { CPUTick(DecodeTickPins(pins)); }
+	void	CPUTick(const FCPUTickInfo& tick);
+	void	SetLastTickPins(uint64_t pins) { LastTickPins = pins; }	// for when the way ticks are passed in changes
 	int		OnInstructionExecuted(uint64_t pins);
 	void	StartFrame();
 	bool	FrameTick(void);
@@ -126,9 +164,11 @@ public:
 	// Breakpoints
 	bool	AddExecBreakpoint(FAddressRef addr);
 	bool	AddDataBreakpoint(FAddressRef addr, uint16_t size);
+	bool	AddDataReadBreakpoint(FAddressRef addr, uint16_t size);
 	bool	RemoveBreakpoint(FAddressRef addr);
 	const FBreakpoint* GetBreakpointForAddress(FAddressRef addr) const;
 	FBreakpoint* GetBreakpointForAddress(FAddressRef addr) { return const_cast<FBreakpoint*>(const_cast<const FDebugger*>(this)->GetBreakpointForAddress(addr)); }
+	void	BreakpointsChanged();	// call after modifying breakpoints directly
 	void	SetScreenMemoryArea(uint16_t start, uint16_t end) { ScreenMemoryStart = start; ScreenMemoryEnd = end; }
 	// Watches
 	void	AddWatch(FWatch watch);
@@ -137,17 +177,26 @@ public:
 	const std::vector<FWatch>& GetWatches() const { return Watches; }
 
 	// Events 
-	void RegisterEventType(uint8_t type, const char* pName, uint32_t col, ShowEventInfoCB pShowAddress = nullptr, ShowEventInfoCB pShowValue = nullptr);
+	void RegisterEventType(uint8_t type, const char* pName, uint32_t col, ShowEventInfoCB pShowAddress = nullptr, ShowEventInfoCB pShowValue = nullptr, bool bEnabled = true);
+	void SetEventTypeEnabled(uint8_t type, bool bEnabled);
+	bool IsEventTypeEnabled(uint8_t type) const { return EventTypeEnabled[type] != 0; }
 	void ResetScanlineEvents(void);
-	void RegisterEvent(uint8_t type, FAddressRef pc, uint16_t address, uint8_t value, uint16_t scanlinePos);
-	const std::vector<FEvent>& GetEventTrace() const { return EventTrace; }
+	void RegisterEvent(uint8_t type, FAddressRef pc, uint16_t address, uint8_t value, uint16_t scanlinePos)
+	{
+		if (EventTypeEnabled[type] == 0)	// disabled & unregistered types are filtered here
+			return;
+
+		ScanlineEvents[scanlinePos] = type;
+		EventTrace.AddEvent(type, pc, address, value, scanlinePos);
+	}
+	const FEventTrace& GetEventTrace() const { return EventTrace; }
 	const uint8_t* GetScanlineEvents() const { return ScanlineEvents; }
 	uint32_t GetEventColour(uint8_t type);
 	const char* GetEventName(uint8_t type);
 	void ClearEvents();
 
 	// Frame Trace
-	const std::vector<FAddressRef>& GetFrameTrace() const { return FrameTrace; }
+	const FInstructionTrace& GetFrameTrace() const { return FrameTrace; }
 	bool	TraceForward(FCodeAnalysisViewState& viewState);
 	bool	TraceBack(FCodeAnalysisViewState& viewState);
 
@@ -160,6 +209,9 @@ public:
 	// Queries
 	bool	IsStopped() const { return bDebuggerStopped; }
 	bool	IsAddressBreakpointed(FAddressRef addr) const;
+	uint32_t	GetBreakpointMask() const { return BreakpointMask; }
+	uint8_t		GetAddressBreakpointFlags(uint16_t addr) const { return AddressBreakpointFlags[addr]; }
+	uint8_t		GetPortBreakpointFlags(uint16_t port) const { return PortBreakpointFlags[port]; }
 	FAddressRef	GetPC() const { return PC; }
 
 	bool* GetDebuggerStoppedPtr() { return &bDebuggerStopped; }
@@ -174,6 +226,7 @@ public:
 	void	DrawUI(void);
 private:
 	int		GetFrameTraceItemIndex(FAddressRef address);
+	int		FindTriggeredBreakpoint(uint32_t bpMask, uint16_t addr, uint64_t pins);
 
 private:
 	FCodeAnalysisState*	pCodeAnalysis = nullptr;
@@ -182,6 +235,7 @@ private:
 	z80_t*			pZ80 = nullptr;
 	m6502_t*		pM6502 = nullptr;
 	uint64_t		LastTickPins = 0;
+	bool			bLastTickIrq = false;
 	FAddressRef		PC;
 	bool			bDebuggerStopped = false;
 	EDebugStepMode	StepMode = EDebugStepMode::None;
@@ -189,10 +243,15 @@ private:
 
 	std::vector<FBreakpoint>	Breakpoints;
 	uint32_t					BreakpointMask = 0;
+	uint8_t						AddressBreakpointFlags[0x10000] = { 0 };	// BPMask flags for each physical address
+	uint8_t						PortBreakpointFlags[0x10000] = { 0 };		// BPMask flags for each IO port
 	std::vector<FWatch>			Watches;
 	FWatch						SelectedWatch;
-	std::vector<FAddressRef>	FrameTrace;
-	std::vector<FEvent>			EventTrace;
+	FInstructionTrace			FrameTrace;
+	std::vector<FAddressRef>	TraceLines;	// decoded part of the frame trace being drawn
+	FEventTrace					EventTrace;
+	FEventTypeInfo				EventTypeInfo[256];	// per debugger as each machine registers its own types
+	uint8_t						EventTypeEnabled[256] = { 0 };	// set when types are registered
 	uint8_t						ScanlineEvents[320];
 	bool							bClearEventsEveryFrame = true;
 
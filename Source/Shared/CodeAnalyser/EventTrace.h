@@ -0,0 +1,114 @@
+#pragma once
+
+#include <CodeAnalyser/CodeAnalyserTypes.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// ordered so there's no padding between members
+struct FEvent
+{
+	FEvent() = default;
+	FEvent(uint8_t type, FAddressRef pc, uint16_t address, uint8_t value, uint16_t scanlinePos)
+		: PC(pc), Address(address), ScanlinePos(scanlinePos), Type(type), Value(value) {}
+
+	FAddressRef		PC;
+	uint16_t		Address = 0;
+	uint16_t		ScanlinePos = 0;
+	uint8_t			Type = 0;
+	uint8_t			Value = 0;
+};
+
+// range of events in the trace - indices keep counting up so a range stays valid until the trace wraps over it
+struct FEventRange
+{
+	uint64_t	Start = 0;
+	uint64_t	End = 0;
+
+	uint32_t	GetCount() const { return (uint32_t)(End - Start); }
+};
+
+// Fixed size ring buffer of events.
+// There's a single writer (the emulation), the write index is published after each event is written
+// so a reader can look at events without taking a lock.
+// Each frame can only add a limited number of events so one busy frame can't flush out the frames before it.
+class FEventTrace
+{
+public:
+	static const uint32_t kDefaultCapacity = 1 << 19;
+	static const uint32_t kDefaultMaxEventsPerFrame = 1 << 14;
+
+	void	Init(uint32_t capacity = kDefaultCapacity, uint32_t maxEventsPerFrame = kDefaultMaxEventsPerFrame)
+	{
+		uint32_t size = 1;
+		while (size < capacity)
+			size <<= 1;
+		if (Events.size() != size)
+			Events.resize(size);
+		Mask = size - 1;
+		MaxEventsPerFrame = maxEventsPerFrame < size ? maxEventsPerFrame : size;
+		Reset();
+	}
+
+	void	Reset()
+	{
+		WriteIndex.store(0, std::memory_order_relaxed);
+		FrameStart = 0;
+		ClearIndex = 0;
+		NoDroppedThisFrame = 0;
+	}
+
+	void	StartFrame()
+	{
+		FrameStart = WriteIndex.load(std::memory_order_relaxed);
+		NoDroppedThisFrame = 0;
+	}
+
+	bool	AddEvent(uint8_t type, FAddressRef pc, uint16_t address, uint8_t value, uint16_t scanlinePos)
+	{
+		const uint64_t writeIndex = WriteIndex.load(std::memory_order_relaxed);
+		if (writeIndex - FrameStart >= MaxEventsPerFrame)
+		{
+			NoDroppedThisFrame++;
+			return false;
+		}
+
+		Events[writeIndex & Mask] = FEvent(type, pc, address, value, scanlinePos);
+		WriteIndex.store(writeIndex + 1, std::memory_order_release);
+		return true;
+	}
+
+	// hide everything written so far
+	void	Clear() { ClearIndex = WriteIndex.load(std::memory_order_relaxed); }
+
+	// events added since the start of the frame
+	FEventRange	GetFrameRange() const { return { FrameStart, WriteIndex.load(std::memory_order_acquire) }; }
+
+	// events since the last clear that haven't been overwritten
+	FEventRange	GetAvailableRange() const
+	{
+		const uint64_t end = WriteIndex.load(std::memory_order_acquire);
+		const uint64_t oldest = end > Events.size() ? end - Events.size() : 0;
+		return { ClearIndex > oldest ? ClearIndex : oldest, end };
+	}
+
+	bool	IsRangeAvailable(const FEventRange& range) const
+	{
+		const uint64_t end = WriteIndex.load(std::memory_order_acquire);
+		return range.End <= end && end - range.Start <= Events.size();
+	}
+
+	const FEvent&	GetEvent(uint64_t index) const { return Events[index & Mask]; }
+	uint32_t		GetCapacity() const { return (uint32_t)Events.size(); }
+	uint32_t		GetNoDroppedThisFrame() const { return NoDroppedThisFrame; }
+
+private:
+	std::vector<FEvent>		Events;
+	uint64_t				Mask = 0;
+	uint32_t				MaxEventsPerFrame = 0;
+	std::atomic<uint64_t>	WriteIndex = 0;
+	uint64_t				FrameStart = 0;
+	uint64_t				ClearIndex = 0;
+	uint32_t				NoDroppedThisFrame = 0;
+};
@@ -0,0 +1,267 @@
+#include "InstructionTrace.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+// Each token starts with a var int, the low 2 bits are the token type
+enum class ETraceToken : uint32_t
+{
+	Delta = 0,	// address in the same bank as the previous one, rest of the value is the zigzag encoded difference
+	Address = 1,	// full address follows
+	Repeat = 2,		// repeat entries from earlier in the block, rest of the value is the count followed by a var int distance back
+};
+
+static const int kMinRepeatLength = 3;	// shorter repeats are cheaper as deltas
+
+static uint32_t HashAddress(FAddressRef address)
+{
+	return (address.Val * 2654435761u) >> 24;
+}
+
+static uint32_t ZigZagEncode(int value)
+{
+	return (uint32_t)((value << 1) ^ (value >> 31));
+}
+
+static int ZigZagDecode(uint32_t value)
+{
+	return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+static uint32_t ReadVarInt(const uint8_t*& pData)
+{
+	uint32_t value = 0;
+	int shift = 0;
+	while (true)
+	{
+		const uint8_t byte = *pData++;
+		value |= (uint32_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			return value;
+		shift += 7;
+	}
+}
+
+void FInstructionTrace::Clear()
+{
+	Data.clear();
+	Blocks.clear();
+	NoEntries = 0;
+	MatchDistance = 0;
+	MatchLength = 0;
+	BlockEntries.clear();
+	memset(LastSeen, 0, sizeof(LastSeen));
+}
+
+void FInstructionTrace::CopyFrom(const FInstructionTrace& other)
+{
+	Clear();
+	Data = other.Data;
+	Blocks = other.Blocks;
+	NoEntries = other.NoEntries;
+	MatchDistance = other.MatchDistance;
+	MatchLength = other.MatchLength;
+}
+
+static void AppendUInt32(std::vector<uint8_t>& outData, uint32_t value)
+{
+	const uint8_t* pValue = (const uint8_t*)&value;
+	outData.insert(outData.end(), pValue, pValue + sizeof(uint32_t));
+}
+
+void FInstructionTrace::WriteTo(std::vector<uint8_t>& outData) const
+{
+	AppendUInt32(outData, (uint32_t)NoEntries);
+	AppendUInt32(outData, (uint32_t)MatchDistance);
+	AppendUInt32(outData, (uint32_t)MatchLength);
+	AppendUInt32(outData, (uint32_t)Blocks.size());
+	AppendUInt32(outData, (uint32_t)Data.size());
+	const uint8_t* pBlocks = (const uint8_t*)Blocks.data();
+	outData.insert(outData.end(), pBlocks, pBlocks + Blocks.size() * sizeof(uint32_t));
+	outData.insert(outData.end(), Data.begin(), Data.end());
+}
+
+bool FInstructionTrace::ReadFrom(const uint8_t* pData, size_t dataSize)
+{
+	Clear();
+
+	uint32_t header[5];
+	if (dataSize < sizeof(header))
+		return false;
+	memcpy(header, pData, sizeof(header));
+	const uint32_t noBlocks = header[3];
+	const uint32_t noDataBytes = header[4];
+	if (dataSize != sizeof(header) + (size_t)noBlocks * sizeof(uint32_t) + noDataBytes)
+		return false;
+	if (noBlocks != (header[0] + kBlockSize - 1) / kBlockSize)
+		return false;
+
+	NoEntries = (int)header[0];
+	MatchDistance = (int)header[1];
+	MatchLength = (int)header[2];
+	pData += sizeof(header);
+	Blocks.resize(noBlocks);
+	memcpy(Blocks.data(), pData, noBlocks * sizeof(uint32_t));
+	pData += noBlocks * sizeof(uint32_t);
+	Data.assign(pData, pData + noDataBytes);
+	return true;
+}
+
+void FInstructionTrace::Add(FAddressRef address)
+{
+	// start a new block - nothing in it refers back to previous blocks
+	if (NoEntries % kBlockSize == 0)
+	{
+		FlushMatch((int)BlockEntries.size());
+		Blocks.push_back((uint32_t)Data.size());
+		BlockEntries.clear();
+		memset(LastSeen, 0, sizeof(LastSeen));
+	}
+
+	const int blockIndex = (int)BlockEntries.size();
+	BlockEntries.push_back(address);
+	NoEntries++;
+
+	uint16_t& lastSeen = LastSeen[HashAddress(address)];
+
+	if (MatchLength > 0)
+	{
+		if (BlockEntries[blockIndex - MatchDistance] == address)
+		{
+			MatchLength++;
+			lastSeen = blockIndex + 1;
+			return;
+		}
+		FlushMatch(blockIndex);
+	}
+
+	// start repeating from the last time we were at this address
+	if (lastSeen != 0 && BlockEntries[lastSeen - 1] == address)
+	{
+		MatchDistance = blockIndex - (lastSeen - 1);
+		MatchLength = 1;
+	}
+	else
+	{
+		WriteLiteral(blockIndex);
+	}
+	lastSeen = blockIndex + 1;
+}
+
+// matchEnd is the block index after the last entry in the repeat
+void FInstructionTrace::FlushMatch(int matchEnd)
+{
+	if (MatchLength == 0)
+		return;
+
+	if (MatchLength >= kMinRepeatLength)
+	{
+		WriteVarInt(((uint32_t)MatchLength << 2) | (uint32_t)ETraceToken::Repeat);
+		WriteVarInt((uint32_t)MatchDistance);
+	}
+	else
+	{
+		for (int i = matchEnd - MatchLength; i < matchEnd; i++)
+			WriteLiteral(i);
+	}
+	MatchLength = 0;
+	MatchDistance = 0;
+}
+
+void FInstructionTrace::WriteLiteral(int blockIndex)
+{
+	const FAddressRef address = BlockEntries[blockIndex];
+	if (blockIndex > 0 && BlockEntries[blockIndex - 1].BankId == address.BankId)
+	{
+		const int delta = (int)address.Address - (int)BlockEntries[blockIndex - 1].Address;
+		WriteVarInt((ZigZagEncode(delta) << 2) | (uint32_t)ETraceToken::Delta);
+	}
+	else
+	{
+		WriteVarInt((uint32_t)ETraceToken::Address);
+		const uint8_t* pBytes = (const uint8_t*)&address.Val;
+		Data.insert(Data.end(), pBytes, pBytes + sizeof(address.Val));
+	}
+}
+
+void FInstructionTrace::WriteVarInt(uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		Data.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	Data.push_back((uint8_t)value);
+}
+
+// returns number of entries decoded
+int FInstructionTrace::DecodeBlock(int blockNo, FAddressRef* pOutEntries) const
+{
+	const uint8_t* pData = Data.data() + Blocks[blockNo];
+	const uint8_t* pDataEnd = Data.data() + (blockNo + 1 < (int)Blocks.size() ? Blocks[blockNo + 1] : Data.size());
+	int noEntries = 0;
+
+	while (pData < pDataEnd)
+	{
+		const uint32_t token = ReadVarInt(pData);
+		switch ((ETraceToken)(token & 3))
+		{
+		case ETraceToken::Delta:
+		{
+			FAddressRef address = pOutEntries[noEntries - 1];
+			address.Address += ZigZagDecode(token >> 2);
+			pOutEntries[noEntries++] = address;
+		}
+		break;
+		case ETraceToken::Address:
+			memcpy(&pOutEntries[noEntries++].Val, pData, sizeof(uint32_t));
+			pData += sizeof(uint32_t);
+			break;
+		case ETraceToken::Repeat:
+		{
+			const int length = (int)(token >> 2);
+			const int distance = (int)ReadVarInt(pData);
+			for (int i = 0; i < length; i++, noEntries++)
+				pOutEntries[noEntries] = pOutEntries[noEntries - distance];
+		}
+		break;
+		default:
+			assert(0);
+			return noEntries;
+		}
+	}
+
+	// a repeat in the last block might not have been written yet
+	if (blockNo == (int)Blocks.size() - 1)
+	{
+		for (int i = 0; i < MatchLength; i++, noEntries++)
+			pOutEntries[noEntries] = pOutEntries[noEntries - MatchDistance];
+	}
+
+	return noEntries;
+}
+
+FAddressRef FInstructionTrace::GetEntry(int index) const
+{
+	FAddressRef blockEntries[kBlockSize];
+	DecodeBlock(index / kBlockSize, blockEntries);
+	return blockEntries[index % kBlockSize];
+}
+
+void FInstructionTrace::GetEntries(int start, int count, std::vector<FAddressRef>& outEntries) const
+{
+	if (start < 0 || count <= 0 || start >= NoEntries)
+		return;
+	const int end = std::min(start + count, NoEntries);
+
+	FAddressRef blockEntries[kBlockSize];
+	for (int blockNo = start / kBlockSize; blockNo * kBlockSize < end; blockNo++)
+	{
+		const int blockStart = blockNo * kBlockSize;
+		const int noEntries = DecodeBlock(blockNo, blockEntries);
+		const int first = std::max(start, blockStart) - blockStart;
+		const int last = std::min(end - blockStart, noEntries);
+		outEntries.insert(outEntries.end(), blockEntries + first, blockEntries + last);
+	}
+}
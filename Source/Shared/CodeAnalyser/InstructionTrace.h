@@ -0,0 +1,50 @@
+#pragma once
+
+#include "CodeAnalyserTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// List of executed instruction addresses, compressed as it's added to.
+// Addresses are stored as the difference from the previous instruction, loops are stored as a repeat of
+// what came a short distance before (LDIR, DJNZ delays, screen clears...).
+// The trace is split into fixed size blocks that don't refer back to earlier blocks so any entry can be
+// found by decoding a single block.
+class FInstructionTrace
+{
+public:
+	static const int	kBlockSize = 1024;
+
+	void	Clear();
+	void	Add(FAddressRef address);
+	void	CopyFrom(const FInstructionTrace& other);	// copies the compressed data only - the copy can be read but not added to
+
+	// compressed data as bytes for saving, reading it back gives a trace that can't be added to
+	void	WriteTo(std::vector<uint8_t>& outData) const;	// appends to outData
+	bool	ReadFrom(const uint8_t* pData, size_t dataSize);
+
+	int			GetNoEntries() const { return NoEntries; }
+	bool		IsEmpty() const { return NoEntries == 0; }
+	FAddressRef	GetEntry(int index) const;
+	void		GetEntries(int start, int count, std::vector<FAddressRef>& outEntries) const;	// appends to outEntries
+	size_t		GetMemoryUsage() const { return Data.size() + Blocks.size() * sizeof(uint32_t); }
+
+private:
+	void	FlushMatch(int matchEnd);
+	void	WriteLiteral(int blockIndex);
+	void	WriteVarInt(uint32_t value);
+	int		DecodeBlock(int blockNo, FAddressRef* pOutEntries) const;
+
+	std::vector<uint8_t>	Data;
+	std::vector<uint32_t>	Blocks;		// offset into Data of the start of each block
+	int						NoEntries = 0;
+
+	// repeat that's still being matched, it's written out when it ends
+	int						MatchDistance = 0;
+	int						MatchLength = 0;
+
+	// only needed while adding
+	std::vector<FAddressRef>	BlockEntries;	// entries in the current block
+	uint16_t				LastSeen[256] = { 0 };	// 1 based index in BlockEntries where an address hashing to each slot was last added
+};
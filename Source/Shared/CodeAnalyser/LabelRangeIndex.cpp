@@ -0,0 +1,75 @@
+#include "LabelRangeIndex.h"
+
+#include <algorithm>
+
+void FLabelRangeIndex::Reset()
+{
+	Pages.clear();
+	for (std::vector<FEntry>& entries : Entries)
+		entries.clear();
+}
+
+bool FLabelRangeIndex::Update(const FCodeAnalysisPage* pPages, int noPages)
+{
+	if ((int)Pages.size() != noPages)
+		Reset();
+	Pages.resize(noPages);
+
+	bool bChanged = false;
+	for (int pageNo = 0; pageNo < noPages; pageNo++)
+	{
+		const FCodeAnalysisPage& page = pPages[pageNo];
+		FPageLabels& pageLabels = Pages[pageNo];
+		if (pageLabels.bGathered && pageLabels.LabelChangeCount == page.LabelChangeCount)
+			continue;
+
+		for (std::vector<FEntry>& entries : pageLabels.Entries)
+			entries.clear();
+
+		const uint16_t pageBaseAddr = pageNo * FCodeAnalysisPage::kPageSize;
+		for (int pageAddr = 0; pageAddr < FCodeAnalysisPage::kPageSize; pageAddr++)
+		{
+			const FLabelInfo* pLabel = page.Labels[pageAddr];
+			if (pLabel == nullptr)
+				continue;
+
+			FEntry entry;
+			entry.BankAddr = pageBaseAddr + pageAddr;
+			entry.pLabel = pLabel;
+
+			pageLabels.Entries[(int)ELabelRangeType::Any].push_back(entry);
+			if (pLabel->LabelType == ELabelType::Code || pLabel->LabelType == ELabelType::Function)
+				pageLabels.Entries[(int)ELabelRangeType::Code].push_back(entry);
+			if (pLabel->LabelType == ELabelType::Function)
+				pageLabels.Entries[(int)ELabelRangeType::Function].push_back(entry);
+		}
+
+		pageLabels.LabelChangeCount = page.LabelChangeCount;
+		pageLabels.bGathered = true;
+		bChanged = true;
+	}
+
+	// pages are in address order so joining them keeps the entries sorted
+	if (bChanged)
+	{
+		for (int type = 0; type < (int)ELabelRangeType::Count; type++)
+		{
+			std::vector<FEntry>& entries = Entries[type];
+			entries.clear();
+			for (const FPageLabels& pageLabels : Pages)
+				entries.insert(entries.end(), pageLabels.Entries[type].begin(), pageLabels.Entries[type].end());
+		}
+	}
+
+	return bChanged;
+}
+
+const FLabelRangeIndex::FEntry* FLabelRangeIndex::FindLabel(ELabelRangeType type, uint16_t bankAddr) const
+{
+	const std::vector<FEntry>& entries = Entries[(int)type];
+	auto entryIt = std::upper_bound(entries.begin(), entries.end(), bankAddr, [](uint16_t addr, const FEntry& entry) { return addr < entry.BankAddr; });
+	if (entryIt == entries.begin())
+		return nullptr;
+
+	return &*(entryIt - 1);
+}
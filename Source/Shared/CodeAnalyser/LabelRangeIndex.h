@@ -0,0 +1,46 @@
+#pragma once
+
+#include "CodeAnalysisPage.h"
+
+#include <cstdint>
+#include <vector>
+
+// which labels a search considers
+enum class ELabelRangeType
+{
+	Any,
+	Code,		// code & function labels
+	Function,
+
+	Count
+};
+
+// A bank's labels sorted by address, so the label an address falls under can be found with a binary search
+// instead of walking back through the pages.
+// Updating only gathers the labels again for pages whose LabelChangeCount has moved on.
+class FLabelRangeIndex
+{
+public:
+	struct FEntry
+	{
+		uint16_t			BankAddr = 0;
+		const FLabelInfo*	pLabel = nullptr;
+	};
+
+	void	Reset();
+	bool	Update(const FCodeAnalysisPage* pPages, int noPages);	// returns true if any labels changed
+
+	// last label of the type at or before the bank address, nullptr if there isn't one
+	const FEntry*	FindLabel(ELabelRangeType type, uint16_t bankAddr) const;
+
+private:
+	struct FPageLabels
+	{
+		bool				bGathered = false;
+		uint32_t			LabelChangeCount = 0;
+		std::vector<FEntry>	Entries[(int)ELabelRangeType::Count];
+	};
+
+	std::vector<FPageLabels>	Pages;
+	std::vector<FEntry>			Entries[(int)ELabelRangeType::Count];
+};
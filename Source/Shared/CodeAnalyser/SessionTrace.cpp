@@ -0,0 +1,546 @@
+#include "SessionTrace.h"
+
+#include "Debug/DebugLog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
+static const uint32_t kSessionTraceMagic = 0x43525453;	// 'STRC'
+static const uint32_t kChunkMagic = 0x4b4e4843;			// 'CHNK'
+static const uint32_t kIndexMagic = 0x58444e49;			// 'INDX'
+static const uint32_t kSessionTraceVersion = 1;
+static const int kMemoryPageSize = 1024;				// granularity of memory changes between frames
+
+static const uint32_t kFrameFlag_KeyFrame = 1;
+
+struct FSessionTraceFileHeader
+{
+	uint32_t	Magic = kSessionTraceMagic;
+	uint32_t	Version = kSessionTraceVersion;
+	uint32_t	BankSize = 0;
+	uint32_t	NoBanks = 0;
+};
+
+struct FSessionTraceChunkHeader
+{
+	uint32_t	Magic = kChunkMagic;
+	int32_t		FirstFrameNo = 0;
+	int32_t		LastFrameNo = 0;
+	uint32_t	RawSize = 0;
+	uint32_t	CompressedSize = 0;
+};
+
+// last thing in the file, missing if the recording wasn't closed properly
+struct FSessionTraceIndexFooter
+{
+	uint64_t	IndexOffset = 0;
+	uint32_t	NoChunks = 0;
+	uint32_t	Magic = kIndexMagic;
+};
+
+// 64 bit file offsets for sessions over 2GB
+static bool SeekFile(FILE* fp, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(fp, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static uint64_t GetFileSize(FILE* fp)
+{
+#ifdef _WIN32
+	_fseeki64(fp, 0, SEEK_END);
+	return (uint64_t)_ftelli64(fp);
+#else
+	fseeko(fp, 0, SEEK_END);
+	return (uint64_t)ftello(fp);
+#endif
+}
+
+static void AppendBytes(std::vector<uint8_t>& outData, const void* pData, size_t size)
+{
+	const uint8_t* pBytes = (const uint8_t*)pData;
+	outData.insert(outData.end(), pBytes, pBytes + size);
+}
+
+static void AppendUInt32(std::vector<uint8_t>& outData, uint32_t value)
+{
+	AppendBytes(outData, &value, sizeof(uint32_t));
+}
+
+// Writer
+
+bool FSessionTraceWriter::Open(const char* pFileName, int bankSize, int noBanks, int keyFrameInterval, int maxQueuedFrames)
+{
+	Close();
+
+	fp = fopen(pFileName, "wb");
+	if (fp == nullptr)
+	{
+		LOGERROR("Could not open session trace '%s' for writing", pFileName);
+		return false;
+	}
+
+	FileName = pFileName;
+	BankSize = bankSize;
+	NoBanks = noBanks;
+	KeyFrameInterval = std::max(1, keyFrameInterval);
+	MaxQueuedFrames = std::max(1, maxQueuedFrames);
+
+	NoFramesWritten = 0;
+	NoFramesDropped = 0;
+	BytesWritten = 0;
+	LastAddedFrameNo = -1;
+	ChunkData.clear();
+	ChunkNoFrames = 0;
+	ChunkIndex.clear();
+	bWriteFailed = false;
+
+	FSessionTraceFileHeader header;
+	header.BankSize = (uint32_t)bankSize;
+	header.NoBanks = (uint32_t)noBanks;
+	WriteBytes(&header, sizeof(header));
+
+	bStopping = false;
+	WriteThread = std::thread(&FSessionTraceWriter::WriteThreadMain, this);
+	return true;
+}
+
+void FSessionTraceWriter::Close()
+{
+	if (IsOpen() == false)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(QueueLock);
+		bStopping = true;
+	}
+	QueueSignal.notify_one();
+	WriteThread.join();
+
+	WriteIndex();
+	fclose(fp);
+	fp = nullptr;
+
+	LOGINFO("Session trace '%s' closed: %d frames written, %d dropped, %dK", FileName.c_str(), (int)NoFramesWritten, (int)NoFramesDropped, (int)(BytesWritten / 1024));
+}
+
+bool FSessionTraceWriter::AddFrame(int frameNo, const FInstructionTrace& trace, const FEventTrace& eventTrace, FEventRange eventRange,
+									const void* pMachineState, size_t machineStateSize, const uint8_t* const* pBanks)
+{
+	if (IsOpen() == false)
+		return false;
+
+	// the chunk index relies on frame numbers going up
+	if (frameNo <= LastAddedFrameNo)
+	{
+		LOGWARNING("Session trace frame %d added after frame %d, ignoring", frameNo, LastAddedFrameNo);
+		return false;
+	}
+	LastAddedFrameNo = frameNo;
+
+	std::unique_ptr<FQueuedFrame> pFrame;
+	{
+		std::lock_guard<std::mutex> lock(QueueLock);
+		if ((int)Queue.size() >= MaxQueuedFrames)
+		{
+			NoFramesDropped++;
+			return false;
+		}
+
+		if (FreeFrames.empty() == false)
+		{
+			pFrame = std::move(FreeFrames.back());
+			FreeFrames.pop_back();
+		}
+	}
+
+	if (pFrame == nullptr)
+		pFrame = std::make_unique<FQueuedFrame>();
+
+	pFrame->FrameNo = frameNo;
+	pFrame->Trace.clear();
+	trace.WriteTo(pFrame->Trace);
+
+	pFrame->Events.clear();
+	if (eventTrace.IsRangeAvailable(eventRange))
+	{
+		for (uint64_t i = eventRange.Start; i < eventRange.End; i++)
+			pFrame->Events.push_back(eventTrace.GetEvent(i));
+	}
+
+	const uint8_t* pState = (const uint8_t*)pMachineState;
+	pFrame->MachineState.assign(pState, pState + machineStateSize);
+
+	pFrame->Memory.resize((size_t)BankSize * NoBanks);
+	for (int bankNo = 0; bankNo < NoBanks; bankNo++)
+		memcpy(pFrame->Memory.data() + (size_t)bankNo * BankSize, pBanks[bankNo], BankSize);
+
+	{
+		std::lock_guard<std::mutex> lock(QueueLock);
+		Queue.push_back(std::move(pFrame));
+	}
+	QueueSignal.notify_one();
+	return true;
+}
+
+void FSessionTraceWriter::WriteThreadMain()
+{
+	while (true)
+	{
+		std::unique_ptr<FQueuedFrame> pFrame;
+		{
+			std::unique_lock<std::mutex> lock(QueueLock);
+			QueueSignal.wait(lock, [this] { return Queue.empty() == false || bStopping; });
+			if (Queue.empty())
+				break;	// stopping & everything has been written
+
+			pFrame = std::move(Queue.front());
+			Queue.pop_front();
+		}
+
+		AddToChunk(*pFrame);
+		if (ChunkNoFrames == KeyFrameInterval)
+			WriteChunk();
+
+		std::lock_guard<std::mutex> lock(QueueLock);
+		FreeFrames.push_back(std::move(pFrame));
+	}
+
+	if (ChunkNoFrames > 0)
+		WriteChunk();
+}
+
+// Frame layout in a chunk:
+//	FrameNo, Flags, trace size, trace, event count, events, machine state size, machine state
+//	keyframes then have the whole of memory, other frames have a page count followed by page number & contents for each changed page
+void FSessionTraceWriter::AddToChunk(const FQueuedFrame& frame)
+{
+	const bool bKeyFrame = ChunkNoFrames == 0;
+	if (bKeyFrame)
+		ChunkFirstFrameNo = frame.FrameNo;
+	ChunkLastFrameNo = frame.FrameNo;
+
+	AppendUInt32(ChunkData, (uint32_t)frame.FrameNo);
+	AppendUInt32(ChunkData, bKeyFrame ? kFrameFlag_KeyFrame : 0);
+	AppendUInt32(ChunkData, (uint32_t)frame.Trace.size());
+	AppendBytes(ChunkData, frame.Trace.data(), frame.Trace.size());
+	AppendUInt32(ChunkData, (uint32_t)frame.Events.size());
+	AppendBytes(ChunkData, frame.Events.data(), frame.Events.size() * sizeof(FEvent));
+	AppendUInt32(ChunkData, (uint32_t)frame.MachineState.size());
+	AppendBytes(ChunkData, frame.MachineState.data(), frame.MachineState.size());
+
+	if (bKeyFrame)
+	{
+		AppendBytes(ChunkData, frame.Memory.data(), frame.Memory.size());
+	}
+	else
+	{
+		const size_t countPos = ChunkData.size();
+		AppendUInt32(ChunkData, 0);
+
+		uint32_t noChangedPages = 0;
+		const uint32_t noPages = (uint32_t)(frame.Memory.size() / kMemoryPageSize);
+		for (uint32_t pageNo = 0; pageNo < noPages; pageNo++)
+		{
+			const size_t pageOffset = (size_t)pageNo * kMemoryPageSize;
+			if (memcmp(frame.Memory.data() + pageOffset, LastMemory.data() + pageOffset, kMemoryPageSize) == 0)
+				continue;
+
+			AppendUInt32(ChunkData, pageNo);
+			AppendBytes(ChunkData, frame.Memory.data() + pageOffset, kMemoryPageSize);
+			noChangedPages++;
+		}
+		memcpy(ChunkData.data() + countPos, &noChangedPages, sizeof(uint32_t));
+	}
+
+	LastMemory = frame.Memory;
+	ChunkNoFrames++;
+}
+
+bool FSessionTraceWriter::WriteChunk()
+{
+	const int noFrames = ChunkNoFrames;
+	ChunkNoFrames = 0;
+
+	if (bWriteFailed)
+	{
+		NoFramesDropped += noFrames;
+		ChunkData.clear();
+		return false;
+	}
+
+	uLongf compressedSize = compressBound((uLong)ChunkData.size());
+	CompressedData.resize(compressedSize);
+	if (compress2(CompressedData.data(), &compressedSize, ChunkData.data(), (uLong)ChunkData.size(), Z_BEST_SPEED) != Z_OK)
+	{
+		LOGERROR("Session trace: failed to compress frames %d-%d", ChunkFirstFrameNo, ChunkLastFrameNo);
+		NoFramesDropped += noFrames;
+		ChunkData.clear();
+		return false;
+	}
+
+	FSessionTraceChunk& chunk = ChunkIndex.emplace_back();
+	chunk.FirstFrameNo = ChunkFirstFrameNo;
+	chunk.LastFrameNo = ChunkLastFrameNo;
+	chunk.Offset = BytesWritten;
+
+	FSessionTraceChunkHeader header;
+	header.FirstFrameNo = ChunkFirstFrameNo;
+	header.LastFrameNo = ChunkLastFrameNo;
+	header.RawSize = (uint32_t)ChunkData.size();
+	header.CompressedSize = (uint32_t)compressedSize;
+	ChunkData.clear();
+
+	if (WriteBytes(&header, sizeof(header)) == false || WriteBytes(CompressedData.data(), compressedSize) == false)
+	{
+		ChunkIndex.pop_back();
+		NoFramesDropped += noFrames;
+		return false;
+	}
+
+	NoFramesWritten += noFrames;
+	return true;
+}
+
+bool FSessionTraceWriter::WriteBytes(const void* pData, size_t size)
+{
+	if (bWriteFailed)
+		return false;
+
+	if (fwrite(pData, 1, size, fp) != size)
+	{
+		LOGERROR("Session trace: failed writing to '%s', recording stopped", FileName.c_str());
+		bWriteFailed = true;
+		return false;
+	}
+
+	BytesWritten += size;
+	return true;
+}
+
+void FSessionTraceWriter::WriteIndex()
+{
+	FSessionTraceIndexFooter footer;
+	footer.IndexOffset = BytesWritten;
+	footer.NoChunks = (uint32_t)ChunkIndex.size();
+	WriteBytes(ChunkIndex.data(), ChunkIndex.size() * sizeof(FSessionTraceChunk));
+	WriteBytes(&footer, sizeof(footer));
+}
+
+// Reader
+
+bool FSessionTraceReader::Open(const char* pFileName)
+{
+	Close();
+
+	fp = fopen(pFileName, "rb");
+	if (fp == nullptr)
+	{
+		LOGERROR("Could not open session trace '%s'", pFileName);
+		return false;
+	}
+
+	FSessionTraceFileHeader header;
+	if (fread(&header, sizeof(header), 1, fp) != 1 || header.Magic != kSessionTraceMagic || header.Version != kSessionTraceVersion)
+	{
+		LOGERROR("'%s' is not a session trace", pFileName);
+		Close();
+		return false;
+	}
+
+	BankSize = (int)header.BankSize;
+	NoBanks = (int)header.NoBanks;
+
+	const uint64_t fileSize = GetFileSize(fp);
+	if (ReadIndex(fileSize) == false)
+	{
+		LOGWARNING("Session trace '%s' has no index, it probably wasn't closed - scanning chunks", pFileName);
+		ScanChunks(fileSize);
+	}
+
+	return true;
+}
+
+void FSessionTraceReader::Close()
+{
+	if (fp != nullptr)
+		fclose(fp);
+	fp = nullptr;
+	ChunkIndex.clear();
+	LoadedChunk = -1;
+	ChunkData.clear();
+}
+
+int FSessionTraceReader::GetFirstFrameNo() const
+{
+	return ChunkIndex.empty() ? -1 : ChunkIndex.front().FirstFrameNo;
+}
+
+int FSessionTraceReader::GetLastFrameNo() const
+{
+	return ChunkIndex.empty() ? -1 : ChunkIndex.back().LastFrameNo;
+}
+
+bool FSessionTraceReader::ReadIndex(uint64_t fileSize)
+{
+	FSessionTraceIndexFooter footer;
+	if (fileSize < sizeof(FSessionTraceFileHeader) + sizeof(footer))
+		return false;
+	if (SeekFile(fp, fileSize - sizeof(footer)) == false || fread(&footer, sizeof(footer), 1, fp) != 1)
+		return false;
+	if (footer.Magic != kIndexMagic || footer.IndexOffset + footer.NoChunks * sizeof(FSessionTraceChunk) + sizeof(footer) != fileSize)
+		return false;
+
+	ChunkIndex.resize(footer.NoChunks);
+	if (SeekFile(fp, footer.IndexOffset) == false || fread(ChunkIndex.data(), sizeof(FSessionTraceChunk), footer.NoChunks, fp) != footer.NoChunks)
+	{
+		ChunkIndex.clear();
+		return false;
+	}
+	return true;
+}
+
+// rebuild the index from the chunk headers - a chunk cut short at the end of the file is left out
+bool FSessionTraceReader::ScanChunks(uint64_t fileSize)
+{
+	ChunkIndex.clear();
+	uint64_t offset = sizeof(FSessionTraceFileHeader);
+	while (offset + sizeof(FSessionTraceChunkHeader) <= fileSize)
+	{
+		FSessionTraceChunkHeader header;
+		if (SeekFile(fp, offset) == false || fread(&header, sizeof(header), 1, fp) != 1 || header.Magic != kChunkMagic)
+			break;
+
+		const uint64_t chunkEnd = offset + sizeof(header) + header.CompressedSize;
+		if (chunkEnd > fileSize)
+			break;
+
+		FSessionTraceChunk& chunk = ChunkIndex.emplace_back();
+		chunk.FirstFrameNo = header.FirstFrameNo;
+		chunk.LastFrameNo = header.LastFrameNo;
+		chunk.Offset = offset;
+		offset = chunkEnd;
+	}
+	return ChunkIndex.empty() == false;
+}
+
+bool FSessionTraceReader::LoadChunk(int chunkNo)
+{
+	if (LoadedChunk == chunkNo)
+		return true;
+
+	LoadedChunk = -1;
+	FSessionTraceChunkHeader header;
+	if (SeekFile(fp, ChunkIndex[chunkNo].Offset) == false || fread(&header, sizeof(header), 1, fp) != 1 || header.Magic != kChunkMagic)
+		return false;
+
+	CompressedData.resize(header.CompressedSize);
+	if (fread(CompressedData.data(), 1, header.CompressedSize, fp) != header.CompressedSize)
+		return false;
+
+	ChunkData.resize(header.RawSize);
+	uLongf rawSize = header.RawSize;
+	if (uncompress(ChunkData.data(), &rawSize, CompressedData.data(), header.CompressedSize) != Z_OK || rawSize != header.RawSize)
+	{
+		LOGERROR("Session trace: chunk for frames %d-%d is corrupt", header.FirstFrameNo, header.LastFrameNo);
+		return false;
+	}
+
+	LoadedChunk = chunkNo;
+	return true;
+}
+
+// bounds checked reading through a chunk's frames
+struct FChunkReader
+{
+	const uint8_t*	pData;
+	const uint8_t*	pEnd;
+
+	const uint8_t* Get(size_t size)
+	{
+		if ((size_t)(pEnd - pData) < size)
+			return nullptr;
+		const uint8_t* pBytes = pData;
+		pData += size;
+		return pBytes;
+	}
+
+	bool ReadUInt32(uint32_t& outValue)
+	{
+		const uint8_t* pBytes = Get(sizeof(uint32_t));
+		if (pBytes == nullptr)
+			return false;
+		memcpy(&outValue, pBytes, sizeof(uint32_t));
+		return true;
+	}
+};
+
+bool FSessionTraceReader::ReadFrame(int frameNo, FSessionTraceFrame& outFrame)
+{
+	if (IsOpen() == false || ChunkIndex.empty())
+		return false;
+
+	// chunks are in frame order
+	auto chunkIt = std::upper_bound(ChunkIndex.begin(), ChunkIndex.end(), frameNo,
+		[](int frameNo, const FSessionTraceChunk& chunk) { return frameNo < chunk.FirstFrameNo; });
+	if (chunkIt == ChunkIndex.begin())
+		return false;
+	const int chunkNo = (int)(chunkIt - ChunkIndex.begin()) - 1;
+	if (frameNo > ChunkIndex[chunkNo].LastFrameNo || LoadChunk(chunkNo) == false)
+		return false;
+
+	// apply the memory changes from the keyframe at the start of the chunk up to the frame
+	const size_t memorySize = (size_t)BankSize * NoBanks;
+	outFrame.Memory.resize(memorySize);
+	FChunkReader reader = { ChunkData.data(), ChunkData.data() + ChunkData.size() };
+	while (true)
+	{
+		uint32_t recordFrameNo, flags, traceSize, noEvents, stateSize;
+		if (reader.ReadUInt32(recordFrameNo) == false || reader.ReadUInt32(flags) == false || (int)recordFrameNo > frameNo)
+			return false;
+
+		const bool bFrame = (int)recordFrameNo == frameNo;
+		const uint8_t* pTrace = reader.ReadUInt32(traceSize) ? reader.Get(traceSize) : nullptr;
+		const uint8_t* pEvents = pTrace != nullptr && reader.ReadUInt32(noEvents) ? reader.Get(noEvents * sizeof(FEvent)) : nullptr;
+		const uint8_t* pState = pEvents != nullptr && reader.ReadUInt32(stateSize) ? reader.Get(stateSize) : nullptr;
+		if (pState == nullptr)
+			return false;
+
+		if (flags & kFrameFlag_KeyFrame)
+		{
+			const uint8_t* pMemory = reader.Get(memorySize);
+			if (pMemory == nullptr)
+				return false;
+			memcpy(outFrame.Memory.data(), pMemory, memorySize);
+		}
+		else
+		{
+			uint32_t noChangedPages;
+			if (reader.ReadUInt32(noChangedPages) == false)
+				return false;
+			for (uint32_t i = 0; i < noChangedPages; i++)
+			{
+				uint32_t pageNo;
+				if (reader.ReadUInt32(pageNo) == false || (size_t)(pageNo + 1) * kMemoryPageSize > memorySize)
+					return false;
+				const uint8_t* pPage = reader.Get(kMemoryPageSize);
+				if (pPage == nullptr)
+					return false;
+				memcpy(outFrame.Memory.data() + (size_t)pageNo * kMemoryPageSize, pPage, kMemoryPageSize);
+			}
+		}
+
+		if (bFrame)
+		{
+			outFrame.FrameNo = frameNo;
+			outFrame.Events.resize(noEvents);
+			memcpy(outFrame.Events.data(), pEvents, noEvents * sizeof(FEvent));
+			outFrame.MachineState.assign(pState, pState + stateSize);
+			return outFrame.InstructionTrace.ReadFrom(pTrace, traceSize);
+		}
+	}
+}
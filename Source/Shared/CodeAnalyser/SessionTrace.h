@@ -0,0 +1,141 @@
+#pragma once
+
+#include "EventTrace.h"
+#include "InstructionTrace.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Everything recorded for one emulated frame
+struct FSessionTraceFrame
+{
+	int						FrameNo = -1;
+	FInstructionTrace		InstructionTrace;	// read only
+	std::vector<FEvent>		Events;
+	std::vector<uint8_t>	MachineState;	// CPU registers, bank setup etc. - up to the machine what goes in here
+	std::vector<uint8_t>	Memory;			// recorded banks one after the other
+};
+
+// entry in the chunk index, stored as is at the end of the file
+struct FSessionTraceChunk
+{
+	int			FirstFrameNo = 0;
+	int			LastFrameNo = 0;	// frames can be missing if they were dropped
+	uint64_t	Offset = 0;	// of the chunk header
+};
+
+// Records a whole session to disk.
+// The file is a run of zlib compressed chunks, each starts with a full copy of memory followed by frames
+// that only store the pages that changed. An index of the chunks is written when the file is closed.
+// Frames are passed to a background thread through a bounded queue - if the disk can't keep up frames are dropped
+// rather than holding up the emulation.
+class FSessionTraceWriter
+{
+public:
+	static const int kDefaultKeyFrameInterval = 50;
+	static const int kDefaultMaxQueuedFrames = 64;
+
+	~FSessionTraceWriter() { Close(); }
+
+	bool	Open(const char* pFileName, int bankSize, int noBanks, int keyFrameInterval = kDefaultKeyFrameInterval, int maxQueuedFrames = kDefaultMaxQueuedFrames);
+	void	Close();	// writes out everything still queued
+	bool	IsOpen() const { return WriteThread.joinable(); }
+
+	// called at the end of each emulated frame, returns false if the frame was dropped or isn't after the last one added
+	bool	AddFrame(int frameNo, const FInstructionTrace& trace, const FEventTrace& eventTrace, FEventRange eventRange,
+					const void* pMachineState, size_t machineStateSize, const uint8_t* const* pBanks);
+
+	const std::string&	GetFileName() const { return FileName; }
+	int			GetNoFramesWritten() const { return NoFramesWritten; }
+	int			GetNoFramesDropped() const { return NoFramesDropped; }
+	uint64_t	GetBytesWritten() const { return BytesWritten; }
+
+private:
+	struct FQueuedFrame
+	{
+		int						FrameNo = -1;
+		std::vector<uint8_t>	Trace;
+		std::vector<FEvent>		Events;
+		std::vector<uint8_t>	MachineState;
+		std::vector<uint8_t>	Memory;
+	};
+
+	void	WriteThreadMain();
+	void	AddToChunk(const FQueuedFrame& frame);
+	bool	WriteChunk();
+	bool	WriteBytes(const void* pData, size_t size);
+	void	WriteIndex();
+
+	std::string		FileName;
+	FILE*			fp = nullptr;
+	int				BankSize = 0;
+	int				NoBanks = 0;
+	int				KeyFrameInterval = kDefaultKeyFrameInterval;
+	int				MaxQueuedFrames = kDefaultMaxQueuedFrames;
+	int				LastAddedFrameNo = -1;
+
+	// shared with the write thread
+	std::mutex		QueueLock;
+	std::condition_variable	QueueSignal;
+	std::deque<std::unique_ptr<FQueuedFrame>>	Queue;
+	std::vector<std::unique_ptr<FQueuedFrame>>	FreeFrames;	// reused so the emulation isn't allocating every frame
+	bool			bStopping = false;
+	std::thread		WriteThread;
+
+	std::atomic<int>		NoFramesWritten = 0;
+	std::atomic<int>		NoFramesDropped = 0;
+	std::atomic<uint64_t>	BytesWritten = 0;
+
+	// only touched by the write thread
+	std::vector<uint8_t>	ChunkData;	// uncompressed frames in the current chunk
+	std::vector<uint8_t>	CompressedData;
+	int						ChunkFirstFrameNo = 0;
+	int						ChunkLastFrameNo = 0;
+	int						ChunkNoFrames = 0;
+	std::vector<uint8_t>	LastMemory;	// memory in the previous frame written, deltas are made against this
+	std::vector<FSessionTraceChunk>	ChunkIndex;
+	bool					bWriteFailed = false;
+};
+
+// Reads frames back from a recorded session.
+// Any frame can be rebuilt by decompressing the chunk it's in and applying the memory changes from the chunk start.
+class FSessionTraceReader
+{
+public:
+	~FSessionTraceReader() { Close(); }
+
+	bool	Open(const char* pFileName);
+	void	Close();
+	bool	IsOpen() const { return fp != nullptr; }
+
+	int		GetFirstFrameNo() const;
+	int		GetLastFrameNo() const;
+	int		GetNoChunks() const { return (int)ChunkIndex.size(); }
+	int		GetBankSize() const { return BankSize; }
+	int		GetNoBanks() const { return NoBanks; }
+
+	// returns false if the frame wasn't recorded (before the start, after the end or dropped)
+	bool	ReadFrame(int frameNo, FSessionTraceFrame& outFrame);
+
+private:
+	bool	ReadIndex(uint64_t fileSize);
+	bool	ScanChunks(uint64_t fileSize);
+	bool	LoadChunk(int chunkNo);
+
+	FILE*	fp = nullptr;
+	int		BankSize = 0;
+	int		NoBanks = 0;
+	std::vector<FSessionTraceChunk>	ChunkIndex;
+
+	int						LoadedChunk = -1;
+	std::vector<uint8_t>	ChunkData;
+	std::vector<uint8_t>	CompressedData;
+};
@@ -2,7 +2,13 @@
 
 #include "CodeAnalyser/CodeAnalyserTypes.h"
 #include "CodeAnalyser/CodeAnalysisPage.h"
+#include "CodeAnalyser/EventTrace.h"
+#include "CodeAnalyser/InstructionTrace.h"
+#include "CodeAnalyser/SessionTrace.h"
+#include "Util/MemoryHistory.h"
+#include "Util/PaletteConvert.h"
 
+#include <cstring>
 #include <gtest/gtest.h>
 
 TEST(CodeAnalyserTest, BasicAssertions)
@@ -27,6 +33,359 @@ TEST(CodeAnalyserTest, Enums)
 	EXPECT_EQ((int)ELabelType::Text, 3);
 }
 
+TEST(CodeAnalyserTest, ItemReferenceTracker)
+{
+	FItemReferenceTracker tracker;
+	EXPECT_TRUE(tracker.IsEmpty());
+
+	// enough references to go past inline storage & linear search
+	for (int pass = 0; pass < 3; pass++)
+	{
+		for (int i = 0; i < 100; i++)
+			tracker.RegisterAccess(FAddressRef(1, (uint16_t)(i * 3)));
+	}
+
+	EXPECT_EQ(tracker.GetNoReferences(), 100);
+	for (int i = 0; i < 100; i++)
+	{
+		EXPECT_EQ(tracker.GetReferences()[i], FAddressRef(1, (uint16_t)(i * 3)));	// keeps first access order
+		EXPECT_EQ(tracker.GetCount(i), 3);
+	}
+
+	FItemReferenceTracker copy = tracker;
+	EXPECT_EQ(copy.GetNoReferences(), 100);
+
+	tracker.Reset();
+	EXPECT_TRUE(tracker.IsEmpty());
+	EXPECT_EQ(copy.GetNoReferences(), 100);
+}
+
+TEST(CodeAnalyserTest, PageAccessTracking)
+{
+	FCodeAnalysisPage* pPage = new FCodeAnalysisPage;
+	pPage->Initialise();
+
+	EXPECT_TRUE(pPage->GetReads(10).IsEmpty());
+	EXPECT_EQ(pPage->LastFrameRead[10], -1);
+
+	pPage->RegisterRead(10, FAddressRef(0, 0x8000), 5);
+	pPage->RegisterRead(10, FAddressRef(0, 0x8000), 6);
+	pPage->RegisterWrite(11, FAddressRef(0, 0x8010), 6);
+
+	EXPECT_EQ(pPage->LastFrameRead[10], 6);
+	EXPECT_EQ(pPage->GetReads(10).GetNoReferences(), 1);
+	EXPECT_EQ(pPage->GetReads(10).GetCount(0), 2);
+	EXPECT_TRUE(pPage->GetWrites(10).IsEmpty());
+	EXPECT_EQ(pPage->GetWrites(11).GetNoReferences(), 1);
+	EXPECT_EQ(pPage->LastFrameWritten[11], 6);
+
+	pPage->ResetAccessInfo();
+	EXPECT_TRUE(pPage->GetReads(10).IsEmpty());
+	EXPECT_EQ(pPage->LastFrameRead[10], -1);
+	delete pPage;
+}
+
+TEST(CodeAnalyserTest, PageCoverage)
+{
+	FCodeAnalysisPage* pPage = new FCodeAnalysisPage;
+	pPage->Initialise();
+	pPage->UpdateCoverage();
+	EXPECT_EQ(pPage->Coverage.Unknown, (int)FCodeAnalysisPage::kPageSize);
+
+	// counts follow the first accesses without counting the page again
+	pPage->RegisterRead(10, FAddressRef(0, 0x8000), 5);
+	pPage->RegisterRead(10, FAddressRef(0, 0x8000), 6);
+	EXPECT_EQ(pPage->Coverage.ReadOnlyData, 1);
+	pPage->RegisterWrite(10, FAddressRef(0, 0x8010), 6);
+	pPage->RegisterWrite(11, FAddressRef(0, 0x8010), 6);
+	EXPECT_EQ(pPage->Coverage.ReadOnlyData, 0);
+	EXPECT_EQ(pPage->Coverage.ReadWriteData, 1);
+	EXPECT_EQ(pPage->Coverage.WriteOnlyData, 1);
+	EXPECT_EQ(pPage->Coverage.Unknown, FCodeAnalysisPage::kPageSize - 2);
+
+	// same as counting it from scratch
+	const FCoverageStats incremental = pPage->Coverage;
+	pPage->AnnotationChangeCount++;
+	pPage->UpdateCoverage();
+	EXPECT_EQ(pPage->Coverage.ReadWriteData, incremental.ReadWriteData);
+	EXPECT_EQ(pPage->Coverage.WriteOnlyData, incremental.WriteOnlyData);
+	EXPECT_EQ(pPage->Coverage.Unknown, incremental.Unknown);
+
+	pPage->ResetAccessInfo();
+	EXPECT_EQ(pPage->Coverage.Unknown, (int)FCodeAnalysisPage::kPageSize);
+	delete pPage;
+}
+
+TEST(CodeAnalyserTest, EventTrace)
+{
+	FEventTrace trace;
+	trace.Init(100, 40);	// rounded up to 128
+	EXPECT_EQ(trace.GetCapacity(), 128);
+
+	// frame limit
+	trace.StartFrame();
+	for (int i = 0; i < 50; i++)
+		trace.AddEvent(1, FAddressRef(0, 0x8000), (uint16_t)i, 0, 0);
+	const FEventRange firstFrame = trace.GetFrameRange();
+	EXPECT_EQ(firstFrame.GetCount(), 40);
+	EXPECT_EQ(trace.GetNoDroppedThisFrame(), 10);
+	EXPECT_EQ(trace.GetEvent(firstFrame.Start + 39).Address, 39);
+
+	// wrap around over the first frame
+	for (int frame = 0; frame < 3; frame++)
+	{
+		trace.StartFrame();
+		EXPECT_EQ(trace.GetNoDroppedThisFrame(), 0);
+		for (int i = 0; i < 40; i++)
+			trace.AddEvent(2, FAddressRef(0, 0x8000), (uint16_t)(100 + i), 0, 0);
+	}
+	const FEventRange lastFrame = trace.GetFrameRange();
+	EXPECT_TRUE(trace.IsRangeAvailable(lastFrame));
+	EXPECT_FALSE(trace.IsRangeAvailable(firstFrame));
+	EXPECT_EQ(trace.GetEvent(lastFrame.Start).Address, 100);
+	EXPECT_EQ(trace.GetAvailableRange().GetCount(), 128);
+
+	trace.Clear();
+	EXPECT_EQ(trace.GetAvailableRange().GetCount(), 0);
+}
+
+TEST(CodeAnalyserTest, InstructionTrace)
+{
+	// loops, a block copy and a bank change - like a real frame
+	std::vector<FAddressRef> expected;
+	for (int i = 0; i < 5000; i++)
+	{
+		for (uint16_t addr = 0x8000; addr < 0x8010; addr += 2)
+			expected.push_back(FAddressRef(3, addr));
+		if ((i & 63) == 0)
+		{
+			for (int j = 0; j < 200; j++)
+				expected.push_back(FAddressRef(3, 0x9000));	// LDIR
+			expected.push_back(FAddressRef(1, 0x0038));
+			expected.push_back(FAddressRef(1, 0x0039));
+		}
+	}
+
+	FInstructionTrace trace;
+	for (const FAddressRef& addr : expected)
+		trace.Add(addr);
+	ASSERT_EQ(trace.GetNoEntries(), (int)expected.size());
+
+	std::vector<FAddressRef> decoded;
+	trace.GetEntries(0, trace.GetNoEntries(), decoded);
+	ASSERT_EQ(decoded.size(), expected.size());
+	for (size_t i = 0; i < expected.size(); i++)
+		ASSERT_EQ(decoded[i], expected[i]);
+
+	// random access across block boundaries
+	for (int i = 0; i < (int)expected.size(); i += 997)
+		EXPECT_EQ(trace.GetEntry(i), expected[i]);
+	decoded.clear();
+	trace.GetEntries(FInstructionTrace::kBlockSize - 5, 10, decoded);
+	for (int i = 0; i < 10; i++)
+		EXPECT_EQ(decoded[i], expected[FInstructionTrace::kBlockSize - 5 + i]);
+
+	EXPECT_LT(trace.GetMemoryUsage(), expected.size() * sizeof(FAddressRef) / 4);
+
+	// copies are read from the same data
+	FInstructionTrace copy;
+	copy.CopyFrom(trace);
+	EXPECT_EQ(copy.GetNoEntries(), trace.GetNoEntries());
+	EXPECT_EQ(copy.GetEntry(trace.GetNoEntries() - 1), expected.back());
+
+	trace.Clear();
+	EXPECT_TRUE(trace.IsEmpty());
+}
+
+TEST(CodeAnalyserTest, SessionTrace)
+{
+	const char* pFileName = "SessionTraceTest.trace";
+	const int kBankSize = 4096;
+	const int kNoBanks = 2;
+	const int kNoFrames = 120;
+
+	uint8_t memory[kNoBanks][kBankSize] = {};
+	const uint8_t* pBanks[kNoBanks] = { memory[0], memory[1] };
+	FEventTrace eventTrace;
+	eventTrace.Init(1024, 64);
+
+	// queue is big enough that no frames get dropped
+	FSessionTraceWriter writer;
+	ASSERT_TRUE(writer.Open(pFileName, kBankSize, kNoBanks, 50, kNoFrames));
+	for (int frameNo = 0; frameNo < kNoFrames; frameNo++)
+	{
+		memory[frameNo & 1][(frameNo * 37) % kBankSize] = (uint8_t)frameNo;
+
+		FInstructionTrace trace;
+		for (int i = 0; i < 100 + frameNo; i++)
+			trace.Add(FAddressRef(1, (uint16_t)(0x8000 + (i % 10))));
+
+		eventTrace.StartFrame();
+		eventTrace.AddEvent(1, FAddressRef(1, 0x8000), (uint16_t)frameNo, 0, 0);
+
+		const uint32_t machineState = 0x1000 + frameNo;
+		EXPECT_TRUE(writer.AddFrame(frameNo, trace, eventTrace, eventTrace.GetFrameRange(), &machineState, sizeof(machineState), pBanks));
+	}
+	EXPECT_FALSE(writer.AddFrame(kNoFrames - 1, FInstructionTrace(), eventTrace, eventTrace.GetFrameRange(), nullptr, 0, pBanks));	// frame numbers have to go up
+	writer.Close();
+	EXPECT_EQ(writer.GetNoFramesWritten(), kNoFrames);
+	EXPECT_EQ(writer.GetNoFramesDropped(), 0);
+
+	FSessionTraceReader reader;
+	ASSERT_TRUE(reader.Open(pFileName));
+	EXPECT_EQ(reader.GetNoChunks(), 3);
+	EXPECT_EQ(reader.GetFirstFrameNo(), 0);
+	EXPECT_EQ(reader.GetLastFrameNo(), kNoFrames - 1);
+
+	// frames in the middle of a chunk are rebuilt from its keyframe
+	FSessionTraceFrame frame;
+	for (int frameNo : { 77, 0, 49, 50, kNoFrames - 1 })
+	{
+		ASSERT_TRUE(reader.ReadFrame(frameNo, frame));
+		EXPECT_EQ(frame.FrameNo, frameNo);
+		EXPECT_EQ(frame.InstructionTrace.GetNoEntries(), 100 + frameNo);
+		EXPECT_EQ(frame.InstructionTrace.GetEntry(13), FAddressRef(1, 0x8003));
+		ASSERT_EQ(frame.Events.size(), 1u);
+		EXPECT_EQ(frame.Events[0].Address, frameNo);
+		uint32_t machineState = 0;
+		ASSERT_EQ(frame.MachineState.size(), sizeof(machineState));
+		memcpy(&machineState, frame.MachineState.data(), sizeof(machineState));
+		EXPECT_EQ(machineState, 0x1000 + frameNo);
+
+		// the last write made each bank
+		for (int bankNo = 0; bankNo < kNoBanks; bankNo++)
+		{
+			const int lastWriteFrame = (frameNo & 1) == bankNo ? frameNo : frameNo - 1;
+			if (lastWriteFrame >= 0)
+			{
+				EXPECT_EQ(frame.Memory[bankNo * kBankSize + (lastWriteFrame * 37) % kBankSize], (uint8_t)lastWriteFrame);
+			}
+		}
+	}
+	EXPECT_FALSE(reader.ReadFrame(kNoFrames, frame));
+	reader.Close();
+
+	// without the index at the end the chunks are found by scanning
+	FILE* fp = fopen(pFileName, "r+b");
+	ASSERT_NE(fp, nullptr);
+	fseek(fp, -4, SEEK_END);
+	const uint32_t badMagic = 0;
+	fwrite(&badMagic, sizeof(badMagic), 1, fp);
+	fclose(fp);
+	ASSERT_TRUE(reader.Open(pFileName));
+	EXPECT_EQ(reader.GetNoChunks(), 3);
+	EXPECT_TRUE(reader.ReadFrame(100, frame));
+	reader.Close();
+
+	remove(pFileName);
+}
+
+TEST(CodeAnalyserTest, MemoryHistory)
+{
+	const int kBankSize = 4 * FMemoryHistory::kPageSize;
+	const int kNoBanks = 2;
+	const int kMaxFrames = 20;
+	const int kKeyFrameInterval = 5;
+	const int kNoFrames = 40;
+
+	uint8_t memory[kNoBanks][kBankSize] = {};
+	uint8_t* pBanks[kNoBanks] = { memory[0], memory[1] };
+	std::vector<std::vector<uint8_t>> frameMemory;
+
+	FMemoryHistory history;
+	history.Init(kBankSize, kMaxFrames, kKeyFrameInterval);
+	for (int frameNo = 0; frameNo < kNoFrames; frameNo++)
+	{
+		// scattered bytes with gaps either side of the run split size, a whole page now & then and some frames with no changes
+		if (frameNo % 7 != 3)
+		{
+			for (int i = 0; i < 12; i++)
+				memory[i & 1][(frameNo * 131 + i * (1 + (i % 6))) % kBankSize] += (uint8_t)(frameNo + i + 1);
+		}
+		if (frameNo % 9 == 4)
+			memset(&memory[1][FMemoryHistory::kPageSize * 2], frameNo, FMemoryHistory::kPageSize);
+
+		EXPECT_EQ(history.CaptureFrame(pBanks, kNoBanks), frameNo);
+		frameMemory.emplace_back(&memory[0][0], &memory[0][0] + sizeof(memory));
+	}
+
+	// old frames go a keyframe at a time
+	const int noFrames = history.GetNoFrames();
+	const int firstFrame = kNoFrames - noFrames;
+	EXPECT_GE(noFrames, kMaxFrames);
+	EXPECT_LE(noFrames, kMaxFrames + kKeyFrameInterval);
+	EXPECT_GT(history.GetNoKeyFrames(), 1);
+	EXPECT_FALSE(history.IsFrameAvailable(firstFrame - 1));
+	EXPECT_TRUE(history.IsFrameAvailable(firstFrame));
+	EXPECT_TRUE(history.IsFrameAvailable(kNoFrames - 1));
+	EXPECT_FALSE(history.IsFrameAvailable(kNoFrames));
+
+	uint8_t restored[kNoBanks][kBankSize];
+	uint8_t* pRestoredBanks[kNoBanks] = { restored[0], restored[1] };
+	for (int frameNo = firstFrame; frameNo < kNoFrames; frameNo++)
+	{
+		memset(restored, 0xff, sizeof(restored));
+		ASSERT_TRUE(history.RestoreFrame(frameNo, pRestoredBanks, kNoBanks));
+		EXPECT_EQ(memcmp(restored, frameMemory[frameNo].data(), sizeof(restored)), 0) << "frame " << frameNo;
+	}
+	EXPECT_FALSE(history.RestoreFrame(firstFrame - 1, pRestoredBanks, kNoBanks));
+	EXPECT_FALSE(history.RestoreFrame(kNoFrames - 1, pRestoredBanks, 1));
+
+	// going backwards rebuilds from the keyframe, forwards carries on from the last rebuilt frame
+	for (int frameNo : { kNoFrames - 1, kNoFrames - 3, kNoFrames - 2, firstFrame, kNoFrames - 1 })
+	{
+		ASSERT_TRUE(history.RestoreFrame(frameNo, pRestoredBanks, kNoBanks));
+		EXPECT_EQ(memcmp(restored, frameMemory[frameNo].data(), sizeof(restored)), 0) << "frame " << frameNo;
+	}
+
+	// a different number of banks starts a new keyframe
+	const int noKeyFrames = history.GetNoKeyFrames();
+	memory[0][0]++;
+	const int oneBankFrame = history.CaptureFrame(pBanks, 1);
+	EXPECT_EQ(history.GetNoKeyFrames(), noKeyFrames + 1);
+	ASSERT_TRUE(history.RestoreFrame(oneBankFrame, pRestoredBanks, 1));
+	EXPECT_EQ(memcmp(restored[0], memory[0], kBankSize), 0);
+
+	// machine state is kept with each frame & carrying on from a restored frame drops the ones after it
+	const int stateFrame = history.CaptureFrame(pBanks, 1, &oneBankFrame, sizeof(oneBankFrame));
+	memory[0][1]++;
+	history.CaptureFrame(pBanks, 1);
+	int state = 0;
+	EXPECT_TRUE(history.GetMachineState(stateFrame, &state, sizeof(state)));
+	EXPECT_EQ(state, oneBankFrame);
+	EXPECT_FALSE(history.GetMachineState(oneBankFrame, &state, sizeof(state)));
+	history.DiscardFramesAfter(stateFrame);
+	EXPECT_EQ(history.GetLastFrameNo(), stateFrame);
+	memory[0][2]++;
+	EXPECT_EQ(history.CaptureFrame(pBanks, 1), stateFrame + 1);
+	ASSERT_TRUE(history.RestoreFrame(stateFrame + 1, pRestoredBanks, 1));
+	EXPECT_EQ(memcmp(restored[0], memory[0], kBankSize), 0);
+
+	history.Reset();
+	EXPECT_EQ(history.GetNoFrames(), 0);
+	EXPECT_FALSE(history.IsFrameAvailable(oneBankFrame));
+}
+
+TEST(CodeAnalyserTest, PaletteConvert)
+{
+	uint32_t palette[16];
+	for (int i = 0; i < 16; i++)
+		palette[i] = 0xff000000 | (i * 0x10203);
+
+	// odd size so the scalar tail gets used too
+	const int kNoPixels = 16 * 5 + 7;
+	uint8_t pixels[kNoPixels];
+	for (int i = 0; i < kNoPixels; i++)
+		pixels[i] = (uint8_t)((i * 7) & 15);
+
+	uint32_t expected[kNoPixels];
+	uint32_t converted[kNoPixels];
+	ConvertPalettedToRGBA_Scalar(pixels, expected, kNoPixels, palette);
+	ConvertPalettedToRGBA(pixels, converted, kNoPixels, palette, 16);
+	for (int i = 0; i < kNoPixels; i++)
+		EXPECT_EQ(converted[i], expected[i]);
+}
+
 bool RunCodeAnalyserTests(void)
 {
 	return true;
@@ -44,24 +44,83 @@ bool FCodeAnalysisViewState::GoToPreviousAddress()
 	return true;
 }
 
-int GetItemIndexForAddress(const FCodeAnalysisState &state, FAddressRef addr)
+static bool AddressCoordLess(const FAddressCoord& coord, FAddressRef addr)
 {
-	const FCodeAnalysisBank* pBank = state.GetBank(addr.BankId);
+	return coord.Address.Address < addr.Address || (coord.Address.Address == addr.Address && coord.Address.BankId < addr.BankId);
+}
 
-	int index = -1;
+bool FCodeAnalysisViewState::GetYPosForAddress(FAddressRef addr, float& ypos) const
+{
+	auto it = std::lower_bound(AddressCoords.begin(), AddressCoords.end(), addr, AddressCoordLess);
+	if (it == AddressCoords.end() || it->Address != addr)
+		return false;
 
-	assert(pBank != nullptr);
-	
-	for (int i = 0; i < (int)pBank->ItemList.size(); i++)
+	ypos = it->YPos;
+	return true;
+}
+
+// range of the bank's item list that items for an address can be in
+// items are in address order so the page start table narrows it down to a page
+static void GetBankItemRangeForAddress(const FCodeAnalysisBank& bank, uint16_t address, int& start, int& end)
+{
+	start = 0;
+	end = (int)bank.ItemList.size();
+	if ((int)bank.PageItemStart.size() == bank.NoPages + 1 && bank.AddressValid(address))
 	{
-		if (pBank->ItemList[i].IsValid() && pBank->ItemList[i].AddressRef.Address > addr.Address)
-			return index;
-		index = i;
+		const int pageNo = (address - bank.GetMappedAddress()) >> FCodeAnalysisPage::kPageShift;
+		start = bank.PageItemStart[pageNo];
+		end = bank.PageItemStart[pageNo + 1];
 	}
-	return -1;
 }
 
+static bool ItemAddressLess(const FCodeAnalysisItem& item, uint16_t address) { return item.AddressRef.Address < address; }
+static bool AddressItemLess(uint16_t address, const FCodeAnalysisItem& item) { return address < item.AddressRef.Address; }
+
+// index of the last item at or before the address
+int GetItemIndexForAddress(const FCodeAnalysisState &state, FAddressRef addr)
+{
+	const FCodeAnalysisBank* pBank = state.GetBank(addr.BankId);
+	assert(pBank != nullptr);
+
+	if (pBank->PrimaryMappedPage != -1 && pBank->AddressValid(addr.Address) == false)
+		return -1;
+
+	int start, end;
+	GetBankItemRangeForAddress(*pBank, addr.Address, start, end);
+	const auto it = std::upper_bound(pBank->ItemList.begin() + start, pBank->ItemList.begin() + end, addr.Address, AddressItemLess);
+	return (int)(it - pBank->ItemList.begin()) - 1;
+}
+
+// index of the first item at or after the address in a list being viewed, -1 if there isn't one
+int GetFirstItemIndexAtAddress(const FCodeAnalysisState& state, const std::vector<FCodeAnalysisItem>& itemList, FAddressRef addr)
+{
+	const FCodeAnalysisBank* pBank = state.GetBank(addr.BankId);
+	int offset = 0;
+	int start = 0;
+	int end = (int)itemList.size();
 
+	if (pBank != nullptr && &itemList == &pBank->ItemList)
+	{
+		GetBankItemRangeForAddress(*pBank, addr.Address, start, end);
+	}
+	else if (pBank != nullptr && &itemList == &state.ItemList)
+	{
+		for (const FItemListSegment& segment : state.ItemListSegments)
+		{
+			if (segment.BankId == addr.BankId && segment.Count == (int)pBank->ItemList.size())
+			{
+				GetBankItemRangeForAddress(*pBank, addr.Address, start, end);
+				offset = segment.Start;
+				break;
+			}
+		}
+	}
+
+	auto it = std::lower_bound(itemList.begin() + offset + start, itemList.begin() + offset + end, addr.Address, ItemAddressLess);
+	if (it == itemList.end())
+		return -1;
+	return (int)(it - itemList.begin());
+}
 
 std::vector<FMemoryRegionDescGenerator*>	g_RegionDescHandlers;
 
@@ -84,6 +143,11 @@ bool AddMemoryRegionDescGenerator(FMemoryRegionDescGenerator* pGen)
 	return true;
 }
 
+void RemoveMemoryRegionDescGenerator(FMemoryRegionDescGenerator* pGen)
+{
+	g_RegionDescHandlers.erase(std::remove(g_RegionDescHandlers.begin(), g_RegionDescHandlers.end(), pGen), g_RegionDescHandlers.end());
+}
+
 void DrawSnippetToolTip(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState, const FAddressRef addr)
 {
 	// Bring up snippet in tool tip
@@ -116,34 +180,20 @@ void DrawAddressLabel(FCodeAnalysisState &state, FCodeAnalysisViewState& viewSta
 {
 	int labelOffset = 0;
 	const char *pLabelString = GetRegionDesc(addr.Address);
-	FCodeAnalysisBank* pBank = state.GetBank(addr.BankId);
-	assert(pBank != nullptr);
+	assert(state.GetBank(addr.BankId) != nullptr);
 
 	if (pLabelString == nullptr)	// get a label
 	{
-		// find a label for this address
-		for (int addrVal = addr.Address; addrVal >= 0; addrVal--)
+		FLabelSearchResult label;
+		if (FindLabelBeforeAddress(state, addr, bFunctionRel ? ELabelRangeType::Function : ELabelRangeType::Any, label))
 		{
-			if (pBank->AddressValid(addrVal) == false)
-			{
-				pBank = state.GetBank(state.GetBankFromAddress(addrVal));
-				assert(pBank != nullptr);
-			}
-
-			const FLabelInfo* pLabel = state.GetLabelForAddress(FAddressRef(pBank->Id,addrVal));
-			if (pLabel != nullptr)
-			{
-				if (bFunctionRel == false || pLabel->LabelType == ELabelType::Function)
-				{
-					pLabelString = pLabel->Name.c_str();
-					break;
-				}
-			}
-
-			labelOffset++;
-
-			if (pLabelString == nullptr && addrVal == 0)
-				pLabelString = "0000";
+			pLabelString = label.pLabel->Name.c_str();
+			labelOffset = label.Offset;
+		}
+		else
+		{
+			pLabelString = "0000";
+			labelOffset = addr.Address;
 		}
 	}
 	
@@ -272,6 +322,7 @@ void DrawLabelDetails(FCodeAnalysisState &state, FCodeAnalysisViewState& viewSta
 			pLabelInfo->LabelType = ELabelType::Function;
 		if (pLabelInfo->LabelType == ELabelType::Function && pLabelInfo->Global == false)
 			pLabelInfo->LabelType = ELabelType::Code;
+		state.SetLabelChanged(item.AddressRef);
 		GenerateGlobalInfo(state);
 	}
 
@@ -305,9 +356,12 @@ void DrawCommentBlockDetails(FCodeAnalysisState& state, const FCodeAnalysisItem&
 
 	if (ImGui::InputTextMultiline("Comment Text", &pCommentBlock->Comment))
 	{
+		state.SetCodeAnalysisDirty(item.AddressRef);
 		if (pCommentBlock->Comment.empty() == true)
+		{
 			state.SetCommentBlockForAddress(item.AddressRef, nullptr);
-		state.SetCodeAnalysisDirty(item.AddressRef);
+			FCommentBlock::Free(state, pCommentBlock);
+		}
 	}
 
 }
@@ -449,6 +503,7 @@ void UpdatePopups(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState)
 		ImGui::SetKeyboardFocusHere();
 		if (ImGui::InputText("##comment", &cursorItem.Item->Comment, ImGuiInputTextFlags_EnterReturnsTrue))
 		{
+			state.SetCodeAnalysisDirty(cursorItem.AddressRef);
 			ImGui::CloseCurrentPopup();
 		}
 		ImGui::SetItemDefaultFocus();
@@ -507,7 +562,7 @@ void ExpandCommentBlock(FCodeAnalysisState& state, FItemListBuilder& builder, FC
 		if (line.empty() || line[0] == '@')	// skip lines starting with @ - we might want to create items from them in future
 			continue;
 
-		FCommentLine* pLine = FCommentLine::Allocate();
+		FCommentLine* pLine = FCommentLine::Allocate(state);
 		pLine->Comment = line;
 		//pLine->Address = addr;
 		builder.ItemList.emplace_back(pLine, builder.BankId, builder.CurrAddr);
@@ -523,22 +578,33 @@ void ExpandCommentBlock(FCodeAnalysisState& state, FItemListBuilder& builder, FC
 	}
 }
 
-void UpdateItemListForBank(FCodeAnalysisState& state, FCodeAnalysisBank& bank)
+// recycle comment lines from a range of an item list
+static void FreeCommentLines(FCodeAnalysisState& state, const FCodeAnalysisItem* pItems, int noItems)
 {
-	bank.ItemList.clear();
-	FItemListBuilder listBuilder(bank.ItemList);
-	listBuilder.BankId = bank.Id;
+	for (int i = 0; i < noItems; i++)
+	{
+		const FCodeAnalysisItem& item = pItems[i];
+		if (item.Item != nullptr && item.Item->Type == EItemType::CommentLine)
+			FCommentLine::Free(state, static_cast<FCommentLine*>(item.Item));
+	}
+}
 
-	const int16_t page = bank.PrimaryMappedPage;
-	const uint16_t bankPhysAddr = page * FCodeAnalysisPage::kPageSize;
-	int nextItemAddress = 0;
+// build items for bank pages [startPage, endPage) onto the end of the builder's list
+// nextItemAddress is the bank address the next code/data item can start at, the updated value is returned
+// the list index each page starts at is written to pPageStarts
+static int BuildItemsForBankPages(FCodeAnalysisState& state, const FCodeAnalysisBank& bank, FItemListBuilder& listBuilder, int startPage, int endPage, int nextItemAddress, int* pPageStarts)
+{
+	const uint16_t bankPhysAddr = bank.PrimaryMappedPage * FCodeAnalysisPage::kPageSize;
 
-	for (int bankAddr = 0; bankAddr < bank.NoPages * FCodeAnalysisPage::kPageSize; bankAddr++)
+	for (int bankAddr = startPage * FCodeAnalysisPage::kPageSize; bankAddr < endPage * FCodeAnalysisPage::kPageSize; bankAddr++)
 	{
 		FCodeAnalysisPage& page = bank.Pages[bankAddr >> FCodeAnalysisPage::kPageShift];
 		const uint16_t pageAddr = bankAddr & FCodeAnalysisPage::kPageMask;
 		listBuilder.CurrAddr = bankPhysAddr + bankAddr;
 
+		if (pageAddr == 0)
+			pPageStarts[(bankAddr >> FCodeAnalysisPage::kPageShift) - startPage] = (int)listBuilder.ItemList.size();
+
 		FCommentBlock* pCommentBlock = page.CommentBlocks[pageAddr];
 		if (pCommentBlock != nullptr)
 			ExpandCommentBlock(state, listBuilder, pCommentBlock);
@@ -573,6 +639,183 @@ void UpdateItemListForBank(FCodeAnalysisState& state, FCodeAnalysisBank& bank)
 			}
 		}
 	}
+
+	return nextItemAddress;
+}
+
+// bank address after the item - matches how BuildItemsForBankPages steps over code & data
+static int GetItemEndBankAddress(const FCodeAnalysisBank& bank, const FCodeAnalysisItem& item)
+{
+	const int bankAddr = item.AddressRef.Address - bank.GetMappedAddress();
+	if (item.Item->Type == EItemType::Code)
+		return bankAddr + item.Item->ByteSize;
+
+	const FDataInfo* pDataInfo = static_cast<const FDataInfo*>(item.Item);
+	if (pDataInfo->DataType != EDataType::Blob && pDataInfo->DataType != EDataType::ScreenPixels)
+		return bankAddr + pDataInfo->ByteSize;
+	return bankAddr + 1;
+}
+
+// first code or data item in [startIndex, endIndex), -1 if none
+static int FindCodeOrDataItem(const std::vector<FCodeAnalysisItem>& itemList, int startIndex, int endIndex)
+{
+	for (int i = startIndex; i < endIndex; i++)
+	{
+		const EItemType type = itemList[i].Item->Type;
+		if (type == EItemType::Code || type == EItemType::Data)
+			return i;
+	}
+	return -1;
+}
+
+void UpdateItemListForBank(FCodeAnalysisState& state, FCodeAnalysisBank& bank)
+{
+	// recycle comment lines from the old list - other banks may not be rebuilt so their lines have to stay
+	FreeCommentLines(state, bank.ItemList.data(), (int)bank.ItemList.size());
+	bank.ItemList.clear();
+	FItemListBuilder listBuilder(bank.ItemList);
+	listBuilder.BankId = bank.Id;
+
+	bank.PageItemStart.resize(bank.NoPages + 1);
+	BuildItemsForBankPages(state, bank, listBuilder, 0, bank.NoPages, 0, bank.PageItemStart.data());
+	bank.PageItemStart[bank.NoPages] = (int)bank.ItemList.size();
+	std::fill(bank.DirtyPages.begin(), bank.DirtyPages.end(), 0);
+}
+
+// replacement of a range of a bank's items
+struct FItemListEdit
+{
+	int16_t	BankId = -1;
+	int		Start = 0;		// index in bank list
+	int		OldCount = 0;
+	int		NewCount = 0;
+};
+
+// rebuild runs of dirty pages and splice them into the bank's item list
+static void UpdateDirtyPagesForBank(FCodeAnalysisState& state, FCodeAnalysisBank& bank, std::vector<FItemListEdit>& edits)
+{
+	std::vector<FCodeAnalysisItem> newItems;
+	std::vector<int> newPageStarts(bank.NoPages);
+	FItemListBuilder listBuilder(newItems);
+	listBuilder.BankId = bank.Id;
+
+	int pageNo = 0;
+	while (pageNo < bank.NoPages)
+	{
+		if (bank.DirtyPages[pageNo] == 0)
+		{
+			pageNo++;
+			continue;
+		}
+
+		const int startPage = pageNo;
+
+		// items from the previous page can run into this one
+		int nextItemAddress = startPage * FCodeAnalysisPage::kPageSize;
+		if (startPage > 0)
+		{
+			for (int i = bank.PageItemStart[startPage] - 1; i >= 0; i--)
+			{
+				const EItemType type = bank.ItemList[i].Item->Type;
+				if (type == EItemType::Code || type == EItemType::Data)
+				{
+					nextItemAddress = GetItemEndBankAddress(bank, bank.ItemList[i]);
+					break;
+				}
+			}
+		}
+
+		newItems.clear();
+		while (pageNo < bank.NoPages)
+		{
+			nextItemAddress = BuildItemsForBankPages(state, bank, listBuilder, pageNo, pageNo + 1, nextItemAddress, &newPageStarts[pageNo - startPage]);
+			bank.DirtyPages[pageNo] = 0;
+			pageNo++;
+
+			if (pageNo == bank.NoPages)
+				break;
+			if (bank.DirtyPages[pageNo])
+				continue;
+
+			// a clean page has to be rebuilt as well if an item overlaps its start, either before or after this rebuild
+			const int pageStartAddr = pageNo * FCodeAnalysisPage::kPageSize;
+			const int oldItem = FindCodeOrDataItem(bank.ItemList, bank.PageItemStart[pageNo], bank.PageItemStart[pageNo + 1]);
+			const bool bOldOverlap = oldItem == -1 || bank.ItemList[oldItem].AddressRef.Address - bank.GetMappedAddress() != pageStartAddr;
+			if (nextItemAddress <= pageStartAddr && bOldOverlap == false)
+				break;
+		}
+
+		// splice new items in
+		const int oldStart = bank.PageItemStart[startPage];
+		const int oldCount = bank.PageItemStart[pageNo] - oldStart;
+		const int newCount = (int)newItems.size();
+		FreeCommentLines(state, bank.ItemList.data() + oldStart, oldCount);
+
+		if (newCount < oldCount)
+			bank.ItemList.erase(bank.ItemList.begin() + oldStart + newCount, bank.ItemList.begin() + oldStart + oldCount);
+		else if (newCount > oldCount)
+			bank.ItemList.insert(bank.ItemList.begin() + oldStart + oldCount, newItems.begin() + oldCount, newItems.end());
+		std::copy(newItems.begin(), newItems.begin() + std::min(oldCount, newCount), bank.ItemList.begin() + oldStart);
+
+		for (int i = startPage; i < pageNo; i++)
+			bank.PageItemStart[i] = oldStart + newPageStarts[i - startPage];
+		for (int i = pageNo; i <= bank.NoPages; i++)
+			bank.PageItemStart[i] += newCount - oldCount;
+
+		edits.push_back({ bank.Id, oldStart, oldCount, newCount });
+	}
+}
+
+// rebuild the global item list from the bank lists
+static void RebuildGlobalItemList(FCodeAnalysisState& state)
+{
+	state.ItemList.clear();
+	state.ItemListSegments.clear();
+
+	int pageNo = 0;
+	while (pageNo < FCodeAnalysisState::kNoPagesInAddressSpace)
+	{
+		int16_t bankId = state.GetBankFromAddress(pageNo * FCodeAnalysisPage::kPageSize);
+		FCodeAnalysisBank* pBank = state.GetBank(bankId);
+		if (pBank != nullptr)
+		{
+			state.ItemListSegments.push_back({ bankId, (int)state.ItemList.size(), (int)pBank->ItemList.size() });
+			state.ItemList.insert(state.ItemList.end(), pBank->ItemList.begin(), pBank->ItemList.end());
+			pageNo += pBank->NoPages;
+		}
+		else
+		{
+			pageNo++;
+		}
+	}
+}
+
+// apply bank edits to the global item list - edits must be in the order they were made
+static void ApplyGlobalItemListEdits(FCodeAnalysisState& state, const std::vector<FItemListEdit>& edits)
+{
+	for (const FItemListEdit& edit : edits)
+	{
+		const FCodeAnalysisBank* pBank = state.GetBank(edit.BankId);
+		const int delta = edit.NewCount - edit.OldCount;
+
+		for (int segNo = 0; segNo < (int)state.ItemListSegments.size(); segNo++)
+		{
+			FItemListSegment& segment = state.ItemListSegments[segNo];
+			if (segment.BankId != edit.BankId)
+				continue;
+
+			const int start = segment.Start + edit.Start;
+			if (delta < 0)
+				state.ItemList.erase(state.ItemList.begin() + start + edit.NewCount, state.ItemList.begin() + start + edit.OldCount);
+			else if (delta > 0)
+				state.ItemList.insert(state.ItemList.begin() + start + edit.OldCount, pBank->ItemList.begin() + edit.Start + edit.OldCount, pBank->ItemList.begin() + edit.Start + edit.NewCount);
+			std::copy(pBank->ItemList.begin() + edit.Start, pBank->ItemList.begin() + edit.Start + std::min(edit.OldCount, edit.NewCount), state.ItemList.begin() + start);
+
+			segment.Count += delta;
+			for (int i = segNo + 1; i < (int)state.ItemListSegments.size(); i++)
+				state.ItemListSegments[i].Start += delta;
+		}
+	}
 }
 
 void UpdateItemList(FCodeAnalysisState &state)
@@ -580,45 +823,34 @@ void UpdateItemList(FCodeAnalysisState &state)
 	// build item list - not every frame please!
 	if (state.IsCodeAnalysisDataDirty() )
 	{
-		const float line_height = ImGui::GetTextLineHeight();
-		
-		state.ItemList.clear();
-		FCommentLine::FreeAll();	// recycle comment lines
-
-		//int nextItemAddress = 0;
+		// whole banks are only rebuilt when they're newly mapped or everything has changed
+		// otherwise just the dirty pages get rebuilt and patched into the lists
+		bool bFullRebuild = state.HasMemoryBeenRemapped() || state.ItemListSegments.empty();
+		std::vector<FItemListEdit> edits;
 
 		auto& banks = state.GetBanks();
 		for (auto& bank : banks)
 		{
-			if (bank.bIsDirty || bank.ItemList.empty())
+			if (bank.bIsDirty || bank.PageItemStart.empty())
 			{
 				UpdateItemListForBank(state, bank);
 				bank.bIsDirty = false;
+				bFullRebuild = true;
 			}
-		}
-		int pageNo = 0;
-
-		while (pageNo < FCodeAnalysisState::kNoPagesInAddressSpace)
-		{
-			int16_t bankId = state.GetBankFromAddress(pageNo * FCodeAnalysisPage::kPageSize);
-			FCodeAnalysisBank* pBank = state.GetBank(bankId);
-			if (pBank != nullptr)
+			else if (bank.HasDirtyPages())
 			{
-				state.ItemList.insert(state.ItemList.end(), pBank->ItemList.begin(), pBank->ItemList.end());
-				/*const uint16_t bankAddrStart = pageNo * FCodeAnalysisPage::kPageSize;
-				for (const auto& bankItem : pBank->ItemList)
-				{
-					FCodeAnalysisItem& item = state.ItemList.emplace_back(bankItem);
-					item.AddressRef.Address += bankAddrStart;
-				}*/
-				pageNo += pBank->NoPages;
-			}
-			else
-			{
-				pageNo++;
+				UpdateDirtyPagesForBank(state, bank, edits);
 			}
 		}
 
+		if (bFullRebuild)
+			RebuildGlobalItemList(state);
+		else
+			ApplyGlobalItemListEdits(state, edits);
+
+		// nothing in the lists points at removed items now
+		ReleasePendingItemFrees(state);
+
 		// Maybe this needs to follow the same algorithm as the main view?
 		//ImGui::SetScrollY(state.GetFocussedViewState().CursorItemIndex * line_height);
 		state.ClearDirtyStatus();
@@ -666,6 +898,8 @@ void DoItemContextMenu(FCodeAnalysisState& state, const FCodeAnalysisItem &item)
 #endif
 			if (ImGui::Selectable("Toggle Data Breakpoint"))
 				state.ToggleDataBreakpointAtAddress(item.AddressRef, item.Item->ByteSize);
+			if (ImGui::Selectable("Toggle Data Read Breakpoint"))
+				state.ToggleDataReadBreakpointAtAddress(item.AddressRef, item.Item->ByteSize);
 			if (ImGui::Selectable("Add Watch"))
 				state.Debugger.AddWatch(item.AddressRef);
 
@@ -947,7 +1181,8 @@ void DrawItemList(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState,
 		const float currScrollY = ImGui::GetScrollY();
 		const float currWindowHeight = ImGui::GetWindowHeight();
 		const int kJumpViewOffset = 5;
-		for (int item = 0; item < (int)itemList.size(); item++)
+		const int firstItem = GetFirstItemIndexAtAddress(state, itemList, gotoAddress);
+		for (int item = std::max(firstItem, 0); firstItem != -1 && item < (int)itemList.size(); item++)
 		{
 			if ((itemList[item].AddressRef.Address >= gotoAddress.Address) && (viewState.GoToLabel || itemList[item].Item->Type != EItemType::Label))
 			{
@@ -996,6 +1231,7 @@ void DrawItemList(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState,
 		}
 
 	}
+	std::sort(newList.begin(), newList.end(), [](const FAddressCoord& a, const FAddressCoord& b) { return AddressCoordLess(a, b.Address); });
 	viewState.AddressCoords = newList;
 }
 
@@ -1046,7 +1282,7 @@ void DrawCodeAnalysisData(FCodeAnalysisState &state, int windowId)
 	// Reset Reference Info
 	if (ImGui::Button("Reset Reference Info"))
 	{
-		ResetReferenceInfo(state);
+		state.AnalysisJobs.AddJob(std::make_unique<FResetReferenceInfoJob>());
 	}
 	if (ImGui::IsItemHovered())
 	{
@@ -1054,6 +1290,19 @@ void DrawCodeAnalysisData(FCodeAnalysisState &state, int windowId)
 		ImGui::Text("This will reset all recorded references");
 		ImGui::EndTooltip();
 	}
+
+	// analysis passes that are still running
+	const FAnalysisJob* pAnalysisJob = state.AnalysisJobs.GetCurrentJob();
+	if (pAnalysisJob != nullptr)
+	{
+		ImGui::SameLine();
+		ImGui::ProgressBar(pAnalysisJob->GetProgress(), ImVec2(glyph_width * 30.0f, 0), pAnalysisJob->GetName());
+		if (state.AnalysisJobs.GetNoJobs() > 1)
+		{
+			ImGui::SameLine();
+			ImGui::Text("+%d queued", state.AnalysisJobs.GetNoJobs() - 1);
+		}
+	}
 	
 	if(ImGui::BeginChild("##analysis", ImVec2(ImGui::GetWindowContentRegionWidth() * 0.75f, 0), true))
 	{
@@ -1130,6 +1379,7 @@ void DrawCodeAnalysisData(FCodeAnalysisState &state, int windowId)
 							// map bank in
 							viewState.ViewingBankId = bank.Id;
 
+							state.LoadBankAnalysis(bank);
 							state.MapBankForAnalysis(bank);
 
 							// Bank header
@@ -1586,6 +1836,47 @@ bool DrawBankInput(FCodeAnalysisState& state, const char* label, int16_t& bankId
 
 // Config Window - Debug?
 
+template <class T, int kItemsPerSlab>
+void DrawItemPoolStatsRow(const char* pName, const FItemPool<T, kItemsPerSlab>& pool)
+{
+	ImGui::TableNextRow();
+	ImGui::TableSetColumnIndex(0);
+	ImGui::Text("%s", pName);
+	ImGui::TableSetColumnIndex(1);
+	ImGui::Text("%d", pool.GetNoLive());
+	ImGui::TableSetColumnIndex(2);
+	ImGui::Text("%d", pool.GetNoFree());
+	ImGui::TableSetColumnIndex(3);
+	ImGui::Text("%d", pool.GetTotalAllocations());
+	ImGui::TableSetColumnIndex(4);
+	ImGui::Text("%d", pool.GetNoSlabs());
+	ImGui::TableSetColumnIndex(5);
+	ImGui::Text("%dK", (int)(pool.GetMemoryUsage() / 1024));
+}
+
+void DrawItemPoolStats(FCodeAnalysisState& state)
+{
+	ImGui::Separator();
+	ImGui::Text("Item Pools");
+	if (ImGui::BeginTable("ItemPools", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Pool");
+		ImGui::TableSetupColumn("Live");
+		ImGui::TableSetupColumn("Free");
+		ImGui::TableSetupColumn("Allocs");
+		ImGui::TableSetupColumn("Slabs");
+		ImGui::TableSetupColumn("Memory");
+		ImGui::TableHeadersRow();
+
+		DrawItemPoolStatsRow("Code", state.ItemPools.CodeInfo);
+		DrawItemPoolStatsRow("Labels", state.ItemPools.Labels);
+		DrawItemPoolStatsRow("Comment Blocks", state.ItemPools.CommentBlocks);
+		DrawItemPoolStatsRow("Comment Lines", state.ItemPools.CommentLines);
+
+		ImGui::EndTable();
+	}
+}
+
 void DrawCodeAnalysisConfigWindow(FCodeAnalysisState& state)
 {
 	FCodeAnalysisConfig& config = state.Config;
@@ -1598,4 +1889,6 @@ void DrawCodeAnalysisConfigWindow(FCodeAnalysisState& state)
 	ImGui::SliderFloat("Branch Line Start", &config.BranchLineIndentStart, 0, 200.0f);
 	ImGui::SliderFloat("Branch Line Spacing", &config.BranchSpacing, 0, 20.0f);
 	ImGui::SliderInt("Branch Line No Indents", &config.BranchMaxIndent,1,10);
+
+	DrawItemPoolStats(state);
 }
\ No newline at end of file
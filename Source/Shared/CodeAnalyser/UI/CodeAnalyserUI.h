@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include <vector>
 
 #include "../CodeAnalyserTypes.h"
 
@@ -32,6 +33,7 @@ protected:
 // UI
 
 bool AddMemoryRegionDescGenerator(FMemoryRegionDescGenerator* pGen);
+void RemoveMemoryRegionDescGenerator(FMemoryRegionDescGenerator* pGen);
 
 void ShowCodeAccessorActivity(FCodeAnalysisState& state, const FAddressRef accessorCodeAddr);
 //void DrawCodeAddress(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState, uint16_t addr, bool bFunctionRel = false);
@@ -39,6 +41,8 @@ void DrawCodeAddress(FCodeAnalysisState& state, FCodeAnalysisViewState& viewStat
 void DrawAddressLabel(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState, uint16_t addr, bool bFunctionRel = false);
 void DrawAddressLabel(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState, FAddressRef addr, bool bFunctionRel = false);
 int GetItemIndexForAddress(const FCodeAnalysisState& state, FAddressRef addr);
+int GetFirstItemIndexAtAddress(const FCodeAnalysisState& state, const std::vector<FCodeAnalysisItem>& itemList, FAddressRef addr);
+void UpdateItemList(FCodeAnalysisState& state);
 void DrawCodeAnalysisItem(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState, const FCodeAnalysisItem& item);
 bool DrawNumberTypeCombo(const char* pLabel, ENumberDisplayMode& numberMode);
 bool DrawOperandTypeCombo(const char* pLabel, EOperandType& operandType);
@@ -209,7 +209,10 @@ void DrawCodeInfo(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState,
 			const ImVec2 mousePos = ImGui::GetMousePos();
 			const ImVec2 dist(mousePos.x - mid.x, mousePos.y - mid.y);
 			if ((dist.x * dist.x + dist.y * dist.y) < (8 * 8))
+			{
 				pBP->bEnabled = !pBP->bEnabled;
+				debugger.BreakpointsChanged();
+			}
 		}
 	}
 
@@ -258,8 +261,7 @@ void DrawCodeInfo(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState,
 
 			if (pCodeInfo->bSelfModifyingCode)
 			{
-				FDataInfo* pOperandData = state.GetWriteDataInfoForAddress(physAddress + i);
-				if (pOperandData->Writes.IsEmpty() == false)
+				if (state.GetWritesForAddress((uint16_t)(physAddress + i)).IsEmpty() == false)
 				{
 					// Change the colour if this is self modifying code and the byte has been modified.
 					bByteModified = true;
@@ -346,11 +348,11 @@ void DrawCodeDetails(FCodeAnalysisState& state, FCodeAnalysisViewState& viewStat
 
 		for (int i = 1; i < pCodeInfo->ByteSize; i++)
 		{
-			FDataInfo* pOperandData = state.GetWriteDataInfoForAddress(physAddress + i);
-			if (pOperandData->Writes.IsEmpty() == false)
+			const FItemReferenceTracker& operandWrites = state.GetWritesForAddress((uint16_t)(physAddress + i));
+			if (operandWrites.IsEmpty() == false)
 			{
 				ImGui::Text("Operand Writes:");
-				for (const auto& writer : pOperandData->Writes.GetReferences())
+				for (const auto& writer : operandWrites.GetReferences())
 				{
 					DrawCodeAddress(state, viewState, writer);
 				}
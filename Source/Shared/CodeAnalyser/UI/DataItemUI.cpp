@@ -19,7 +19,7 @@ float DrawDataCharMapLine(FCodeAnalysisState& state,uint16_t addr, const FDataIn
 	const float startPos = pos.x;
 	pos.y -= rectSize + 2;
 
-	const FCharacterSet* pCharSet = GetCharacterSetFromAddress(pDataInfo->CharSetAddress);
+	const FCharacterSet* pCharSet = GetCharacterSetFromAddress(state, pDataInfo->CharSetAddress);
 
 	for (int byte = 0; byte < pDataInfo->ByteSize; byte++)
 	{
@@ -254,10 +254,10 @@ void EditWordDataItem(FCodeAnalysisState& state, uint16_t address)
 
 void ShowDataItemActivity(FCodeAnalysisState& state, FAddressRef addr)
 {
-	const FDataInfo* pReadDataInfo = state.GetReadDataInfoForAddress(addr);
-	const FDataInfo* pWriteDataInfo = state.GetWriteDataInfoForAddress(addr);
-	const int framesSinceWritten = pWriteDataInfo->LastFrameWritten == -1 ? 255 : state.CurrentFrameNo - pWriteDataInfo->LastFrameWritten;
-	const int framesSinceRead = pReadDataInfo->LastFrameRead == -1 ? 255 : state.CurrentFrameNo - pReadDataInfo->LastFrameRead;
+	const int lastFrameWritten = state.GetLastFrameWrittenForAddress(addr);
+	const int lastFrameRead = state.GetLastFrameReadForAddress(addr);
+	const int framesSinceWritten = lastFrameWritten == -1 ? 255 : state.CurrentFrameNo - lastFrameWritten;
+	const int framesSinceRead = lastFrameRead == -1 ? 255 : state.CurrentFrameNo - lastFrameRead;
 	const int wBrightVal = (255 - std::min(framesSinceWritten << 2, 255)) & 0xff;
 	const int rBrightVal = (255 - std::min(framesSinceRead << 2, 255)) & 0xff;
 	float offset = 0;
@@ -539,10 +539,13 @@ void DrawDataValueGraphWord(FCodeAnalysisState& state, FAddressRef addressRef)
 }
 
 
-void DrawDataAccesses(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState, FDataInfo* pDataInfo)
+void DrawDataAccesses(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState, FAddressRef addressRef)
 {
+	const FItemReferenceTracker& reads = state.GetReadsForAddress(addressRef);
+	const FItemReferenceTracker& writes = state.GetWritesForAddress(addressRef);
+
 	// List Data accesses
-	if (pDataInfo->Reads.IsEmpty() == false)
+	if (reads.IsEmpty() == false)
 	{
 		static std::string commentTxt;
 		static bool bOverride = false;
@@ -560,13 +563,17 @@ void DrawDataAccesses(FCodeAnalysisState& state, FCodeAnalysisViewState& viewSta
 		}
 
 		ImGui::Text("Reads:");
-		for (const auto& reader : pDataInfo->Reads.GetReferences())
+		const auto& readers = reads.GetReferences();
+		for (int readerNo = 0; readerNo < (int)readers.size(); readerNo++)
 		{
+			const FAddressRef& reader = readers[readerNo];
 			ShowCodeAccessorActivity(state, reader);
 
 			ImGui::Text("   ");
 			ImGui::SameLine();
 			DrawCodeAddress(state, viewState, reader);
+			ImGui::SameLine();
+			ImGui::TextDisabled("x%u", reads.GetCount(readerNo));
 
 			if (bWriteComment)
 			{
@@ -574,13 +581,16 @@ void DrawDataAccesses(FCodeAnalysisState& state, FCodeAnalysisViewState& viewSta
 				if (pCodeInfo)
 				{
 					if (pCodeInfo->Comment.empty() || bOverride)
+					{
 						pCodeInfo->Comment = commentTxt;
+						state.SetCodeAnalysisDirty(reader);
+					}
 				}
 			}
 		}
 	}
 
-	if (pDataInfo->Writes.IsEmpty() == false)
+	if (writes.IsEmpty() == false)
 	{
 		static std::string commentTxt;
 		static bool bOverride = false;
@@ -598,13 +608,17 @@ void DrawDataAccesses(FCodeAnalysisState& state, FCodeAnalysisViewState& viewSta
 		}
 
 		ImGui::Text("Writes:");
-		for (const auto& writer : pDataInfo->Writes.GetReferences())
+		const auto& writers = writes.GetReferences();
+		for (int writerNo = 0; writerNo < (int)writers.size(); writerNo++)
 		{
+			const FAddressRef& writer = writers[writerNo];
 			ShowCodeAccessorActivity(state, writer);
 
 			ImGui::Text("   ");
 			ImGui::SameLine();
 			DrawCodeAddress(state, viewState, writer);
+			ImGui::SameLine();
+			ImGui::TextDisabled("x%u", writes.GetCount(writerNo));
 
 			if (bWriteComment)
 			{
@@ -612,14 +626,17 @@ void DrawDataAccesses(FCodeAnalysisState& state, FCodeAnalysisViewState& viewSta
 				if (pCodeInfo)
 				{
 					if (pCodeInfo->Comment.empty() || bOverride)
+					{
 						pCodeInfo->Comment = commentTxt;
+						state.SetCodeAnalysisDirty(writer);
+					}
 				}
 			}
 		}
 	}
 
 	// last writer to address
-	const FAddressRef lastWriter = pDataInfo->LastWriter;
+	const FAddressRef lastWriter = state.GetLastWriterForAddress(addressRef);
 	if (lastWriter.IsValid())
 	{
 		ImGui::Text("Last Writer: ");
@@ -688,7 +705,7 @@ void DrawDataDetails(FCodeAnalysisState& state, FCodeAnalysisViewState& viewStat
 			DrawAddressInput(state, "Attribs Address", params.AttribsAddress);
 		}
 
-		FCharacterSet *pCharSet = GetCharacterSetFromAddress(item.AddressRef);
+		FCharacterSet *pCharSet = GetCharacterSetFromAddress(state, item.AddressRef);
 		if (pCharSet != nullptr)
 		{
 			if (ImGui::Button("Update Character Set"))
@@ -783,6 +800,6 @@ void DrawDataDetails(FCodeAnalysisState& state, FCodeAnalysisViewState& viewStat
 		break;
 	}
 
-	DrawDataAccesses(state, viewState, pDataInfo);
+	DrawDataAccesses(state, viewState, item.AddressRef);
 }
 
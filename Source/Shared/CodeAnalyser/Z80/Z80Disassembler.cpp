@@ -486,7 +486,7 @@ public:
     std::string				Text;
 };
 
-IDasmNumberOutput* g_pNumberOutputObj = nullptr;
+thread_local IDasmNumberOutput* g_pNumberOutputObj = nullptr;	// per thread so disassembly can run on several threads at once
 IDasmNumberOutput* GetNumberOutput()
 {
     return g_pNumberOutputObj;
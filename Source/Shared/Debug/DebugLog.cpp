@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <mutex>
 #ifdef _WIN32
 #include <Windows.h>
 #endif
@@ -44,11 +45,15 @@
 	fn(buf); 
 #endif
 
+// log can be written to from several analysis threads
+static std::mutex g_LogLock;
+
 void LogFatal(const char* str)
 {
 #ifdef WIN32
 	OutputDebugStringA(str);
 #endif
+	std::lock_guard<std::mutex> lock(g_LogLock);
 	g_ImGuiLog.AddLog("[Fatal] %s", str);
 }
 
@@ -57,6 +62,7 @@ void LogError(const char* str)
 #ifdef WIN32
 	OutputDebugStringA(str);
 #endif
+	std::lock_guard<std::mutex> lock(g_LogLock);
 	g_ImGuiLog.AddLog("[Error] %s", str);
 }
 
@@ -65,6 +71,7 @@ void LogWarning(const char* str)
 #ifdef WIN32
 	OutputDebugStringA(str);
 #endif
+	std::lock_guard<std::mutex> lock(g_LogLock);
 	g_ImGuiLog.AddLog("[Warning] %s", str);
 }
 
@@ -73,6 +80,7 @@ void LogInfo(const char* str)
 #ifdef WIN32
 	OutputDebugStringA(str);
 #endif
+	std::lock_guard<std::mutex> lock(g_LogLock);
 	g_ImGuiLog.AddLog("[Info] %s", str);
 }
 
@@ -81,6 +89,7 @@ void LogDebug(const char* str)
 #ifdef WIN32
 	OutputDebugStringA(str);
 #endif
+	std::lock_guard<std::mutex> lock(g_LogLock);
 	g_ImGuiLog.AddLog("[Debug] %s", str);
 }
 
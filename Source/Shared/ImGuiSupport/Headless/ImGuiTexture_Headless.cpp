@@ -0,0 +1,21 @@
+#include "../ImGuiTexture.h"
+
+// Null texture implementation for builds that have no graphics API (e.g. headless batch analysis)
+// ImGui calls still work but nothing is ever rendered
+
+ImTextureID ImGui_CreateTextureRGBA(const void* pixels, int width, int height)
+{
+	return nullptr;
+}
+
+void ImGui_FreeTexture(ImTextureID texture)
+{
+}
+
+void ImGui_UpdateTextureRGBA(ImTextureID texture, const void* pixels)
+{
+}
+
+void ImGui_UpdateTextureRGBA(ImTextureID texture, const void* pixels, int srcWidth, int srcHeight)
+{
+}
@@ -0,0 +1,64 @@
+#include "EmuScheduler.h"
+
+void FEmuScheduler::Reset()
+{
+	bStarted = false;
+	AccumulatedMicroSeconds = 0;
+	FramesRunThisUpdate = 0;
+	FramesRunLastUpdate = 0;
+	EmulationSpeed = 0.0f;
+}
+
+void FEmuScheduler::BeginUpdate()
+{
+	const FClock::time_point now = FClock::now();
+	if (bStarted == false)
+	{
+		// run a single frame the first time through
+		LastUpdateTime = now - std::chrono::microseconds(FrameMicroSeconds);
+		bStarted = true;
+	}
+
+	const double elapsedMicroSeconds = (double)std::chrono::duration_cast<std::chrono::microseconds>(now - LastUpdateTime).count();
+	LastUpdateTime = now;
+
+	if (elapsedMicroSeconds > 0)
+		EmulationSpeed = (float)(FramesRunThisUpdate * (double)FrameMicroSeconds / elapsedMicroSeconds);
+	FramesRunLastUpdate = FramesRunThisUpdate;
+	FramesRunThisUpdate = 0;
+
+	if (bTurboMode)
+		AccumulatedMicroSeconds = 0;
+	else
+		AccumulatedMicroSeconds += elapsedMicroSeconds * SpeedScale;
+}
+
+bool FEmuScheduler::ShouldRunFrame()
+{
+	if (bTurboMode)
+	{
+		// always run one frame so the emulation moves on however slow the frames are
+		if (FramesRunThisUpdate > 0)
+		{
+			const auto timeSpent = std::chrono::duration_cast<std::chrono::milliseconds>(FClock::now() - LastUpdateTime);
+			if (timeSpent.count() >= TurboBudgetMS)
+				return false;
+		}
+		FramesRunThisUpdate++;
+		return true;
+	}
+
+	if (AccumulatedMicroSeconds < FrameMicroSeconds)
+		return false;
+
+	if (FramesRunThisUpdate == kMaxCatchUpFrames)
+	{
+		// can't keep up - drop the time rather than falling further behind
+		AccumulatedMicroSeconds = 0;
+		return false;
+	}
+
+	AccumulatedMicroSeconds -= FrameMicroSeconds;
+	FramesRunThisUpdate++;
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Decides how many whole emulated frames to run each UI frame.
+// Real time is accumulated and frames are run at a fixed timestep so emulation speed doesn't depend on the UI frame rate.
+// In turbo mode frames are run back to back until the time budget for the UI frame is used up.
+//
+// Usage:
+//	Scheduler.BeginUpdate();
+//	while (Scheduler.ShouldRunFrame())
+//		RunEmulatedFrame();
+class FEmuScheduler
+{
+public:
+	static const int	kMaxCatchUpFrames = 4;			// frames run to catch up after a slow UI frame before time is dropped
+	static const int	kDefaultTurboBudgetMS = 12;		// leaves time for the UI at 60hz
+
+	void	Reset();
+	void	SetFrameTime(uint32_t frameMicroSeconds) { FrameMicroSeconds = frameMicroSeconds; }
+	void	SetSpeedScale(float speedScale) { SpeedScale = speedScale; }
+	void	SetTurbo(bool bTurbo) { bTurboMode = bTurbo; }
+	void	SetTurboBudget(int milliSeconds) { TurboBudgetMS = milliSeconds; }
+
+	void	BeginUpdate();
+	bool	ShouldRunFrame();
+
+	uint32_t	GetFrameTime() const { return FrameMicroSeconds; }
+	bool		IsTurbo() const { return bTurboMode; }
+	bool*		GetTurboPtr() { return &bTurboMode; }
+	int			GetFramesRunLastUpdate() const { return FramesRunLastUpdate; }
+	float		GetEmulationSpeed() const { return EmulationSpeed; }	// emulated time / real time
+
+private:
+	typedef std::chrono::steady_clock FClock;
+
+	uint32_t	FrameMicroSeconds = 20000;
+	float		SpeedScale = 1.0f;
+	bool		bTurboMode = false;
+	int			TurboBudgetMS = kDefaultTurboBudgetMS;
+
+	bool		bStarted = false;
+	FClock::time_point	LastUpdateTime;
+	double		AccumulatedMicroSeconds = 0;
+	int			FramesRunThisUpdate = 0;
+	int			FramesRunLastUpdate = 0;
+	float		EmulationSpeed = 0.0f;
+};
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -37,4 +38,16 @@ uint8_t ParseHexString8bit(const std::string& string);
 uint16_t ParseHexString16bit(const std::string& string);
 
 bool CreateDir(const char* osDir);
-char GetDirSep();
\ No newline at end of file
+char GetDirSep();
+bool IsFileNewer(const char* pFilename, const char* pOtherFilename);	// false if either file is missing
+
+// read only mapping of a whole file into memory - platform specific
+struct FMappedFile
+{
+	const uint8_t*	pData = nullptr;
+	size_t			Size = 0;
+	void*			pPlatformHandle = nullptr;
+};
+
+bool MapFile(const char* pFilename, FMappedFile& outMapping);
+void UnmapFile(FMappedFile& mapping);
\ No newline at end of file
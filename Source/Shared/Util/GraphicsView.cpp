@@ -3,6 +3,7 @@
 #include <imgui.h>
 #include <ImGuiSupport/ImGuiTexture.h>
 #include <cstdint>
+#include <string.h>
 #include <vector>
 
 void DisplayTextureInspector(const ImTextureID texture, float width, float height, bool bScale = false, bool bMagnifier = true);
@@ -55,9 +56,21 @@ void FGraphicsView::Clear(const uint32_t col)
 		PixelBuffer[i] = col;
 }
 
+void FGraphicsView::ClearRect(int xp, int yp, int width, int height, const uint32_t col)
+{
+	uint32_t* pBase = PixelBuffer + (xp + (yp * Width));
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+			pBase[x] = col;
+		pBase += Width;
+	}
+}
+
 void FGraphicsView::Draw(float xSize, float ySize, bool bScale, bool bMagnifier)
 {
-	UpdateTexture();
+	if (bManualTextureUpdate == false)
+		UpdateTexture();
 	DisplayTextureInspector(Texture, xSize, ySize, bScale, bMagnifier);
 }
 
@@ -169,57 +182,54 @@ void DisplayTextureInspector(const ImTextureID texture, float width, float heigh
 
 // Character sets
 
-static std::vector<FCharacterSet*>	g_CharacterSets;
-static std::vector<FCharacterMap*>	g_CharacterMaps;
-
 void UpdateCharacterSetImage(FCodeAnalysisState& state, FCharacterSet& characterSet);
 
 
-void InitCharacterSets()
+void InitCharacterSets(FCodeAnalysisState& state)
 {
 	// char sets
-	for (auto& it : g_CharacterSets)
+	for (auto& it : state.CharacterSets)
 		delete it;
 
-	g_CharacterSets.clear();
+	state.CharacterSets.clear();
 
 	// char maps
-	for (auto& it : g_CharacterMaps)
+	for (auto& it : state.CharacterMaps)
 		delete it;
 
-	g_CharacterMaps.clear();
+	state.CharacterMaps.clear();
 }
 
 void UpdateCharacterSets(FCodeAnalysisState& state)
 {
-	for (auto& it : g_CharacterSets)
+	for (auto& it : state.CharacterSets)
 	{
 		if(it->Params.bDynamic)
 			UpdateCharacterSetImage(state, *it);
 	}
 }
 
-int GetNoCharacterSets()
+int GetNoCharacterSets(const FCodeAnalysisState& state)
 {
-	return (int)g_CharacterSets.size();
+	return (int)state.CharacterSets.size();
 }
 
-void DeleteCharacterSet(int index)
+void DeleteCharacterSet(FCodeAnalysisState& state, int index)
 {
-	g_CharacterSets.erase(g_CharacterSets.begin() + index);
+	state.CharacterSets.erase(state.CharacterSets.begin() + index);
 }
 
-FCharacterSet* GetCharacterSetFromIndex(int index)
+FCharacterSet* GetCharacterSetFromIndex(const FCodeAnalysisState& state, int index)
 {
-	if (index >= 0 && index < GetNoCharacterSets())
-		return g_CharacterSets[index];
+	if (index >= 0 && index < GetNoCharacterSets(state))
+		return state.CharacterSets[index];
 	else
 		return nullptr;
 }
 
-FCharacterSet* GetCharacterSetFromAddress(FAddressRef address)
+FCharacterSet* GetCharacterSetFromAddress(const FCodeAnalysisState& state, FAddressRef address)
 {
-	for (auto& it : g_CharacterSets)
+	for (auto& it : state.CharacterSets)
 	{
 		if (it->Params.Address == address)
 			return it;
@@ -229,6 +239,7 @@ FCharacterSet* GetCharacterSetFromAddress(FAddressRef address)
 }
 
 // This function assumes the data is mapped in memory
+// Characters are only redrawn if their source bytes have changed since they were last drawn
 void UpdateCharacterSetImage(FCodeAnalysisState& state, FCharacterSet& characterSet)
 {
 	uint16_t addr = characterSet.Params.Address.Address;
@@ -240,11 +251,13 @@ void UpdateCharacterSetImage(FCodeAnalysisState& state, FCharacterSet& character
 	const uint8_t paperMask = 7;
 	const uint8_t paperShift = 3;
 
-	characterSet.Image->Clear(0);	// clear first
+	const bool bRedrawAll = characterSet.bCharSourcesValid == false;
+	bool bImageChanged = bRedrawAll;
+	if (bRedrawAll)
+		characterSet.Image->Clear(0);	// clear first
 
 	for (int charNo = 0; charNo < 256; charNo++)
 	{
-		const uint8_t* pCharData = state.CPUInterface->GetMemPtr(addr);
 		const int xp = (charNo & 15) * 8;
 		const int yp = (charNo >> 4) * 8;
 		uint32_t inkCol = 0xffffffff;
@@ -278,6 +291,16 @@ void UpdateCharacterSetImage(FCodeAnalysisState& state, FCharacterSet& character
                 break;
 		}
 
+		FCharacterSource& charSource = characterSet.CharSources[charNo];
+		if (bRedrawAll == false && colAttr == charSource.ColourAttr && memcmp(charPix, charSource.Pixels, sizeof(charPix)) == 0)
+			continue;
+
+		charSource.ColourAttr = colAttr;
+		memcpy(charSource.Pixels, charPix, sizeof(charPix));
+		if (bRedrawAll == false)
+			characterSet.Image->ClearRect(xp, yp, 8, 8, 0);
+		bImageChanged = true;
+
 		if (colAttr != 0xff)
 		{
 			// get ink & paper
@@ -289,12 +312,15 @@ void UpdateCharacterSetImage(FCodeAnalysisState& state, FCharacterSet& character
 		characterSet.Image->DrawBitImage(charPix, xp, yp, 1, 1, inkCol, paperCol);
 	}
 
-	characterSet.Image->UpdateTexture();
+	characterSet.bCharSourcesValid = true;
+	if (bImageChanged)
+		characterSet.Image->UpdateTexture();
 }
 
 void UpdateCharacterSet(FCodeAnalysisState& state, FCharacterSet& characterSet, const FCharSetCreateParams& params)
 {
 	characterSet.Params = params;
+	characterSet.bCharSourcesValid = false;	// params changed so redraw everything
 	//characterSet.Params.Address = params.Address;
 	//characterSet.Params.AttribsAddress = params.AttribsAddress;
 	//characterSet.Params.MaskInfo = params.MaskInfo;
@@ -306,14 +332,15 @@ void UpdateCharacterSet(FCodeAnalysisState& state, FCharacterSet& characterSet,
 
 bool CreateCharacterSetAt(FCodeAnalysisState& state, const FCharSetCreateParams& params)
 {
-	if (params.Address.IsValid() == false || GetCharacterSetFromAddress(params.Address) != nullptr)
+	if (params.Address.IsValid() == false || GetCharacterSetFromAddress(state, params.Address) != nullptr)
 		return false;
 
 	FCharacterSet* pNewCharSet = new FCharacterSet;
 	pNewCharSet->Image = new FGraphicsView(128, 128);
+	pNewCharSet->Image->SetManualTextureUpdate(true);	// uploaded when characters change
 	UpdateCharacterSet(state, *pNewCharSet, params);
 
-	g_CharacterSets.push_back(pNewCharSet);
+	state.CharacterSets.push_back(pNewCharSet);
 	return true;
 }
 
@@ -322,27 +349,27 @@ bool CreateCharacterSetAt(FCodeAnalysisState& state, const FCharSetCreateParams&
 
 
 
-int GetNoCharacterMaps()
+int GetNoCharacterMaps(const FCodeAnalysisState& state)
 {
-	return (int)g_CharacterMaps.size();
+	return (int)state.CharacterMaps.size();
 }
 
-void DeleteCharacterMap(int index)
+void DeleteCharacterMap(FCodeAnalysisState& state, int index)
 {
-	g_CharacterMaps.erase(g_CharacterMaps.begin() + index);
+	state.CharacterMaps.erase(state.CharacterMaps.begin() + index);
 }
 
-FCharacterMap* GetCharacterMapFromIndex(int index)
+FCharacterMap* GetCharacterMapFromIndex(const FCodeAnalysisState& state, int index)
 {
-	if (index >= 0 && index < GetNoCharacterMaps())
-		return g_CharacterMaps[index];
+	if (index >= 0 && index < GetNoCharacterMaps(state))
+		return state.CharacterMaps[index];
 	else
 		return nullptr;
 }
 
-FCharacterMap* GetCharacterMapFromAddress(FAddressRef address)
+FCharacterMap* GetCharacterMapFromAddress(const FCodeAnalysisState& state, FAddressRef address)
 {
-	for (auto& it : g_CharacterMaps)
+	for (auto& it : state.CharacterMaps)
 	{
 		if (it->Params.Address == address)
 			return it;
@@ -353,7 +380,7 @@ FCharacterMap* GetCharacterMapFromAddress(FAddressRef address)
 
 bool CreateCharacterMap(FCodeAnalysisState& state, const FCharMapCreateParams& params)
 {
-	if (params.Address.IsValid() == false || GetCharacterMapFromAddress(params.Address) != nullptr)
+	if (params.Address.IsValid() == false || GetCharacterMapFromAddress(state, params.Address) != nullptr)
 		return false;
 
 	FLabelInfo* pLabel = state.GetLabelForAddress(params.Address);
@@ -363,6 +390,6 @@ bool CreateCharacterMap(FCodeAnalysisState& state, const FCharMapCreateParams& p
 	FCharacterMap* pNewCharMap = new FCharacterMap;
 	pNewCharMap->Params = params;
 
-	g_CharacterMaps.push_back(pNewCharMap);
+	state.CharacterMaps.push_back(pNewCharMap);
 	return true;
 }
\ No newline at end of file
@@ -13,7 +13,10 @@ public:
 	~FGraphicsView();
 
 	void Clear(const uint32_t col = 0xff000000);
+	void ClearRect(int xp, int yp, int width, int height, const uint32_t col = 0xff000000);
 	void UpdateTexture(void);
+	// for views whose owner calls UpdateTexture when the pixels change, so drawing doesn't upload every frame
+	void SetManualTextureUpdate(bool bManual) { bManualTextureUpdate = bManual; }
 	void Draw(float xSize, float ySize, bool bScale = false, bool bMagnifier = true);
 	void Draw(bool bMagnifier = true);
 
@@ -39,6 +42,7 @@ private:
 	int				Height = 0;
 	uint32_t*		PixelBuffer = nullptr;
 	void*			Texture = nullptr;
+	bool			bManualTextureUpdate = false;
 };
 
 // Character set stuff
@@ -81,6 +85,13 @@ struct FCharSetCreateParams
 	bool			bDynamic = false;
 };
 
+// source data a character was last drawn from
+struct FCharacterSource
+{
+	uint8_t		Pixels[8];
+	uint8_t		ColourAttr;
+};
+
 struct FCharacterSet
 {
 	~FCharacterSet() { delete Image; }
@@ -95,6 +106,10 @@ struct FCharacterSet
 	FCharSetCreateParams	Params;
 
 	FGraphicsView*	Image = nullptr;	
+
+	// only characters whose source changed get redrawn
+	FCharacterSource	CharSources[256];
+	bool				bCharSourcesValid = false;
 };
 
 // Character Maps
@@ -115,20 +130,20 @@ struct FCharacterMap
 // utils
 uint32_t GetColFromAttr(uint8_t colBits, const uint32_t* colourLUT, bool bBright = true);
 
-// Character sets
-void InitCharacterSets();
+// Character sets - these live in the analysis state
+void InitCharacterSets(FCodeAnalysisState& state);
 void UpdateCharacterSets(FCodeAnalysisState& state);
-int GetNoCharacterSets();
-void DeleteCharacterSet(int index);
-FCharacterSet* GetCharacterSetFromIndex(int index);
-FCharacterSet* GetCharacterSetFromAddress(FAddressRef address);
+int GetNoCharacterSets(const FCodeAnalysisState& state);
+void DeleteCharacterSet(FCodeAnalysisState& state, int index);
+FCharacterSet* GetCharacterSetFromIndex(const FCodeAnalysisState& state, int index);
+FCharacterSet* GetCharacterSetFromAddress(const FCodeAnalysisState& state, FAddressRef address);
 void UpdateCharacterSet(FCodeAnalysisState& state, FCharacterSet& characterSet, const FCharSetCreateParams& params);
 bool CreateCharacterSetAt(FCodeAnalysisState& state, const FCharSetCreateParams& params);
 
 // Character Maps
-int GetNoCharacterMaps();
-void DeleteCharacterMap(int index);
-FCharacterMap* GetCharacterMapFromIndex(int index);
-FCharacterMap* GetCharacterMapFromAddress(FAddressRef address);
+int GetNoCharacterMaps(const FCodeAnalysisState& state);
+void DeleteCharacterMap(FCodeAnalysisState& state, int index);
+FCharacterMap* GetCharacterMapFromIndex(const FCodeAnalysisState& state, int index);
+FCharacterMap* GetCharacterMapFromAddress(const FCodeAnalysisState& state, FAddressRef address);
 bool CreateCharacterMap(FCodeAnalysisState& state, const FCharMapCreateParams& params);
 
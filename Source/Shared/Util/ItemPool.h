@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Slab allocator for items of a single type
+// Items are constructed into fixed size slabs so allocation is usually a pointer bump.
+// Freed items go on a free list for reuse. Reset() destroys all items in one go but keeps the slabs.
+// Types with private constructors/destructors need to make FItemPool a friend.
+template <class T, int kItemsPerSlab = 1024>
+class FItemPool
+{
+public:
+	FItemPool() = default;
+	FItemPool(const FItemPool&) = delete;
+	FItemPool& operator=(const FItemPool&) = delete;
+
+	~FItemPool()
+	{
+		Reset();
+		for (T* pSlab : Slabs)
+			::operator delete(pSlab);
+	}
+
+	T* Allocate()
+	{
+		TotalAllocations++;
+
+		if (FreeList.empty() == false)
+		{
+			T* pItem = FreeList.back();
+			FreeList.pop_back();
+			return pItem;
+		}
+
+		if (NextSlot == kItemsPerSlab)
+		{
+			CurrentSlab++;
+			NextSlot = 0;
+		}
+
+		if (CurrentSlab == (int)Slabs.size())
+			Slabs.push_back(static_cast<T*>(::operator new(sizeof(T) * kItemsPerSlab)));
+
+		T* pItem = new (&Slabs[CurrentSlab][NextSlot++]) T;
+		NoConstructed++;
+		return pItem;
+	}
+
+	// return an item to the pool - it's reset to a default item straight away so anything it owns is released
+	void Free(T* pItem)
+	{
+		pItem->~T();
+		new (pItem) T;
+		FreeList.push_back(pItem);
+	}
+
+	// destroy all items, slabs are kept for reuse
+	void Reset()
+	{
+		for (int slabNo = 0; slabNo < (int)Slabs.size() && NoConstructed > 0; slabNo++)
+		{
+			const int noInSlab = NoConstructed < kItemsPerSlab ? NoConstructed : kItemsPerSlab;
+			for (int i = 0; i < noInSlab; i++)
+				Slabs[slabNo][i].~T();
+			NoConstructed -= noInSlab;
+		}
+
+		FreeList.clear();
+		CurrentSlab = 0;
+		NextSlot = 0;
+		NoConstructed = 0;
+		TotalAllocations = 0;
+	}
+
+	int		GetNoLive() const { return NoConstructed - (int)FreeList.size(); }
+	int		GetNoFree() const { return (int)FreeList.size(); }
+	int		GetNoSlabs() const { return (int)Slabs.size(); }
+	int		GetTotalAllocations() const { return TotalAllocations; }	// since last reset
+	size_t	GetMemoryUsage() const { return Slabs.size() * sizeof(T) * kItemsPerSlab; }
+
+private:
+	std::vector<T*>	Slabs;
+	std::vector<T*>	FreeList;
+	int				CurrentSlab = 0;
+	int				NextSlot = 0;
+	int				NoConstructed = 0;	// items constructed in slabs, including ones on the free list
+	int				TotalAllocations = 0;
+};
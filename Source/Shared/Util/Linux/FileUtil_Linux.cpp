@@ -1,7 +1,10 @@
 #include  "../FileUtil.h"
 
+#include <fcntl.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 bool CreateDir(const char* osDir)
 {
@@ -20,3 +23,44 @@ char GetDirSep()
 {
 	return '/';
 }
+
+bool IsFileNewer(const char* pFilename, const char* pOtherFilename)
+{
+	struct stat st = { 0 };
+	struct stat otherSt = { 0 };
+	if (stat(pFilename, &st) == -1 || stat(pOtherFilename, &otherSt) == -1)
+		return false;
+
+	return st.st_mtime > otherSt.st_mtime;
+}
+
+bool MapFile(const char* pFilename, FMappedFile& outMapping)
+{
+	const int fd = open(pFilename, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat st = { 0 };
+	if (fstat(fd, &st) == -1 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* pData = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);	// mapping holds its own reference to the file
+	if (pData == MAP_FAILED)
+		return false;
+
+	outMapping.pData = (const uint8_t*)pData;
+	outMapping.Size = st.st_size;
+	outMapping.pPlatformHandle = nullptr;
+	return true;
+}
+
+void UnmapFile(FMappedFile& mapping)
+{
+	if (mapping.pData != nullptr)
+		munmap((void*)mapping.pData, mapping.Size);
+	mapping = FMappedFile();
+}
@@ -0,0 +1,264 @@
+#include "MemoryHistory.h"
+
+#include <cassert>
+#include <string.h>
+
+// delta stream format:
+//	per changed page: uint16 page no, then runs of (uint16 skip, uint16 count, count XOR bytes) covering the page
+//	terminated by kEndOfDelta
+static const uint16_t kEndOfDelta = 0xffff;
+
+// zero gaps shorter than this are folded into the literal run rather than starting a new run
+static const int kMinSkipRun = 4;
+
+static void WriteU16(std::vector<uint8_t>& data, uint16_t val)
+{
+	data.push_back(val & 0xff);
+	data.push_back(val >> 8);
+}
+
+static uint16_t ReadU16(const uint8_t*& pData)
+{
+	const uint16_t val = pData[0] | (pData[1] << 8);
+	pData += 2;
+	return val;
+}
+
+void FMemoryHistory::Init(int bankSize, int maxFrames, int keyFrameInterval)
+{
+	assert(bankSize % kPageSize == 0);
+	BankSize = bankSize;
+	PagesPerBank = bankSize / kPageSize;
+	MaxFrames = maxFrames;
+	KeyFrameInterval = keyFrameInterval;
+	Reset();
+}
+
+void FMemoryHistory::Reset()
+{
+	Frames.clear();
+	LastImage.clear();
+	LastImageBanks = 0;
+	FramesSinceKeyFrame = 0;
+	RestoredFrameNo = -1;
+}
+
+int FMemoryHistory::CaptureFrame(const uint8_t* const* pBanks, int noBanks, const void* pMachineState, size_t machineStateSize)
+{
+	FFrameRecord& record = Frames.emplace_back();
+	record.FrameNo = NextFrameNo++;
+	record.NoBanks = noBanks;
+	if (pMachineState != nullptr)
+		record.MachineState.assign((const uint8_t*)pMachineState, (const uint8_t*)pMachineState + machineStateSize);
+
+	// bank layout changed or due a keyframe
+	if (LastImageBanks != noBanks || Frames.size() == 1 || FramesSinceKeyFrame >= KeyFrameInterval)
+		WriteKeyFrame(record, pBanks, noBanks);
+	else
+		WriteDeltaFrame(record, pBanks, noBanks);
+
+	EvictOldFrames();
+	return record.FrameNo;
+}
+
+void FMemoryHistory::WriteKeyFrame(FFrameRecord& record, const uint8_t* const* pBanks, int noBanks)
+{
+	record.bKeyFrame = true;
+	record.Data.resize((size_t)noBanks * BankSize);
+	LastImage.resize((size_t)noBanks * BankSize);
+	LastImageBanks = noBanks;
+
+	for (int bankNo = 0; bankNo < noBanks; bankNo++)
+	{
+		memcpy(&record.Data[(size_t)bankNo * BankSize], pBanks[bankNo], BankSize);
+		memcpy(&LastImage[(size_t)bankNo * BankSize], pBanks[bankNo], BankSize);
+	}
+
+	FramesSinceKeyFrame = 0;
+}
+
+void FMemoryHistory::WriteDeltaFrame(FFrameRecord& record, const uint8_t* const* pBanks, int noBanks)
+{
+	record.bKeyFrame = false;
+	uint8_t xorPage[kPageSize];
+
+	for (int bankNo = 0; bankNo < noBanks; bankNo++)
+	{
+		for (int pageNo = 0; pageNo < PagesPerBank; pageNo++)
+		{
+			const uint8_t* pSrc = pBanks[bankNo] + pageNo * kPageSize;
+			uint8_t* pLast = &LastImage[(size_t)bankNo * BankSize + pageNo * kPageSize];
+
+			// page granular dirty check
+			if (memcmp(pSrc, pLast, kPageSize) == 0)
+				continue;
+
+			for (int i = 0; i < kPageSize; i++)
+				xorPage[i] = pSrc[i] ^ pLast[i];
+			memcpy(pLast, pSrc, kPageSize);
+
+			WriteU16(record.Data, (uint16_t)(bankNo * PagesPerBank + pageNo));
+
+			int offset = 0;
+			while (offset < kPageSize)
+			{
+				int skip = 0;
+				while (offset + skip < kPageSize && xorPage[offset + skip] == 0)
+					skip++;
+
+				const int runStart = offset + skip;
+				int runEnd = runStart;
+				while (runEnd < kPageSize)
+				{
+					if (xorPage[runEnd] != 0)
+					{
+						runEnd++;
+						continue;
+					}
+
+					// only break the run on a gap big enough to be worth a new run header
+					int gap = 0;
+					while (runEnd + gap < kPageSize && xorPage[runEnd + gap] == 0 && gap < kMinSkipRun)
+						gap++;
+					if (gap == kMinSkipRun || runEnd + gap == kPageSize)
+						break;
+					runEnd += gap;
+				}
+
+				WriteU16(record.Data, (uint16_t)skip);
+				WriteU16(record.Data, (uint16_t)(runEnd - runStart));
+				record.Data.insert(record.Data.end(), &xorPage[runStart], &xorPage[runStart] + (runEnd - runStart));
+				offset = runEnd;
+			}
+		}
+	}
+
+	WriteU16(record.Data, kEndOfDelta);
+	record.Data.shrink_to_fit();
+	FramesSinceKeyFrame++;
+}
+
+void FMemoryHistory::ApplyDelta(const std::vector<uint8_t>& delta, uint8_t* pImage)
+{
+	const uint8_t* pData = delta.data();
+
+	while (true)
+	{
+		const uint16_t pageNo = ReadU16(pData);
+		if (pageNo == kEndOfDelta)
+			break;
+
+		uint8_t* pPage = pImage + (size_t)pageNo * kPageSize;
+		int offset = 0;
+		while (offset < kPageSize)
+		{
+			offset += ReadU16(pData);
+			const int count = ReadU16(pData);
+			for (int i = 0; i < count; i++)
+				pPage[offset + i] ^= *pData++;
+			offset += count;
+		}
+	}
+}
+
+// remove whole keyframe groups from the front so the oldest frame can always be rebuilt
+void FMemoryHistory::EvictOldFrames()
+{
+	while ((int)Frames.size() > MaxFrames)
+	{
+		size_t nextKeyFrame = 1;
+		while (nextKeyFrame < Frames.size() && Frames[nextKeyFrame].bKeyFrame == false)
+			nextKeyFrame++;
+
+		if (nextKeyFrame == Frames.size() || (int)(Frames.size() - nextKeyFrame) < MaxFrames)
+			break;
+
+		Frames.erase(Frames.begin(), Frames.begin() + nextKeyFrame);
+	}
+}
+
+bool FMemoryHistory::IsFrameAvailable(int frameNo) const
+{
+	if (Frames.empty())
+		return false;
+
+	return frameNo >= Frames.front().FrameNo && frameNo <= Frames.back().FrameNo;
+}
+
+bool FMemoryHistory::RestoreFrame(int frameNo, uint8_t* const* pBanks, int noBanks) const
+{
+	if (IsFrameAvailable(frameNo) == false)
+		return false;
+
+	const int frameIndex = frameNo - Frames.front().FrameNo;
+	if (Frames[frameIndex].NoBanks != noBanks)
+		return false;
+
+	int keyFrameIndex = frameIndex;
+	while (Frames[keyFrameIndex].bKeyFrame == false)
+		keyFrameIndex--;
+
+	// rebuild into a contiguous image then copy out to the banks
+	// carry on from the last rebuilt frame if it's between the keyframe and this one
+	int startIndex = keyFrameIndex;
+	const int restoredIndex = IsFrameAvailable(RestoredFrameNo) ? RestoredFrameNo - Frames.front().FrameNo : -1;
+	if (restoredIndex >= keyFrameIndex && restoredIndex <= frameIndex)
+		startIndex = restoredIndex;
+	else
+		RestoredImage = Frames[keyFrameIndex].Data;
+
+	for (int i = startIndex + 1; i <= frameIndex; i++)
+		ApplyDelta(Frames[i].Data, RestoredImage.data());
+	RestoredFrameNo = frameNo;
+
+	for (int bankNo = 0; bankNo < noBanks; bankNo++)
+		memcpy(pBanks[bankNo], &RestoredImage[(size_t)bankNo * BankSize], BankSize);
+
+	return true;
+}
+
+bool FMemoryHistory::GetMachineState(int frameNo, void* pOutState, size_t machineStateSize) const
+{
+	if (IsFrameAvailable(frameNo) == false)
+		return false;
+
+	const FFrameRecord& record = Frames[frameNo - Frames.front().FrameNo];
+	if (record.MachineState.size() != machineStateSize)
+		return false;
+
+	memcpy(pOutState, record.MachineState.data(), machineStateSize);
+	return true;
+}
+
+void FMemoryHistory::DiscardFramesAfter(int frameNo)
+{
+	if (IsFrameAvailable(frameNo) == false)
+		return;
+
+	while (Frames.back().FrameNo > frameNo)
+		Frames.pop_back();
+
+	// frame numbers get reused so the rebuilt frame can't be trusted
+	NextFrameNo = frameNo + 1;
+	RestoredFrameNo = -1;
+	LastImageBanks = 0;	// next capture is a keyframe as LastImage is ahead of the kept frames
+}
+
+int FMemoryHistory::GetNoKeyFrames() const
+{
+	int count = 0;
+	for (const auto& frame : Frames)
+	{
+		if (frame.bKeyFrame)
+			count++;
+	}
+	return count;
+}
+
+size_t FMemoryHistory::GetMemoryUsage() const
+{
+	size_t total = LastImage.capacity() + RestoredImage.capacity();
+	for (const auto& frame : Frames)
+		total += frame.Data.capacity() + frame.MachineState.capacity() + sizeof(FFrameRecord);
+	return total;
+}
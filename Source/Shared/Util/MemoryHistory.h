@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// History of banked memory, one entry per captured frame.
+// Frames are stored as periodic full keyframes with XOR/RLE encoded page deltas in between.
+// Any frame still in the history can be rebuilt from its keyframe on demand.
+// The last rebuilt frame is kept so stepping forward through the history only applies the new deltas.
+class FMemoryHistory
+{
+public:
+	static const int kPageSize = 1024;
+
+	void	Init(int bankSize, int maxFrames, int keyFrameInterval = 50);
+	void	Reset();
+
+	// capture the current contents of the banks & optional machine state - returns the frame number
+	int		CaptureFrame(const uint8_t* const* pBanks, int noBanks, const void* pMachineState = nullptr, size_t machineStateSize = 0);
+	// rebuild memory for a captured frame into the banks
+	bool	RestoreFrame(int frameNo, uint8_t* const* pBanks, int noBanks) const;
+	bool	GetMachineState(int frameNo, void* pOutState, size_t machineStateSize) const;
+	// drop frames after this one, used when emulation carries on from a restored frame
+	void	DiscardFramesAfter(int frameNo);
+
+	bool	IsFrameAvailable(int frameNo) const;
+	int		GetNoFrames() const { return (int)Frames.size(); }
+	int		GetLastFrameNo() const { return Frames.empty() ? -1 : Frames.back().FrameNo; }
+	int		GetNoKeyFrames() const;
+	size_t	GetMemoryUsage() const;
+
+private:
+	struct FFrameRecord
+	{
+		int						FrameNo = -1;
+		bool					bKeyFrame = false;
+		int						NoBanks = 0;
+		std::vector<uint8_t>	Data;	// raw banks for keyframes, page deltas otherwise
+		std::vector<uint8_t>	MachineState;
+	};
+
+	void	WriteKeyFrame(FFrameRecord& record, const uint8_t* const* pBanks, int noBanks);
+	void	WriteDeltaFrame(FFrameRecord& record, const uint8_t* const* pBanks, int noBanks);
+	void	EvictOldFrames();
+
+	static void	ApplyDelta(const std::vector<uint8_t>& delta, uint8_t* pImage);
+
+	int		BankSize = 16 * 1024;
+	int		PagesPerBank = 16;
+	int		MaxFrames = 0;
+	int		KeyFrameInterval = 50;
+
+	int		NextFrameNo = 0;
+	int		FramesSinceKeyFrame = 0;
+
+	std::deque<FFrameRecord>	Frames;
+	std::vector<uint8_t>		LastImage;	// memory at the last capture, deltas are made against this
+	int							LastImageBanks = 0;
+
+	mutable std::vector<uint8_t>	RestoredImage;	// last frame rebuilt by RestoreFrame
+	mutable int						RestoredFrameNo = -1;
+};
@@ -7,8 +7,9 @@
 static ENumberDisplayMode g_NumDispMode = ENumberDisplayMode::HexAitch;
 static const int kTextLength = 24;
 static const int kNoStrings = 8;
-int g_StringIndex = 0;
-static char g_TextWorkspace[kNoStrings][kTextLength];
+// per thread so analysis can run on several threads at once
+thread_local int g_StringIndex = 0;
+thread_local static char g_TextWorkspace[kNoStrings][kTextLength];
 
 char* GetStrPtr()
 {
@@ -0,0 +1,126 @@
+#include "PaletteConvert.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PALETTE_CONVERT_SSSE3 1
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SSSE3_TARGET
+#else
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#endif
+#elif defined(__aarch64__)
+#define PALETTE_CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+static const int kMaxSIMDPaletteSize = 16;
+
+void ConvertPalettedToRGBA_Scalar(const uint8_t* pSrc, uint32_t* pDest, int noPixels, const uint32_t* pPalette)
+{
+	for (int i = 0; i < noPixels; i++)
+		pDest[i] = pPalette[pSrc[i]];
+}
+
+// split the palette into a 16 entry table per colour channel
+static void GetChannelTables(const uint32_t* pPalette, int paletteSize, uint8_t tables[4][kMaxSIMDPaletteSize])
+{
+	for (int i = 0; i < kMaxSIMDPaletteSize; i++)
+	{
+		const uint32_t col = i < paletteSize ? pPalette[i] : 0;
+		for (int channel = 0; channel < 4; channel++)
+			tables[channel][i] = (col >> (channel * 8)) & 0xff;
+	}
+}
+
+#if PALETTE_CONVERT_SSSE3
+static bool HasSSSE3()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 9)) != 0;
+#else
+	return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+// 16 pixels at a time - look up each channel with a byte shuffle then interleave the channels back into pixels
+SSSE3_TARGET static int ConvertPalettedToRGBA_SSSE3(const uint8_t* pSrc, uint32_t* pDest, int noPixels, const uint8_t tables[4][kMaxSIMDPaletteSize])
+{
+	const __m128i table0 = _mm_loadu_si128((const __m128i*)tables[0]);
+	const __m128i table1 = _mm_loadu_si128((const __m128i*)tables[1]);
+	const __m128i table2 = _mm_loadu_si128((const __m128i*)tables[2]);
+	const __m128i table3 = _mm_loadu_si128((const __m128i*)tables[3]);
+
+	int i = 0;
+	for (; i + 16 <= noPixels; i += 16)
+	{
+		const __m128i indices = _mm_loadu_si128((const __m128i*)(pSrc + i));
+		const __m128i c0 = _mm_shuffle_epi8(table0, indices);
+		const __m128i c1 = _mm_shuffle_epi8(table1, indices);
+		const __m128i c2 = _mm_shuffle_epi8(table2, indices);
+		const __m128i c3 = _mm_shuffle_epi8(table3, indices);
+
+		const __m128i c01Lo = _mm_unpacklo_epi8(c0, c1);
+		const __m128i c01Hi = _mm_unpackhi_epi8(c0, c1);
+		const __m128i c23Lo = _mm_unpacklo_epi8(c2, c3);
+		const __m128i c23Hi = _mm_unpackhi_epi8(c2, c3);
+
+		__m128i* pOut = (__m128i*)(pDest + i);
+		_mm_storeu_si128(pOut + 0, _mm_unpacklo_epi16(c01Lo, c23Lo));
+		_mm_storeu_si128(pOut + 1, _mm_unpackhi_epi16(c01Lo, c23Lo));
+		_mm_storeu_si128(pOut + 2, _mm_unpacklo_epi16(c01Hi, c23Hi));
+		_mm_storeu_si128(pOut + 3, _mm_unpackhi_epi16(c01Hi, c23Hi));
+	}
+	return i;
+}
+#endif
+
+#if PALETTE_CONVERT_NEON
+// 16 pixels at a time - table lookup per channel, the interleaving store puts the channels back together
+static int ConvertPalettedToRGBA_NEON(const uint8_t* pSrc, uint32_t* pDest, int noPixels, const uint8_t tables[4][kMaxSIMDPaletteSize])
+{
+	const uint8x16_t table0 = vld1q_u8(tables[0]);
+	const uint8x16_t table1 = vld1q_u8(tables[1]);
+	const uint8x16_t table2 = vld1q_u8(tables[2]);
+	const uint8x16_t table3 = vld1q_u8(tables[3]);
+
+	int i = 0;
+	for (; i + 16 <= noPixels; i += 16)
+	{
+		const uint8x16_t indices = vld1q_u8(pSrc + i);
+		uint8x16x4_t pixels;
+		pixels.val[0] = vqtbl1q_u8(table0, indices);
+		pixels.val[1] = vqtbl1q_u8(table1, indices);
+		pixels.val[2] = vqtbl1q_u8(table2, indices);
+		pixels.val[3] = vqtbl1q_u8(table3, indices);
+		vst4q_u8((uint8_t*)(pDest + i), pixels);
+	}
+	return i;
+}
+#endif
+
+void ConvertPalettedToRGBA(const uint8_t* pSrc, uint32_t* pDest, int noPixels, const uint32_t* pPalette, int paletteSize)
+{
+	int noConverted = 0;
+
+	if (paletteSize <= kMaxSIMDPaletteSize)
+	{
+		uint8_t tables[4][kMaxSIMDPaletteSize];
+#if PALETTE_CONVERT_SSSE3
+		static const bool bHasSSSE3 = HasSSSE3();
+		if (bHasSSSE3)
+		{
+			GetChannelTables(pPalette, paletteSize, tables);
+			noConverted = ConvertPalettedToRGBA_SSSE3(pSrc, pDest, noPixels, tables);
+		}
+#elif PALETTE_CONVERT_NEON
+		GetChannelTables(pPalette, paletteSize, tables);
+		noConverted = ConvertPalettedToRGBA_NEON(pSrc, pDest, noPixels, tables);
+#endif
+	}
+
+	// whatever is left over
+	ConvertPalettedToRGBA_Scalar(pSrc + noConverted, pDest + noConverted, noPixels - noConverted, pPalette);
+}
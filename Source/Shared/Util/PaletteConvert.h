@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+
+// Expand palette indices to 32 bit colours.
+// Palettes of up to 16 colours use SIMD table lookups (SSSE3/NEON) when the CPU has them.
+void ConvertPalettedToRGBA(const uint8_t* pSrc, uint32_t* pDest, int noPixels, const uint32_t* pPalette, int paletteSize);
+void ConvertPalettedToRGBA_Scalar(const uint8_t* pSrc, uint32_t* pDest, int noPixels, const uint32_t* pPalette);
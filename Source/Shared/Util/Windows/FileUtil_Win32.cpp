@@ -81,6 +81,55 @@ char GetDirSep()
 	return '\\';
 }
 
+bool IsFileNewer(const char* pFilename, const char* pOtherFilename)
+{
+	WIN32_FILE_ATTRIBUTE_DATA fileData;
+	WIN32_FILE_ATTRIBUTE_DATA otherFileData;
+	if (GetFileAttributesExA(pFilename, GetFileExInfoStandard, &fileData) == FALSE || GetFileAttributesExA(pOtherFilename, GetFileExInfoStandard, &otherFileData) == FALSE)
+		return false;
+
+	return CompareFileTime(&fileData.ftLastWriteTime, &otherFileData.ftLastWriteTime) > 0;
+}
+
+bool MapFile(const char* pFilename, FMappedFile& outMapping)
+{
+	HANDLE hFile = CreateFileA(pFilename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(hFile, &fileSize) == FALSE || fileSize.QuadPart == 0)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(hFile);	// mapping holds its own reference to the file
+	if (hMapping == nullptr)
+		return false;
+
+	const void* pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (pData == nullptr)
+	{
+		CloseHandle(hMapping);
+		return false;
+	}
+
+	outMapping.pData = (const uint8_t*)pData;
+	outMapping.Size = (size_t)fileSize.QuadPart;
+	outMapping.pPlatformHandle = hMapping;
+	return true;
+}
+
+void UnmapFile(FMappedFile& mapping)
+{
+	if (mapping.pData != nullptr)
+		UnmapViewOfFile(mapping.pData);
+	if (mapping.pPlatformHandle != nullptr)
+		CloseHandle((HANDLE)mapping.pPlatformHandle);
+	mapping = FMappedFile();
+}
 
 #if 0
 std::string g_BrowserURL;
@@ -14,16 +14,11 @@ std::string GenerateAddressLabelString(FCodeAnalysisState& state, FAddressRef ad
 	const char* pLabelString = nullptr;
 	std::string labelStr;
 
-	for (int addrVal = addr.Address; addrVal >= 0; addrVal--)
+	FLabelSearchResult label;
+	if (FindLabelBeforeAddress(state, addr, ELabelRangeType::Any, label))
 	{
-		FLabelInfo* pLabelInfo = state.GetLabelForAddress(addrVal);
-		if (pLabelInfo != nullptr)
-		{
-			labelStr = "[" + pLabelInfo->Name;
-			break;
-		}
-
-		labelOffset++;
+		labelStr = "[" + label.pLabel->Name;
+		labelOffset = label.Offset;
 	}
 
 	if (labelStr.empty() == false)
@@ -151,7 +151,7 @@ void LoadLabelsBin(FCodeAnalysisState& state, FILE* fp, int versionNo, uint16_t
 
 	for (int i = 0; i < recordCount; i++)
 	{
-		FLabelInfo* pLabel = FLabelInfo::Allocate();
+		FLabelInfo* pLabel = FLabelInfo::Allocate(state);
 
 		std::string enumVal;
 		ReadStringFromFile(enumVal, fp);
@@ -227,7 +227,7 @@ void LoadCodeInfoBin(FCodeAnalysisState& state, FILE* fp, int versionNo, uint16_
 
 	for (int i = 0; i < recordCount; i++)
 	{
-		FCodeInfo* pCodeInfo = FCodeInfo::Allocate();
+		FCodeInfo* pCodeInfo = FCodeInfo::Allocate(state);
 
 		if (versionNo > 8)
 			fread(&pCodeInfo->OperandType, sizeof(pCodeInfo->OperandType), 1, fp);
@@ -293,7 +293,7 @@ void SaveDataInfoBin(const FCodeAnalysisState& state, FILE* fp, uint16_t startAd
 			int noReads = 0;
 			const long noReadsFilePos = ftell(fp);
 			fwrite(&noReads, sizeof(int), 1, fp);
-			for (const auto& ref : pDataInfo->Reads.GetReferences())
+			for (const auto& ref : state.GetReadsForAddress((uint16_t)i).GetReferences())
 			{
 				const uint16_t refAddr = ref.Address;
 				if (refAddr >= startAddress && refAddr <= endAddress)
@@ -312,7 +312,7 @@ void SaveDataInfoBin(const FCodeAnalysisState& state, FILE* fp, uint16_t startAd
 			int noWrites = 0;
 			const long noWritesFilePos = ftell(fp);
 			fwrite(&noWrites, sizeof(int), 1, fp);
-			for (const auto& ref : pDataInfo->Writes.GetReferences())
+			for (const auto& ref : state.GetWritesForAddress((uint16_t)i).GetReferences())
 			{
 				const uint16_t refAddr = ref.Address;
 				if (refAddr >= startAddress && refAddr <= endAddress)
@@ -390,7 +390,7 @@ void LoadDataInfoBin(FCodeAnalysisState& state, FILE* fp, int versionNo, uint16_
 				uint16_t dataAddr;
 				fread(&dataAddr, sizeof(uint16_t), 1, fp);
 				if (dataAddr >= startAddress && dataAddr <= endAddress)
-					pDataInfo->Reads.RegisterAccess(state.AddressRefFromPhysicalAddress(dataAddr));
+					state.GetReadPage(address)->GetOrCreateReads(address & FCodeAnalysisPage::kPageMask).RegisterAccess(state.AddressRefFromPhysicalAddress(dataAddr));
 				else
 					LOGWARNING("LoadDataInfoBin: Address %x outside of range", dataAddr);
 			}
@@ -404,7 +404,7 @@ void LoadDataInfoBin(FCodeAnalysisState& state, FILE* fp, int versionNo, uint16_
 				uint16_t dataAddr;
 				fread(&dataAddr, sizeof(uint16_t), 1, fp);
 				if (dataAddr >= startAddress && dataAddr <= endAddress)
-					pDataInfo->Writes.RegisterAccess(state.AddressRefFromPhysicalAddress(dataAddr));
+					state.GetWritePage(address)->GetOrCreateWrites(address & FCodeAnalysisPage::kPageMask).RegisterAccess(state.AddressRefFromPhysicalAddress(dataAddr));
 				else
 					LOGWARNING("LoadDataInfoBin: Address %x outside of range", dataAddr);
 			}
@@ -446,7 +446,7 @@ void LoadCommentBlocksBin(FCodeAnalysisState& state, FILE* fp, int versionNo, ui
 
 	for (int i = 0; i < recordCount; i++)
 	{
-		FCommentBlock* pCommentBlock = FCommentBlock::Allocate();
+		FCommentBlock* pCommentBlock = FCommentBlock::Allocate(state);
 		uint16_t address;
 		fread(&address, sizeof(address), 1, fp);
 		ReadStringFromFile(pCommentBlock->Comment, fp);
@@ -505,9 +505,9 @@ void SaveGameDataBin(const FCodeAnalysisState& state, FILE *fp, uint16_t addrSta
 		const long noCharSetsPos = ftell(fp);
 		fwrite(&noCharSets, sizeof(noCharSets), 1, fp);
 
-		for (int i = 0; i < GetNoCharacterSets(); i++)
+		for (int i = 0; i < GetNoCharacterSets(state); i++)
 		{
-			const FCharacterSet* pCharSet = GetCharacterSetFromIndex(i);
+			const FCharacterSet* pCharSet = GetCharacterSetFromIndex(state, i);
 			const uint16_t addr = pCharSet->Params.Address.Address;
 			if (addr >= addrStart && addr <= addrEnd)
 			{
@@ -533,9 +533,9 @@ void SaveGameDataBin(const FCodeAnalysisState& state, FILE *fp, uint16_t addrSta
 		const long noCharMapsPos = ftell(fp);
 		fwrite(&noCharMaps, sizeof(noCharMaps), 1, fp);
 
-		for (int i = 0; i < GetNoCharacterMaps(); i++)
+		for (int i = 0; i < GetNoCharacterMaps(state); i++)
 		{
-			const FCharacterMap* pCharMap = GetCharacterMapFromIndex(i);
+			const FCharacterMap* pCharMap = GetCharacterMapFromIndex(state, i);
 			const uint16_t addr = pCharMap->Params.Address.Address;
 			if (addr >= addrStart && addr <= addrEnd)
 			{
@@ -650,8 +650,6 @@ void LoadGameDataBin(FCodeAnalysisState& state, FILE *fp, int versionNo, uint16_
 const uint32_t kMachineStateMagic = 0xFaceCafe;
 const uint32_t kMachineStateVersion = 4;
 
-static zx_t g_SaveSlot;
-
 void SaveMachineState(FSpectrumEmu* pSpectrumEmu, FILE *fp)
 {
 	FCodeAnalysisState& state = pSpectrumEmu->CodeAnalysis;
@@ -689,7 +687,8 @@ void SaveMachineState(FSpectrumEmu* pSpectrumEmu, FILE *fp)
 	fwrite(&kMachineStateVersion, sizeof(kMachineStateVersion), 1, fp);
 
 	// just save the whole thing out
-	zx_t& dst =  g_SaveSlot;
+	zx_t* pSaveSlot = new zx_t;	// too big for the stack
+	zx_t& dst = *pSaveSlot;
 	dst = pSpectrumEmu->ZXEmuState;	// copy to save slot
 	chips_debug_snapshot_onsave(&dst.debug);
 	chips_audio_callback_snapshot_onsave(&dst.audio.callback);
@@ -697,6 +696,7 @@ void SaveMachineState(FSpectrumEmu* pSpectrumEmu, FILE *fp)
 	mem_snapshot_onsave(&dst.mem, &pSpectrumEmu->ZXEmuState);
 
 	fwrite(&dst, sizeof(zx_t), 1, fp);
+	delete pSaveSlot;
 	return;
 }
 
@@ -716,7 +716,8 @@ bool LoadMachineState(FSpectrumEmu* pSpectrumEmu, FILE* fp)
 
 	// load the entire state
 	zx_t* sys = &pSpectrumEmu->ZXEmuState;
-	zx_t& im = g_SaveSlot;
+	zx_t* pSaveSlot = new zx_t;	// too big for the stack
+	zx_t& im = *pSaveSlot;
 
 	fread(&im, sizeof(zx_t), 1, fp);	// load into save slot
 
@@ -726,6 +727,7 @@ bool LoadMachineState(FSpectrumEmu* pSpectrumEmu, FILE* fp)
 	ay38910_snapshot_onload(&im.ay, &sys->ay);
 	mem_snapshot_onload(&im.mem, sys);
 	*sys = im;	// copy across new state
+	delete pSaveSlot;
 
 	// Set code analysis banks
 	if (sys->type == ZX_TYPE_128)
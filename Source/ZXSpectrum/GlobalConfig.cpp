@@ -33,6 +33,8 @@ bool LoadGlobalConfig(const char* fileName)
 	config.bShowScanLineIndicator = jsonConfigFile["ShowScanlineIndicator"];
 	if(jsonConfigFile.contains("ShowOpcodeValues"))
 		config.bShowOpcodeValues = jsonConfigFile["ShowOpcodeValues"];
+	if (jsonConfigFile.contains("InstructionLevelAnalysis"))
+		config.bInstructionLevelAnalysis = jsonConfigFile["InstructionLevelAnalysis"];
 	config.LastGame = jsonConfigFile["LastGame"];
 	config.NumberDisplayMode = (ENumberDisplayMode)jsonConfigFile["NumberMode"];
 	if (jsonConfigFile.contains("BranchLinesDisplayMode"))
@@ -75,6 +77,7 @@ bool SaveGlobalConfig(const char* fileName)
 	jsonConfigFile["EnableAudio"] = config.bEnableAudio;
 	jsonConfigFile["ShowScanlineIndicator"] = config.bShowScanLineIndicator;
 	jsonConfigFile["ShowOpcodeValues"] = config.bShowOpcodeValues;
+	jsonConfigFile["InstructionLevelAnalysis"] = config.bInstructionLevelAnalysis;
 	jsonConfigFile["LastGame"] = config.LastGame;
 	jsonConfigFile["NumberMode"] = (int)config.NumberDisplayMode;
 	jsonConfigFile["BranchLinesDisplayMode"] = config.BranchLinesDisplayMode;
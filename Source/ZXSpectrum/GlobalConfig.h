@@ -8,6 +8,7 @@ struct FGlobalConfig
 	bool				bEnableAudio;
 	bool				bShowScanLineIndicator = false;
 	bool				bShowOpcodeValues = false;
+	bool				bInstructionLevelAnalysis = false;	// analyse per instruction instead of per tick
 	ENumberDisplayMode	NumberDisplayMode = ENumberDisplayMode::HexAitch;
 	int					BranchLinesDisplayMode = 1;
 	std::string			LastGame;
@@ -0,0 +1,536 @@
+// Headless batch analyser
+// Loads a snapshot or RZX, runs the emulator & code analysis flat out for a number of frames
+// then exports the analysis json and timing stats. No window or graphics API is created.
+// Given a directory it runs every game in it, spread over a number of worker threads.
+// With -threadscaling the directory is run again for each power of two number of threads up to -threads
+// and the throughput for each is reported.
+//
+// With -benchmark the snapshot is reloaded and the frames are run a second time with analysis switched off
+// to compare emulated MHz.
+//
+// -instructionlevel runs the analysis per instruction rather than per tick.
+//
+// -compactjson exports the analysis without indentation.
+//
+// Usage: SpectrumAnalyserHeadless [-128] (-snapshot <file> | -rzx <file>) [-frames <n>] [-benchmark] [-instructionlevel] [-compactjson] [-out <json file>] [-stats <json file>]
+//        SpectrumAnalyserHeadless [-128] -dir <games dir> [-threads <n>] [-threadscaling] [-frames <n>] [-outdir <dir>] [-stats <json file>]
+
+#include "imgui.h"
+#include <implot.h>
+
+#include "../SpectrumEmu.h"
+#include "../GameConfig.h"
+#include "../GlobalConfig.h"
+#include "CodeAnalyser/CodeAnalysisJson.h"
+#include "Debug/DebugLog.h"
+#include "Util/FileUtil.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <json.hpp>
+
+#define SOKOL_IMPL
+#include <sokol_audio.h>	// audio is never set up, but the emulator pushes samples to it
+
+using json = nlohmann::json;
+
+struct FHeadlessConfig
+{
+	bool			ParseCommandline(int argc, char** argv);
+
+	ESpectrumModel	Model = ESpectrumModel::Spectrum48K;
+	std::string		SnapshotFile;
+	std::string		RZXFile;
+	std::string		GamesDir;
+	int				NoFrames = 50 * 60;	// a minute of emulated time
+	int				NoThreads = 0;		// 0 = one per hardware thread
+	bool			bThreadScaling = false;
+	bool			bBenchmark = false;
+	bool			bInstructionLevelAnalysis = false;
+	bool			bCompactJson = false;
+	std::string		OutputJsonFile;
+	std::string		OutputDir;
+	std::string		StatsJsonFile;
+};
+
+// a single game to run
+struct FHeadlessJob
+{
+	FGameSnapshot	Snapshot;
+	std::string		OutputJsonFile;
+};
+
+struct FHeadlessStats
+{
+	std::string	Game;
+	bool	bLoaded = false;
+	bool	bExported = false;
+	int		FramesRun = 0;
+	double	LoadSeconds = 0.0;
+	double	RunSeconds = 0.0;
+	double	ExportSeconds = 0.0;
+	double	MinFrameMS = 0.0;
+	double	MaxFrameMS = 0.0;
+	bool	bStoppedByDebugger = false;
+	uint32_t	TicksPerFrame = 0;
+
+	// benchmark run with analysis off
+	int		NoAnalysisFramesRun = 0;
+	double	NoAnalysisRunSeconds = 0.0;
+};
+
+// a Spectrum frame is 1/50th of a second
+static const uint32_t kFrameMicroSeconds = 20000;
+
+bool FHeadlessConfig::ParseCommandline(int argc, char** argv)
+{
+	for (int arg = 1; arg < argc; arg++)
+	{
+		const std::string argStr = argv[arg];
+		const bool bHasValue = arg + 1 < argc;
+
+		if (argStr == "-128")
+		{
+			Model = ESpectrumModel::Spectrum128K;
+		}
+		else if (argStr == "-snapshot" && bHasValue)
+		{
+			SnapshotFile = argv[++arg];
+		}
+		else if (argStr == "-rzx" && bHasValue)
+		{
+			RZXFile = argv[++arg];
+		}
+		else if (argStr == "-frames" && bHasValue)
+		{
+			NoFrames = atoi(argv[++arg]);
+		}
+		else if (argStr == "-dir" && bHasValue)
+		{
+			GamesDir = argv[++arg];
+			if (GamesDir.back() != '/' && GamesDir.back() != '\\')
+				GamesDir += '/';
+		}
+		else if (argStr == "-benchmark")
+		{
+			bBenchmark = true;
+		}
+		else if (argStr == "-instructionlevel")
+		{
+			bInstructionLevelAnalysis = true;
+		}
+		else if (argStr == "-compactjson")
+		{
+			bCompactJson = true;
+		}
+		else if (argStr == "-threads" && bHasValue)
+		{
+			NoThreads = atoi(argv[++arg]);
+		}
+		else if (argStr == "-threadscaling")
+		{
+			bThreadScaling = true;
+		}
+		else if (argStr == "-outdir" && bHasValue)
+		{
+			OutputDir = argv[++arg];
+			if (OutputDir.back() != '/' && OutputDir.back() != '\\')
+				OutputDir += '/';
+		}
+		else if (argStr == "-out" && bHasValue)
+		{
+			OutputJsonFile = argv[++arg];
+		}
+		else if (argStr == "-stats" && bHasValue)
+		{
+			StatsJsonFile = argv[++arg];
+		}
+		else
+		{
+			LOGERROR("Unknown or incomplete argument '%s'", argStr.c_str());
+			return false;
+		}
+	}
+
+	const int noSources = (SnapshotFile.empty() ? 0 : 1) + (RZXFile.empty() ? 0 : 1) + (GamesDir.empty() ? 0 : 1);
+	if (noSources != 1)
+	{
+		LOGERROR("Specify one of -snapshot, -rzx or -dir");
+		return false;
+	}
+
+	if (NoThreads <= 0)
+		NoThreads = std::max(1, (int)std::thread::hardware_concurrency());
+
+	return true;
+}
+
+// just the machine state - the analysis is left alone
+static bool LoadSnapshotHeadless(FSpectrumEmu* pEmu, const FGameSnapshot& snapshot)
+{
+	if (snapshot.Type == ESnapshotType::RZX)
+		return pEmu->RZXManager.Load(snapshot.FileName.c_str());
+	else
+		return pEmu->GamesList.LoadGame(snapshot.FileName.c_str());
+}
+
+static bool LoadGameHeadless(FSpectrumEmu* pEmu, const FGameSnapshot& snapshot)
+{
+	if (LoadSnapshotHeadless(pEmu, snapshot) == false)
+		return false;
+
+	FGameConfig* pGameConfig = CreateNewGameConfigFromSnapshot(snapshot);
+	if (pGameConfig == nullptr)
+		return false;
+
+	// don't pick up existing analysis from the workspace - we want a clean run
+	pEmu->StartGame(pGameConfig, /* bLoadGameData */ false);
+	pEmu->CodeAnalysis.AnalysisJobs.RunAll(pEmu->CodeAnalysis);	// finish the load time re-analysis before anything is timed
+	pEmu->CodeAnalysis.Debugger.Continue();
+	return true;
+}
+
+// millions of emulated CPU ticks per second of run time
+static double GetEmulatedMHz(const FHeadlessStats& stats, int framesRun, double runSeconds)
+{
+	return runSeconds > 0.0 ? ((double)framesRun * stats.TicksPerFrame) / (runSeconds * 1000000.0) : 0.0;
+}
+
+static json StatsToJson(const FHeadlessConfig& config, const FHeadlessStats& stats)
+{
+	const double emulatedSeconds = (stats.FramesRun * kFrameMicroSeconds) / 1000000.0;
+
+	json jsonStats;
+	jsonStats["Game"] = stats.Game;
+	jsonStats["Loaded"] = stats.bLoaded;
+	jsonStats["Exported"] = stats.bExported;
+	jsonStats["FramesRequested"] = config.NoFrames;
+	jsonStats["FramesRun"] = stats.FramesRun;
+	jsonStats["LoadSeconds"] = stats.LoadSeconds;
+	jsonStats["RunSeconds"] = stats.RunSeconds;
+	jsonStats["ExportSeconds"] = stats.ExportSeconds;
+	jsonStats["MinFrameMS"] = stats.MinFrameMS;
+	jsonStats["MaxFrameMS"] = stats.MaxFrameMS;
+	jsonStats["SpeedMultiplier"] = stats.RunSeconds > 0.0 ? emulatedSeconds / stats.RunSeconds : 0.0;
+	jsonStats["EmulatedMHz"] = GetEmulatedMHz(stats, stats.FramesRun, stats.RunSeconds);
+	jsonStats["StoppedByDebugger"] = stats.bStoppedByDebugger;
+	if (config.bBenchmark)
+	{
+		jsonStats["NoAnalysisFramesRun"] = stats.NoAnalysisFramesRun;
+		jsonStats["NoAnalysisRunSeconds"] = stats.NoAnalysisRunSeconds;
+		jsonStats["NoAnalysisEmulatedMHz"] = GetEmulatedMHz(stats, stats.NoAnalysisFramesRun, stats.NoAnalysisRunSeconds);
+	}
+	return jsonStats;
+}
+
+static bool WriteStatsJson(const std::string& fileName, const json& jsonStats)
+{
+	std::ofstream outFileStream(fileName);
+	if (outFileStream.is_open() == false)
+	{
+		LOGERROR("Could not write stats file '%s'", fileName.c_str());
+		return false;
+	}
+	outFileStream << std::setw(4) << jsonStats << std::endl;
+	return true;
+}
+
+static void PrintStats(const FHeadlessConfig& config, const FHeadlessStats& stats)
+{
+	const double emulatedSeconds = (stats.FramesRun * kFrameMicroSeconds) / 1000000.0;
+
+	printf("Frames run:        %d\n", stats.FramesRun);
+	printf("Load time:         %.3fs\n", stats.LoadSeconds);
+	printf("Run time:          %.3fs\n", stats.RunSeconds);
+	printf("Export time:       %.3fs\n", stats.ExportSeconds);
+	printf("Frame time:        %.3fms avg, %.3fms min, %.3fms max\n", stats.FramesRun ? (stats.RunSeconds * 1000.0) / stats.FramesRun : 0.0, stats.MinFrameMS, stats.MaxFrameMS);
+	printf("Speed:             %.2fx realtime\n", stats.RunSeconds > 0.0 ? emulatedSeconds / stats.RunSeconds : 0.0);
+	printf("Emulated MHz:      %.2f\n", GetEmulatedMHz(stats, stats.FramesRun, stats.RunSeconds));
+	if (config.bBenchmark)
+		printf("No analysis MHz:   %.2f (%d frames in %.3fs)\n", GetEmulatedMHz(stats, stats.NoAnalysisFramesRun, stats.NoAnalysisRunSeconds), stats.NoAnalysisFramesRun, stats.NoAnalysisRunSeconds);
+	if (stats.bStoppedByDebugger)
+		printf("Stopped early by debugger\n");
+}
+
+typedef std::chrono::high_resolution_clock FClock;
+
+// Init & game loading touch process wide state (global config, game configs, viewer registration)
+// so only one emulator instance does it at a time. Running frames & exporting is per instance.
+static std::mutex g_EmuSetupLock;
+
+// nothing is written back to the workspace, the global config & game data are left as they were
+static void ShutdownHeadless(FSpectrumEmu* pEmu)
+{
+	{
+		std::lock_guard<std::mutex> lock(g_EmuSetupLock);
+		pEmu->Shutdown(/* bSaveData */ false);
+	}
+	delete pEmu;
+}
+
+static bool RunJob(const FHeadlessConfig& config, const FHeadlessJob& job, FHeadlessStats& stats)
+{
+	stats.Game = job.Snapshot.FileName;
+
+	FSpectrumConfig spectrumConfig;
+	spectrumConfig.Model = config.Model;
+	spectrumConfig.SpecificGame = "ROM";	// to make it not load the last game
+
+	const auto loadStart = FClock::now();
+	FSpectrumEmu* pSpectrumEmu = new FSpectrumEmu;
+	{
+		std::lock_guard<std::mutex> lock(g_EmuSetupLock);
+		pSpectrumEmu->Init(spectrumConfig);
+		GetGlobalConfig().bInstructionLevelAnalysis = config.bInstructionLevelAnalysis;	// Init loads the global config
+		stats.bLoaded = LoadGameHeadless(pSpectrumEmu, job.Snapshot);
+	}
+	stats.LoadSeconds = std::chrono::duration<double>(FClock::now() - loadStart).count();
+
+	if (stats.bLoaded == false)
+	{
+		LOGERROR("Could not load '%s'", job.Snapshot.FileName.c_str());
+		ShutdownHeadless(pSpectrumEmu);
+		return false;
+	}
+
+	// run frames flat out
+	const auto runStart = FClock::now();
+	for (int frameNo = 0; frameNo < config.NoFrames; frameNo++)
+	{
+		if (pSpectrumEmu->CodeAnalysis.Debugger.IsStopped())
+		{
+			stats.bStoppedByDebugger = true;
+			break;
+		}
+
+		const auto frameStart = FClock::now();
+		pSpectrumEmu->TickEmulation(kFrameMicroSeconds);
+		const double frameMS = std::chrono::duration<double, std::milli>(FClock::now() - frameStart).count();
+
+		stats.MinFrameMS = stats.FramesRun == 0 ? frameMS : std::min(stats.MinFrameMS, frameMS);
+		stats.MaxFrameMS = std::max(stats.MaxFrameMS, frameMS);
+		stats.FramesRun++;
+	}
+	stats.RunSeconds = std::chrono::duration<double>(FClock::now() - runStart).count();
+	stats.TicksPerFrame = clk_us_to_ticks(pSpectrumEmu->ZXEmuState.freq_hz, kFrameMicroSeconds);
+
+	// run the same frames again from the snapshot without the analysis tick callback to see what it costs
+	// the analysis is exported afterwards but it won't have changed
+	if (config.bBenchmark)
+	{
+		{
+			std::lock_guard<std::mutex> lock(g_EmuSetupLock);
+			if (LoadSnapshotHeadless(pSpectrumEmu, job.Snapshot) == false)
+				LOGWARNING("Could not reload '%s' for the benchmark", job.Snapshot.FileName.c_str());
+		}
+
+		auto& debugCallback = pSpectrumEmu->ZXEmuState.debug.callback;
+		const auto analysisCallback = debugCallback.func;
+		debugCallback.func = nullptr;
+
+		const auto noAnalysisStart = FClock::now();
+		for (int frameNo = 0; frameNo < stats.FramesRun; frameNo++)
+			pSpectrumEmu->TickEmulation(kFrameMicroSeconds);
+		stats.NoAnalysisRunSeconds = std::chrono::duration<double>(FClock::now() - noAnalysisStart).count();
+		stats.NoAnalysisFramesRun = stats.FramesRun;
+
+		debugCallback.func = analysisCallback;
+	}
+
+	// export analysis
+	const auto exportStart = FClock::now();
+	stats.bExported = true;
+	if (job.OutputJsonFile.empty() == false)
+		stats.bExported = ExportAnalysisJson(pSpectrumEmu->CodeAnalysis, job.OutputJsonFile.c_str(), false, config.bCompactJson);
+	stats.ExportSeconds = std::chrono::duration<double>(FClock::now() - exportStart).count();
+
+	ShutdownHeadless(pSpectrumEmu);
+	return stats.bExported;
+}
+
+static int RunSingleGame(const FHeadlessConfig& config)
+{
+	FHeadlessJob job;
+	if (config.RZXFile.empty() == false)
+	{
+		job.Snapshot.FileName = config.RZXFile;
+		job.Snapshot.Type = ESnapshotType::RZX;
+	}
+	else
+	{
+		job.Snapshot.FileName = config.SnapshotFile;
+		job.Snapshot.Type = GetSnapshotTypeFromFileName(job.Snapshot.FileName);
+	}
+	job.Snapshot.DisplayName = GetFileFromPath(job.Snapshot.FileName.c_str());
+	job.OutputJsonFile = config.OutputJsonFile;
+
+	FHeadlessStats stats;
+	bool bSuccess = RunJob(config, job, stats);
+	if (stats.bLoaded == false)
+		return 1;
+
+	PrintStats(config, stats);
+	if (config.StatsJsonFile.empty() == false && WriteStatsJson(config.StatsJsonFile, StatsToJson(config, stats)) == false)
+		bSuccess = false;
+
+	return bSuccess ? 0 : 1;
+}
+
+// one run through all the games
+struct FGameFarmRun
+{
+	int		NoThreads = 0;
+	int		NoGames = 0;
+	int		NoFailed = 0;
+	int		TotalFrames = 0;
+	double	WallSeconds = 0.0;
+
+	double	GetGamesPerSecond() const { return WallSeconds > 0.0 ? NoGames / WallSeconds : 0.0; }
+	double	GetSpeedMultiplier() const { return WallSeconds > 0.0 ? (((double)TotalFrames * kFrameMicroSeconds) / 1000000.0) / WallSeconds : 0.0; }
+};
+
+static FGameFarmRun RunGamesOnThreads(const FHeadlessConfig& config, const std::vector<FHeadlessJob>& jobs, int noThreads, std::vector<FHeadlessStats>& jobStats)
+{
+	std::atomic<int> nextJob = 0;
+	std::atomic<int> noFailed = 0;
+
+	const auto farmStart = FClock::now();
+	std::vector<std::thread> workers;
+	for (int threadNo = 0; threadNo < noThreads; threadNo++)
+	{
+		workers.emplace_back([&]()
+		{
+			while (true)
+			{
+				const int jobNo = nextJob++;
+				if (jobNo >= (int)jobs.size())
+					break;
+
+				if (RunJob(config, jobs[jobNo], jobStats[jobNo]) == false)
+					noFailed++;
+			}
+		});
+	}
+
+	for (auto& worker : workers)
+		worker.join();
+
+	FGameFarmRun run;
+	run.NoThreads = noThreads;
+	run.NoGames = (int)jobs.size();
+	run.NoFailed = noFailed;
+	run.WallSeconds = std::chrono::duration<double>(FClock::now() - farmStart).count();
+	for (const FHeadlessStats& stats : jobStats)
+		run.TotalFrames += stats.FramesRun;
+	return run;
+}
+
+// run every game in a directory, spread across worker threads
+static int RunGameFarm(const FHeadlessConfig& config)
+{
+	FGamesList gamesList;
+	if (gamesList.EnumerateGames(config.GamesDir.c_str()) == false)
+	{
+		LOGERROR("Could not enumerate games in '%s'", config.GamesDir.c_str());
+		return 1;
+	}
+
+	std::vector<FHeadlessJob> jobs;
+	for (int gameNo = 0; gameNo < gamesList.GetNoGames(); gameNo++)
+	{
+		FHeadlessJob& job = jobs.emplace_back();
+		job.Snapshot = gamesList.GetGame(gameNo);
+		if (config.OutputDir.empty() == false)
+			job.OutputJsonFile = config.OutputDir + RemoveFileExtension(job.Snapshot.DisplayName.c_str()) + ".json";
+	}
+
+	const int maxThreads = std::min(config.NoThreads, std::max(1, (int)jobs.size()));
+	std::vector<int> threadCounts;
+	if (config.bThreadScaling)
+	{
+		for (int noThreads = 1; noThreads < maxThreads; noThreads *= 2)
+			threadCounts.push_back(noThreads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	// the stats for each game come from the last run
+	std::vector<FHeadlessStats> jobStats;
+	std::vector<FGameFarmRun> runs;
+	for (int noThreads : threadCounts)
+	{
+		printf("Running %d games on %d threads\n", (int)jobs.size(), noThreads);
+		jobStats.assign(jobs.size(), FHeadlessStats());
+		runs.push_back(RunGamesOnThreads(config, jobs, noThreads, jobStats));
+	}
+
+	const FGameFarmRun& lastRun = runs.back();
+	json jsonGames = json::array();
+	for (const FHeadlessStats& stats : jobStats)
+		jsonGames.push_back(StatsToJson(config, stats));
+
+	printf("Games run:         %d (%d failed)\n", (int)jobs.size(), lastRun.NoFailed);
+	for (const FGameFarmRun& run : runs)
+	{
+		printf("Threads:           %d\n", run.NoThreads);
+		printf("Wall time:         %.3fs\n", run.WallSeconds);
+		printf("Throughput:        %.2f games/s, %.2fx realtime", run.GetGamesPerSecond(), run.GetSpeedMultiplier());
+		if (runs.size() > 1)
+			printf(", %.2fx single thread", runs[0].GetGamesPerSecond() > 0.0 ? run.GetGamesPerSecond() / runs[0].GetGamesPerSecond() : 0.0);
+		printf("\n");
+	}
+
+	bool bSuccess = lastRun.NoFailed == 0;
+	if (config.StatsJsonFile.empty() == false)
+	{
+		json jsonStats;
+		jsonStats["Threads"] = lastRun.NoThreads;
+		jsonStats["WallSeconds"] = lastRun.WallSeconds;
+		jsonStats["GamesPerSecond"] = lastRun.GetGamesPerSecond();
+		if (config.bThreadScaling)
+		{
+			json jsonScaling = json::array();
+			for (const FGameFarmRun& run : runs)
+			{
+				json jsonRun;
+				jsonRun["Threads"] = run.NoThreads;
+				jsonRun["WallSeconds"] = run.WallSeconds;
+				jsonRun["GamesPerSecond"] = run.GetGamesPerSecond();
+				jsonRun["SpeedMultiplier"] = run.GetSpeedMultiplier();
+				jsonScaling.push_back(jsonRun);
+			}
+			jsonStats["ThreadScaling"] = jsonScaling;
+		}
+		jsonStats["Games"] = jsonGames;
+		if (WriteStatsJson(config.StatsJsonFile, jsonStats) == false)
+			bSuccess = false;
+	}
+
+	return bSuccess ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	FHeadlessConfig config;
+	if (config.ParseCommandline(argc, argv) == false)
+		return 1;
+
+	// ImGui context is needed by parts of initialisation but nothing is ever rendered
+	ImGui::CreateContext();
+	ImPlot::CreateContext();
+
+	const int result = config.GamesDir.empty() ? RunSingleGame(config) : RunGameFarm(config);
+
+	ImPlot::DestroyContext();
+	ImGui::DestroyContext();
+
+	return result;
+}
+
+// needed to get it compiling
+void SetWindowTitle(const char* pTitle) {}
+void SetWindowIcon(const char* pIconFile) {}
@@ -176,13 +176,17 @@ void FIOAnalysis::DrawUI()
 		ImGui::Text("Writes %d (frame %d)", ioAccess.WriteCount, ioAccess.FrameWriteCount);
 
 		ImGui::Text("Callers");
-		for (const auto &accessPC : ioAccess.Callers.GetReferences())
+		const auto& callers = ioAccess.Callers.GetReferences();
+		for (int callerNo = 0; callerNo < (int)callers.size(); callerNo++)
 		{
+			const FAddressRef& accessPC = callers[callerNo];
 			ImGui::PushID(accessPC.Val);
 			ShowCodeAccessorActivity(state, accessPC);
 			ImGui::Text("   ");
 			ImGui::SameLine();
 			DrawCodeAddress(state, viewState, accessPC);
+			ImGui::SameLine();
+			ImGui::Text(" - %u accesses", ioAccess.Callers.GetCount(callerNo));
 			ImGui::PopID();
 		}
 	}
@@ -181,12 +181,14 @@ void DrawMemoryHandlers(FSpectrumEmu* pSpectrumEmu)
 		ImGui::Text("Total Accesses %d", pSelectedHandler->TotalCount);
 
 		ImGui::Text("Callers");
-		for (const auto &accessPC : pSelectedHandler->Callers.GetReferences())
+		const auto& callers = pSelectedHandler->Callers.GetReferences();
+		for (int callerNo = 0; callerNo < (int)callers.size(); callerNo++)
 		{
+			const FAddressRef& accessPC = callers[callerNo];
 			ImGui::PushID(accessPC.Val);
 			DrawCodeAddress(pSpectrumEmu->CodeAnalysis, viewState, accessPC);
-			//ImGui::SameLine();
-			//ImGui::Text(" - %d accesses",accessPC.second);
+			ImGui::SameLine();
+			ImGui::Text(" - %u accesses", pSelectedHandler->Callers.GetCount(callerNo));
 			ImGui::PopID();
 		}
 	}
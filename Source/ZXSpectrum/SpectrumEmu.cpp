@@ -249,31 +249,123 @@ int UIEvalBreakpoint(ui_dbg_t* dbg_win, uint16_t pc, int ticks, uint64_t pins, v
 	return 0;
 }
 
+// IO access - called on the first tick of the access
+void FSpectrumEmu::Z80IOTick(FAddressRef pcAddrRef, const FCPUTickInfo& tick, uint16_t scanlinePos)
+{
+	FDebugger& debugger = CodeAnalysis.Debugger;
+	const uint64_t pins = tick.Pins;
+	const uint16_t pc = pcAddrRef.Address;
+	const uint8_t data = tick.Data;
+	const uint16_t addr = tick.Address;
+
+	IOAnalysis.IOHandler(pc, pins);
+
+	if (pins & Z80_RD)
+	{
+		if ((pins & Z80_A0) == 0)
+			debugger.RegisterEvent((uint8_t)EEventType::KeyboardRead, pcAddrRef, addr , data, scanlinePos);
+		else if ((pins & (Z80_A7 | Z80_A6 | Z80_A5)) == 0) // Kempston Joystick (........000.....)
+			debugger.RegisterEvent((uint8_t)EEventType::KempstonJoystickRead, pcAddrRef, addr, data, scanlinePos);
+		else if (pins & 0xff)
+			debugger.RegisterEvent((uint8_t)EEventType::FloatingBusRead, pcAddrRef, addr, data, scanlinePos);
+		// 128K specific
+		else if (ZXEmuState.type == ZX_TYPE_128)
+		{
+			if ((pins & (Z80_A15 | Z80_A14 | Z80_A1)) == (Z80_A15 | Z80_A14))
+				debugger.RegisterEvent((uint8_t)EEventType::SoundChipRead, pcAddrRef, addr, data, scanlinePos);
+		}
+	}
+	else if (pins & Z80_WR)
+	{
+		// an IO write
+
+		// handle bank switching on speccy 128
+		if ((pins & Z80_A0) == 0)
+		{
+			// Spectrum ULA (...............0)
+
+			// has border colour changed?
+			if ((data & 7) != (LastFE & 7))
+				debugger.RegisterEvent((uint8_t)EEventType::SetBorderColour, pcAddrRef, Z80_GET_ADDR(pins), data, scanlinePos);
+
+			// has beeper changed
+			if ((data & (1 << 4)) != (LastFE & (1 << 4)))
+				debugger.RegisterEvent((uint8_t)EEventType::OutputBeeper, pcAddrRef, Z80_GET_ADDR(pins), data, scanlinePos);
+
+			// has mic output changed
+			if ((data & (1 << 3)) != (LastFE & (1 << 3)))
+				debugger.RegisterEvent((uint8_t)EEventType::OutputMic, pcAddrRef, Z80_GET_ADDR(pins), data, scanlinePos);
+
+			LastFE = data;
+		}
+		else if (ZXEmuState.type == ZX_TYPE_128)
+		{
+			if ((pins & (Z80_A15 | Z80_A1)) == 0)
+			{
+				if (!ZXEmuState.memory_paging_disabled)
+				{
+					debugger.RegisterEvent((uint8_t)EEventType::SwitchMemoryBanks, pcAddrRef, Z80_GET_ADDR(pins), data, scanlinePos);
+
+					const int ramBank = data & 0x7;
+					const int romBank = (data & (1 << 4)) ? 1 : 0;
+					const int displayRamBank = (data & (1 << 3)) ? 7 : 5;
+
+					SetROMBank(romBank);
+					SetRAMBank(3, ramBank);
+				}
+			}
+			else if ((pins & (Z80_A15 | Z80_A14 | Z80_A1)) == (Z80_A15 | Z80_A14))	// select AY-3-8912 register (11............0.)
+				debugger.RegisterEvent((uint8_t)EEventType::SoundChipRegisterSelect, pcAddrRef, addr, data, scanlinePos);
+			else if ((pins & (Z80_A15 | Z80_A14 | Z80_A1)) == Z80_A15)	// write to AY-3-8912 (10............0.) 
+				debugger.RegisterEvent((uint8_t)EEventType::SoundChipRegisterWrite, pcAddrRef, addr, data, scanlinePos);
+		}
+
+	}
+}
+
 uint64_t FSpectrumEmu::Z80Tick(int num, uint64_t pins)
+{
+	// decode the pins once for both the analysis and the debugger
+	const FCPUTickInfo tick = CodeAnalysis.Debugger.DecodeTickPins(pins);
+	Z80AnalysisTick(tick, (uint16_t)ZXEmuState.scanline_y, 1);
+	return pins;
+}
+
+// replay the ticks recorded for an instruction through the same analysis as per tick mode
+void FSpectrumEmu::OnInstructionTicks(const ZXTickRecord* pRecords, int noRecords)
+{
+	for (int i = 0; i < noRecords; i++)
+	{
+		const ZXTickRecord& record = pRecords[i];
+		const FCPUTickInfo tick = FDebugger::DecodeZ80TickPins(record.Pins, record.PrevPins, record.Flags & ZX_TICKRECORD_OPDONE, record.Flags & ZX_TICKRECORD_IFF1);
+		Z80AnalysisTick(tick, record.ScanlineY, record.Ticks);
+	}
+}
+
+// noTicks is the number of emulated ticks this covers - for instruction level analysis some ticks aren't passed in
+void FSpectrumEmu::Z80AnalysisTick(const FCPUTickInfo& tick, uint16_t scanlinePos, int noTicks)
 {
 	FCodeAnalysisState &state = CodeAnalysis;
 	FDebugger& debugger = CodeAnalysis.Debugger;
 	z80_t& cpu = ZXEmuState.cpu;
-	const uint16_t pc = GetPC().Address;
-	static uint64_t lastTickPins = 0;
-	const uint64_t risingPins = pins & (pins ^ lastTickPins);
-	lastTickPins = pins;
-	const uint16_t scanlinePos = (uint16_t)ZXEmuState.scanline_y;
+	const uint64_t pins = tick.Pins;
 
-	if (scanlinePos == 0)	// clear scanline info on new frame
+	if (scanlinePos == 0 && LastScanlinePos != 0)	// clear scanline info on new frame
 		debugger.ResetScanlineEvents();
+	LastScanlinePos = scanlinePos;
 
-	/* memory and IO requests */
-	if (pins & Z80_MREQ) 
+	// most ticks are in the middle of a machine cycle so there is nothing to analyse
+	if (tick.bNewBusCycle)
 	{
-		/* a memory request machine cycle
-			FIXME: 'contended memory' accesses should inject wait states
-		*/
-		const uint16_t addr = Z80_GET_ADDR(pins);
-		const uint8_t value = Z80_GET_DATA(pins);
-		if (pins & Z80_RD)
+		const FAddressRef pcAddrRef = debugger.GetPC();
+		const uint16_t pc = pcAddrRef.Address;
+		const uint16_t addr = tick.Address;
+		const uint8_t value = tick.Data;
+
+		/* memory and IO requests */
+		if (tick.bMemRead)
 		{
-			if (risingPins & Z80_INT)	// check if in interrupt - could this be done in the shared code analysis?
+			if (tick.RisingPins & Z80_INT)	// check if in interrupt - could this be done in the shared code analysis?
 			{
 				// TODO: read is to fetch interrupt handler address
 				//LOGINFO("Interrupt Handler at: %x", value);
@@ -294,12 +386,10 @@ uint64_t FSpectrumEmu::Z80Tick(int num, uint64_t pins)
 					RegisterDataRead(state, pc, addr);
 			}
 		}
-		else if (pins & Z80_WR) 
+		else if (tick.bMemWrite)
 		{
 			if (state.bRegisterDataAccesses)
 				RegisterDataWrite(state, pc, addr, value);
-			const FAddressRef addrRef = state.AddressRefFromPhysicalAddress(addr);
-			const FAddressRef pcAddrRef = state.AddressRefFromPhysicalAddress(pc);
 			state.SetLastWriterForAddress(addr, pcAddrRef);
 			
 			if (addr >= kScreenPixMemStart && addr <= kScreenPixMemEnd)
@@ -311,97 +401,27 @@ uint64_t FSpectrumEmu::Z80Tick(int num, uint64_t pins)
 				debugger.RegisterEvent((uint8_t)EEventType::ScreenAttrWrite, pcAddrRef, addr, value, scanlinePos);
 			}
 		}
-	}
-
-	// Handle IO operations
-	if (pins & Z80_IORQ)
-	{
-		const FAddressRef pcAddrRef = state.AddressRefFromPhysicalAddress(pc);
-		const uint8_t data = Z80_GET_DATA(pins);
-		const uint16_t addr = Z80_GET_ADDR(pins);
-
-		IOAnalysis.IOHandler(pc, pins);
-
-		if (pins & Z80_RD)
+		else if (pins & Z80_IORQ)
 		{
-			if ((pins & Z80_A0) == 0)
-				debugger.RegisterEvent((uint8_t)EEventType::KeyboardRead, pcAddrRef, addr , data, scanlinePos);
-			else if ((pins & (Z80_A7 | Z80_A6 | Z80_A5)) == 0) // Kempston Joystick (........000.....)
-				debugger.RegisterEvent((uint8_t)EEventType::KempstonJoystickRead, pcAddrRef, addr, data, scanlinePos);
-			else if (pins & 0xff)
-				debugger.RegisterEvent((uint8_t)EEventType::FloatingBusRead, pcAddrRef, addr, data, scanlinePos);
-			// 128K specific
-			else if (ZXEmuState.type == ZX_TYPE_128)
-			{
-				if ((pins & (Z80_A15 | Z80_A14 | Z80_A1)) == (Z80_A15 | Z80_A14))
-					debugger.RegisterEvent((uint8_t)EEventType::SoundChipRead, pcAddrRef, addr, data, scanlinePos);
-			}
-		}
-		else if (pins & Z80_WR)
-		{
-			// an IO write
-
-			// handle bank switching on speccy 128
-			if ((pins & Z80_A0) == 0)
-			{
-				static uint8_t LastFE = 0;
-				// Spectrum ULA (...............0)
-
-				// has border colour changed?
-				if ((data & 7) != (LastFE & 7))
-					debugger.RegisterEvent((uint8_t)EEventType::SetBorderColour, pcAddrRef, Z80_GET_ADDR(pins), data, scanlinePos);
-
-				// has beeper changed
-				if ((data & (1 << 4)) != (LastFE & (1 << 4)))
-					debugger.RegisterEvent((uint8_t)EEventType::OutputBeeper, pcAddrRef, Z80_GET_ADDR(pins), data, scanlinePos);
-
-				// has mic output changed
-				if ((data & (1 << 3)) != (LastFE & (1 << 3)))
-					debugger.RegisterEvent((uint8_t)EEventType::OutputMic, pcAddrRef, Z80_GET_ADDR(pins), data, scanlinePos);
-
-				LastFE = data;
-			}
-			else if (ZXEmuState.type == ZX_TYPE_128)
-			{
-				if ((pins & (Z80_A15 | Z80_A1)) == 0)
-				{
-					if (!ZXEmuState.memory_paging_disabled)
-					{
-						debugger.RegisterEvent((uint8_t)EEventType::SwitchMemoryBanks, pcAddrRef, Z80_GET_ADDR(pins), data, scanlinePos);
-
-						const int ramBank = data & 0x7;
-						const int romBank = (data & (1 << 4)) ? 1 : 0;
-						const int displayRamBank = (data & (1 << 3)) ? 7 : 5;
-
-						SetROMBank(romBank);
-						SetRAMBank(3, ramBank);
-					}
-				}
-				else if ((pins & (Z80_A15 | Z80_A14 | Z80_A1)) == (Z80_A15 | Z80_A14))	// select AY-3-8912 register (11............0.)
-					debugger.RegisterEvent((uint8_t)EEventType::SoundChipRegisterSelect, pcAddrRef, addr, data, scanlinePos);
-				else if ((pins & (Z80_A15 | Z80_A14 | Z80_A1)) == Z80_A15)	// write to AY-3-8912 (10............0.) 
-					debugger.RegisterEvent((uint8_t)EEventType::SoundChipRegisterWrite, pcAddrRef, addr, data, scanlinePos);
-			}
-
+			Z80IOTick(pcAddrRef, tick, scanlinePos);
 		}
 	}
 
-	if (pins & Z80_INT)	// have we had a vblank interrupt?
-	{
-	}
-
-	InstructionsTicks++;
-
-	const bool bNewOp = z80_opdone(&ZXEmuState.cpu);
+	InstructionsTicks += noTicks;
 
-	if (bNewOp)
+	if (tick.bNewOp)
 	{
 		OnInstructionExecuted(InstructionsTicks, pins);
 		InstructionsTicks = 0;
 	}
 
-	debugger.CPUTick(pins);
-	return pins;
+	debugger.CPUTick(tick);
+}
+
+static void InstructionTicksCB(const ZXTickRecord* pRecords, int noRecords, void* pUserData)
+{
+	FSpectrumEmu* pEmu = (FSpectrumEmu*)pUserData;
+	pEmu->OnInstructionTicks(pRecords, noRecords);
 }
 
 static uint64_t Z80TickThunk(int num, uint64_t pins, void* user_data)
@@ -435,6 +455,7 @@ void FSpectrumEmu::SetRAMBank(int slot, int bankNo)
 	const int startPage = slot * kNoBankPages;
 	CodeAnalysis.UnMapBank(CurRAMBank[slot], startPage);
 	CodeAnalysis.MapBank(bankId, startPage);
+	CodeAnalysis.LoadBankAnalysis(*CodeAnalysis.GetBank(bankId));	// first time it's been mapped in?
 
 	CurRAMBank[slot] = bankId;
 }
@@ -565,6 +586,7 @@ bool FSpectrumEmu::Init(const FSpectrumConfig& config)
 	CodeAnalysis.Config.BranchLinesDisplayMode = globalConfig.BranchLinesDisplayMode;
 	CodeAnalysis.Config.bShowBanks = config.Model == ESpectrumModel::Spectrum128K;
 	CodeAnalysis.Config.CharacterColourLUT = FZXGraphicsView::GetColourLUT();
+	CodeAnalysis.pAnalysisDatabase = &AnalysisDatabase;
 	
 	// setup emu
 	zx_type_t type = config.Model == ESpectrumModel::Spectrum128K ? ZX_TYPE_128 : ZX_TYPE_48K;
@@ -658,8 +680,10 @@ bool FSpectrumEmu::Init(const FSpectrumConfig& config)
 	CodeAnalysis.ViewState[0].Enabled = true;	// always have first view enabled
 
 	// Setup memory description handlers
-	AddMemoryRegionDescGenerator(new FScreenPixMemDescGenerator());
-	AddMemoryRegionDescGenerator(new FScreenAttrMemDescGenerator());	
+	MemoryRegionDescGenerators.push_back(new FScreenPixMemDescGenerator());
+	MemoryRegionDescGenerators.push_back(new FScreenAttrMemDescGenerator());
+	for (FMemoryRegionDescGenerator* pGen : MemoryRegionDescGenerators)
+		AddMemoryRegionDescGenerator(pGen);
 
 	// register Viewers
 	RegisterStarquakeViewer(this);
@@ -733,7 +757,7 @@ bool FSpectrumEmu::Init(const FSpectrumConfig& config)
 		CodeAnalysis.Init(this);
 
 		if (FileExists(romJsonFName.c_str()))
-			ImportAnalysisJson(CodeAnalysis, romJsonFName.c_str());
+			ImportSharedAnalysisJson(CodeAnalysis, romJsonFName.c_str());
 	}
 
 	if(config.SkoolkitImport.empty() == false)
@@ -761,22 +785,50 @@ bool FSpectrumEmu::Init(const FSpectrumConfig& config)
 	return true;
 }
 
-void FSpectrumEmu::Shutdown()
+void FSpectrumEmu::Shutdown(bool bSaveData /* = true */)
 {
-	if (RZXManager.GetReplayMode() == EReplayMode::Off)
-		SaveCurrentGameData();	// save on close
+	if (bSaveData)
+	{
+		if (RZXManager.GetReplayMode() == EReplayMode::Off)
+			SaveCurrentGameData();	// save on close
 
-	// Save Global Config - move to function?
-	FGlobalConfig& config = GetGlobalConfig();
+		// Save Global Config - move to function?
+		FGlobalConfig& config = GetGlobalConfig();
 
-	if (pActiveGame != nullptr)
-		config.LastGame = pActiveGame->pConfig->Name;
+		if (pActiveGame != nullptr)
+			config.LastGame = pActiveGame->pConfig->Name;
+
+		config.NumberDisplayMode = GetNumberDisplayMode();
+		config.bShowOpcodeValues = CodeAnalysis.Config.bShowOpcodeValues;
+		config.BranchLinesDisplayMode = CodeAnalysis.Config.BranchLinesDisplayMode;
 
-	config.NumberDisplayMode = GetNumberDisplayMode();
-	config.bShowOpcodeValues = CodeAnalysis.Config.bShowOpcodeValues;
-	config.BranchLinesDisplayMode = CodeAnalysis.Config.BranchLinesDisplayMode;
+		SaveGlobalConfig(kGlobalConfigFilename);
+	}
+
+	// free what Init & StartGame set up, the analysis state frees its own
+	AnalysisDatabase.Close();
+	FrameTraceViewer.Shutdown();
+	SpectrumViewer.Shutdown();
+	ShutdownGraphicsViewer(GraphicsViewer);
+
+	for (FViewerBase* pViewer : Viewers)
+		delete pViewer;
+	Viewers.clear();
+
+	for (FMemoryRegionDescGenerator* pGen : MemoryRegionDescGenerators)
+	{
+		RemoveMemoryRegionDescGenerator(pGen);
+		delete pGen;
+	}
+	MemoryRegionDescGenerators.clear();
+
+	if (pActiveGame != nullptr)
+		delete pActiveGame->pViewerData;
+	delete pActiveGame;
+	pActiveGame = nullptr;
+	GraphicsViewer.pGame = nullptr;
 
-	SaveGlobalConfig(kGlobalConfigFilename);
+	ui_zx_discard(&UIZX);
 }
 
 void FSpectrumEmu::StartGame(FGameConfig *pGameConfig, bool bLoadGameData /* =  true*/)
@@ -785,6 +837,7 @@ void FSpectrumEmu::StartGame(FGameConfig *pGameConfig, bool bLoadGameData /* =
 	MemoryAccessHandlers.clear();	// remove old memory handlers
 	ResetMemoryStats(MemStats);
 	FrameTraceViewer.Reset();
+	AnalysisDatabase.Close();
 
 	const std::string windowTitle = kAppTitle + " - " + pGameConfig->Name;
 	SetWindowTitle(windowTitle.c_str());
@@ -826,9 +879,23 @@ void FSpectrumEmu::StartGame(FGameConfig *pGameConfig, bool bLoadGameData /* =
 			romJsonFName = root + kRomInfo128JsonFile;
 
 		const std::string analysisJsonFName = root + "AnalysisJson/" + pGameConfig->Name + ".json";
+		const std::string analysisDatabaseFName = root + "AnalysisDatabase/" + pGameConfig->Name + ".adb";
 		const std::string analysisStateFName = root + "AnalysisState/" + pGameConfig->Name + ".astate";
 		const std::string saveStateFName = root + "SaveStates/" + pGameConfig->Name + ".state";
-		if (FileExists(analysisJsonFName.c_str()))
+		// analysis is saved to the database now, the json is only written by 'Export Analysis Json'
+		// a json that's newer than the database has been exported or edited since so it's used instead, the next save replaces the database
+		const bool bJsonIsNewer = IsFileNewer(analysisJsonFName.c_str(), analysisDatabaseFName.c_str());
+		if (bJsonIsNewer)
+		{
+			LOGINFO("'%s' is newer than the analysis database, importing it instead", analysisJsonFName.c_str());
+			AnalysisDatabase.Close();
+		}
+
+		if (bJsonIsNewer == false && FileExists(analysisDatabaseFName.c_str()) && AnalysisDatabase.Open(CodeAnalysis, analysisDatabaseFName.c_str()))
+		{
+			ImportAnalysisState(CodeAnalysis, analysisStateFName.c_str());	// pages that haven't been read in yet get their state when they are
+		}
+		else if (FileExists(analysisJsonFName.c_str()))
 		{
 			ImportAnalysisJson(CodeAnalysis, analysisJsonFName.c_str());
 			ImportAnalysisState(CodeAnalysis, analysisStateFName.c_str());
@@ -839,15 +906,24 @@ void FSpectrumEmu::StartGame(FGameConfig *pGameConfig, bool bLoadGameData /* =
 		LoadGameState(this, saveStateFName.c_str());
 
 		if (FileExists(romJsonFName.c_str()))
-			ImportAnalysisJson(CodeAnalysis, romJsonFName.c_str());
+			ImportSharedAnalysisJson(CodeAnalysis, romJsonFName.c_str());
 
 		// where do we want pokes to live?
 		LoadPOKFile(*pGameConfig, std::string(GetGlobalConfig().PokesFolder + pGameConfig->Name + ".pok").c_str());
 	}
-	ReAnalyseCode(CodeAnalysis);
 	GenerateGlobalInfo(CodeAnalysis);
 	FormatSpectrumMemory(CodeAnalysis);
 	CodeAnalysis.SetAddressRangeDirty();
+	AnalysisDatabase.ClearChangedPages(CodeAnalysis);	// fix ups above don't need saving
+
+	// code fix ups are done a slice at a time between frames
+	std::unique_ptr<FReAnalyseCodeJob> pReAnalyseJob = std::make_unique<FReAnalyseCodeJob>(/* bFixUpsAreSaved */ true);
+	pReAnalyseJob->OnFinished = [](FCodeAnalysisState& state)
+	{
+		GenerateGlobalInfo(state);
+		state.SetAddressRangeDirty();
+	};
+	CodeAnalysis.AnalysisJobs.AddJob(std::move(pReAnalyseJob));
 
 	// Start in break mode so the memory will be in it's initial state. 
 	// Otherwise, if we export a skool/asm file once the game is running the memory could be in an arbitrary state.
@@ -894,12 +970,12 @@ void FSpectrumEmu::SaveCurrentGameData()
 			const std::string root = GetGlobalConfig().WorkspaceRoot;
 			const std::string configFName = root + "Configs/" + pGameConfig->Name + ".json";
 			const std::string dataFName = root + "GameData/" + pGameConfig->Name + ".bin";
-			const std::string analysisJsonFName = root + "AnalysisJson/" + pGameConfig->Name + ".json";
+			const std::string analysisDatabaseFName = root + "AnalysisDatabase/" + pGameConfig->Name + ".adb";
 			const std::string analysisStateFName = root + "AnalysisState/" + pGameConfig->Name + ".astate";
 			const std::string saveStateFName = root + "SaveStates/" + pGameConfig->Name + ".state";
 			EnsureDirectoryExists(std::string(root + "Configs").c_str());
 			EnsureDirectoryExists(std::string(root + "GameData").c_str());
-			EnsureDirectoryExists(std::string(root + "AnalysisJson").c_str());
+			EnsureDirectoryExists(std::string(root + "AnalysisDatabase").c_str());
 			EnsureDirectoryExists(std::string(root + "AnalysisState").c_str());
 			EnsureDirectoryExists(std::string(root + "SaveStates").c_str());
 
@@ -919,7 +995,7 @@ void FSpectrumEmu::SaveCurrentGameData()
 
 			// The Future
 			SaveGameState(this, saveStateFName.c_str());
-			ExportAnalysisJson(CodeAnalysis, analysisJsonFName.c_str());
+			AnalysisDatabase.Save(CodeAnalysis, analysisDatabaseFName.c_str());	// only writes pages that have changed
 			ExportAnalysisState(CodeAnalysis, analysisStateFName.c_str());
 		}
 	}
@@ -1084,6 +1160,14 @@ void FSpectrumEmu::DrawMainMenu(double timeMS)
 				}
 			}
 
+			if (pActiveGame != nullptr && ImGui::MenuItem("Export Analysis Json"))
+			{
+				const std::string dir = GetGlobalConfig().WorkspaceRoot + "AnalysisJson/";
+				EnsureDirectoryExists(dir.c_str());
+				AnalysisDatabase.LoadAllBanks(CodeAnalysis);	// banks that haven't been mapped in yet
+				ExportAnalysisJson(CodeAnalysis, std::string(dir + pActiveGame->pConfig->Name + ".json").c_str());
+			}
+
 			if (ImGui::MenuItem("Export ASM File"))
 			{
 				// ImGui popup windows can't be activated from within a Menu so we set a flag to act on outside of the menu code.
@@ -1223,6 +1307,7 @@ void FSpectrumEmu::DrawMainMenu(double timeMS)
 			}
 			ImGui::MenuItem("Scan Line Indicator", 0, &config.bShowScanLineIndicator);
 			ImGui::MenuItem("Enable Audio", 0, &config.bEnableAudio);
+			ImGui::MenuItem("Instruction Level Analysis", 0, &config.bInstructionLevelAnalysis);
 			ImGui::MenuItem("Edit Mode", 0, &CodeAnalysis.bAllowEditing);
 			ImGui::MenuItem("Show Opcode Values", 0, &CodeAnalysis.Config.bShowOpcodeValues);
 
@@ -1491,81 +1576,117 @@ void FSpectrumEmu::Tick()
 
 	if (debugger.IsStopped() == false)
 	{
-		const float frameTime = std::min(1000000.0f / ImGui::GetIO().Framerate, 32000.0f) * ExecSpeedScale;
-		//const float frameTime = min(1000000.0f / 50, 32000.0f) * ExecSpeedScale;
-		const uint32_t microSeconds = std::max(static_cast<uint32_t>(frameTime), uint32_t(1));
+		// run whole emulated frames at a fixed rate - a slow UI frame means more emulated frames next time
+		EmuScheduler.SetFrameTime(GetFrameMicroSeconds());
+		EmuScheduler.SetSpeedScale(ExecSpeedScale);
+		EmuScheduler.BeginUpdate();
+		while (debugger.IsStopped() == false && EmuScheduler.ShouldRunFrame())
+			TickEmulation(EmuScheduler.GetFrameTime());
+	}
+	else
+	{
+		EmuScheduler.Reset();	// don't try to catch up on the time spent stopped
+	}
+
+	// carry on with any long analysis passes between frames
+	CodeAnalysis.AnalysisJobs.Update(CodeAnalysis);
+
+	// hand the latest state over to the UI
+	const chips_display_info_t disp = zx_display_info(&ZXEmuState);
+	AnalysisSnapshots.Publish(CodeAnalysis, (const uint8_t*)disp.frame.buffer.ptr, disp.frame.buffer.size);
+
+	UpdateCharacterSets(CodeAnalysis);
 
-		CodeAnalysis.OnFrameStart();
-		StoreRegisters_Z80(CodeAnalysis);
+	// Draw UI
+	pUISnapshot = AnalysisSnapshots.Acquire();
+	DrawDockingView();
+	AnalysisSnapshots.Release();
+	pUISnapshot = nullptr;
+}
+
+uint32_t FSpectrumEmu::GetFrameMicroSeconds() const
+{
+	const uint64_t frameTicks = (uint64_t)ZXEmuState.frame_scan_lines * ZXEmuState.scanline_period;
+	return (uint32_t)((frameTicks * 1000000) / ZXEmuState.freq_hz);
+}
+
+// Run the emulator & analysis for the given time - doesn't touch the UI so can be used headless
+void FSpectrumEmu::TickEmulation(uint32_t microSeconds)
+{
+	CodeAnalysis.OnFrameStart();
+	StoreRegisters_Z80(CodeAnalysis);
 #if ENABLE_CAPTURES
-		const uint32_t ticks_to_run = clk_ticks_to_run(&ZXEmuState.clk, microSeconds);
-		uint32_t ticks_executed = 0;
-		while (UIZX.dbg.dbg.z80->trap_id != kCaptureTrapId && ticks_executed < ticks_to_run)
-		{
-			ticks_executed += z80_exec(&ZXEmuState.cpu, ticks_to_run - ticks_executed);
+	const uint32_t ticks_to_run = clk_ticks_to_run(&ZXEmuState.clk, microSeconds);
+	uint32_t ticks_executed = 0;
+	while (UIZX.dbg.dbg.z80->trap_id != kCaptureTrapId && ticks_executed < ticks_to_run)
+	{
+		ticks_executed += z80_exec(&ZXEmuState.cpu, ticks_to_run - ticks_executed);
 
-			if (UIZX.dbg.dbg.z80->trap_id == kCaptureTrapId)
+		if (UIZX.dbg.dbg.z80->trap_id == kCaptureTrapId)
+		{
+			const uint16_t PC = GetPC();
+			FMachineState* pMachineState = CodeAnalysis.GetMachineState(PC);
+			if (pMachineState == nullptr)
 			{
-				const uint16_t PC = GetPC();
-				FMachineState* pMachineState = CodeAnalysis.GetMachineState(PC);
-				if (pMachineState == nullptr)
-				{
-					pMachineState = AllocateMachineState(CodeAnalysis);
-					CodeAnalysis.SetMachineStateForAddress(PC, pMachineState);
-				}
-
-				CaptureMachineState(pMachineState, this);
-				UIZX.dbg.dbg.z80->trap_id = 0;
-				_ui_dbg_continue(&UIZX.dbg);
+				pMachineState = AllocateMachineState(CodeAnalysis);
+				CodeAnalysis.SetMachineStateForAddress(PC, pMachineState);
 			}
+
+			CaptureMachineState(pMachineState, this);
+			UIZX.dbg.dbg.z80->trap_id = 0;
+			_ui_dbg_continue(&UIZX.dbg);
 		}
-		clk_ticks_executed(&ZXEmuState.clk, ticks_executed);
-		kbd_update(&ZXEmuState.kbd);
+	}
+	clk_ticks_executed(&ZXEmuState.clk, ticks_executed);
+	kbd_update(&ZXEmuState.kbd);
 #else
-		if (RZXManager.GetReplayMode() == EReplayMode::Playback)
-		{
-			if (RZXFetchesRemaining <= 0)
-				RZXFetchesRemaining += RZXManager.Update();
-			const uint32_t fetchesProcessed = ZXExeEmu_UseFetchCount(&ZXEmuState, RZXFetchesRemaining, GetIOInputFunc, this);
-			RZXFetchesRemaining -= fetchesProcessed;
-		}
+	if (RZXManager.GetReplayMode() == EReplayMode::Playback)
+	{
+		if (RZXFetchesRemaining <= 0)
+			RZXFetchesRemaining += RZXManager.Update();
+		const uint32_t fetchesProcessed = ZXExeEmu_UseFetchCount(&ZXEmuState, RZXFetchesRemaining, GetIOInputFunc, this);
+		RZXFetchesRemaining -= fetchesProcessed;
+	}
+	else
+	{
+		// edge detection needs the pins from the last tick the debugger saw to be the last tick emulated
+		const bool bInstructionLevel = GetGlobalConfig().bInstructionLevelAnalysis && ZXEmuState.debug.callback.func != nullptr;
+		if (bInstructionLevel != bInstructionLevelLastFrame)
+			CodeAnalysis.Debugger.SetLastTickPins(ZXEmuState.pins);
+		bInstructionLevelLastFrame = bInstructionLevel;
+
+		if (bInstructionLevel)
+			ZXExeEmu_InstructionLevel(&ZXEmuState, microSeconds, InstructionTicksCB, this);
 		else
-		{
 			ZXExeEmu(&ZXEmuState, microSeconds);
-		}
+	}
 #endif
-		/*if (RZXManager.GetReplayMode() == EReplayMode::Playback)
-		{
-			assert(ZXEmuState.valid);
-			uint32_t icount = RZXManager.Update();
+	/*if (RZXManager.GetReplayMode() == EReplayMode::Playback)
+	{
+		assert(ZXEmuState.valid);
+		uint32_t icount = RZXManager.Update();
 
-			uint32_t ticks_to_run = clk_ticks_to_run(&ZXEmuState.clk, microSeconds);
-			uint32_t ticks_executed = z80_exec(&ZXEmuState.cpu, ticks_to_run);
-			clk_ticks_executed(&ZXEmuState.clk, ticks_executed);
-			kbd_update(&ZXEmuState.kbd);
-		}
-		else
-		{
-			uint32_t frameTicks = ZXEmuState.frame_scan_lines* ZXEmuState.scanline_period;
-			//zx_exec(&ZXEmuState, microSeconds);
-
-			//uint32_t ticks_to_run = clk_ticks_to_run(&ZXEmuState.clk, microSeconds);
-			//frameTicks = ticks_to_run;
-			ZXEmuState.clk.ticks_to_run = frameTicks;
-			const uint32_t ticksExecuted = z80_exec(&ZXEmuState.cpu, frameTicks);
-			clk_ticks_executed(&ZXEmuState.clk, ticksExecuted);
-			kbd_update(&ZXEmuState.kbd);
-		}*/
-		FrameTraceViewer.CaptureFrame();
-		//FrameScreenPixWrites.clear();
-		//FrameScreenAttrWrites.clear();
-		CodeAnalysis.OnFrameEnd();
+		uint32_t ticks_to_run = clk_ticks_to_run(&ZXEmuState.clk, microSeconds);
+		uint32_t ticks_executed = z80_exec(&ZXEmuState.cpu, ticks_to_run);
+		clk_ticks_executed(&ZXEmuState.clk, ticks_executed);
+		kbd_update(&ZXEmuState.kbd);
 	}
+	else
+	{
+		uint32_t frameTicks = ZXEmuState.frame_scan_lines* ZXEmuState.scanline_period;
+		//zx_exec(&ZXEmuState, microSeconds);
 
-	UpdateCharacterSets(CodeAnalysis);
-
-	// Draw UI
-	DrawDockingView();
+		//uint32_t ticks_to_run = clk_ticks_to_run(&ZXEmuState.clk, microSeconds);
+		//frameTicks = ticks_to_run;
+		ZXEmuState.clk.ticks_to_run = frameTicks;
+		const uint32_t ticksExecuted = z80_exec(&ZXEmuState.cpu, frameTicks);
+		clk_ticks_executed(&ZXEmuState.clk, ticksExecuted);
+		kbd_update(&ZXEmuState.kbd);
+	}*/
+	FrameTraceViewer.CaptureFrame();
+	//FrameScreenPixWrites.clear();
+	//FrameScreenAttrWrites.clear();
+	CodeAnalysis.OnFrameEnd();
 }
 
 void FSpectrumEmu::DrawMemoryTools()
@@ -42,6 +42,11 @@
 #include "IOAnalysis.h"
 #include "SnapshotLoaders/RZXLoader.h"
 #include "Util/Misc.h"
+#include "Util/EmuScheduler.h"
+#include "CodeAnalyser/AnalysisSnapshot.h"
+#include "CodeAnalyser/AnalysisPageDatabase.h"
+
+struct ZXTickRecord;
 
 struct FGame;
 struct FGameViewer;
@@ -49,6 +54,7 @@ struct FGameViewerData;
 struct FGameConfig;
 struct FViewerConfig;
 struct FSkoolFileInfo;
+class FMemoryRegionDescGenerator;
 
 enum class ESpectrumModel
 {
@@ -87,7 +93,7 @@ public:
 	}
 
 	bool	Init(const FSpectrumConfig& config);
-	void	Shutdown();
+	void	Shutdown(bool bSaveData = true);	// bSaveData writes the game data & global config back to the workspace
 
 	bool	IsInitialised() const { return bInitialised; }
 
@@ -107,8 +113,14 @@ public:
 
 	void	OnInstructionExecuted(int ticks, uint64_t pins);
 	uint64_t Z80Tick(int num, uint64_t pins);
+	void	Z80AnalysisTick(const FCPUTickInfo& tick, uint16_t scanlinePos, int noTicks);
+	void	Z80IOTick(FAddressRef pcAddrRef, const FCPUTickInfo& tick, uint16_t scanlinePos);
+	void	OnInstructionTicks(const ZXTickRecord* pRecords, int noRecords);
+	uint32_t	GetFrameMicroSeconds() const;
+	const FAnalysisFrameSnapshot*	GetUISnapshot() const { return pUISnapshot; }	// null outside of UI drawing
 
 	void	Tick();
+	void	TickEmulation(uint32_t microSeconds);
 	void	DrawMemoryTools();
 	void	DrawUI();
 	bool	DrawDockingView();
@@ -177,6 +189,9 @@ public:
 	uint8_t*		MappedInMemory = nullptr;
 
 	float			ExecSpeedScale = 1.0f;
+	FEmuScheduler	EmuScheduler;	// runs whole frames at a fixed rate independent of the UI
+	FAnalysisSnapshots	AnalysisSnapshots;	// published at the end of emulation for the UI to draw from
+	const FAnalysisFrameSnapshot*	pUISnapshot = nullptr;
 
 	// Chips UI
 	ui_zx_t			UIZX;
@@ -191,6 +206,7 @@ public:
 	FFrameTraceViewer		FrameTraceViewer;
 	FGraphicsViewerState	GraphicsViewer;
 	FCodeAnalysisState		CodeAnalysis;
+	FAnalysisPageDatabase	AnalysisDatabase;	// game's saved analysis, banks are read from it as they're mapped in
 	FIOAnalysis				IOAnalysis;
 
 	// Code analysis pages - to cover 48K & 128K Spectrums
@@ -216,14 +232,18 @@ public:
 	
 	uint16_t		PreviousPC = 0;		// store previous pc
 	int				InstructionsTicks = 0;
+	uint16_t		LastScanlinePos = 0;
+	uint8_t			LastFE = 0;			// last value written to ULA port
 
 	FRZXManager		RZXManager;
 	int				RZXFetchesRemaining = 0;
+	bool			bInstructionLevelLastFrame = false;
 
 	bool		bShowImGuiDemo = false;
 	bool		bShowImPlotDemo = false;
 private:
 	std::vector<FViewerBase*>	Viewers;
+	std::vector<FMemoryRegionDescGenerator*>	MemoryRegionDescGenerators;
 
 	bool	bReplaceGamePopup = false;
 	bool	bExportAsm = false;
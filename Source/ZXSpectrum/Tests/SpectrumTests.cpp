@@ -8,6 +8,15 @@
 #include <gtest/gtest.h>
 #include "../SnapshotLoaders/SNALoader.h"
 #include "../ZXChipsImpl.h"
+#include "../GlobalConfig.h"
+#include "CodeAnalyser/CodeAnalysisJson.h"
+#include "CodeAnalyser/CodeAnalysisState.h"
+#include "CodeAnalyser/UI/CodeAnalyserUI.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <json.hpp>
 
 // Demonstrate some basic assertions.
 TEST(ZXSpectrumTest, BasicAssertions) 
@@ -62,6 +71,915 @@ TEST_F(FSpectrumEmuTest, SnapshotLoaderTest)
 
 };
 
+TEST_F(FSpectrumEmuTest, InstructionLevelStepTest)
+{
+	ASSERT_NE(pEmu, nullptr);
+	const bool bLoaded = LoadSNAFile(pEmu, "Tests/testminimal.sna");
+	EXPECT_EQ(bLoaded, true);
+
+	// stepping should stop in the same place as per tick analysis
+	pEmu->CodeAnalysis.Debugger.StepInto();
+	ZXExeEmu_InstructionLevel(&pEmu->ZXEmuState, 1000000, [](const ZXTickRecord* pRecords, int noRecords, void* pUserData)
+	{
+		((FSpectrumEmu*)pUserData)->OnInstructionTicks(pRecords, noRecords);
+	}, pEmu);
+	EXPECT_EQ(pEmu->ZXEmuState.cpu.pc, 0x8002);
+};
+
+TEST_F(FSpectrumEmuTest, AnalysisSnapshotTest)
+{
+	ASSERT_NE(pEmu, nullptr);
+	FAnalysisSnapshots snapshots;
+
+	// first publish copies everything, after that only changed pages
+	EXPECT_TRUE(snapshots.Publish(pEmu->CodeAnalysis, nullptr, 0));
+	EXPECT_GT(snapshots.GetNoPagesCopiedLastPublish(), 0);
+	EXPECT_TRUE(snapshots.Publish(pEmu->CodeAnalysis, nullptr, 0));
+	EXPECT_EQ(snapshots.GetNoPagesCopiedLastPublish(), 0);
+
+	const uint8_t val = pEmu->ReadByte(0x8000);
+	pEmu->WriteByte(0x8000, val ^ 0xff);
+	EXPECT_TRUE(snapshots.Publish(pEmu->CodeAnalysis, nullptr, 0));
+	EXPECT_EQ(snapshots.GetNoPagesCopiedLastPublish(), 1);
+
+	// snapshot being drawn from isn't overwritten
+	const FAnalysisFrameSnapshot* pSnapshot = snapshots.Acquire();
+	ASSERT_NE(pSnapshot, nullptr);
+	const int16_t bankId = pEmu->CodeAnalysis.GetBankFromAddress(0x8000);
+	const FCodeAnalysisBank* pBank = pEmu->CodeAnalysis.GetBank(bankId);
+	const int bankPageNo = (0x8000 - pBank->GetMappedAddress()) >> FCodeAnalysisPage::kPageShift;
+	EXPECT_EQ(pSnapshot->GetPage(bankId, bankPageNo)->Memory[0], val ^ 0xff);
+
+	pEmu->WriteByte(0x8000, val);
+	EXPECT_TRUE(snapshots.Publish(pEmu->CodeAnalysis, nullptr, 0));
+	EXPECT_FALSE(snapshots.Publish(pEmu->CodeAnalysis, nullptr, 0));
+	EXPECT_EQ(pSnapshot->GetPage(bankId, bankPageNo)->Memory[0], val ^ 0xff);
+	snapshots.Release();
+	EXPECT_TRUE(snapshots.Publish(pEmu->CodeAnalysis, nullptr, 0));
+
+	// repeat accesses don't copy the page every frame
+	FCodeAnalysisPage* pPage = pEmu->CodeAnalysis.GetReadPage(0x8000);
+	const int frameNo = pEmu->CodeAnalysis.CurrentFrameNo;
+	pPage->ResetAccessInfo();
+	EXPECT_TRUE(snapshots.Publish(pEmu->CodeAnalysis, nullptr, 0));
+	EXPECT_EQ(snapshots.GetNoPagesCopiedLastPublish(), 1);
+	pPage->RegisterRead(0, FAddressRef(), frameNo);
+	EXPECT_TRUE(snapshots.Publish(pEmu->CodeAnalysis, nullptr, 0));
+	EXPECT_EQ(snapshots.GetNoPagesCopiedLastPublish(), 1);	// first access
+	pPage->RegisterRead(0, FAddressRef(), frameNo + 1);
+	EXPECT_TRUE(snapshots.Publish(pEmu->CodeAnalysis, nullptr, 0));
+	EXPECT_EQ(snapshots.GetNoPagesCopiedLastPublish(), 0);
+	pPage->RegisterRead(0, FAddressRef(), frameNo + FCodeAnalysisPage::kAccessChangeFrames);
+	EXPECT_TRUE(snapshots.Publish(pEmu->CodeAnalysis, nullptr, 0));
+	EXPECT_EQ(snapshots.GetNoPagesCopiedLastPublish(), 1);
+};
+
+TEST_F(FSpectrumEmuTest, AnalysisDatabaseTest)
+{
+	ASSERT_NE(pEmu, nullptr);
+	FCodeAnalysisState& state = pEmu->CodeAnalysis;
+	const char* pFileName = "AnalysisDatabaseTest.adb";
+	FAnalysisPageDatabase database;
+
+	// first save writes everything, after that only changed pages
+	EXPECT_TRUE(database.Save(state, pFileName));
+	EXPECT_GT(database.GetNoPagesWrittenLastSave(), 0);
+	EXPECT_TRUE(database.Save(state, pFileName));
+	EXPECT_EQ(database.GetNoPagesWrittenLastSave(), 0);
+
+	AddLabel(state, 0x8000, "database_test", ELabelType::Data);
+	EXPECT_TRUE(database.Save(state, pFileName));
+	EXPECT_EQ(database.GetNoPagesWrittenLastSave(), 1);
+
+	// label comes back from the appended record
+	RemoveLabelAtAddress(state, state.AddressRefFromPhysicalAddress(0x8000));
+	EXPECT_EQ(state.GetLabelForAddress(0x8000), nullptr);
+	FAnalysisPageDatabase reopened;
+	EXPECT_TRUE(reopened.Open(state, pFileName));
+	const FLabelInfo* pLabel = state.GetLabelForAddress(0x8000);
+	ASSERT_NE(pLabel, nullptr);
+	EXPECT_EQ(pLabel->Name, "database_test");
+
+	// the re-analysis done on load doesn't count an edit made before it as saved
+	reopened.ClearChangedPages(state);
+	AddLabel(state, 0x8004, "database_test_edit", ELabelType::Data);
+	FAnalysisPageDatabase* pOldDatabase = state.pAnalysisDatabase;
+	state.pAnalysisDatabase = &reopened;
+	state.AnalysisJobs.AddJob(std::make_unique<FReAnalyseCodeJob>(/* bFixUpsAreSaved */ true));
+	state.AnalysisJobs.RunAll(state);
+	state.pAnalysisDatabase = pOldDatabase;
+	EXPECT_TRUE(reopened.Save(state, pFileName));
+	EXPECT_EQ(reopened.GetNoPagesWrittenLastSave(), 1);
+
+	reopened.Close();
+	database.Close();
+	remove(pFileName);
+};
+
+TEST_F(FSpectrumEmuTest, AnalysisStateLazyLoadTest)
+{
+	ASSERT_NE(pEmu, nullptr);
+	FCodeAnalysisState& state = pEmu->CodeAnalysis;
+	const char* pDatabaseFileName = "AnalysisStateLazyLoadTest.adb";
+	const char* pStateFileName = "AnalysisStateLazyLoadTest.astate";
+	const char* pResavedStateFileName = "AnalysisStateLazyLoadTest2.astate";
+
+	// a RAM bank that isn't mapped in on a 48K machine
+	FCodeAnalysisBank* pBank = nullptr;
+	for (auto& bank : state.GetBanks())
+	{
+		if (bank.bReadOnly == false && bank.IsMapped() == false)
+		{
+			pBank = &bank;
+			break;
+		}
+	}
+	ASSERT_NE(pBank, nullptr);
+
+	const FAddressRef labelAddr(pBank->Id, pBank->GetMappedAddress());
+	FLabelInfo* pLabel = GenerateLabelForAddress(state, labelAddr, ELabelType::Data);
+	ASSERT_NE(pLabel, nullptr);
+	const std::string labelName = pLabel->Name;
+	pLabel->References.RegisterAccess(state.AddressRefFromPhysicalAddress(0x8000));
+	FCodeAnalysisPage& page = pBank->Pages[0];
+	page.bUsed = true;
+
+	FAnalysisPageDatabase& database = pEmu->AnalysisDatabase;
+	EXPECT_TRUE(database.Save(state, pDatabaseFileName));
+	EXPECT_TRUE(ExportAnalysisState(state, pStateFileName));
+
+	// the unmapped bank stays in the database, its label name is still known about
+	pLabel->References.Reset();
+	state.ResetLabelNames();
+	ASSERT_TRUE(database.Open(state, pDatabaseFileName));
+	EXPECT_TRUE(pBank->bHasStoredPages);
+	EXPECT_TRUE(database.IsPageWaitingToLoad(page.PageId));
+	EXPECT_EQ(state.GetLabelUsage().count(labelName), 1);
+
+	// state for the page is held until the bank is read in and is saved again as it was
+	EXPECT_TRUE(ImportAnalysisState(state, pStateFileName));
+	EXPECT_EQ(state.PendingPageStates.count(page.PageId), 1);
+	EXPECT_TRUE(pLabel->References.IsEmpty());
+	EXPECT_TRUE(ExportAnalysisState(state, pResavedStateFileName));
+	size_t stateSize = 0;
+	size_t resavedStateSize = 0;
+	uint8_t* pStateData = (uint8_t*)LoadBinaryFile(pStateFileName, stateSize);
+	uint8_t* pResavedStateData = (uint8_t*)LoadBinaryFile(pResavedStateFileName, resavedStateSize);
+	ASSERT_NE(pStateData, nullptr);
+	ASSERT_NE(pResavedStateData, nullptr);
+	ASSERT_EQ(stateSize, resavedStateSize);
+	EXPECT_EQ(memcmp(pStateData, pResavedStateData, stateSize), 0);
+	free(pStateData);
+	free(pResavedStateData);
+
+	state.LoadBankAnalysis(*pBank);
+	EXPECT_FALSE(pBank->bHasStoredPages);
+	EXPECT_TRUE(state.PendingPageStates.empty());
+	const FLabelInfo* pLoadedLabel = page.Labels[0];
+	ASSERT_NE(pLoadedLabel, nullptr);
+	EXPECT_EQ(pLoadedLabel->Name, labelName);
+	EXPECT_EQ(pLoadedLabel->References.GetReferences().size(), 1);
+
+	database.Close();
+	remove(pDatabaseFileName);
+	remove(pStateFileName);
+	remove(pResavedStateFileName);
+};
+
+// from CodeAnalysisJson.cpp
+void WriteAnalysisGlobalsToJson(FCodeAnalysisState& state, nlohmann::json& jsonDoc, bool bROMS);
+void WritePageToJson(const FCodeAnalysisPage& page, nlohmann::json& jsonDoc);
+bool ImportAnalysisJsonDoc(FCodeAnalysisState& state, const nlohmann::json& jsonGameData);
+
+// Build the whole document in memory - these produce & read the same files as the streamed versions, used for comparison
+static bool ExportAnalysisJsonDocument(FCodeAnalysisState& state, const char* pJsonFileName)
+{
+	nlohmann::json jsonGameData;
+	WriteAnalysisGlobalsToJson(state, jsonGameData, false);
+
+	for (const FCodeAnalysisBank& bank : state.GetBanks())
+	{
+		if (bank.bReadOnly)	// skip read only banks - ROM
+			continue;
+
+		for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
+		{
+			nlohmann::json pageData;
+			WritePageToJson(bank.Pages[pageNo], pageData);
+			jsonGameData["Pages"].push_back(pageData);
+		}
+	}
+
+	std::ofstream outFileStream(pJsonFileName);
+	if (outFileStream.is_open() == false)
+		return false;
+
+	outFileStream << std::setw(4) << jsonGameData << std::endl;
+	return true;
+}
+
+static bool ImportAnalysisJsonDocument(FCodeAnalysisState& state, const char* pJsonFileName)
+{
+	std::ifstream inFileStream(pJsonFileName);
+	if (inFileStream.is_open() == false)
+		return false;
+
+	nlohmann::json jsonGameData;
+	inFileStream >> jsonGameData;
+	return ImportAnalysisJsonDoc(state, jsonGameData);
+}
+
+static std::string ReadTextFile(const char* pFileName)
+{
+	std::ifstream file(pFileName);
+	return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+TEST_F(FSpectrumEmuTest, AnalysisJsonStreamTest)
+{
+	ASSERT_NE(pEmu, nullptr);
+	FCodeAnalysisState& state = pEmu->CodeAnalysis;
+	const char* pStreamedFile = "AnalysisJsonStreamTest.json";
+	const char* pDocumentFile = "AnalysisJsonStreamTest.document.json";
+	const char* pCompactFile = "AnalysisJsonStreamTest.compact.json";
+
+	AddLabel(state, 0x8000, "json_stream_test", ELabelType::Data);
+
+	// streamed output is the same as writing the whole document
+	EXPECT_TRUE(ExportAnalysisJson(state, pStreamedFile));
+	EXPECT_TRUE(ExportAnalysisJsonDocument(state, pDocumentFile));
+	EXPECT_TRUE(ExportAnalysisJson(state, pCompactFile, false, true));
+	std::ifstream streamedFile(pStreamedFile), documentFile(pDocumentFile), compactFile(pCompactFile);
+	const std::string streamedJson((std::istreambuf_iterator<char>(streamedFile)), std::istreambuf_iterator<char>());
+	const std::string documentJson((std::istreambuf_iterator<char>(documentFile)), std::istreambuf_iterator<char>());
+	const std::string compactJson((std::istreambuf_iterator<char>(compactFile)), std::istreambuf_iterator<char>());
+	EXPECT_EQ(streamedJson, documentJson);
+	EXPECT_LT(compactJson.size(), streamedJson.size());
+	EXPECT_EQ(nlohmann::json::parse(compactJson), nlohmann::json::parse(streamedJson));
+	streamedFile.close();
+	documentFile.close();
+	compactFile.close();
+
+	// label comes back from both forms
+	RemoveLabelAtAddress(state, state.AddressRefFromPhysicalAddress(0x8000));
+	EXPECT_TRUE(ImportAnalysisJson(state, pStreamedFile));
+	const FLabelInfo* pLabel = state.GetLabelForAddress(0x8000);
+	ASSERT_NE(pLabel, nullptr);
+	EXPECT_EQ(pLabel->Name, "json_stream_test");
+
+	RemoveLabelAtAddress(state, state.AddressRefFromPhysicalAddress(0x8000));
+	EXPECT_TRUE(ImportAnalysisJson(state, pCompactFile));
+	pLabel = state.GetLabelForAddress(0x8000);
+	ASSERT_NE(pLabel, nullptr);
+	EXPECT_EQ(pLabel->Name, "json_stream_test");
+
+	remove(pStreamedFile);
+	remove(pDocumentFile);
+	remove(pCompactFile);
+};
+
+TEST_F(FSpectrumEmuTest, LabelRangeIndexTest)
+{
+	ASSERT_NE(pEmu, nullptr);
+	FCodeAnalysisState& state = pEmu->CodeAnalysis;
+
+	AddLabel(state, 0x8000, "range_function", ELabelType::Function);
+	AddLabel(state, 0x8010, "range_label", ELabelType::Code);
+
+	FLabelSearchResult result;
+	EXPECT_TRUE(FindLabelBeforeAddress(state, state.AddressRefFromPhysicalAddress(0x8020), ELabelRangeType::Code, result));
+	EXPECT_EQ(result.pLabel->Name, "range_label");
+	EXPECT_EQ(result.Offset, 0x10);
+	EXPECT_TRUE(FindLabelBeforeAddress(state, state.AddressRefFromPhysicalAddress(0x8020), ELabelRangeType::Function, result));
+	EXPECT_EQ(result.pLabel->Name, "range_function");
+	EXPECT_EQ(result.Offset, 0x20);
+
+	// index picks up the removed label
+	RemoveLabelAtAddress(state, state.AddressRefFromPhysicalAddress(0x8010));
+	EXPECT_TRUE(FindLabelBeforeAddress(state, state.AddressRefFromPhysicalAddress(0x8020), ELabelRangeType::Code, result));
+	EXPECT_EQ(result.pLabel->Name, "range_function");
+	EXPECT_EQ(result.LabelAddress.Address, 0x8000);
+
+	RemoveLabelAtAddress(state, state.AddressRefFromPhysicalAddress(0x8000));
+};
+
+TEST_F(FSpectrumEmuTest, AnalysisJobQueueTest)
+{
+	ASSERT_NE(pEmu, nullptr);
+	FCodeAnalysisState& state = pEmu->CodeAnalysis;
+	FAnalysisJobQueue& jobs = state.AnalysisJobs;
+	EXPECT_FALSE(jobs.IsBusy());
+
+	// LD HL,$4000 with an operand byte that's been set to something else
+	pEmu->WriteByte(0x8000, 0x21);
+	pEmu->WriteByte(0x8001, 0x00);
+	pEmu->WriteByte(0x8002, 0x40);
+	WriteCodeInfoForAddress(state, 0x8000);
+	state.GetReadDataInfoForAddress(0x8001)->DataType = EDataType::Byte;
+
+	bool bFinished = false;
+	std::unique_ptr<FAnalysisJob> pJob = std::make_unique<FReAnalyseCodeJob>();
+	pJob->OnFinished = [&bFinished](FCodeAnalysisState&) { bFinished = true; };
+	jobs.AddJob(std::move(pJob));
+	jobs.AddJob(std::make_unique<FResetReferenceInfoJob>());
+
+	// a step is always done even with no time budget
+	jobs.Update(state, 0.0);
+	ASSERT_EQ(jobs.GetNoJobs(), 2);
+	EXPECT_GT(jobs.GetCurrentJob()->GetProgress(), 0.0f);
+	EXPECT_LT(jobs.GetCurrentJob()->GetProgress(), 0.1f);
+	EXPECT_FALSE(bFinished);
+
+	jobs.RunAll(state);
+	EXPECT_TRUE(bFinished);
+	EXPECT_FALSE(jobs.IsBusy());
+	EXPECT_EQ(state.GetReadDataInfoForAddress(0x8001)->DataType, EDataType::InstructionOperand);
+	EXPECT_EQ(state.GetReadDataInfoForAddress(0x8002)->DataType, EDataType::InstructionOperand);
+};
+
+// number of addresses or ports with a breakpoint flag set
+static int CountBreakpointFlags(const FDebugger& debugger, uint32_t bpMask, bool bPorts)
+{
+	int count = 0;
+	for (int addr = 0; addr < 0x10000; addr++)
+	{
+		const uint8_t flags = bPorts ? debugger.GetPortBreakpointFlags(addr) : debugger.GetAddressBreakpointFlags(addr);
+		if (flags & bpMask)
+			count++;
+	}
+	return count;
+}
+
+TEST_F(FSpectrumEmuTest, BreakpointTableTest)
+{
+	ASSERT_NE(pEmu, nullptr);
+	FCodeAnalysisState& state = pEmu->CodeAnalysis;
+	FDebugger& debugger = state.Debugger;
+	const FAddressRef execAddr = state.AddressRefFromPhysicalAddress(0x8000);
+	const FAddressRef writeAddr = state.AddressRefFromPhysicalAddress(0x9000);
+	const FAddressRef readAddr = state.AddressRefFromPhysicalAddress(0xFFFE);
+	const FAddressRef outPort = state.AddressRefFromPhysicalAddress(0x00FE);
+	const FAddressRef inPort = state.AddressRefFromPhysicalAddress(0x7FFD);
+	const char* pFileName = "BreakpointTableTest.bin";
+
+	EXPECT_TRUE(debugger.AddExecBreakpoint(execAddr));
+	EXPECT_TRUE(debugger.AddDataBreakpoint(writeAddr, 4));
+	EXPECT_TRUE(debugger.AddDataReadBreakpoint(readAddr, 4));	// wraps round to 0
+	EXPECT_EQ(debugger.GetAddressBreakpointFlags(0x8000), BPMask_Exec);
+	EXPECT_EQ(debugger.GetAddressBreakpointFlags(0x9003), BPMask_DataWrite);
+	EXPECT_EQ(debugger.GetAddressBreakpointFlags(0x9004), 0);
+	EXPECT_EQ(debugger.GetAddressBreakpointFlags(0x0001), BPMask_DataRead);
+	EXPECT_EQ(CountBreakpointFlags(debugger, BPMask_Exec, false), 1);
+	EXPECT_EQ(CountBreakpointFlags(debugger, BPMask_DataWrite, false), 4);
+	EXPECT_EQ(CountBreakpointFlags(debugger, BPMask_DataRead, false), 4);
+	EXPECT_EQ(debugger.GetBreakpointMask(), BPMask_Exec | BPMask_DataWrite | BPMask_DataRead);
+
+	// port breakpoints are made by changing the type, only the bits in the mask are matched
+	EXPECT_TRUE(debugger.AddExecBreakpoint(outPort));
+	FBreakpoint* pBreakpoint = debugger.GetBreakpointForAddress(outPort);
+	ASSERT_NE(pBreakpoint, nullptr);
+	pBreakpoint->Type = EBreakpointType::Out;
+	pBreakpoint->Val = 0x00FF;
+	EXPECT_TRUE(debugger.AddExecBreakpoint(inPort));
+	pBreakpoint = debugger.GetBreakpointForAddress(inPort);
+	ASSERT_NE(pBreakpoint, nullptr);
+	pBreakpoint->Type = EBreakpointType::In;
+	pBreakpoint->Val = 0xFFFF;
+	debugger.BreakpointsChanged();
+	EXPECT_EQ(debugger.GetAddressBreakpointFlags(0x00FE), 0);
+	EXPECT_EQ(debugger.GetAddressBreakpointFlags(0x7FFD), 0);
+	EXPECT_EQ(CountBreakpointFlags(debugger, BPMask_Exec, false), 1);
+	EXPECT_EQ(CountBreakpointFlags(debugger, BPMask_IOWrite, true), 256);
+	EXPECT_EQ(debugger.GetPortBreakpointFlags(0x12FE), BPMask_IOWrite);
+	EXPECT_EQ(debugger.GetPortBreakpointFlags(0x12FF), 0);
+	EXPECT_EQ(CountBreakpointFlags(debugger, BPMask_IORead, true), 1);
+	EXPECT_EQ(debugger.GetPortBreakpointFlags(0x7FFD), BPMask_IORead);
+	EXPECT_EQ(debugger.GetPortBreakpointFlags(0x7FFE), BPMask_IOWrite);
+
+	// disabling takes the flags out until it's enabled again
+	pBreakpoint = debugger.GetBreakpointForAddress(execAddr);
+	ASSERT_NE(pBreakpoint, nullptr);
+	pBreakpoint->bEnabled = false;
+	debugger.BreakpointsChanged();
+	EXPECT_EQ(debugger.GetAddressBreakpointFlags(0x8000), 0);
+	EXPECT_EQ(debugger.GetBreakpointMask() & BPMask_Exec, 0);
+	pBreakpoint->bEnabled = true;
+	debugger.BreakpointsChanged();
+	EXPECT_EQ(debugger.GetAddressBreakpointFlags(0x8000), BPMask_Exec);
+
+	EXPECT_TRUE(debugger.RemoveBreakpoint(writeAddr));
+	EXPECT_EQ(CountBreakpointFlags(debugger, BPMask_DataWrite, false), 0);
+	EXPECT_EQ(CountBreakpointFlags(debugger, BPMask_DataRead, false), 4);
+	EXPECT_EQ(debugger.GetBreakpointMask() & BPMask_DataWrite, 0);
+
+	// tables are rebuilt on load
+	FILE* fp = fopen(pFileName, "wb");
+	ASSERT_NE(fp, nullptr);
+	debugger.SaveToFile(fp);
+	fclose(fp);
+
+	EXPECT_TRUE(debugger.RemoveBreakpoint(execAddr));
+	EXPECT_TRUE(debugger.RemoveBreakpoint(readAddr));
+	EXPECT_TRUE(debugger.RemoveBreakpoint(outPort));
+	EXPECT_TRUE(debugger.RemoveBreakpoint(inPort));
+	EXPECT_EQ(debugger.GetBreakpointMask(), 0);
+	EXPECT_EQ(CountBreakpointFlags(debugger, 0xff, false), 0);
+	EXPECT_EQ(CountBreakpointFlags(debugger, 0xff, true), 0);
+
+	fp = fopen(pFileName, "rb");
+	ASSERT_NE(fp, nullptr);
+	debugger.LoadFromFile(fp);
+	fclose(fp);
+	remove(pFileName);
+
+	EXPECT_EQ(debugger.GetBreakpointMask(), BPMask_Exec | BPMask_DataRead | BPMask_IORead | BPMask_IOWrite);
+	EXPECT_EQ(CountBreakpointFlags(debugger, BPMask_Exec, false), 1);
+	EXPECT_EQ(debugger.GetAddressBreakpointFlags(0x8000), BPMask_Exec);
+	EXPECT_EQ(CountBreakpointFlags(debugger, BPMask_DataWrite, false), 0);
+	EXPECT_EQ(CountBreakpointFlags(debugger, BPMask_DataRead, false), 4);
+	EXPECT_EQ(debugger.GetAddressBreakpointFlags(0xFFFF), BPMask_DataRead);
+	EXPECT_EQ(CountBreakpointFlags(debugger, BPMask_IOWrite, true), 256);
+	EXPECT_EQ(CountBreakpointFlags(debugger, BPMask_IORead, true), 1);
+	EXPECT_EQ(debugger.GetPortBreakpointFlags(0x7FFD), BPMask_IORead);
+};
+
+// tick with a memory access to an address
+static FCPUTickInfo MakeMemoryAccessTick(uint16_t address, bool bWrite, uint8_t value)
+{
+	FCPUTickInfo tick;
+	tick.Pins = Z80_MREQ | (bWrite ? Z80_WR : Z80_RD) | address;
+	Z80_SET_DATA(tick.Pins, (uint64_t)value);
+	tick.Address = address;
+	tick.Data = value;
+	tick.bNewBusCycle = true;
+	tick.bMemRead = bWrite == false;
+	tick.bMemWrite = bWrite;
+	return tick;
+}
+
+TEST_F(FSpectrumEmuTest, BreakpointConditionTest)
+{
+	ASSERT_NE(pEmu, nullptr);
+	FCodeAnalysisState& state = pEmu->CodeAnalysis;
+	FDebugger& debugger = state.Debugger;
+	const FAddressRef addr = state.AddressRefFromPhysicalAddress(0x8000);
+	const char* pFileName = "BreakpointConditionTest.bin";
+
+	// read breakpoints don't break on writes
+	debugger.Continue();
+	EXPECT_TRUE(debugger.AddDataReadBreakpoint(addr, 1));
+	debugger.CPUTick(MakeMemoryAccessTick(0x8000, true, 0));
+	EXPECT_FALSE(debugger.IsStopped());
+	debugger.CPUTick(MakeMemoryAccessTick(0x8000, false, 0));
+	EXPECT_TRUE(debugger.IsStopped());
+	EXPECT_TRUE(debugger.RemoveBreakpoint(addr));
+
+	// write breakpoint that only breaks when a value is written
+	debugger.Continue();
+	EXPECT_TRUE(debugger.AddDataBreakpoint(addr, 1));
+	FBreakpoint* pBreakpoint = debugger.GetBreakpointForAddress(addr);
+	ASSERT_NE(pBreakpoint, nullptr);
+	pBreakpoint->MatchValue = 0x42;
+	debugger.CPUTick(MakeMemoryAccessTick(0x8000, true, 0x41));
+	EXPECT_FALSE(debugger.IsStopped());
+	debugger.CPUTick(MakeMemoryAccessTick(0x8000, true, 0x42));
+	EXPECT_TRUE(debugger.IsStopped());
+
+	// breaks on every third matching write
+	pBreakpoint->HitCountTarget = 3;
+	pBreakpoint->NoHits = 0;
+	for (int writeNo = 1; writeNo <= 6; writeNo++)
+	{
+		debugger.Continue();
+		debugger.CPUTick(MakeMemoryAccessTick(0x8000, true, 0x42));
+		debugger.CPUTick(MakeMemoryAccessTick(0x8000, true, 0x41));
+		EXPECT_EQ(debugger.IsStopped(), writeNo % 3 == 0);
+	}
+
+	// conditions are saved with the breakpoint
+	FILE* fp = fopen(pFileName, "wb");
+	ASSERT_NE(fp, nullptr);
+	debugger.SaveToFile(fp);
+	fclose(fp);
+	EXPECT_TRUE(debugger.RemoveBreakpoint(addr));
+	fp = fopen(pFileName, "rb");
+	ASSERT_NE(fp, nullptr);
+	debugger.LoadFromFile(fp);
+	fclose(fp);
+	remove(pFileName);
+
+	pBreakpoint = debugger.GetBreakpointForAddress(addr);
+	ASSERT_NE(pBreakpoint, nullptr);
+	EXPECT_EQ(pBreakpoint->Type, EBreakpointType::Data);
+	EXPECT_TRUE(pBreakpoint->bEnabled);
+	EXPECT_EQ(pBreakpoint->Size, 1);
+	EXPECT_EQ(pBreakpoint->MatchValue, 0x42);
+	EXPECT_EQ(pBreakpoint->HitCountTarget, 3u);
+	EXPECT_TRUE(debugger.RemoveBreakpoint(addr));
+	debugger.Continue();
+};
+
+// runs frames and makes a line of text for each address the analysis has recorded something for, and for each event
+static void RunAnalysisFrames(FSpectrumEmu* pEmu, bool bInstructionLevel, int noFrames, std::vector<std::string>& outPageInfo, std::vector<std::string>& outEvents, std::set<int>& outEventTypes)
+{
+	GetGlobalConfig().bInstructionLevelAnalysis = bInstructionLevel;
+	FDebugger& debugger = pEmu->CodeAnalysis.Debugger;
+	debugger.Continue();
+
+	char line[256];
+	for (int frameNo = 0; frameNo < noFrames; frameNo++)
+	{
+		pEmu->TickEmulation(20000);
+
+		const FEventTrace& eventTrace = debugger.GetEventTrace();
+		const FEventRange range = eventTrace.GetFrameRange();
+		for (uint64_t eventNo = range.Start; eventNo < range.End; eventNo++)
+		{
+			const FEvent& event = eventTrace.GetEvent(eventNo);
+			snprintf(line, sizeof(line), "%d: type %d pc %d:%04X addr %04X val %02X scanline %d", frameNo, event.Type, event.PC.BankId, event.PC.Address, event.Address, event.Value, event.ScanlinePos);
+			outEvents.push_back(line);
+			outEventTypes.insert(event.Type);
+		}
+	}
+
+	for (const FCodeAnalysisBank& bank : pEmu->CodeAnalysis.GetBanks())
+	{
+		for (int pageNo = 0; pageNo < bank.NoPages; pageNo++)
+		{
+			const FCodeAnalysisPage& page = bank.Pages[pageNo];
+			for (int pageAddr = 0; pageAddr < FCodeAnalysisPage::kPageSize; pageAddr++)
+			{
+				const FCodeInfo* pCodeInfo = page.CodeInfo[pageAddr];
+				const FDataInfo& dataInfo = page.DataInfo[pageAddr];
+				const FItemReferenceTracker& reads = page.GetReads(pageAddr);
+				const FItemReferenceTracker& writes = page.GetWrites(pageAddr);
+				if (pCodeInfo == nullptr && reads.IsEmpty() && writes.IsEmpty() && page.LastFrameRead[pageAddr] == -1 && page.LastFrameWritten[pageAddr] == -1)
+					continue;
+
+				snprintf(line, sizeof(line), "%d:%d:%03X", bank.Id, pageNo, pageAddr);
+				std::string info = line;
+				if (pCodeInfo != nullptr)
+				{
+					snprintf(line, sizeof(line), " code size %d last exec %d flags %X", pCodeInfo->ByteSize, pCodeInfo->FrameLastExecuted, pCodeInfo->Flags);
+					info += line;
+				}
+				snprintf(line, sizeof(line), " data type %d size %d last read %d last write %d", (int)dataInfo.DataType, dataInfo.ByteSize, page.LastFrameRead[pageAddr], page.LastFrameWritten[pageAddr]);
+				info += line;
+				for (const FAddressRef& ref : reads.GetReferences())
+				{
+					snprintf(line, sizeof(line), " r%d:%04X", ref.BankId, ref.Address);
+					info += line;
+				}
+				for (const FAddressRef& ref : writes.GetReferences())
+				{
+					snprintf(line, sizeof(line), " w%d:%04X", ref.BankId, ref.Address);
+					info += line;
+				}
+				outPageInfo.push_back(info);
+			}
+		}
+	}
+}
+
+// 48K snapshot of a program that does all the things the analysis tracks every frame:
+// IM 2 interrupts, border OUTs, keyboard INs, screen pixel & attribute writes and 128K paging writes
+static std::vector<uint8_t> MakeAnalysisWorkloadSNA()
+{
+	static const uint8_t kMainCode[] =
+	{
+		0xF3,				// 8000 di
+		0x31, 0x00, 0xBE,	// 8001 ld sp,$BE00
+		0x3E, 0x81,			// 8004 ld a,$81
+		0xED, 0x47,			// 8006 ld i,a
+		0xED, 0x5E,			// 8008 im 2
+		0xFB,				// 800A ei
+		0x3A, 0x00, 0x83,	// 800B loop: ld a,($8300)
+		0xE6, 0x07,			// 800E and 7
+		0xD3, 0xFE,			// 8010 out ($FE),a
+		0xDB, 0xFE,			// 8012 in a,($FE)
+		0x32, 0x00, 0x40,	// 8014 ld ($4000),a
+		0x3A, 0x00, 0x83,	// 8017 ld a,($8300)
+		0x32, 0x00, 0x58,	// 801A ld ($5800),a
+		0xE6, 0x07,			// 801D and 7
+		0x01, 0xFD, 0x7F,	// 801F ld bc,$7FFD
+		0xED, 0x79,			// 8022 out (c),a
+		0x32, 0x00, 0xC0,	// 8024 ld ($C000),a
+		0x76,				// 8027 halt
+		0x18, 0xE1,			// 8028 jr loop
+	};
+	static const uint8_t kInterruptCode[] =
+	{
+		0xF5,				// 8282 push af
+		0x3A, 0x00, 0x83,	// 8283 ld a,($8300)
+		0x3C,				// 8286 inc a
+		0x32, 0x00, 0x83,	// 8287 ld ($8300),a
+		0xF1,				// 828A pop af
+		0xFB,				// 828B ei
+		0xED, 0x4D,			// 828C reti
+	};
+
+	const size_t kHeaderSize = 27;
+	const uint16_t kStackPointer = 0xBDFE;
+	std::vector<uint8_t> sna(kHeaderSize + 0xC000, 0);
+	auto ramOffset = [kHeaderSize](uint16_t address) { return kHeaderSize + address - 0x4000; };
+
+	memcpy(&sna[ramOffset(0x8000)], kMainCode, sizeof(kMainCode));
+	memset(&sna[ramOffset(0x8100)], 0x82, 257);	// IM 2 vector table, all entries point at 0x8282
+	memcpy(&sna[ramOffset(0x8282)], kInterruptCode, sizeof(kInterruptCode));
+
+	// start address is popped off the stack
+	sna[0x17] = kStackPointer & 0xff;
+	sna[0x18] = kStackPointer >> 8;
+	sna[0x19] = 1;	// IM
+	sna[ramOffset(kStackPointer)] = 0x00;
+	sna[ramOffset(kStackPointer) + 1] = 0x80;
+	return sna;
+}
+
+static void RunAnalysisWorkload(bool bInstructionLevel, int noFrames, std::vector<std::string>& outPageInfo, std::vector<std::string>& outEvents, std::set<int>& outEventTypes)
+{
+	FSpectrumConfig config;
+	config.Model = ESpectrumModel::Spectrum128K;
+	config.SpecificGame = "ROM";	// to make it not load the last game
+	FSpectrumEmu* pEmu = new FSpectrumEmu;
+	pEmu->Init(config);
+
+	const std::vector<uint8_t> sna = MakeAnalysisWorkloadSNA();
+	EXPECT_TRUE(LoadSNAFromMemory(pEmu, sna.data(), sna.size()));
+	RunAnalysisFrames(pEmu, bInstructionLevel, noFrames, outPageInfo, outEvents, outEventTypes);
+	EXPECT_GT(pEmu->ReadByte(0x8300), 0);	// interrupt handler has run
+
+	pEmu->Shutdown(/* bSaveData */ false);
+	delete pEmu;
+}
+
+TEST_F(FSpectrumEmuTest, InstructionLevelAnalysisTest)
+{
+	ASSERT_NE(pEmu, nullptr);
+	const int kNoFrames = 10;
+	const bool bOldInstructionLevel = GetGlobalConfig().bInstructionLevelAnalysis;
+
+	// same workload on a fresh emulator for each
+	std::vector<std::string> perTickPages, perTickEvents;
+	std::set<int> perTickEventTypes;
+	RunAnalysisWorkload(false, kNoFrames, perTickPages, perTickEvents, perTickEventTypes);
+
+	std::vector<std::string> instructionPages, instructionEvents;
+	std::set<int> instructionEventTypes;
+	RunAnalysisWorkload(true, kNoFrames, instructionPages, instructionEvents, instructionEventTypes);
+	GetGlobalConfig().bInstructionLevelAnalysis = bOldInstructionLevel;
+
+	EXPECT_FALSE(perTickPages.empty());
+	ASSERT_EQ(perTickPages.size(), instructionPages.size());
+	for (size_t i = 0; i < perTickPages.size(); i++)
+		EXPECT_EQ(perTickPages[i], instructionPages[i]);
+
+	// every kind of event the workload makes has to be there
+	EXPECT_FALSE(perTickEvents.empty());
+	for (EEventType eventType : { EEventType::ScreenPixWrite, EEventType::ScreenAttrWrite, EEventType::KeyboardRead, EEventType::SetBorderColour, EEventType::SwitchMemoryBanks })
+	{
+		EXPECT_EQ(perTickEventTypes.count((int)eventType), 1) << (int)eventType;
+		EXPECT_EQ(instructionEventTypes.count((int)eventType), 1) << (int)eventType;
+	}
+
+	ASSERT_EQ(perTickEvents.size(), instructionEvents.size());
+	for (size_t i = 0; i < perTickEvents.size(); i++)
+		EXPECT_EQ(perTickEvents[i], instructionEvents[i]);
+};
+
+// The 128K workload run for a second then every RAM bank given labels & comments,
+// so the json benchmark always saves & loads the same fully analysed game
+static FSpectrumEmu* CreateAnalysed128KGame()
+{
+	FSpectrumConfig config;
+	config.Model = ESpectrumModel::Spectrum128K;
+	config.SpecificGame = "ROM";	// to make it not load the last game
+	FSpectrumEmu* pEmu = new FSpectrumEmu;
+	pEmu->Init(config);
+
+	const std::vector<uint8_t> sna = MakeAnalysisWorkloadSNA();
+	EXPECT_TRUE(LoadSNAFromMemory(pEmu, sna.data(), sna.size()));
+	pEmu->CodeAnalysis.Debugger.Continue();
+	for (int frameNo = 0; frameNo < 50; frameNo++)
+		pEmu->TickEmulation(20000);
+
+	FCodeAnalysisState& state = pEmu->CodeAnalysis;
+	char text[64];
+	for (FCodeAnalysisBank& bank : state.GetBanks())
+	{
+		if (bank.bReadOnly)
+			continue;
+
+		for (int bankAddr = 0; bankAddr < bank.NoPages * FCodeAnalysisPage::kPageSize; bankAddr += 16)
+		{
+			const FAddressRef addrRef(bank.Id, (uint16_t)(bank.GetMappedAddress() + bankAddr));
+			AddLabelAtAddress(state, addrRef);
+			snprintf(text, sizeof(text), "bank %d offset %04X", bank.Id, bankAddr);
+			state.GetReadDataInfoForAddress(addrRef)->Comment = text;
+			if ((bankAddr & 63) == 0)
+				AddCommentBlock(state, addrRef)->Comment = text;
+		}
+	}
+
+	return pEmu;
+}
+
+template<typename F> static double TimeSeconds(F func)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	func();
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// streamed json save & load against building the whole document
+TEST_F(FSpectrumEmuTest, AnalysisJsonBenchmarkTest)
+{
+	ASSERT_NE(pEmu, nullptr);
+	FSpectrumEmu* pGameEmu = CreateAnalysed128KGame();
+	FCodeAnalysisState& state = pGameEmu->CodeAnalysis;
+	const char* pStreamedFile = "AnalysisJsonBenchmarkTest.json";
+	const char* pDocumentFile = "AnalysisJsonBenchmarkTest.document.json";
+
+	const FCodeAnalysisBank* pLastBank = nullptr;
+	for (const FCodeAnalysisBank& bank : state.GetBanks())
+	{
+		if (bank.bReadOnly == false)
+			pLastBank = &bank;
+	}
+	ASSERT_NE(pLastBank, nullptr);
+	const FAddressRef lastLabelAddr(pLastBank->Id, (uint16_t)(pLastBank->GetMappedAddress() + pLastBank->NoPages * FCodeAnalysisPage::kPageSize - 16));
+	ASSERT_NE(state.GetLabelForAddress(lastLabelAddr), nullptr);
+	const std::string lastLabelName = state.GetLabelForAddress(lastLabelAddr)->Name;
+
+	const double streamedSaveSeconds = TimeSeconds([&] { EXPECT_TRUE(ExportAnalysisJson(state, pStreamedFile)); });
+	const double documentSaveSeconds = TimeSeconds([&] { EXPECT_TRUE(ExportAnalysisJsonDocument(state, pDocumentFile)); });
+	EXPECT_EQ(ReadTextFile(pStreamedFile), ReadTextFile(pDocumentFile));
+
+	// loading replaces the analysis with what was saved, so both loads see the same game
+	const double streamedLoadSeconds = TimeSeconds([&] { EXPECT_TRUE(ImportAnalysisJson(state, pStreamedFile)); });
+	ASSERT_NE(state.GetLabelForAddress(lastLabelAddr), nullptr);
+	EXPECT_EQ(state.GetLabelForAddress(lastLabelAddr)->Name, lastLabelName);
+	const double documentLoadSeconds = TimeSeconds([&] { EXPECT_TRUE(ImportAnalysisJsonDocument(state, pDocumentFile)); });
+	ASSERT_NE(state.GetLabelForAddress(lastLabelAddr), nullptr);
+	EXPECT_EQ(state.GetLabelForAddress(lastLabelAddr)->Name, lastLabelName);
+
+	printf("Json save: %.3fs streamed, %.3fs document\n", streamedSaveSeconds, documentSaveSeconds);
+	printf("Json load: %.3fs streamed, %.3fs document\n", streamedLoadSeconds, documentLoadSeconds);
+
+	pGameEmu->Shutdown(/* bSaveData */ false);
+	delete pGameEmu;
+	remove(pStreamedFile);
+	remove(pDocumentFile);
+};
+
+// type & address of each item, comment lines are allocated per build so their pointers aren't compared
+static std::vector<std::string> DescribeItemList(const std::vector<FCodeAnalysisItem>& itemList)
+{
+	std::vector<std::string> desc;
+	for (const FCodeAnalysisItem& item : itemList)
+	{
+		char itemText[64];
+		const FItem* pItem = item.Item->Type == EItemType::CommentLine ? nullptr : item.Item;
+		snprintf(itemText, sizeof(itemText), "%d:%04X %d %p", item.AddressRef.BankId, item.AddressRef.Address, (int)item.Item->Type, (const void*)pItem);
+		desc.push_back(itemText);
+	}
+	return desc;
+}
+
+// update the item lists from the dirty pages and check they match rebuilding everything
+static void CheckIncrementalItemList(FCodeAnalysisState& state, const char* pStep)
+{
+	EXPECT_TRUE(state.IsCodeAnalysisDataDirty()) << pStep;
+	UpdateItemList(state);
+
+	std::vector<std::vector<std::string>> bankItems;
+	std::vector<std::vector<int>> bankPageStarts;
+	for (const FCodeAnalysisBank& bank : state.GetBanks())
+	{
+		bankItems.push_back(DescribeItemList(bank.ItemList));
+		bankPageStarts.push_back(bank.PageItemStart);
+	}
+	const std::vector<std::string> globalItems = DescribeItemList(state.ItemList);
+
+	for (FCodeAnalysisBank& bank : state.GetBanks())
+		bank.bIsDirty = true;
+	state.SetAddressRangeDirty();
+	UpdateItemList(state);
+
+	for (int bankNo = 0; bankNo < (int)state.GetBanks().size(); bankNo++)
+	{
+		const FCodeAnalysisBank& bank = state.GetBanks()[bankNo];
+		EXPECT_TRUE(bankItems[bankNo] == DescribeItemList(bank.ItemList)) << pStep << ": bank " << bank.Name;
+		EXPECT_TRUE(bankPageStarts[bankNo] == bank.PageItemStart) << pStep << ": bank " << bank.Name;
+	}
+	EXPECT_TRUE(globalItems == DescribeItemList(state.ItemList)) << pStep << ": global list";
+}
+
+TEST_F(FSpectrumEmuTest, ItemListIncrementalUpdateTest)
+{
+	ASSERT_NE(pEmu, nullptr);
+	FCodeAnalysisState& state = pEmu->CodeAnalysis;
+
+	state.SetAddressRangeDirty();
+	UpdateItemList(state);
+
+	// LD HL,$1234 on the last byte of a page, the operand is in the next page
+	pEmu->WriteByte(0x83FF, 0x21);
+	pEmu->WriteByte(0x8400, 0x34);
+	pEmu->WriteByte(0x8401, 0x12);
+	WriteCodeInfoForAddress(state, 0x83FF);
+	state.SetCodeAnalysisDirty(0x83FF);
+	CheckIncrementalItemList(state, "code over page end");
+
+	// data item running into the next page
+	FDataInfo* pDataInfo = state.GetReadDataInfoForAddress(0x87FE);
+	pDataInfo->DataType = EDataType::WordArray;
+	pDataInfo->ByteSize = 4;
+	state.SetCodeAnalysisDirty(0x87FE);
+	CheckIncrementalItemList(state, "data over page end");
+
+	// label & comment block on the first address of a page
+	AddLabel(state, 0x8C00, "incremental_label", ELabelType::Data);
+	AddCommentBlock(state, state.AddressRefFromPhysicalAddress(0x8C00))->Comment = "first line\nsecond line";
+	CheckIncrementalItemList(state, "label & comment block");
+
+	// only the pages the items start in are dirtied, the pages they ran into need rebuilding too
+	state.GetCodeInfoForAddress(0x83FF)->bDisabled = true;
+	state.SetCodeAnalysisDirty(0x83FF);
+	CheckIncrementalItemList(state, "code disabled");
+
+	pDataInfo->DataType = EDataType::Byte;
+	pDataInfo->ByteSize = 1;
+	state.SetCodeAnalysisDirty(0x87FE);
+	CheckIncrementalItemList(state, "data shrunk");
+
+	// removed label stays out of the pool until the lists no longer have it
+	const int noFreeLabels = state.ItemPools.Labels.GetNoFree();
+	RemoveLabelAtAddress(state, state.AddressRefFromPhysicalAddress(0x8C00));
+	EXPECT_EQ(state.ItemPools.Labels.GetNoFree(), noFreeLabels);
+	CheckIncrementalItemList(state, "label removed");
+	EXPECT_EQ(state.ItemPools.Labels.GetNoFree(), noFreeLabels + 1);
+};
+
+TEST_F(FSpectrumEmuTest, ItemIndexSearchTest)
+{
+	ASSERT_NE(pEmu, nullptr);
+	FCodeAnalysisState& state = pEmu->CodeAnalysis;
+
+	// LD HL,$1234 at the start of the bank, over a page end and at the end of the bank
+	const uint16_t codeAddresses[] = { 0x8000, 0x83FF, 0xBFFD };
+	for (uint16_t codeAddr : codeAddresses)
+	{
+		pEmu->WriteByte(codeAddr, 0x21);
+		pEmu->WriteByte(codeAddr + 1, 0x34);
+		pEmu->WriteByte(codeAddr + 2, 0x12);
+		WriteCodeInfoForAddress(state, codeAddr);
+	}
+	AddLabel(state, 0x8000, "search_start", ELabelType::Function);
+	AddLabel(state, 0xBFFF, "search_end", ELabelType::Data);
+	AddCommentBlock(state, state.AddressRefFromPhysicalAddress(0x9000))->Comment = "first line\nsecond line";
+	state.SetAddressRangeDirty();
+	UpdateItemList(state);
+
+	const int16_t bankId = state.GetBankFromAddress(0x8000);
+	const FCodeAnalysisBank* pBank = state.GetBank(bankId);
+	ASSERT_NE(pBank, nullptr);
+	const std::vector<FCodeAnalysisItem>& bankItems = pBank->ItemList;
+	ASSERT_FALSE(bankItems.empty());
+	const int bankStart = pBank->GetMappedAddress();
+	const int bankEnd = bankStart + pBank->GetSizeBytes();
+
+	EXPECT_EQ(GetItemIndexForAddress(state, { bankId, (uint16_t)(bankStart - 1) }), -1);
+	EXPECT_EQ(GetItemIndexForAddress(state, { bankId, (uint16_t)bankEnd }), -1);
+
+	// compare with walking through the bank's list
+	int lastIndex = -1;
+	int firstIndex = 0;
+	for (int addr = bankStart; addr < bankEnd; addr++)
+	{
+		while (lastIndex + 1 < (int)bankItems.size() && bankItems[lastIndex + 1].AddressRef.Address <= addr)
+			lastIndex++;
+		while (firstIndex < (int)bankItems.size() && bankItems[firstIndex].AddressRef.Address < addr)
+			firstIndex++;
+		const int expectedFirst = firstIndex < (int)bankItems.size() ? firstIndex : -1;
+
+		ASSERT_EQ(GetItemIndexForAddress(state, { bankId, (uint16_t)addr }), lastIndex) << "address " << addr;
+		ASSERT_EQ(GetFirstItemIndexAtAddress(state, bankItems, { bankId, (uint16_t)addr }), expectedFirst) << "address " << addr;
+	}
+
+	// global list over the whole address space
+	const std::vector<FCodeAnalysisItem>& globalItems = state.ItemList;
+	firstIndex = 0;
+	for (int addr = 0; addr < (1 << 16); addr++)
+	{
+		while (firstIndex < (int)globalItems.size() && globalItems[firstIndex].AddressRef.Address < addr)
+			firstIndex++;
+		const int expectedFirst = firstIndex < (int)globalItems.size() ? firstIndex : -1;
+		const FAddressRef addrRef = state.AddressRefFromPhysicalAddress((uint16_t)addr);
+
+		ASSERT_EQ(GetFirstItemIndexAtAddress(state, globalItems, addrRef), expectedFirst) << "address " << addr;
+	}
+};
 
 // needed to get it compiling
 void SetWindowTitle(const char* pTitle) {}
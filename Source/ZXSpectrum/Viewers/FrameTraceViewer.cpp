@@ -1,12 +1,17 @@
 #include "FrameTraceViewer.h"
 #include "ZXGraphicsView.h"
 #include "../SpectrumEmu.h"
+#include "../GameConfig.h"
+#include "../GlobalConfig.h"
 
 #include <imgui.h>
 #include <CodeAnalyser/UI/CodeAnalyserUI.h>
+#include <Debug/DebugLog.h>
 #include <ImGuiSupport/ImGuiTexture.h>
 
+#include <Util/FileUtil.h>
 #include <Util/Misc.h>
+#include <Util/PaletteConvert.h>
 
 
 void FFrameTraceViewer::Init(FSpectrumEmu* pEmu)
@@ -16,35 +21,72 @@ void FFrameTraceViewer::Init(FSpectrumEmu* pEmu)
 
 	// Init Frame Trace
 	for (int i = 0; i < kNoFramesInTrace; i++)
-	{
-		FrameTrace[i].Texture = ImGui_CreateTextureRGBA(pSpectrumEmu->SpectrumViewer.GetFrameBuffer(), dispInfo.frame.dim.width, dispInfo.frame.dim.height);
 		FrameTrace[i].CPUState = malloc(sizeof(z80_t));
-	}
+
+	const size_t noPixels = dispInfo.frame.dim.width * dispInfo.frame.dim.height;
+	ScreenPixels = new uint32_t[noPixels];
+	memset(ScreenPixels, 0, noPixels * sizeof(uint32_t));
+	ScreenTexture = ImGui_CreateTextureRGBA(ScreenPixels, dispInfo.frame.dim.width, dispInfo.frame.dim.height);
+
+	MemoryHistory.Init(16 * 1024, kNoFramesInMemoryHistory);
 
 	ShowWritesView = new FZXGraphicsView(320, 256);
 }
 
+static int GetRAMBanks(zx_t& zx, uint8_t* pBanks[8])
+{
+	const int noBanks = zx.type == ZX_TYPE_48K ? 3 : 8;
+	for (int i = 0; i < noBanks; i++)
+		pBanks[i] = zx.ram[i];
+	return noBanks;
+}
+
+// machine state stored with each frame of a session recording
+struct FSpeccyRecordedState
+{
+	z80_t	CPU;
+	uint8_t	MemoryBankRegister;
+};
+
 void FFrameTraceViewer::Reset()
 {
 	for (int i = 0; i < kNoFramesInTrace; i++)
 	{
 		auto& frame = FrameTrace[i];
-		frame.InstructionTrace.clear();
-		frame.FrameEvents.clear();
+		frame.InstructionTrace.Clear();
+		frame.FrameEvents = FEventRange();
 		frame.FrameOverview.clear();
 		frame.MemoryDiffs.clear();
+		frame.MemoryFrameNo = -1;
+		frame.Screen.reset();
 	}
+
+	DisplayedScreen.reset();
+	MemoryHistory.Reset();
+
+	// recordings belong to the game that was running
+	SessionRecorder.Close();
+	SessionPlayer.Close();
 }
 
 void	FFrameTraceViewer::Shutdown()
 {
 	for (int i = 0; i < kNoFramesInTrace; i++)
 	{
-		ImGui_FreeTexture(FrameTrace[i].Texture);
-		FrameTrace[i].Texture = nullptr;
+		FrameTrace[i].Screen.reset();
 		free(FrameTrace[i].CPUState);
+		FrameTrace[i].CPUState = nullptr;
 	}
 
+	SessionRecorder.Close();
+	SessionPlayer.Close();
+
+	ImGui_FreeTexture(ScreenTexture);
+	ScreenTexture = nullptr;
+	delete[] ScreenPixels;
+	ScreenPixels = nullptr;
+	DisplayedScreen.reset();
+
 	delete ShowWritesView;
 	ShowWritesView = nullptr;
 }
@@ -54,25 +96,46 @@ void FFrameTraceViewer::CaptureFrame()
 {
 	// set up new trace frame
 	FSpeccyFrameTrace& frame = FrameTrace[CurrentTraceFrame];
-	ImGui_UpdateTextureRGBA(frame.Texture, pSpectrumEmu->SpectrumViewer.GetFrameBuffer());
-	frame.InstructionTrace = pSpectrumEmu->CodeAnalysis.Debugger.GetFrameTrace();	// copy frame trace - use method?
-	frame.FrameEvents = pSpectrumEmu->CodeAnalysis.Debugger.GetEventTrace();
-	frame.FrameOverview.clear();
+	const int prevFrameIndex = CurrentTraceFrame == 0 ? kNoFramesInTrace - 1 : CurrentTraceFrame - 1;
+	const FSpeccyFrameTrace& prevFrame = FrameTrace[prevFrameIndex];
 
-	// copy memory
-	const int noBanks = pSpectrumEmu->ZXEmuState.type == ZX_TYPE_48K ? 3:8;
-	for (int i = 0; i < noBanks; i++)
-		memcpy(frame.MemoryBanks[i], pSpectrumEmu->ZXEmuState.ram[i], 16 * 1024);
+	// keep the emulator's palette indices - a static screen shares one copy
+	const chips_display_info_t disp = zx_display_info(&pSpectrumEmu->ZXEmuState);
+	const uint8_t* pPix = (const uint8_t*)disp.frame.buffer.ptr;
+	const size_t screenSize = disp.frame.buffer.size;
+	if (prevFrame.Screen != nullptr && prevFrame.Screen->size() == screenSize && memcmp(prevFrame.Screen->data(), pPix, screenSize) == 0)
+		frame.Screen = prevFrame.Screen;
+	else
+		frame.Screen = std::make_shared<const std::vector<uint8_t>>(pPix, pPix + screenSize);
+
+	frame.InstructionTrace.CopyFrom(pSpectrumEmu->CodeAnalysis.Debugger.GetFrameTrace());
+	frame.FrameEvents = pSpectrumEmu->CodeAnalysis.Debugger.GetEventTrace().GetFrameRange();	// events stay in the debugger's ring buffer
+	frame.FrameOverview.clear();
 
 	frame.MemoryBankRegister = pSpectrumEmu->ZXEmuState.last_mem_config;
 
 	// get CPU state
 	memcpy(frame.CPUState, &pSpectrumEmu->ZXEmuState.cpu, sizeof(z80_t));
 
-	// Generate diffs
-	const int prevFrameIndex = CurrentTraceFrame == 0 ? kNoFramesInTrace - 1 : CurrentTraceFrame - 1;
-	const FSpeccyFrameTrace& prevFrame = FrameTrace[prevFrameIndex];
+	FSpeccyRecordedState recordedState;
+	memset(&recordedState, 0, sizeof(recordedState));	// padding goes to disk too
+	recordedState.CPU = pSpectrumEmu->ZXEmuState.cpu;
+	recordedState.MemoryBankRegister = frame.MemoryBankRegister;
+
+	// capture memory - only pages that changed since the last capture are stored
+	// machine state goes in too so frames older than the trace can still be restored
+	uint8_t* pBanks[8];
+	const int noBanks = GetRAMBanks(pSpectrumEmu->ZXEmuState, pBanks);
+	frame.MemoryFrameNo = MemoryHistory.CaptureFrame(pBanks, noBanks, &recordedState, sizeof(recordedState));
 
+	if (SessionRecorder.IsOpen())
+	{
+		const FDebugger& debugger = pSpectrumEmu->CodeAnalysis.Debugger;
+		SessionRecorder.AddFrame(pSpectrumEmu->CodeAnalysis.CurrentFrameNo, debugger.GetFrameTrace(), debugger.GetEventTrace(), frame.FrameEvents,
+			&recordedState, sizeof(recordedState), pBanks);
+	}
+
+	// Generate diffs
 	// Not used atm
 	//GenerateMemoryDiff(frame, prevFrame, frame.MemoryDiffs);
 
@@ -83,51 +146,175 @@ void FFrameTraceViewer::CaptureFrame()
 
 void FFrameTraceViewer::RestoreFrame(const FSpeccyFrameTrace& frame)
 {
-	// restore CPU regs
-	memcpy(&pSpectrumEmu->ZXEmuState.cpu, frame.CPUState, sizeof(z80_t));
+	// rebuild memory from history
+	uint8_t* pBanks[8];
+	const int noBanks = GetRAMBanks(pSpectrumEmu->ZXEmuState, pBanks);
+	if (MemoryHistory.RestoreFrame(frame.MemoryFrameNo, pBanks, noBanks) == false)
+		return;
 
-	// restore memory
-	const int noBanks = pSpectrumEmu->ZXEmuState.type == ZX_TYPE_48K ? 3 : 8;
-	for (int i = 0; i < noBanks; i++)
-		memcpy(pSpectrumEmu->ZXEmuState.ram[i],frame.MemoryBanks[i],  16 * 1024);
+	RestoreMachineState(frame.CPUState, frame.MemoryBankRegister);
+}
+
+// frames older than the trace only have memory & machine state
+void FFrameTraceViewer::RestoreHistoryFrame(int memoryFrameNo)
+{
+	uint8_t* pBanks[8];
+	const int noBanks = GetRAMBanks(pSpectrumEmu->ZXEmuState, pBanks);
+	FSpeccyRecordedState recordedState;
+	if (MemoryHistory.GetMachineState(memoryFrameNo, &recordedState, sizeof(recordedState)) == false ||
+		MemoryHistory.RestoreFrame(memoryFrameNo, pBanks, noBanks) == false)
+		return;
+
+	RestoreMachineState(&recordedState.CPU, recordedState.MemoryBankRegister);
+}
+
+// emulation carries on from a restored frame so the frames after it are dropped
+void FFrameTraceViewer::DiscardHistoryAfter(int memoryFrameNo)
+{
+	if (MemoryHistory.IsFrameAvailable(memoryFrameNo) == false)
+		return;
+
+	MemoryHistory.DiscardFramesAfter(memoryFrameNo);
+	for (int i = 0; i < kNoFramesInTrace; i++)
+	{
+		if (FrameTrace[i].MemoryFrameNo > memoryFrameNo)
+			FrameTrace[i].MemoryFrameNo = -1;	// numbers get reused
+	}
+}
+
+void FFrameTraceViewer::RestoreMachineState(const void* pCPUState, uint8_t memoryBankRegister)
+{
+	// restore CPU regs
+	memcpy(&pSpectrumEmu->ZXEmuState.cpu, pCPUState, sizeof(z80_t));
 
 	// restore bank setup
 	if (pSpectrumEmu->ZXEmuState.type == ZX_TYPE_128)
 	{
-		pSpectrumEmu->ZXEmuState.last_mem_config = frame.MemoryBankRegister;
+		pSpectrumEmu->ZXEmuState.last_mem_config = memoryBankRegister;
 
 		// bit 3 defines the video scanout memory bank (5 or 7) 
-		pSpectrumEmu->ZXEmuState.display_ram_bank = (frame.MemoryBankRegister & (1 << 3)) ? 7 : 5;
+		pSpectrumEmu->ZXEmuState.display_ram_bank = (memoryBankRegister & (1 << 3)) ? 7 : 5;
 
 		// map last bank
-		mem_map_ram(&pSpectrumEmu->ZXEmuState.mem, 0, 0xC000, 0x4000, pSpectrumEmu->ZXEmuState.ram[frame.MemoryBankRegister & 0x7]);
+		mem_map_ram(&pSpectrumEmu->ZXEmuState.mem, 0, 0xC000, 0x4000, pSpectrumEmu->ZXEmuState.ram[memoryBankRegister & 0x7]);
 
 		// map ROM
-		if (frame.MemoryBankRegister & (1 << 4)) // bit 4 set: ROM1 
+		if (memoryBankRegister & (1 << 4)) // bit 4 set: ROM1 
 			mem_map_rom(&pSpectrumEmu->ZXEmuState.mem, 0, 0x0000, 0x4000, pSpectrumEmu->ZXEmuState.rom[1]);
 		else // bit 4 clear: ROM0 
 			mem_map_rom(&pSpectrumEmu->ZXEmuState.mem, 0, 0x0000, 0x4000, pSpectrumEmu->ZXEmuState.rom[0]);
 
 		// Set code analysis banks
-		pSpectrumEmu->SetROMBank(frame.MemoryBankRegister & (1 << 4) ? 1 : 0);
-		pSpectrumEmu->SetRAMBank(3, frame.MemoryBankRegister & 0x7);
+		pSpectrumEmu->SetROMBank(memoryBankRegister & (1 << 4) ? 1 : 0);
+		pSpectrumEmu->SetRAMBank(3, memoryBankRegister & 0x7);
+	}
+}
+
+// rebuild a frame from the session recording - memory comes from the nearest keyframe before it
+bool FFrameTraceViewer::RestoreRecordedFrame(int frameNo)
+{
+	uint8_t* pBanks[8];
+	const int noBanks = GetRAMBanks(pSpectrumEmu->ZXEmuState, pBanks);
+	if (SessionPlayer.ReadFrame(frameNo, RecordedFrame) == false)
+		return false;
+	if (SessionPlayer.GetNoBanks() != noBanks || RecordedFrame.MachineState.size() != sizeof(FSpeccyRecordedState))
+	{
+		LOGWARNING("Session recording was made on a different machine type");
+		return false;
 	}
+
+	const int bankSize = SessionPlayer.GetBankSize();
+	for (int bankNo = 0; bankNo < noBanks; bankNo++)
+		memcpy(pBanks[bankNo], RecordedFrame.Memory.data() + bankNo * bankSize, bankSize);
+
+	FSpeccyRecordedState recordedState;
+	memcpy(&recordedState, RecordedFrame.MachineState.data(), sizeof(recordedState));
+	RestoreMachineState(&recordedState.CPU, recordedState.MemoryBankRegister);
+	return true;
+}
+
+static std::string GetSessionTraceDir()
+{
+	return GetGlobalConfig().WorkspaceRoot + "SessionTraces/";
+}
+
+std::string FFrameTraceViewer::GetSessionTraceFileName() const
+{
+	const FGame* pActiveGame = pSpectrumEmu->pActiveGame;
+	return GetSessionTraceDir() + (pActiveGame != nullptr ? pActiveGame->pConfig->Name : std::string("Session")) + ".trace";
+}
+
+void FFrameTraceViewer::DrawSessionRecording()
+{
+	const std::string fileName = GetSessionTraceFileName();
+
+	if (SessionRecorder.IsOpen())
+	{
+		if (ImGui::Button("Stop Recording"))
+			SessionRecorder.Close();
+		ImGui::SameLine();
+		ImGui::Text("Recording %s: %d frames, %d dropped, %dK", SessionRecorder.GetFileName().c_str(), SessionRecorder.GetNoFramesWritten(),
+			SessionRecorder.GetNoFramesDropped(), (int)(SessionRecorder.GetBytesWritten() / 1024));
+		return;
+	}
+
+	if (ImGui::Button("Record Session"))
+	{
+		SessionPlayer.Close();	// might be the same file
+		EnsureDirectoryExists(GetSessionTraceDir().c_str());
+		uint8_t* pBanks[8];
+		const int noBanks = GetRAMBanks(pSpectrumEmu->ZXEmuState, pBanks);
+		SessionRecorder.Open(fileName.c_str(), 16 * 1024, noBanks);
+	}
+	ImGui::SameLine();
+	ImGui::Text("%s", fileName.c_str());
+
+	ImGui::Separator();
+	if (SessionPlayer.IsOpen() == false)
+	{
+		if (ImGui::Button("Open Recording") && SessionPlayer.Open(fileName.c_str()))
+			RecordedFrameNo = SessionPlayer.GetFirstFrameNo();
+		return;
+	}
+
+	ImGui::Text("Recorded frames %d - %d", SessionPlayer.GetFirstFrameNo(), SessionPlayer.GetLastFrameNo());
+	ImGui::SliderInt("Frame", &RecordedFrameNo, SessionPlayer.GetFirstFrameNo(), SessionPlayer.GetLastFrameNo());
+	if (ImGui::Button("Restore"))
+	{
+		if (RestoreRecordedFrame(RecordedFrameNo))
+			pSpectrumEmu->CodeAnalysis.Debugger.Continue();
+		else
+			LOGWARNING("Frame %d isn't in the session recording", RecordedFrameNo);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Close Recording"))
+		SessionPlayer.Close();
 }
 
 void FFrameTraceViewer::Draw()
 {
+	// the memory history can go back further than the full trace
+	const int maxShowFrame = std::max(kNoFramesInTrace, MemoryHistory.GetNoFrames()) - 1;
+
 	if (ImGui::ArrowButton("##left", ImGuiDir_Left))
 		ShowFrame = std::max(--ShowFrame, 0);
 
 	ImGui::SameLine();
 
 	if (ImGui::ArrowButton("##right", ImGuiDir_Right))
-		ShowFrame = std::min(++ShowFrame, kNoFramesInTrace - 1);
+		ShowFrame = std::min(++ShowFrame, maxShowFrame);
 
 	ImGui::SameLine();
-	int frameNo = 0;
-
-	if (ImGui::SliderInt("Backwards Offset", &ShowFrame, 0, kNoFramesInTrace - 1))
+	ShowFrame = std::min(ShowFrame, maxShowFrame);
+	const bool bSliderChanged = ImGui::SliderInt("Backwards Offset", &ShowFrame, 0, maxShowFrame);
+	const bool bTraceFrame = ShowFrame < kNoFramesInTrace;
+	const int memoryFrameNo = MemoryHistory.GetLastFrameNo() - ShowFrame;
+	int frameNo = CurrentTraceFrame - ShowFrame - 1;
+	if (frameNo < 0)
+		frameNo += kNoFramesInTrace;
+	FSpeccyFrameTrace& frame = bTraceFrame ? FrameTrace[frameNo] : HistoryOnlyFrame;
+
+	if (bSliderChanged)
 	{
 		if (ShowFrame == 0)
 			pSpectrumEmu->CodeAnalysis.Debugger.Continue();
@@ -136,39 +323,57 @@ void FFrameTraceViewer::Draw()
 
 		PixelWriteline = -1;
 		SelectedTraceLine = -1;
-		frameNo = CurrentTraceFrame - ShowFrame - 1;
-		if (frameNo < 0)
-			frameNo += kNoFramesInTrace;
-		DrawFrameScreenWritePixels(FrameTrace[frameNo]);
+		DrawFrameScreenWritePixels(frame);
 
 		if (RestoreOnScrub)
-			RestoreFrame(FrameTrace[frameNo]);
-	}
-	else
-	{
-		frameNo = CurrentTraceFrame - ShowFrame - 1;
-		if (frameNo < 0)
-			frameNo += kNoFramesInTrace;
+		{
+			if (bTraceFrame)
+				RestoreFrame(frame);
+			else
+				RestoreHistoryFrame(memoryFrameNo);
+		}
 	}
-	const FSpeccyFrameTrace& frame = FrameTrace[frameNo];
-	
 
 	if (ImGui::Button("Restore"))
 	{
-		RestoreFrame(frame);
+		if (bTraceFrame)
+		{
+			RestoreFrame(frame);
+			DiscardHistoryAfter(frame.MemoryFrameNo);
+			CurrentTraceFrame = frameNo;
+		}
+		else
+		{
+			RestoreHistoryFrame(memoryFrameNo);
+			DiscardHistoryAfter(memoryFrameNo);
+		}
 
 		// continue running
 		pSpectrumEmu->CodeAnalysis.Debugger.Continue();
 
-		CurrentTraceFrame = frameNo;
 		ShowFrame = 0;
 	}
 	ImGui::SameLine();
 	ImGui::Checkbox("Restore On Scrub", &RestoreOnScrub);
+	ImGui::SameLine();
+	size_t traceMemory = 0;
+	for (int i = 0; i < kNoFramesInTrace; i++)
+		traceMemory += FrameTrace[i].InstructionTrace.GetMemoryUsage();
+	ImGui::Text("History: %d frames, %d keyframes, %dK, trace %dK", MemoryHistory.GetNoFrames(), MemoryHistory.GetNoKeyFrames(), (int)(MemoryHistory.GetMemoryUsage() / 1024), (int)(traceMemory / 1024));
+	if (bTraceFrame == false)
+		ImGui::Text("Frame is older than the trace, only memory & CPU state are kept");
 	
 	ImVec2 uv0(0, 0);
 	ImVec2 uv1(320.0f / 512.0f, 1.0f);
-	ImGui::Image(frame.Texture, ImVec2(320, 256), uv0, uv1);
+	if (frame.Screen != nullptr && frame.Screen != DisplayedScreen)
+	{
+		const chips_display_info_t disp = zx_display_info(&pSpectrumEmu->ZXEmuState);
+		const int noPixels = std::min((int)frame.Screen->size(), disp.frame.dim.width * disp.frame.dim.height);
+		ConvertPalettedToRGBA(frame.Screen->data(), ScreenPixels, noPixels, (const uint32_t*)disp.palette.ptr, (int)(disp.palette.size / sizeof(uint32_t)));
+		ImGui_UpdateTextureRGBA(ScreenTexture, ScreenPixels);
+		DisplayedScreen = frame.Screen;
+	}
+	ImGui::Image(ScreenTexture, ImVec2(320, 256), uv0, uv1);
 	ImGui::SameLine();
 
 	ShowWritesView->Draw();
@@ -185,7 +390,7 @@ void FFrameTraceViewer::Draw()
 		if (ImGui::BeginTabItem("Trace Overview"))
 		{
 			if (frame.FrameOverview.size() == 0)
-				GenerateTraceOverview(FrameTrace[frameNo]);
+				GenerateTraceOverview(frame);
 			DrawTraceOverview(frame);
 			ImGui::EndTabItem();
 		}
@@ -202,6 +407,12 @@ void FFrameTraceViewer::Draw()
 			ImGui::EndTabItem();
 		}
 
+		if (ImGui::BeginTabItem("Session Recording"))
+		{
+			DrawSessionRecording();
+			ImGui::EndTabItem();
+		}
+
 		ImGui::EndTabBar();
 	}
 	
@@ -212,13 +423,17 @@ void	FFrameTraceViewer::DrawInstructionTrace(const FSpeccyFrameTrace& frame)
 	FCodeAnalysisState& state = pSpectrumEmu->CodeAnalysis;
 	FCodeAnalysisViewState& viewState = state.GetFocussedViewState();
 	const float line_height = ImGui::GetTextLineHeight();
-	ImGuiListClipper clipper((int)frame.InstructionTrace.size(), line_height);
+	ImGuiListClipper clipper(frame.InstructionTrace.GetNoEntries(), line_height);
 
 	while (clipper.Step())
 	{
+		// only the visible lines are decoded
+		TraceLines.clear();
+		frame.InstructionTrace.GetEntries(clipper.DisplayStart, clipper.DisplayEnd - clipper.DisplayStart, TraceLines);
+
 		for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
 		{
-			const FAddressRef instAddr = frame.InstructionTrace[i];
+			const FAddressRef instAddr = TraceLines[i - clipper.DisplayStart];
 
 			ImGui::PushID(i);
 
@@ -247,54 +462,28 @@ void	FFrameTraceViewer::GenerateTraceOverview(FSpeccyFrameTrace& frame)
 {
 	FCodeAnalysisState& state = pSpectrumEmu->CodeAnalysis;
 	frame.FrameOverview.clear();
-	for (int i = 0; i < frame.InstructionTrace.size(); i++)
+	TraceLines.clear();
+	frame.InstructionTrace.GetEntries(0, frame.InstructionTrace.GetNoEntries(), TraceLines);
+	for (const FAddressRef instAddr : TraceLines)
 	{
-		const FAddressRef instAddr = frame.InstructionTrace[i];
 
-		// TODO: find closest global label
-		int labelOffset = 0;
-		uint16_t labelAddress = 0;
-		uint16_t functionAddress = 0;
-		const char* pLabelString = nullptr;
-		bool bFound = false;
+		// closest code label, then the function it's in - a function with no label after it is its own label
+		FLabelSearchResult label;
+		if (FindLabelBeforeAddress(state, instAddr, ELabelRangeType::Code, label) == false)
+			continue;
 
-		//for (int traceIndex = i; traceIndex >= 0; traceIndex--)
-		for (int addrVal = instAddr.Address; addrVal >= 0; addrVal--)
-		{
-			//uint16_t addrVal = frame.InstructionTrace[traceIndex];
-			const FLabelInfo* pLabel = state.GetLabelForAddress(addrVal);
-			if (pLabel != nullptr && (pLabel->LabelType == ELabelType::Code || pLabel->LabelType == ELabelType::Function))
-			{
-				if (pLabel->LabelType == ELabelType::Function)
-				{
-					functionAddress = addrVal;
-					pLabelString = pLabel->Name.c_str();
-					bFound = true;
-					if (labelAddress == 0)	// we found a function before a label
-					{
-						labelAddress = functionAddress;
-					}
-					break;
-				}
-				if (pLabel->LabelType == ELabelType::Code)
-				{
-					labelAddress = addrVal;
-				}
-			}
-
-			labelOffset++;
-		}
+		FLabelSearchResult function = label;
+		if (label.pLabel->LabelType != ELabelType::Function && FindLabelBeforeAddress(state, label.LabelAddress, ELabelRangeType::Function, function) == false)
+			continue;
 
-		if (bFound)
+		const uint16_t labelAddress = label.LabelAddress.Address;
+		if (frame.FrameOverview.empty() || frame.FrameOverview.back().LabelAddress != labelAddress)
 		{
-			if (frame.FrameOverview.empty() || frame.FrameOverview.back().LabelAddress != labelAddress)
-			{
-				FFrameOverviewItem newItem;
-				newItem.Label = pLabelString;
-				newItem.LabelAddress = labelAddress;
-				newItem.FunctionAddress = functionAddress;
-				frame.FrameOverview.push_back(newItem);
-			}
+			FFrameOverviewItem newItem;
+			newItem.Label = function.pLabel->Name;
+			newItem.LabelAddress = labelAddress;
+			newItem.FunctionAddress = function.LabelAddress.Address;
+			frame.FrameOverview.push_back(newItem);
 		}
 	}
 }
@@ -306,17 +495,34 @@ void FFrameTraceViewer::GenerateMemoryDiff(const FSpeccyFrameTrace& frame, const
 	// diff RAM with previous frame
 	// skip ROM & screen memory
 	// might want to exclude stack (once we determine where it is)
+	// frames are rebuilt from the memory history
+	// the older frame is rebuilt first so the newer one only applies the deltas in between
 	const int noBanks = pSpectrumEmu->ZXEmuState.type == ZX_TYPE_48K ? 3 : 8;
+	std::vector<uint8_t> frameMem(noBanks * 16 * 1024), otherMem(noBanks * 16 * 1024);
+	uint8_t* pFrameBanks[8];
+	uint8_t* pOtherBanks[8];
+	for (int i = 0; i < noBanks; i++)
+	{
+		pFrameBanks[i] = &frameMem[i * 16 * 1024];
+		pOtherBanks[i] = &otherMem[i * 16 * 1024];
+	}
+
+	const bool bOtherFirst = otherFrame.MemoryFrameNo < frame.MemoryFrameNo;
+	if (MemoryHistory.RestoreFrame(bOtherFirst ? otherFrame.MemoryFrameNo : frame.MemoryFrameNo, bOtherFirst ? pOtherBanks : pFrameBanks, noBanks) == false ||
+		MemoryHistory.RestoreFrame(bOtherFirst ? frame.MemoryFrameNo : otherFrame.MemoryFrameNo, bOtherFirst ? pFrameBanks : pOtherBanks, noBanks) == false)
+		return;
+
 	for (int bankNo = 0; bankNo < noBanks; bankNo++)
 	{
 		for (int addr = 0; addr < 16 * 1024; addr++)
 		{
-			if (frame.MemoryBanks[bankNo][addr] != otherFrame.MemoryBanks[bankNo][addr])
+			if (pFrameBanks[bankNo][addr] != pOtherBanks[bankNo][addr])
 			{
 				FMemoryDiff diff;
+				diff.Bank = bankNo;
 				diff.Address = addr;
-				diff.NewVal = frame.MemoryBanks[bankNo][addr];
-				diff.OldVal = otherFrame.MemoryBanks[bankNo][addr];
+				diff.NewVal = pFrameBanks[bankNo][addr];
+				diff.OldVal = pOtherBanks[bankNo][addr];
 				outDiff.push_back(diff);
 			}
 		}
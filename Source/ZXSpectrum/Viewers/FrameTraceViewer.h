@@ -2,8 +2,11 @@
 
 
 #include "CodeAnalyser/CodeAnalyser.h"
+#include "CodeAnalyser/SessionTrace.h"
+#include "Util/MemoryHistory.h"
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -44,13 +47,13 @@ struct FMemoryDiff
 
 struct FSpeccyFrameTrace
 {
-	void*					Texture = nullptr;
-	uint8_t					MemoryBanks[8][16 * 1024];	// 8 x 16K banks
+	std::shared_ptr<const std::vector<uint8_t>>	Screen;	// palette indices, shared with the previous frame if it didn't change
+	int						MemoryFrameNo = -1;	// frame in memory history
 	uint8_t					MemoryBankRegister = 0;
 	void*					CPUState = nullptr;
-	std::vector<FAddressRef>	InstructionTrace;
+	FInstructionTrace			InstructionTrace;
 	std::vector<FMemoryAccess>	ScreenPixWrites;
-	std::vector<FEvent>			FrameEvents;
+	FEventRange					FrameEvents;	// range in the debugger's event trace
 
 	std::vector<FFrameOverviewItem>	FrameOverview;
 	std::vector<FMemoryDiff>	MemoryDiffs;
@@ -66,6 +69,12 @@ public:
 	void	Draw();
 private:
 	void	RestoreFrame(const FSpeccyFrameTrace& frame);
+	void	RestoreHistoryFrame(int memoryFrameNo);
+	void	DiscardHistoryAfter(int memoryFrameNo);
+	void	RestoreMachineState(const void* pCPUState, uint8_t memoryBankRegister);
+	bool	RestoreRecordedFrame(int frameNo);
+	std::string	GetSessionTraceFileName() const;
+	void	DrawSessionRecording();
 	void	DrawInstructionTrace(const FSpeccyFrameTrace& frame);
 	void	GenerateTraceOverview(FSpeccyFrameTrace& frame);
 	void	GenerateMemoryDiff(const FSpeccyFrameTrace& frameA, const FSpeccyFrameTrace& frameB, std::vector<FMemoryDiff>& outDiff);
@@ -81,7 +90,22 @@ private:
 	bool				RestoreOnScrub = false;
 	static const int	kNoFramesInTrace = 300;
 	FSpeccyFrameTrace	FrameTrace[kNoFramesInTrace];
+	static const int	kNoFramesInMemoryHistory = 50 * 60;	// a minute, memory deltas are much smaller than a full trace frame
+	FMemoryHistory		MemoryHistory;
+	FSpeccyFrameTrace	HistoryOnlyFrame;	// stands in for frames older than the trace
 
+	// optional recording of the whole session to disk
+	FSessionTraceWriter	SessionRecorder;
+	FSessionTraceReader	SessionPlayer;
+	FSessionTraceFrame	RecordedFrame;
+	int					RecordedFrameNo = 0;
+
+	// frames are only converted & uploaded when they're shown
+	void*				ScreenTexture = nullptr;
+	uint32_t*			ScreenPixels = nullptr;
+	std::shared_ptr<const std::vector<uint8_t>>	DisplayedScreen;
+
+	std::vector<FAddressRef>	TraceLines;	// decoded part of the instruction trace being drawn
 	int		SelectedTraceLine = -1;
 	int		PixelWriteline = -1;
 	FZXGraphicsView*	ShowWritesView = nullptr;
@@ -15,13 +15,39 @@
 static int kGraphicsViewerWidth = 256;
 static int kGraphicsViewerHeight = 512;
 
+// pixel masks for each bit of a byte, left most pixel first
+static uint32_t g_ByteExpandLUT[256][8];
+
+static void InitByteExpandLUT()
+{
+	for (int byteVal = 0; byteVal < 256; byteVal++)
+	{
+		for (int xpix = 0; xpix < 8; xpix++)
+			g_ByteExpandLUT[byteVal][xpix] = (byteVal & (1 << (7 - xpix))) != 0 ? 0xffffffff : 0;
+	}
+}
+
+static inline void ExpandCharLine(uint32_t* pDest, uint8_t charLine, uint32_t inkCol, uint32_t paperCol)
+{
+	const uint32_t* pMask = g_ByteExpandLUT[charLine];
+	for (int xpix = 0; xpix < 8; xpix++)
+		pDest[xpix] = (inkCol & pMask[xpix]) | (paperCol & ~pMask[xpix]);
+}
+
 bool InitGraphicsViewer(FGraphicsViewerState &state)
 {
 	state.pGraphicsView = new FZXGraphicsView(kGraphicsViewerWidth, kGraphicsViewerHeight);
+	InitByteExpandLUT();
 
 	return true;
 }
 
+void ShutdownGraphicsViewer(FGraphicsViewerState &state)
+{
+	delete state.pGraphicsView;
+	state.pGraphicsView = nullptr;
+}
+
 // speccy colour CLUT
 static const uint32_t g_kColourLUT[8] =
 {
@@ -98,18 +124,18 @@ uint8_t GetHeatmapColourForMemoryAddress(const FCodeAnalysisPage& page, uint16_t
 			return 6;	// yellow code
 	}
 
-	const FDataInfo& dataInfo = page.DataInfo[pageAddress];
-	
-	if (dataInfo.LastFrameWritten != -1)
+	const int lastFrameWritten = page.LastFrameWritten[pageAddress];
+	if (lastFrameWritten != -1)
 	{
-		const int framesSinceWritten = currentFrameNo - dataInfo.LastFrameWritten;
+		const int framesSinceWritten = currentFrameNo - lastFrameWritten;
 		if (framesSinceWritten < frameThreshold)
 			return 2; // red
 	}
 
-	if (dataInfo.LastFrameRead != -1)
+	const int lastFrameRead = page.LastFrameRead[pageAddress];
+	if (lastFrameRead != -1)
 	{
-		const int framesSinceRead = currentFrameNo - dataInfo.LastFrameRead;
+		const int framesSinceRead = currentFrameNo - lastFrameRead;
 		if (framesSinceRead < frameThreshold)
 			return 4;	// green
 	}	
@@ -117,6 +143,69 @@ uint8_t GetHeatmapColourForMemoryAddress(const FCodeAnalysisPage& page, uint16_t
 	return 7;
 }
 
+// work out the heatmap colour of every byte in a page in one pass
+// a straight run over the frame arrays so the compiler can vectorise it
+static void ClassifyPageAccesses(const int* pLastFrameRead, const int* pLastFrameWritten, const int* pLastFrameExecuted, int currentFrameNo, int frameThreshold, uint8_t* pOutColours)
+{
+	for (int pageAddr = 0; pageAddr < FCodeAnalysisPage::kPageSize; pageAddr++)
+	{
+		const bool bRead = pLastFrameRead[pageAddr] != -1 && (currentFrameNo - pLastFrameRead[pageAddr] < frameThreshold);
+		const bool bWritten = pLastFrameWritten[pageAddr] != -1 && (currentFrameNo - pLastFrameWritten[pageAddr] < frameThreshold);
+		const bool bExecuted = pLastFrameExecuted[pageAddr] != -1 && (currentFrameNo - pLastFrameExecuted[pageAddr] < frameThreshold);
+
+		// same priority as GetHeatmapColourForMemoryAddress: code, then written, then read
+		uint8_t col = bRead ? 4 : 7;	// green
+		col = bWritten ? 2 : col;	// red
+		col = bExecuted ? 6 : col;	// yellow
+		pOutColours[pageAddr] = col;
+	}
+}
+
+struct FGraphicsViewerPage
+{
+	const uint8_t*	pMemory = nullptr;
+	const uint8_t*	pHeatmap = nullptr;
+};
+
+// Get a page's memory & heatmap colours, from the UI snapshot if there is one so drawing doesn't touch the live analysis state.
+// The heatmap is only worked out again when the frame, threshold or page changes.
+static FGraphicsViewerPage GetGraphicsViewerPage(FGraphicsViewerState& viewerState, const FCodeAnalysisBank* pBank, int pageNo)
+{
+	const FAnalysisFrameSnapshot* pSnapshot = viewerState.pEmu->GetUISnapshot();
+	const FPageSnapshot* pPageSnapshot = pSnapshot != nullptr ? pSnapshot->GetPage(pBank->Id, pageNo) : nullptr;
+	const FCodeAnalysisPage& page = pBank->Pages[pageNo];
+	const int frameNo = pPageSnapshot != nullptr ? pSnapshot->FrameNo : viewerState.pEmu->CodeAnalysis.CurrentFrameNo;
+	const uint32_t changeCount = pPageSnapshot != nullptr ? pPageSnapshot->ChangeCount : page.SnapshotChangeCount;
+
+	FHeatmapPage& heatmap = viewerState.HeatmapPages[((uint32_t)(uint16_t)pBank->Id << 16) | pageNo];
+	if (heatmap.Colours.empty() || heatmap.FrameNo != frameNo || heatmap.Threshold != viewerState.HeatmapThreshold || heatmap.ChangeCount != changeCount)
+	{
+		heatmap.Colours.resize(FCodeAnalysisPage::kPageSize);
+		if (pPageSnapshot != nullptr)
+		{
+			ClassifyPageAccesses(pPageSnapshot->LastFrameRead, pPageSnapshot->LastFrameWritten, pPageSnapshot->LastFrameExecuted, frameNo, viewerState.HeatmapThreshold, heatmap.Colours.data());
+		}
+		else
+		{
+			int lastFrameExecuted[FCodeAnalysisPage::kPageSize];
+			for (int pageAddr = 0; pageAddr < FCodeAnalysisPage::kPageSize; pageAddr++)
+			{
+				const FCodeInfo* pCodeInfo = page.CodeInfo[pageAddr];
+				lastFrameExecuted[pageAddr] = pCodeInfo != nullptr ? pCodeInfo->FrameLastExecuted : -1;
+			}
+			ClassifyPageAccesses(page.LastFrameRead, page.LastFrameWritten, lastFrameExecuted, frameNo, viewerState.HeatmapThreshold, heatmap.Colours.data());
+		}
+		heatmap.FrameNo = frameNo;
+		heatmap.Threshold = viewerState.HeatmapThreshold;
+		heatmap.ChangeCount = changeCount;
+	}
+
+	FGraphicsViewerPage viewerPage;
+	viewerPage.pMemory = pPageSnapshot != nullptr ? pPageSnapshot->Memory : pBank->Memory + (pageNo * FCodeAnalysisPage::kPageSize);
+	viewerPage.pHeatmap = heatmap.Colours.data();
+	return viewerPage;
+}
+
 void DrawMemoryBankAsGraphicsColumn(FGraphicsViewerState& viewerState, int16_t bankId, uint16_t memAddr, int xPos, int columnWidth)
 {
 	FZXGraphicsView* pGraphicsView = viewerState.pGraphicsView;
@@ -124,15 +213,28 @@ void DrawMemoryBankAsGraphicsColumn(FGraphicsViewerState& viewerState, int16_t b
 	FCodeAnalysisBank* pBank = state.GetBank(bankId);
 	const uint16_t bankSizeMask = pBank->SizeMask;
 
+	uint32_t inkCols[8];
+	for (int i = 0; i < 8; i++)
+		inkCols[i] = pGraphicsView->GetColFromAttr(i, false);
+	const uint32_t paperCol = inkCols[0];
+
+	int curPageNo = -1;
+	FGraphicsViewerPage page;
 	for (int y = 0; y < kGraphicsViewerHeight; y++)
 	{
+		uint32_t* pLineAddr = pGraphicsView->GetPixelBuffer() + (y * kGraphicsViewerWidth) + xPos;
 		for (int xChar = 0; xChar < columnWidth; xChar++)
 		{
 			const uint16_t bankAddr = memAddr & bankSizeMask;
-			const uint8_t charLine = pBank->Memory[bankAddr];
-			FCodeAnalysisPage& page = pBank->Pages[bankAddr >> FCodeAnalysisPage::kPageShift];
-			const uint8_t col = GetHeatmapColourForMemoryAddress(page, memAddr, state.CurrentFrameNo,viewerState.HeatmapThreshold);
-			pGraphicsView->DrawCharLine(charLine, xPos + (xChar * 8), y, col);
+			const int pageNo = bankAddr >> FCodeAnalysisPage::kPageShift;
+			if (pageNo != curPageNo)
+			{
+				page = GetGraphicsViewerPage(viewerState, pBank, pageNo);
+				curPageNo = pageNo;
+			}
+
+			const uint16_t pageAddr = bankAddr & FCodeAnalysisPage::kPageMask;
+			ExpandCharLine(pLineAddr + (xChar * 8), page.pMemory[pageAddr], inkCols[page.pHeatmap[pageAddr]], paperCol);
 
 			memAddr++;
 		}
@@ -390,22 +492,12 @@ void DrawGraphicsViewer(FGraphicsViewerState &viewerState)
 			// determine dest pointer for scanline
 			uint32_t* pLineAddr = pGraphicsView->GetPixelBuffer() + (yDestPos * kGraphicsViewerWidth);
 
-			// pixel line
+			// pixel line - 32 bytes never cross a page
+			const FGraphicsViewerPage page = GetGraphicsViewerPage(viewerState, pBank, bankAddr >> FCodeAnalysisPage::kPageShift);
 			for (int x = 0; x < 256 / 8; x++)
 			{
-				const uint8_t charLine = pBank->Memory[bankAddr];
-				FCodeAnalysisPage& page = pBank->Pages[bankAddr >> 10];
-				const uint8_t col = GetHeatmapColourForMemoryAddress(page, bankAddr, state.CurrentFrameNo, viewerState.HeatmapThreshold);
-
-				//const uint8_t col = GetHeatmapColourForMemoryAddress(viewerState.pEmu->CodeAnalysis, addr, viewerState.HeatmapThreshold);
-				
-				for (int xpix = 0; xpix < 8; xpix++)
-				{
-					const bool bSet = (charLine & (1 << (7 - xpix))) != 0;
-					const uint32_t colRGBA = bSet ? g_kColourLUT[col] : 0xff000000;
-					*(pLineAddr + xpix + (x * 8)) = colRGBA;
-				}
-
+				const uint16_t pageAddr = bankAddr & FCodeAnalysisPage::kPageMask;
+				ExpandCharLine(pLineAddr + (x * 8), page.pMemory[pageAddr], g_kColourLUT[page.pHeatmap[pageAddr]], 0xff000000);
 				bankAddr++;
 			}
 
@@ -5,6 +5,8 @@
 #include "SpriteViewer.h"
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <CodeAnalyser/CodeAnalyserTypes.h>
 
@@ -22,6 +24,15 @@ enum class GraphicsViewMode
 	Count
 };
 
+// heatmap colour for each byte of a page, worked out once per frame
+struct FHeatmapPage
+{
+	int			FrameNo = -1;
+	int			Threshold = -1;
+	uint32_t	ChangeCount = 0;
+	std::vector<uint8_t>	Colours;
+};
+
 // Graphics Viewer
 // TODO: Make class
 struct FGraphicsViewerState
@@ -43,6 +54,8 @@ struct FGraphicsViewerState
 	std::string				SelectedSpriteList;
 	std::map<std::string, FUISpriteList>	SpriteLists;
 
+	std::unordered_map<uint32_t, FHeatmapPage>	HeatmapPages;	// keyed by bank id & page no
+
 	// housekeeping
 	FZXGraphicsView*	pGraphicsView = nullptr;
 	FSpectrumEmu*	pEmu = nullptr;
@@ -51,4 +64,5 @@ struct FGraphicsViewerState
 };
 
 bool InitGraphicsViewer(FGraphicsViewerState &state);
+void ShutdownGraphicsViewer(FGraphicsViewerState &state);
 void DrawGraphicsViewer(FGraphicsViewerState &state);
@@ -4,20 +4,38 @@
 #include <imgui.h>
 #include <implot.h>
 
+static const int kFramesPerHistorySample = 50;	// one a second
+static const int kMaxHistorySamples = 600;
+
+static float GetPercent(int count, int total)
+{
+    return total > 0 ? count * 100.0f / total : 0.0f;
+}
+
+static float GetPercentKnown(const FCoverageStats& stats)
+{
+    return GetPercent(stats.GetTotal() - stats.Unknown, stats.GetTotal());
+}
+
 void FOverviewViewer::DrawUI(void)
 {
+    UpdateCoverageHistory();
     DrawStats();
+    DrawBankStats();
 }
 
+// stats come from the counts kept by each page so there's no need to go through every address
 void FOverviewViewer::DrawStats()
 {
+    FCoverageStats stats;
+    GetMappedCoverageStats(pSpectrumEmu->CodeAnalysis, stats);
+
+    const int total = stats.GetTotal();
     static const char* labels1[] = { "Read Only Data","Write Only Data","Read/Write Data","Commented Code","Uncommented Code","Unknown" };
-    float data1[] = {Stats.PercentReadOnlyData,Stats.PercentWriteOnlyData,Stats.PercentReadWriteData, Stats.PercentCommentedCode, Stats.PercentUncommentedCode, Stats.PercentUnknown };
+    float data1[] = { GetPercent(stats.ReadOnlyData, total), GetPercent(stats.WriteOnlyData, total), GetPercent(stats.ReadWriteData, total),
+        GetPercent(stats.CommentedCode, total), GetPercent(stats.UncommentedCode, total), GetPercent(stats.Unknown, total) };
     static ImPlotPieChartFlags flags = 0;// ImPlotPieChartFlags_Normalize;
 
-    //if (pSpectrumEmu->CodeAnalysis.bCodeAnalysisDataDirty)
-        CalculateStats();
-
     if (ImPlot::BeginPlot("##Pie1", ImVec2(400, 400), ImPlotFlags_Equal | ImPlotFlags_NoMouseText)) 
     {
         ImPlot::SetupAxes(NULL, NULL, ImPlotAxisFlags_NoDecorations, ImPlotAxisFlags_NoDecorations);
@@ -29,55 +47,99 @@ void FOverviewViewer::DrawStats()
     //ImPlot::ShowDemoWindow();
 }
 
-void FOverviewViewer::CalculateStats()
+void FOverviewViewer::DrawBankStats()
 {
-    int UnCommentedCodeCount = 0;
-    int CommentedCodeCount = 0;
-    int ReadOnlyDataCount = 0;
-    int WriteOnlyDataCount = 0;
-    int ReadWriteDataCount = 0;
-    int UnknownCount = 0;
-
-    for (int i = 0; i < (1 << 16); i++)
+    FCodeAnalysisState& state = pSpectrumEmu->CodeAnalysis;
+
+    if (ImGui::BeginTable("BankCoverage", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
     {
-        const bool bInRom = i < 0x4000;
-        const FCodeInfo* pCodeInfo = pSpectrumEmu->CodeAnalysis.GetCodeInfoForAddress(i);
-        if (pCodeInfo != nullptr)
+        ImGui::TableSetupColumn("Bank");
+        ImGui::TableSetupColumn("Code");
+        ImGui::TableSetupColumn("Data");
+        ImGui::TableSetupColumn("Unknown");
+        ImGui::TableSetupColumn("Mapped");
+        ImGui::TableHeadersRow();
+
+        for (FCodeAnalysisBank& bank : state.GetBanks())
         {
-            if (pCodeInfo->Comment.empty())
-                UnCommentedCodeCount++;
-            else
-                CommentedCodeCount++;
+            if (bank.bReadOnly)
+                continue;
+
+            FCoverageStats stats;
+            GetBankCoverageStats(bank, stats);
+            const int total = stats.GetTotal();
+
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%s", bank.Name.c_str());
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.1f%%", GetPercent(stats.CommentedCode + stats.UncommentedCode, total));
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.1f%%", GetPercent(stats.ReadOnlyData + stats.WriteOnlyData + stats.ReadWriteData, total));
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.1f%%", GetPercent(stats.Unknown, total));
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%s", bank.IsMapped() ? "Yes" : "No");
         }
-        else
+        ImGui::EndTable();
+    }
+
+    if (HistorySeconds.empty() == false && ImPlot::BeginPlot("Bank Coverage", ImVec2(-1, 300), ImPlotFlags_NoMouseText))
+    {
+        ImPlot::SetupAxes("Seconds", "Known %", ImPlotAxisFlags_AutoFit, 0);
+        ImPlot::SetupAxesLimits(0, 1, 0, 100);
+        for (const FBankCoverageHistory& history : BankHistory)
         {
-            const FDataInfo *pDataInfo = pSpectrumEmu->CodeAnalysis.GetReadDataInfoForAddress(i);
-            const bool bRead = pDataInfo->LastFrameRead != -1;
-            const bool bWrite = pDataInfo->LastFrameWritten != -1;
-
-            if (bInRom)
-            {
-                ReadOnlyDataCount++;
-            }
-            else
-            {
-                if (bRead && !bWrite)
-                    ReadOnlyDataCount++;
-                else if (!bRead && bWrite)
-                    WriteOnlyDataCount++;
-                else if (bRead && bWrite)
-                    ReadWriteDataCount++;
-                else
-                    UnknownCount++;
-            }
+            const FCodeAnalysisBank* pBank = state.GetBank(history.BankId);
+            if (pBank != nullptr)
+                ImPlot::PlotLine(pBank->Name.c_str(), HistorySeconds.data(), history.PercentKnown.data(), (int)HistorySeconds.size());
         }
+        ImPlot::EndPlot();
     }
+}
+
+// sampled while the viewer is drawn
+void FOverviewViewer::UpdateCoverageHistory()
+{
+    FCodeAnalysisState& state = pSpectrumEmu->CodeAnalysis;
+
+    // new game or rewound
+    if (state.CurrentFrameNo < LastHistoryFrameNo)
+    {
+        HistorySeconds.clear();
+        BankHistory.clear();
+        LastHistoryFrameNo = -1;
+    }
+
+    if (LastHistoryFrameNo != -1 && state.CurrentFrameNo - LastHistoryFrameNo < kFramesPerHistorySample)
+        return;
+    LastHistoryFrameNo = state.CurrentFrameNo;
+
+    if ((int)HistorySeconds.size() == kMaxHistorySamples)
+    {
+        HistorySeconds.erase(HistorySeconds.begin());
+        for (FBankCoverageHistory& history : BankHistory)
+            history.PercentKnown.erase(history.PercentKnown.begin());
+    }
+    HistorySeconds.push_back(state.CurrentFrameNo / 50.0f);
+
+    for (FCodeAnalysisBank& bank : state.GetBanks())
+    {
+        if (bank.bReadOnly)
+            continue;
 
-    // Calculate percentages
-    Stats.PercentCommentedCode = CommentedCodeCount * (1.0f / 65536.0f) * 100.0f;
-    Stats.PercentUncommentedCode = UnCommentedCodeCount * (1.0f / 65536.0f) * 100.0f;
-    Stats.PercentReadOnlyData = ReadOnlyDataCount * (1.0f / 65536.0f) * 100.0f;
-    Stats.PercentWriteOnlyData = WriteOnlyDataCount * (1.0f / 65536.0f) * 100.0f;
-    Stats.PercentReadWriteData = ReadWriteDataCount * (1.0f / 65536.0f) * 100.0f;
-    Stats.PercentUnknown = UnknownCount * (1.0f / 65536.0f) * 100.0f;
+        auto historyIt = std::find_if(BankHistory.begin(), BankHistory.end(), [&bank](const FBankCoverageHistory& history) { return history.BankId == bank.Id; });
+        if (historyIt == BankHistory.end())
+        {
+            // bank appeared part way through, start it at the same percentage
+            historyIt = BankHistory.emplace(BankHistory.end());
+            historyIt->BankId = bank.Id;
+        }
+
+        FCoverageStats stats;
+        GetBankCoverageStats(bank, stats);
+        const float percentKnown = GetPercentKnown(stats);
+        historyIt->PercentKnown.resize(HistorySeconds.size() - 1, percentKnown);
+        historyIt->PercentKnown.push_back(percentKnown);
+    }
 }
@@ -2,16 +2,17 @@
 
 #include "ViewerBase.h"
 
+#include <cstdint>
+#include <vector>
+
 class FSpectrumEmu;
+struct FCoverageStats;
 
-struct FOverviewStats
+// percentage of a bank that's known to be code or accessed data, sampled over time
+struct FBankCoverageHistory
 {
-	float PercentReadOnlyData = 0.0f;
-	float PercentReadWriteData = 0.0f;
-	float PercentWriteOnlyData = 0.0f;
-	float PercentCommentedCode = 0.0f;
-	float PercentUncommentedCode = 0.0f;
-	float PercentUnknown = 0.0f;
+	int16_t				BankId = -1;
+	std::vector<float>	PercentKnown;
 };
 
 class FOverviewViewer : public FViewerBase
@@ -23,7 +24,10 @@ public:
 	void	DrawUI(void) override;
 
 	void	DrawStats();
-	void	CalculateStats();
+	void	DrawBankStats();
+	void	UpdateCoverageHistory();
 private:
-	FOverviewStats	Stats;
-};
\ No newline at end of file
+	std::vector<float>					HistorySeconds;	// emulated time of each history sample
+	std::vector<FBankCoverageHistory>	BankHistory;
+	int									LastHistoryFrameNo = -1;
+};
@@ -10,6 +10,7 @@
 #include "../GlobalConfig.h"
 
 #include <Util/Misc.h>
+#include <Util/PaletteConvert.h>
 #include <ImGuiSupport/ImGuiTexture.h>
 
 void DrawArrow(ImDrawList* dl, ImVec2 pos, bool bLeftDirection);
@@ -33,6 +34,14 @@ void FSpectrumViewer::Init(FSpectrumEmu* pEmu)
 	//SetInputEventHandler(this);
 }
 
+void FSpectrumViewer::Shutdown()
+{
+	ImGui_FreeTexture(ScreenTexture);
+	ScreenTexture = nullptr;
+	delete[] FrameBuffer;
+	FrameBuffer = nullptr;
+}
+
 void FSpectrumViewer::Draw()
 {
 	const FGlobalConfig& config = GetGlobalConfig();
@@ -42,13 +51,34 @@ void FSpectrumViewer::Draw()
 
 	chips_display_info_t disp = zx_display_info(&pSpectrumEmu->ZXEmuState);
 
-	// convert texture to RGBA
-	const uint8_t* pix = (const uint8_t*)disp.frame.buffer.ptr;
+	// convert texture to RGBA - from the published frame when there is one
+	const FAnalysisFrameSnapshot* pSnapshot = pSpectrumEmu->GetUISnapshot();
+	const bool bUseSnapshot = pSnapshot != nullptr && pSnapshot->FrameBuffer.size() == disp.frame.buffer.size;
+	const uint8_t* pix = bUseSnapshot ? pSnapshot->FrameBuffer.data() : (const uint8_t*)disp.frame.buffer.ptr;
 	const uint32_t* pal = (const uint32_t*)disp.palette.ptr;
-	for (int i = 0; i < disp.frame.buffer.size; i++)
-		FrameBuffer[i] = pal[pix[i]];
+	const int noPaletteEntries = (int)(disp.palette.size / sizeof(uint32_t));
+	const int lineWidth = disp.frame.dim.width;
+	const int noLines = (int)(disp.frame.buffer.size / lineWidth);
 
-	ImGui_UpdateTextureRGBA(ScreenTexture, FrameBuffer);
+	// only convert the lines that have changed since the last upload
+	const bool bFullUpdate = UploadedFrame.size() != disp.frame.buffer.size;
+	if (bFullUpdate)
+		UploadedFrame.resize(disp.frame.buffer.size);
+
+	bool bTextureChanged = false;
+	for (int line = 0; line < noLines; line++)
+	{
+		const size_t offset = line * lineWidth;
+		if (bFullUpdate == false && memcmp(&UploadedFrame[offset], pix + offset, lineWidth) == 0)
+			continue;
+
+		ConvertPalettedToRGBA(pix + offset, FrameBuffer + offset, lineWidth, pal, noPaletteEntries);
+		memcpy(&UploadedFrame[offset], pix + offset, lineWidth);
+		bTextureChanged = true;
+	}
+
+	if (bTextureChanged)
+		ImGui_UpdateTextureRGBA(ScreenTexture, FrameBuffer);
 
 	const ImVec2 pos = ImGui::GetCursorScreenPos();
 	//ImGui::Text("Instructions this frame: %d \t(max:%d)", instructionsThisFrame,maxInst);
@@ -214,6 +244,9 @@ void FSpectrumViewer::Draw()
 	ImGui::SameLine();
 	if (ImGui::Button("Reset"))
 		pSpectrumEmu->ExecSpeedScale = 1.0f;
+	ImGui::SameLine();
+	ImGui::Checkbox("Turbo", pSpectrumEmu->EmuScheduler.GetTurboPtr());
+	ImGui::Text("Emulation speed x%.1f (%d frames last update)", pSpectrumEmu->EmuScheduler.GetEmulationSpeed(), pSpectrumEmu->EmuScheduler.GetFramesRunLastUpdate());
 	ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 
 	if (pSpectrumEmu->bHasInterruptHandler)
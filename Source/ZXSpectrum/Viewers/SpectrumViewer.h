@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
 #include "imgui.h"
 #include "Misc/InputEventHandler.h"
@@ -16,6 +17,7 @@ public:
 	FSpectrumViewer() {}
 
 	void	Init(FSpectrumEmu* pEmu);
+	void	Shutdown();
 	void	Draw();
 	void	Tick(void);
 
@@ -29,8 +31,9 @@ private:
 private:
 	FSpectrumEmu* pSpectrumEmu = nullptr;
 
-	uint32_t*		FrameBuffer;	// pixel buffer to store emu output
-	ImTextureID		ScreenTexture;		// texture 
+	uint32_t*		FrameBuffer = nullptr;	// pixel buffer to store emu output
+	ImTextureID		ScreenTexture = nullptr;		// texture 
+	std::vector<uint8_t>	UploadedFrame;	// palette indices of what's in the texture, to find the lines that changed
 
 	// screen inspector
 	bool		bScreenCharSelected = false;
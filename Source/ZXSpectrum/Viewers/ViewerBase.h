@@ -9,6 +9,7 @@ class FViewerBase
 	friend class FSpectrumEmu;
 public:
 					FViewerBase(FSpectrumEmu* pEmu) : pSpectrumEmu(pEmu) {}
+	virtual			~FViewerBase() = default;
 	virtual bool	Init() = 0;
 	virtual void	DrawUI() = 0;
 	const char*		GetName() const { return Name.c_str(); }
@@ -100,6 +100,64 @@ uint32_t ZXExeEmu(zx_t* sys, uint32_t micro_seconds)
 	return num_ticks;
 }
 
+// Like ZXExeEmu but analysis is called once per instruction rather than every tick.
+// The ticks the analysis needs are recorded along with the pins before them so edges
+// can be detected exactly as they would be per tick.
+uint32_t ZXExeEmu_InstructionLevel(zx_t* sys, uint32_t micro_seconds, ZXInstructionCB instructionCB, void* pUserData)
+{
+	CHIPS_ASSERT(sys && sys->valid && instructionCB);
+	const uint32_t num_ticks = clk_us_to_ticks(sys->freq_hz, micro_seconds);
+	uint64_t pins = sys->pins;
+	ZXTickRecord records[ZX_MAX_TICK_RECORDS];
+	int noRecords = 0;
+	uint16_t ticksSinceRecord = 0;
+
+	for (uint32_t tick = 0; (tick < num_ticks) && !(*sys->debug.stopped); tick++)
+	{
+		const uint64_t prevPins = pins;
+		pins = _zx_tick(sys, pins);
+		pins = FloatingBusTick(sys, pins);
+		ticksSinceRecord++;
+
+		const bool bOpDone = z80_opdone(&sys->cpu);
+		const bool bNewBusCycle = (pins & (Z80_MREQ | Z80_IORQ)) && ((pins ^ prevPins) & (Z80_CTRL_PIN_MASK | 0xffff));
+		const bool bIntOrNMI = (pins & Z80_INT) || (pins & ~prevPins & Z80_NMI);
+		if (bOpDone || bNewBusCycle || bIntOrNMI)
+		{
+			ZXTickRecord* pRecord = &records[noRecords++];
+			pRecord->Pins = pins;
+			pRecord->PrevPins = prevPins;
+			pRecord->ScanlineY = (uint16_t)sys->scanline_y;
+			pRecord->Ticks = ticksSinceRecord;
+			pRecord->Flags = (bOpDone ? ZX_TICKRECORD_OPDONE : 0) | (sys->cpu.iff1 ? ZX_TICKRECORD_IFF1 : 0);
+			ticksSinceRecord = 0;
+
+			if (bOpDone || noRecords == ZX_MAX_TICK_RECORDS)
+			{
+				instructionCB(records, noRecords, pUserData);
+				noRecords = 0;
+			}
+		}
+	}
+
+	// flush the partial instruction, including any trailing ticks so tick counts stay correct
+	if (ticksSinceRecord > 0)
+	{
+		ZXTickRecord* pRecord = &records[noRecords++];
+		pRecord->Pins = pins;
+		pRecord->PrevPins = pins;
+		pRecord->ScanlineY = (uint16_t)sys->scanline_y;
+		pRecord->Ticks = ticksSinceRecord;
+		pRecord->Flags = sys->cpu.iff1 ? ZX_TICKRECORD_IFF1 : 0;
+	}
+	if (noRecords > 0)
+		instructionCB(records, noRecords, pUserData);
+
+	sys->pins = pins;
+	kbd_update(&sys->kbd, micro_seconds);
+	return num_ticks;
+}
+
 uint32_t clk_ticks_to_us(uint64_t freq_hz, uint32_t ticks) 
 {
 	return (uint32_t)((ticks * 1000000) / freq_hz);
@@ -17,8 +17,27 @@ extern "C" {
 	
 typedef bool(*GetIOInput)(uint16_t port, uint8_t* pInVal, void* pUserData);
 
+// A tick recorded for instruction level analysis.
+// Only ticks that start a memory/IO access, finish an instruction or have INT/NMI active get recorded.
+typedef struct ZXTickRecord
+{
+	uint64_t	Pins;
+	uint64_t	PrevPins;	// pins from the tick before - for edge detection
+	uint16_t	ScanlineY;
+	uint16_t	Ticks;		// ticks since the previous record, including this one
+	uint8_t		Flags;		// ZX_TICKRECORD_ flags
+} ZXTickRecord;
+
+#define ZX_TICKRECORD_OPDONE	(1<<0)	// z80_opdone() was true
+#define ZX_TICKRECORD_IFF1		(1<<1)	// interrupts were enabled
+#define ZX_MAX_TICK_RECORDS		64
+
+// called at the end of each instruction with the ticks recorded for it
+typedef void(*ZXInstructionCB)(const ZXTickRecord* pRecords, int noRecords, void* pUserData);
+
 void ZXDecodeScreen(zx_t* pZX);
 uint32_t ZXExeEmu(zx_t* sys, uint32_t micro_seconds);
+uint32_t ZXExeEmu_InstructionLevel(zx_t* sys, uint32_t micro_seconds, ZXInstructionCB instructionCB, void* pUserData);
 uint32_t ZXExeEmu_UseFetchCount(zx_t* sys, uint32_t noFetches, GetIOInput ioInputCB, void* pUserData);
 
 #ifdef __cplusplus